@@ -0,0 +1,149 @@
+#include "ssd1306_chart.h"
+#include "nordic_common.h"
+
+// Column holds a sample that is not hidden by the gap ahead of the cursor
+static uint8_t ssd1306_ChartHasSample(const SSD1306_CHART *chart, uint8_t col)
+{
+    return col < chart->Filled && (col + chart->Width - chart->Cursor) % chart->Width >= SSD1306_CHART_GAP;
+}
+
+// Screen row of a value, Max on the top row and Min on the bottom one
+static int16_t ssd1306_ChartRow(const SSD1306_CHART *chart, int16_t value)
+{
+    int32_t span = (int32_t)chart->Max - chart->Min;
+    int32_t offset = ((int32_t)value - chart->Min) * (chart->Height - 1);
+
+    offset = (offset + span / 2) / span;
+    offset = MAX(0, MIN(offset, chart->Height - 1));
+    return chart->Y + chart->Height - 1 - offset;
+}
+
+// Draw the sample of a column as a vertical span joining it to the previous
+// sample, also when that one is already hidden by the gap
+static void ssd1306_ChartDrawSample(const SSD1306_CHART *chart, uint8_t col)
+{
+    uint8_t prev = (col + chart->Width - 1) % chart->Width;
+    int16_t y = ssd1306_ChartRow(chart, chart->Samples[col]);
+    int16_t y_prev = y;
+
+    if (prev < chart->Filled)
+    {
+        y_prev = ssd1306_ChartRow(chart, chart->Samples[prev]);
+    }
+    ssd1306_FillRectangle(chart->X + col, y_prev, chart->X + col, y, White);
+}
+
+static void ssd1306_ChartClearColumn(const SSD1306_CHART *chart, uint8_t col)
+{
+    ssd1306_FillRectangle(chart->X + col, chart->Y, chart->X + col, chart->Y + chart->Height - 1, Black);
+}
+
+// Set the range to min..max, at least MinSpan wide and centred on the data
+static void ssd1306_ChartSetRange(SSD1306_CHART *chart, int32_t min, int32_t max)
+{
+    int32_t span = MAX(max - min, chart->MinSpan);
+
+    min = (min + max) / 2 - span / 2;
+    min = MAX(min, INT16_MIN);
+    min = MIN(min, INT16_MAX - span);
+    chart->Min = min;
+    chart->Max = min + span;
+}
+
+// Once per sweep: narrow the range when the data uses less than half of it.
+// The new range leaves the data two thirds of the height, so it is not
+// narrowed again or widened by the next samples.
+static uint8_t ssd1306_ChartShrink(SSD1306_CHART *chart)
+{
+    int32_t min = INT16_MAX;
+    int32_t max = INT16_MIN;
+    int32_t span = (int32_t)chart->Max - chart->Min;
+    uint8_t col;
+
+    if (span <= chart->MinSpan)
+    {
+        return 0;
+    }
+    for (col = 0; col < chart->Filled; col++)
+    {
+        if (ssd1306_ChartHasSample(chart, col))
+        {
+            min = MIN(min, chart->Samples[col]);
+            max = MAX(max, chart->Samples[col]);
+        }
+    }
+    if (min > max || (max - min) * 2 >= span)
+    {
+        return 0;
+    }
+    ssd1306_ChartSetRange(chart, min - (max - min) / 4, max + (max - min) / 4);
+    return 1;
+}
+
+SSD1306_Error_t ssd1306_ChartInit(SSD1306_CHART *chart, int16_t x, int16_t y, uint8_t width, uint8_t height, int16_t min_span)
+{
+    if (width < SSD1306_CHART_GAP + 2 || width > SSD1306_CHART_MAX_WIDTH || height < 2 || min_span <= 0)
+    {
+        return SSD1306_ERR;
+    }
+
+    chart->X = x;
+    chart->Y = y;
+    chart->Width = width;
+    chart->Height = height;
+    chart->MinSpan = min_span;
+    chart->Min = 0;
+    chart->Max = min_span;
+    chart->Cursor = 0;
+    chart->Filled = 0;
+    ssd1306_ChartRedraw(chart);
+    return SSD1306_OK;
+}
+
+void ssd1306_ChartAddSample(SSD1306_CHART *chart, int16_t value)
+{
+    uint8_t col = chart->Cursor;
+    int32_t margin;
+
+    if (chart->Filled == 0)
+    {
+        ssd1306_ChartSetRange(chart, value, value);
+    }
+
+    chart->Samples[col] = value;
+    chart->Cursor = (col + 1) % chart->Width;
+    chart->Filled = MAX(chart->Filled, col + 1);
+
+    // Widen past the new sample by a quarter of the range, so a slow drift
+    // costs one redraw per quarter range instead of one per sample
+    if (value < chart->Min || value > chart->Max)
+    {
+        margin = ((int32_t)MAX(chart->Max, value) - MIN(chart->Min, value)) / 4;
+        ssd1306_ChartSetRange(chart, MIN(chart->Min, value - margin), MAX(chart->Max, value + margin));
+        ssd1306_ChartRedraw(chart);
+        return;
+    }
+    if (chart->Cursor == 0 && ssd1306_ChartShrink(chart))
+    {
+        ssd1306_ChartRedraw(chart);
+        return;
+    }
+
+    ssd1306_ChartClearColumn(chart, col);
+    ssd1306_ChartDrawSample(chart, col);
+    ssd1306_ChartClearColumn(chart, (col + SSD1306_CHART_GAP) % chart->Width);
+}
+
+void ssd1306_ChartRedraw(SSD1306_CHART *chart)
+{
+    uint8_t col;
+
+    ssd1306_FillRectangle(chart->X, chart->Y, chart->X + chart->Width - 1, chart->Y + chart->Height - 1, Black);
+    for (col = 0; col < chart->Filled; col++)
+    {
+        if (ssd1306_ChartHasSample(chart, col))
+        {
+            ssd1306_ChartDrawSample(chart, col);
+        }
+    }
+}
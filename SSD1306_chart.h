@@ -0,0 +1,55 @@
+#ifndef __SSD1306_CHART_H__
+#define __SSD1306_CHART_H__
+
+#include <_ansi.h>
+
+#include "twi_mng_ssd1306.h"
+
+_BEGIN_STD_C
+
+// Widest chart, one sample per column
+#ifndef SSD1306_CHART_MAX_WIDTH
+#define SSD1306_CHART_MAX_WIDTH SSD1306_WIDTH
+#endif
+
+// Blank columns kept ahead of the newest sample
+#ifndef SSD1306_CHART_GAP
+#define SSD1306_CHART_GAP 2
+#endif
+
+// Sweep-mode trend chart. Samples are kept in a ring of columns: each new
+// sample overwrites the oldest column and blanks the gap ahead of it, so
+// adding a sample touches a fixed number of columns whatever the width.
+typedef struct
+{
+    int16_t X;                                // Top left corner of the plot
+    int16_t Y;
+    uint8_t Width;                            // Plot size in pixels
+    uint8_t Height;
+    int16_t Min;                              // Value shown on the bottom row
+    int16_t Max;                              // Value shown on the top row
+    int16_t MinSpan;                          // Smallest Max - Min
+    uint8_t Cursor;                           // Column of the next sample
+    uint8_t Filled;                           // Columns written so far
+    int16_t Samples[SSD1306_CHART_MAX_WIDTH]; // Sample of each column
+} SSD1306_CHART;
+
+/**
+ * @brief Sets up an empty chart and clears its area.
+ * @param[in] min_span smallest range of values spread over the chart height, must be > 0.
+ */
+SSD1306_Error_t ssd1306_ChartInit(SSD1306_CHART *chart, int16_t x, int16_t y, uint8_t width, uint8_t height, int16_t min_span);
+/**
+ * @brief Adds a sample as the newest column.
+ * @note The chart rescales and redraws only when the sample is outside the current
+ *       range, or once per sweep when the data fills less than half the range.
+ */
+void ssd1306_ChartAddSample(SSD1306_CHART *chart, int16_t value);
+/**
+ * @brief Redraws the whole chart area from the stored samples.
+ */
+void ssd1306_ChartRedraw(SSD1306_CHART *chart);
+
+_END_STD_C
+
+#endif // __SSD1306_CHART_H__
@@ -12,6 +12,10 @@
 // The default value is 128.
 #define SSD1306_WIDTH           130
 
+// SH1106 controllers have 132 columns of RAM and their own init commands.
+// With this macro the 128 visible columns start at SSD1306_X_OFFSET, 2 by default.
+// #define SSD1306_CONTROLLER_SH1106
+
 // The height can be changed as well if necessary.
 // It can be 32, 64 or 128. The default value is 64.
 // #define SSD1306_HEIGHT          32
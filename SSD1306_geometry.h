@@ -0,0 +1,139 @@
+#ifndef __SSD1306_GEOMETRY_H__
+#define __SSD1306_GEOMETRY_H__
+
+// Panel geometry. Everything here is derived at compile time from the
+// settings in ssd1306_conf.h, so page loops, strides and the init command
+// stream are constants for the configured panel. Supported panels:
+//  * SSD1306 128x32 and 128x64
+//  * 130x64, SH1106 panels whose first two columns are not visible
+//  * SH1106 132-column RAM with SSD1306_CONTROLLER_SH1106 defined,
+//    128 visible columns from column 2 unless SSD1306_X_OFFSET is set
+
+#include "ssd1306_conf.h"
+
+// SSD1306 OLED height in pixels
+#ifndef SSD1306_HEIGHT
+#define SSD1306_HEIGHT 64
+#endif
+
+// SSD1306 width in pixels
+#ifndef SSD1306_WIDTH
+#define SSD1306_WIDTH 128
+#endif
+
+// First RAM column shown on the panel
+#ifndef SSD1306_X_OFFSET
+#ifdef SSD1306_CONTROLLER_SH1106
+#define SSD1306_X_OFFSET 2
+#else
+#define SSD1306_X_OFFSET 0
+#endif
+#endif
+
+#define SSD1306_X_OFFSET_LOWER (SSD1306_X_OFFSET & 0x0F)
+#define SSD1306_X_OFFSET_UPPER ((SSD1306_X_OFFSET >> 4) & 0x07)
+
+// Columns of display RAM in the controller
+#ifndef SSD1306_RAM_COLUMNS
+#if defined(SSD1306_CONTROLLER_SH1106) || (SSD1306_WIDTH + SSD1306_X_OFFSET > 128)
+#define SSD1306_RAM_COLUMNS 132
+#else
+#define SSD1306_RAM_COLUMNS 128
+#endif
+#endif
+
+#if (SSD1306_WIDTH + SSD1306_X_OFFSET > SSD1306_RAM_COLUMNS)
+#error "SSD1306_WIDTH + SSD1306_X_OFFSET does not fit in the display RAM"
+#endif
+
+// Number of 8-row RAM pages, a power of two
+#if (SSD1306_HEIGHT == 32)
+#define SSD1306_PAGES 4
+#elif (SSD1306_HEIGHT == 64)
+#define SSD1306_PAGES 8
+#elif (SSD1306_HEIGHT == 128)
+#define SSD1306_PAGES 16
+#else
+#error "Only 32, 64, or 128 lines of height are supported!"
+#endif
+#define SSD1306_PAGE_MASK (SSD1306_PAGES - 1)
+
+// The display start line wraps over the 64 rows of display RAM, so the
+// framebuffer scrolls as a ring of pages only when it covers all of them
+#if (SSD1306_HEIGHT == 64)
+#define SSD1306_RING_SCROLL 1
+#else
+#define SSD1306_RING_SCROLL 0
+#endif
+
+#ifndef SSD1306_BUFFER_SIZE
+#define SSD1306_BUFFER_SIZE (SSD1306_WIDTH * SSD1306_PAGES)
+#endif
+
+// Multiplex ratio and COM pins configuration
+#if (SSD1306_HEIGHT == 32)
+#define SSD1306_MUX_COMMAND 0xA8
+#define SSD1306_MUX_RATIO 0x1F
+#define SSD1306_COM_PINS 0x02
+#elif (SSD1306_HEIGHT == 64)
+#define SSD1306_MUX_COMMAND 0xA8
+#define SSD1306_MUX_RATIO 0x3F
+#define SSD1306_COM_PINS 0x12
+#else
+// Found in the Luma Python lib for SH1106, 0x3F seems to work for 128px high displays too.
+#define SSD1306_MUX_COMMAND 0xFF
+#define SSD1306_MUX_RATIO 0x3F
+#define SSD1306_COM_PINS 0x12
+#endif
+
+#ifdef SSD1306_MIRROR_VERT
+#define SSD1306_COM_SCAN 0xC0 // Mirror vertically
+#else
+#define SSD1306_COM_SCAN 0xC8 // Set COM Output Scan Direction
+#endif
+
+#ifdef SSD1306_MIRROR_HORIZ
+#define SSD1306_SEGMENT_REMAP 0xA0 // Mirror horizontally
+#else
+#define SSD1306_SEGMENT_REMAP 0xA1 // Set segment re-map 0 to 127
+#endif
+
+#ifdef SSD1306_INVERSE_COLOR
+#define SSD1306_DISPLAY_MODE 0xA7 // Inverse color
+#else
+#define SSD1306_DISPLAY_MODE 0xA6 // Normal color
+#endif
+
+// The SH1106 has no scroll or addressing mode commands (it always uses page
+// addressing) and enables its DC-DC converter with 0xAD instead of 0x8D
+#ifdef SSD1306_CONTROLLER_SH1106
+#define SSD1306_INIT_ADDRESSING
+#define SSD1306_INIT_CHARGE_PUMP 0xAD, 0x8B
+#else
+#define SSD1306_INIT_ADDRESSING 0x2E, 0x20, 0x02,
+#define SSD1306_INIT_CHARGE_PUMP 0x8D, 0x14
+#endif
+
+// Init command stream for the configured panel
+#define SSD1306_INIT_COMMANDS                                                          \
+    0xAE,                                     /* Display off */                       \
+    SSD1306_INIT_ADDRESSING                   /* Stop scroll, page addressing */      \
+    0xB0,                                     /* Page start address */                \
+    SSD1306_COM_SCAN,                                                                 \
+    SSD1306_X_OFFSET_LOWER,                   /* Low column address */                \
+    0x10 | SSD1306_X_OFFSET_UPPER,            /* High column address */               \
+    0x40,                                     /* Start line address */                \
+    0x81, 0xFF,                               /* Contrast */                          \
+    SSD1306_SEGMENT_REMAP,                                                            \
+    SSD1306_DISPLAY_MODE,                                                             \
+    SSD1306_MUX_COMMAND, SSD1306_MUX_RATIO,                                           \
+    0xA4,                                     /* Output follows RAM content */        \
+    0xD3, 0x00,                               /* Display offset */                    \
+    0xD5, 0xF0,                               /* Clock divide ratio and oscillator */ \
+    0xD9, 0x22,                               /* Pre-charge period */                 \
+    0xDA, SSD1306_COM_PINS,                   /* COM pins hardware configuration */   \
+    0xDB, 0x20,                               /* VCOMH 0.77xVcc */                    \
+    SSD1306_INIT_CHARGE_PUMP,                 /* DC-DC enable */                      \
+    0xAF                                      /* Display on */
+
+#endif // __SSD1306_GEOMETRY_H__
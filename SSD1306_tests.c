@@ -284,6 +284,24 @@ void ssd1306_TestPolyline()
     return;
 }
 
+void ssd1306_TestPolygonFill()
+{
+    SSD1306_VERTEX loc_vertex[] =
+        {
+            {70, 10},
+            {85, 25},
+            {100, 12},
+            {110, 40},
+            {90, 55},
+            {75, 40}};
+
+    ssd1306_FillTriangle(5, 60, 20, 5, 35, 60, White);
+    ssd1306_FillRoundRectangle(40, 10, 65, 55, 6, White);
+    ssd1306_FillPolygon(loc_vertex, sizeof(loc_vertex) / sizeof(loc_vertex[0]), White);
+    ssd1306_UpdateScreen();
+    return;
+}
+
 void ssd1306_TestDrawBitmap()
 {
     ssd1306_Fill(White);
@@ -318,6 +336,9 @@ void ssd1306_TestAll()
     ssd1306_TestPolyline();
     nrf_delay_ms(3000);
     ssd1306_Fill(Black);
+    ssd1306_TestPolygonFill();
+    nrf_delay_ms(3000);
+    ssd1306_Fill(Black);
     ssd1306_TestArc();
     nrf_delay_ms(3000);
     ssd1306_Fill(Black);
@@ -0,0 +1,57 @@
+#include "ssd1306_textfield.h"
+
+// Draw the character of one cell
+static void ssd1306_TextFieldDrawCell(const SSD1306_TEXTFIELD *field, uint8_t cell)
+{
+    ssd1306_SetCursor(field->X + cell * field->Font->FontWidth, field->Y);
+    ssd1306_WriteChar(field->Text[cell], *field->Font, field->Color);
+}
+
+void ssd1306_TextFieldInit(SSD1306_TEXTFIELD *field, int16_t x, int16_t y, const FontDef *Font, SSD1306_COLOR color)
+{
+    field->X = x;
+    field->Y = y;
+    field->Font = Font;
+    field->Color = color;
+    field->Length = 0;
+    field->Text[0] = '\0';
+}
+
+uint8_t ssd1306_TextFieldSet(SSD1306_TEXTFIELD *field, const char *str)
+{
+    uint8_t cell;
+    uint8_t drawn = 0;
+
+    for (cell = 0; cell < SSD1306_TEXTFIELD_MAX_LEN && str[cell] != '\0'; cell++)
+    {
+        if (cell < field->Length && field->Text[cell] == str[cell])
+        {
+            continue;
+        }
+        field->Text[cell] = str[cell];
+        ssd1306_TextFieldDrawCell(field, cell);
+        drawn++;
+    }
+
+    // Blank the cells the shorter text no longer uses
+    if (cell < field->Length)
+    {
+        ssd1306_FillRectangle(field->X + cell * field->Font->FontWidth, field->Y,
+                              field->X + field->Length * field->Font->FontWidth - 1,
+                              field->Y + field->Font->FontHeight - 1, (SSD1306_COLOR)!field->Color);
+    }
+    field->Length = cell;
+    field->Text[cell] = '\0';
+
+    return drawn;
+}
+
+void ssd1306_TextFieldRedraw(SSD1306_TEXTFIELD *field)
+{
+    uint8_t cell;
+
+    for (cell = 0; cell < field->Length; cell++)
+    {
+        ssd1306_TextFieldDrawCell(field, cell);
+    }
+}
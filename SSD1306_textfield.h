@@ -0,0 +1,45 @@
+#ifndef __SSD1306_TEXTFIELD_H__
+#define __SSD1306_TEXTFIELD_H__
+
+#include <_ansi.h>
+
+#include "twi_mng_ssd1306.h"
+
+_BEGIN_STD_C
+
+// Longest text kept by a text field
+#ifndef SSD1306_TEXTFIELD_MAX_LEN
+#define SSD1306_TEXTFIELD_MAX_LEN 21
+#endif
+
+// One line of text that remembers what it shows, so an update
+// rerenders only the glyph cells whose character changed
+typedef struct
+{
+    int16_t X;                                // Top left corner of the first cell
+    int16_t Y;
+    const FontDef *Font;
+    SSD1306_COLOR Color;
+    uint8_t Length;                           // Characters shown
+    char Text[SSD1306_TEXTFIELD_MAX_LEN + 1]; // Characters shown, NUL terminated
+} SSD1306_TEXTFIELD;
+
+/**
+ * @brief Sets up an empty text field, nothing is drawn.
+ */
+void ssd1306_TextFieldInit(SSD1306_TEXTFIELD *field, int16_t x, int16_t y, const FontDef *Font, SSD1306_COLOR color);
+/**
+ * @brief Shows a new text, redrawing only the cells that differ from the previous one.
+ * @param[in] str text, cut to SSD1306_TEXTFIELD_MAX_LEN characters.
+ * @return number of glyph cells redrawn.
+ * @note Moves the cursor set by ssd1306_SetCursor.
+ */
+uint8_t ssd1306_TextFieldSet(SSD1306_TEXTFIELD *field, const char *str);
+/**
+ * @brief Redraws every cell, e.g. after the screen was cleared.
+ */
+void ssd1306_TextFieldRedraw(SSD1306_TEXTFIELD *field);
+
+_END_STD_C
+
+#endif // __SSD1306_TEXTFIELD_H__
@@ -0,0 +1,69 @@
+/*
+ *      adaptive_sampling.c
+ *
+ *	The MIT License.
+ */
+
+#include "adaptive_sampling.h"
+
+static int32_t AdaptiveSampling_Abs(int32_t value)
+{
+  return (value < 0) ? -value : value;
+}
+
+void AdaptiveSampling_Init(ADAPTIVE_SAMPLING *policy, uint32_t min_period, uint32_t max_period, int32_t temperature_band, int32_t humidity_band)
+{
+  policy->MinPeriod = min_period;
+  policy->MaxPeriod = max_period;
+  policy->TemperatureBand = temperature_band;
+  policy->HumidityBand = humidity_band;
+  policy->Period = min_period;
+  policy->LastTemperature = 0;
+  policy->LastHumidity = 0;
+  policy->HasLast = 0;
+}
+
+// Largest change since the last sample relative to its deadband, in
+// thousandths of the band
+static uint32_t AdaptiveSampling_Change(const ADAPTIVE_SAMPLING *policy, int32_t centi_degrees, int32_t humidity)
+{
+  uint32_t temperature_change = (uint32_t)AdaptiveSampling_Abs(centi_degrees - policy->LastTemperature) * 1000 / policy->TemperatureBand;
+  uint32_t humidity_change = (uint32_t)AdaptiveSampling_Abs(humidity - policy->LastHumidity) * 1000 / policy->HumidityBand;
+
+  return (temperature_change > humidity_change) ? temperature_change : humidity_change;
+}
+
+uint32_t AdaptiveSampling_Update(ADAPTIVE_SAMPLING *policy, int32_t centi_degrees, int32_t humidity)
+{
+  uint32_t change;
+
+  if (!policy->HasLast)
+  {
+    // Nothing to compare the first sample with
+    policy->HasLast = 1;
+  }
+  else
+  {
+    change = AdaptiveSampling_Change(policy, centi_degrees, humidity);
+    if (change > 1000)
+    {
+      // At least halve, more for a fast change, so the next one is about half a band
+      policy->Period = (uint32_t)((uint64_t)policy->Period * 500 / change);
+    }
+    else if (change <= 500)
+    {
+      policy->Period *= 2;
+    }
+  }
+  if (policy->Period < policy->MinPeriod)
+  {
+    policy->Period = policy->MinPeriod;
+  }
+  if (policy->Period > policy->MaxPeriod)
+  {
+    policy->Period = policy->MaxPeriod;
+  }
+  policy->LastTemperature = centi_degrees;
+  policy->LastHumidity = humidity;
+  return policy->Period;
+}
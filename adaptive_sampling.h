@@ -0,0 +1,41 @@
+/*
+ *      adaptive_sampling.h
+ *
+ *	The MIT License.
+ */
+
+#ifndef __ADAPTIVE_SAMPLING_H__
+#define __ADAPTIVE_SAMPLING_H__
+
+#include <stdint.h>
+
+// Sampling period driven by the rate of change. A sample that moved more
+// than a deadband from the previous one shortens the period, at least by
+// half and enough for the next move to be about half a band at the same
+// rate. A sample that moved less than half of every deadband doubles it.
+// The period stays within MinPeriod and MaxPeriod, so stable readings are
+// sampled rarely and a change is followed closely until it settles.
+typedef struct
+{
+  uint32_t MinPeriod;         // ms
+  uint32_t MaxPeriod;         // ms
+  int32_t TemperatureBand;    // Deadband in centi-degrees
+  int32_t HumidityBand;       // Deadband in %RH
+  uint32_t Period;            // Current period in ms
+  int32_t LastTemperature;    // Previous sample
+  int32_t LastHumidity;
+  uint8_t HasLast;            // A previous sample exists
+} ADAPTIVE_SAMPLING;
+
+/**
+ * @brief Sets up the policy, starting at the shortest period.
+ * @param temperature_band, humidity_band deadbands, must be > 0.
+ */
+void AdaptiveSampling_Init(ADAPTIVE_SAMPLING *policy, uint32_t min_period, uint32_t max_period, int32_t temperature_band, int32_t humidity_band);
+/**
+ * @brief Takes a new sample into account.
+ * @return period in ms until the next sample.
+ */
+uint32_t AdaptiveSampling_Update(ADAPTIVE_SAMPLING *policy, int32_t centi_degrees, int32_t humidity);
+
+#endif // __ADAPTIVE_SAMPLING_H__
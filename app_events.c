@@ -0,0 +1,62 @@
+/*
+ *      app_events.c
+ *
+ *	The MIT License.
+ */
+
+#include "app_events.h"
+#include "app_scheduler.h"
+#include "app_util_platform.h"
+
+static app_event_handler_t Events_Handlers[EVENT_COUNT];
+// Events queued in the scheduler and not yet handled
+static volatile uint32_t Events_Pending;
+
+// Scheduler handler, runs in the main loop
+static void Events_Execute(void *p_event_data, uint16_t event_size)
+{
+  uint8_t event = *(uint8_t *)p_event_data;
+
+  // Clear first, so a post from an interrupt during the handler queues it again
+  CRITICAL_REGION_ENTER();
+  Events_Pending &= ~(1UL << event);
+  CRITICAL_REGION_EXIT();
+
+  if (Events_Handlers[event] != NULL)
+  {
+    Events_Handlers[event]();
+  }
+}
+
+void Events_Init(void)
+{
+  // Coalescing keeps each event at most once in the queue. The slot of the
+  // event being handled is freed only after its handler returns, and the
+  // event may be posted again meanwhile, so one slot more.
+  APP_SCHED_INIT(sizeof(uint8_t), EVENT_COUNT + 1);
+}
+
+void Events_Subscribe(app_event_t event, app_event_handler_t handler)
+{
+  Events_Handlers[event] = handler;
+}
+
+void Events_Post(app_event_t event)
+{
+  uint8_t data = event;
+  bool queue;
+
+  CRITICAL_REGION_ENTER();
+  queue = (Events_Pending & (1UL << event)) == 0;
+  Events_Pending |= 1UL << event;
+  if (queue)
+  {
+    APP_ERROR_CHECK(app_sched_event_put(&data, sizeof(data), Events_Execute));
+  }
+  CRITICAL_REGION_EXIT();
+}
+
+void Events_Dispatch(void)
+{
+  app_sched_execute();
+}
@@ -0,0 +1,45 @@
+/*
+ *      app_events.h
+ *
+ *	The MIT License.
+ */
+
+#ifndef __APP_EVENTS_H__
+#define __APP_EVENTS_H__
+
+#include "main.h"
+
+// Deferred work posted from interrupt handlers
+typedef enum
+{
+  EVENT_TICK = 0,        // Repeated timer expired
+  EVENT_CLIMATE,         // New temperature and humidity
+  EVENT_DISPLAY_REFRESH, // Frame buffer changed
+  EVENT_BUTTON,          // BUTTON_1 pressed
+  EVENT_SAMPLE,          // Sampling period expired
+  EVENT_COUNT
+} app_event_t;
+
+typedef void (*app_event_handler_t)(void);
+
+/**
+ * @brief Sets up the app_scheduler queue, one slot per event and one for the
+ *        event being handled.
+ */
+void Events_Init(void);
+/**
+ * @brief Sets the main loop handler of an event.
+ */
+void Events_Subscribe(app_event_t event, app_event_handler_t handler);
+/**
+ * @brief Marks an event pending. Safe from any interrupt priority.
+ * @note An event posted again before its handler runs is coalesced,
+ *       the handler runs once.
+ */
+void Events_Post(app_event_t event);
+/**
+ * @brief Runs the handlers of the pending events, call from the main loop.
+ */
+void Events_Dispatch(void);
+
+#endif // __APP_EVENTS_H__
@@ -0,0 +1,45 @@
+/*
+ *      bin_log.c
+ *
+ *	The MIT License.
+ */
+
+#include "bin_log.h"
+#include "SEGGER_RTT.h"
+#include "app_timer.h"
+#include "app_util_platform.h"
+
+static uint8_t BinLog_Buffer[BINLOG_BUFFER_RECORDS * BINLOG_RECORD_SIZE];
+static uint8_t BinLog_Sequence;
+
+void BinLog_Init(void)
+{
+  SEGGER_RTT_ConfigUpBuffer(BINLOG_RTT_CHANNEL, "binlog", BinLog_Buffer, sizeof(BinLog_Buffer), SEGGER_RTT_MODE_NO_BLOCK_SKIP);
+}
+
+void BinLog_Write(BINLOG_FORMAT format, int16_t field0, int16_t field1, int16_t field2, int16_t field3)
+{
+  BINLOG_RECORD record;
+  const uint8_t *bytes = (const uint8_t *)&record;
+  uint8_t check = 0;
+  uint8_t i;
+
+  record.Sync = BINLOG_SYNC;
+  record.Format = format;
+  record.Check = 0;
+  record.Time = app_timer_cnt_get();
+  record.Field[0] = field0;
+  record.Field[1] = field1;
+  record.Field[2] = field2;
+  record.Field[3] = field3;
+
+  CRITICAL_REGION_ENTER();
+  record.Sequence = BinLog_Sequence++;
+  for (i = 0; i < BINLOG_RECORD_SIZE; i++)
+  {
+    check ^= bytes[i];
+  }
+  record.Check = check;
+  SEGGER_RTT_Write(BINLOG_RTT_CHANNEL, &record, sizeof(record));
+  CRITICAL_REGION_EXIT();
+}
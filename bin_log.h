@@ -0,0 +1,54 @@
+/*
+ *      bin_log.h
+ *
+ *	The MIT License.
+ */
+
+#ifndef __BIN_LOG_H__
+#define __BIN_LOG_H__
+
+#include <stdint.h>
+
+#include "bin_log_formats.h"
+
+// RTT up channel of the records, channel 0 stays with NRF_LOG
+#ifndef BINLOG_RTT_CHANNEL
+#define BINLOG_RTT_CHANNEL (1)
+#endif
+
+// RTT buffer, in records
+#ifndef BINLOG_BUFFER_RECORDS
+#define BINLOG_BUFFER_RECORDS (32)
+#endif
+
+typedef enum
+{
+#define BINLOG_ENUM(name, id, text) name = id,
+  BINLOG_FORMATS(BINLOG_ENUM)
+#undef BINLOG_ENUM
+} BINLOG_FORMAT;
+
+typedef struct
+{
+  uint8_t Sync;
+  uint8_t Format;
+  uint8_t Sequence;
+  uint8_t Check;
+  uint32_t Time;
+  int16_t Field[BINLOG_FIELDS];
+} BINLOG_RECORD;
+
+// Written byte for byte, the layout is the wire format of bin_log_formats.h
+_Static_assert(sizeof(BINLOG_RECORD) == BINLOG_RECORD_SIZE, "BINLOG_RECORD is not BINLOG_RECORD_SIZE bytes");
+
+/**
+ * @brief Sets up the RTT channel of the records.
+ */
+void BinLog_Init(void);
+/**
+ * @brief Writes one record with raw fields, formatting is left to the host decoder.
+ * @note Safe from interrupts. A record that does not fit in the RTT buffer is dropped whole.
+ */
+void BinLog_Write(BINLOG_FORMAT format, int16_t field0, int16_t field1, int16_t field2, int16_t field3);
+
+#endif // __BIN_LOG_H__
@@ -0,0 +1,48 @@
+/*
+ *      bin_log_formats.h
+ *
+ *	The MIT License.
+ */
+
+#ifndef __BIN_LOG_FORMATS_H__
+#define __BIN_LOG_FORMATS_H__
+
+// Binary log record, 16 bytes little-endian:
+//   0  Sync      BINLOG_SYNC
+//   1  Format    one of the ids below
+//   2  Sequence  counts records, gaps show records dropped on a full buffer
+//   3  Check     XOR of bytes 0..15 is 0
+//   4  Time      app_timer ticks, 32768 Hz, 24 bits
+//   8  Field[4]  int16 each, meaning per format
+#define BINLOG_SYNC (0xB1)
+#define BINLOG_RECORD_SIZE (16)
+#define BINLOG_FIELDS (4)
+
+// Formats shared with tools/binlog_decode.cpp. Append only and never
+// renumber, so old logs still decode.
+//   CLIMATE   centi-degrees, %RH, next sampling period in 0.1 s, sensor
+//   DATETIME  year, month << 8 | day, hour << 8 | minute, second
+//   SAMPLER   cycle time in ticks, failed sensor mask, samples dropped
+//   TEMPERATURE_MINUTE, _HOUR, HUMIDITY_MINUTE, _HOUR
+//             min, max, mean, standard deviation over the rolling window,
+//             in centi-degrees or %RH
+//   MOISTURE  dew point in centi-degrees, absolute humidity in centi-g/m3
+//             (unsigned), sensor
+//   TWI       health << 8 | device address, NACKs, bus errors, transactions
+//             failed after all retries, counted since start (unsigned).
+//             Health is 0 ok, 1 degraded, 2 quarantined
+//   TWI_SCAN  addresses that answered, scan time in us, parts found as
+//             1 << TWI_SCAN_PART, display address
+#define BINLOG_FORMATS(X)                           \
+  X(BINLOG_CLIMATE, 1, "climate")                   \
+  X(BINLOG_DATETIME, 2, "datetime")                 \
+  X(BINLOG_SAMPLER, 3, "sampler")                   \
+  X(BINLOG_TEMPERATURE_MINUTE, 4, "temp-1m")        \
+  X(BINLOG_TEMPERATURE_HOUR, 5, "temp-1h")          \
+  X(BINLOG_HUMIDITY_MINUTE, 6, "hum-1m")            \
+  X(BINLOG_HUMIDITY_HOUR, 7, "hum-1h")             \
+  X(BINLOG_MOISTURE, 8, "moisture")                 \
+  X(BINLOG_TWI, 9, "twi")                           \
+  X(BINLOG_TWI_SCAN, 10, "twi-scan")
+
+#endif // __BIN_LOG_FORMATS_H__
@@ -0,0 +1,86 @@
+/*
+ *      climate_metrics.c
+ *
+ *	The MIT License.
+ */
+
+#include "climate_metrics.h"
+
+// Constants in 16.16 fixed point
+#define METRICS_ONE ((int32_t)65536)
+#define METRICS_B ((int32_t)1154744)        // 17.62
+#define METRICS_C ((int32_t)15933112)       // 243.12 *C
+#define METRICS_C_CENTI ((int32_t)24312)    // 243.12 *C in centi-degrees
+#define METRICS_LN2 ((int32_t)45426)        // ln 2
+#define METRICS_LOG2E ((int32_t)94548)      // 1 / ln 2
+#define METRICS_KELVIN ((int32_t)17901158)  // 273.15
+// 6.112 hPa * 216.7 g K / (m3 hPa) per 100 %RH, in centi-grams
+#define METRICS_ABSOLUTE_K (132447ULL)
+
+#define METRICS_TABLE_BITS (5)
+#define METRICS_TABLE_SHIFT (16 - METRICS_TABLE_BITS)
+
+// ln(1 + i / 32)
+static const int32_t Metrics_Ln[(1 << METRICS_TABLE_BITS) + 1] = {
+  0, 2017, 3973, 5873, 7719, 9515, 11262, 12965,
+  14624, 16242, 17821, 19364, 20870, 22343, 23783, 25193,
+  26573, 27924, 29248, 30546, 31818, 33067, 34292, 35494,
+  36675, 37835, 38975, 40095, 41196, 42280, 43345, 44394,
+  45426,
+};
+
+// 2^(i / 32)
+static const int32_t Metrics_Exp2[(1 << METRICS_TABLE_BITS) + 1] = {
+  65536, 66971, 68438, 69936, 71468, 73032, 74632, 76266,
+  77936, 79642, 81386, 83169, 84990, 86851, 88752, 90696,
+  92682, 94711, 96785, 98905, 101070, 103283, 105545, 107856,
+  110218, 112631, 115098, 117618, 120194, 122825, 125515, 128263,
+  131072,
+};
+
+// Linear interpolation in a table over [0, 1), fraction in 16.16
+static int32_t Metrics_Lookup(const int32_t *table, uint32_t fraction)
+{
+  uint32_t i = fraction >> METRICS_TABLE_SHIFT;
+  int32_t step = (int32_t)(fraction & ((1 << METRICS_TABLE_SHIFT) - 1));
+
+  return table[i] + (((table[i + 1] - table[i]) * step) >> METRICS_TABLE_SHIFT);
+}
+
+// ln(code / 65536) for a code of 1 to 65535
+static int32_t Metrics_LnRatio(uint32_t code)
+{
+  int32_t shift = 0;
+
+  // Bring the ratio into [1, 2), each doubling takes ln 2 off the result
+  while (code < METRICS_ONE)
+  {
+    code <<= 1;
+    shift++;
+  }
+  return Metrics_Lookup(Metrics_Ln, code - METRICS_ONE) - shift * METRICS_LN2;
+}
+
+void ClimateMetrics_FromRaw(uint16_t temperature_code, uint16_t humidity_code, CLIMATE_METRICS *metrics)
+{
+  // T = code * 165 / 65536 - 40
+  int32_t temperature = (int32_t)temperature_code * 165 - 40 * METRICS_ONE;
+  // b T / (c + T), c + T > 200
+  int32_t magnus = (int32_t)(((int64_t)METRICS_B * temperature) / (METRICS_C + temperature));
+  // gamma = ln(RH / 100%) + b T / (c + T), RH / 100% = code / 65536
+  int32_t gamma = Metrics_LnRatio(humidity_code == 0 ? 1 : humidity_code) + magnus;
+  int64_t denominator = METRICS_B - gamma;
+  int32_t power;
+  uint64_t absolute;
+
+  // Td = c gamma / (b - gamma), gamma < b - 11
+  metrics->DewPoint = (int16_t)(((int64_t)METRICS_C_CENTI * gamma + (gamma >= 0 ? denominator / 2 : -denominator / 2)) / denominator);
+
+  // AH = K RH exp(b T / (c + T)) / (T + 273.15), with exp(x) = 2^(x / ln 2)
+  power = (int32_t)(((int64_t)magnus * METRICS_LOG2E) >> 16);
+  absolute = (uint64_t)humidity_code * (uint32_t)Metrics_Lookup(Metrics_Exp2, power & 0xFFFF) * METRICS_ABSOLUTE_K;
+  absolute = power >= 0 ? absolute << (power >> 16) : absolute >> -(power >> 16);
+  denominator = ((int64_t)(temperature + METRICS_KELVIN)) << 16;
+  absolute = (absolute + denominator / 2) / denominator;
+  metrics->AbsoluteHumidity = absolute > UINT16_MAX ? UINT16_MAX : (uint16_t)absolute;
+}
@@ -0,0 +1,98 @@
+#include "display_power.h"
+#include "nrf_log.h"
+
+// A failed change leaves State as it was, the next tick or wake retries it
+static void DisplayPower_Set(DISPLAY_POWER *power, DISPLAY_POWER_STATE state)
+{
+    SSD1306_t *previous;
+    ret_code_t err_code;
+
+    if (state == power->State)
+    {
+        return;
+    }
+    previous = ssd1306_SelectDisplay(power->Display);
+    switch (state)
+    {
+    case DISPLAY_POWER_ON:
+        err_code = ssd1306_SetContrast(power->Contrast);
+        break;
+    case DISPLAY_POWER_DIM:
+        err_code = ssd1306_SetContrast(power->DimContrast);
+        break;
+    default:
+        err_code = ssd1306_SetDisplayOn(0);
+        break;
+    }
+    if (err_code == NRF_SUCCESS && power->State == DISPLAY_POWER_OFF)
+    {
+        err_code = ssd1306_SetDisplayOn(1);
+    }
+    ssd1306_SelectDisplay(previous);
+    if (err_code != NRF_SUCCESS)
+    {
+        NRF_LOG_WARNING("DisplayPower_Set - %d error: %d", (int)state, (int)err_code);
+        return;
+    }
+    power->State = state;
+
+    if (state != DISPLAY_POWER_OFF)
+    {
+        // Send what was drawn while the panel was off
+        DisplayPower_Refresh(power);
+    }
+}
+
+void DisplayPower_Init(DISPLAY_POWER *power, SSD1306_t *display, uint32_t dim_ticks, uint32_t off_ticks, uint8_t contrast, uint8_t dim_contrast)
+{
+    SSD1306_t *previous;
+
+    power->Display = display;
+    power->DimTicks = dim_ticks;
+    power->OffTicks = off_ticks;
+    power->Contrast = contrast;
+    power->DimContrast = dim_contrast;
+    power->IdleTicks = 0;
+    power->State = DISPLAY_POWER_ON;
+
+    previous = ssd1306_SelectDisplay(display);
+    ssd1306_SetContrast(contrast);
+    ssd1306_SelectDisplay(previous);
+}
+
+void DisplayPower_Tick(DISPLAY_POWER *power)
+{
+    if (power->IdleTicks < UINT32_MAX)
+    {
+        power->IdleTicks++;
+    }
+    if (power->OffTicks != 0 && power->IdleTicks >= power->OffTicks)
+    {
+        DisplayPower_Set(power, DISPLAY_POWER_OFF);
+    }
+    else if (power->DimTicks != 0 && power->IdleTicks >= power->DimTicks)
+    {
+        DisplayPower_Set(power, DISPLAY_POWER_DIM);
+    }
+    else
+    {
+        // Retries a wake that did not reach the panel
+        DisplayPower_Set(power, DISPLAY_POWER_ON);
+    }
+}
+
+void DisplayPower_Wake(DISPLAY_POWER *power)
+{
+    power->IdleTicks = 0;
+    DisplayPower_Set(power, DISPLAY_POWER_ON);
+}
+
+void DisplayPower_Refresh(DISPLAY_POWER *power)
+{
+    SSD1306_t *const displays[] = {power->Display};
+
+    if (power->State != DISPLAY_POWER_OFF)
+    {
+        ssd1306_UpdateDisplays(displays, 1);
+    }
+}
@@ -0,0 +1,53 @@
+#ifndef __DISPLAY_POWER_H__
+#define __DISPLAY_POWER_H__
+
+#include <_ansi.h>
+
+#include "twi_mng_ssd1306.h"
+
+_BEGIN_STD_C
+
+typedef enum
+{
+    DISPLAY_POWER_ON = 0, // Full contrast
+    DISPLAY_POWER_DIM,    // Low contrast after DimTicks without activity
+    DISPLAY_POWER_OFF     // Panel off after OffTicks, flushes held back
+} DISPLAY_POWER_STATE;
+
+// Inactivity manager of one panel. Counts the main loop ticks since the last
+// user activity and steps the panel down to dim and then off. Only the
+// transitions talk to the panel, so a steady state costs no bus traffic.
+typedef struct
+{
+    SSD1306_t *Display;
+    uint32_t DimTicks;           // Ticks without activity before dimming, 0 never
+    uint32_t OffTicks;           // Ticks without activity before turning off, 0 never
+    uint8_t Contrast;            // Contrast when on
+    uint8_t DimContrast;         // Contrast when dimmed
+    uint32_t IdleTicks;          // Ticks since the last activity
+    DISPLAY_POWER_STATE State;
+} DISPLAY_POWER;
+
+/**
+ * @brief Sets up the manager of an initialized display and sets it to full contrast.
+ */
+void DisplayPower_Init(DISPLAY_POWER *power, SSD1306_t *display, uint32_t dim_ticks, uint32_t off_ticks, uint8_t contrast, uint8_t dim_contrast);
+/**
+ * @brief Call once per tick from the main loop, dims or turns off the panel when idle.
+ * @note Retries a change that failed, e.g. while the panel was quarantined.
+ */
+void DisplayPower_Tick(DISPLAY_POWER *power);
+/**
+ * @brief User activity: restores full contrast and turns the panel on.
+ * @note Sends commands with blocking transfers, call from the main loop.
+ */
+void DisplayPower_Wake(DISPLAY_POWER *power);
+/**
+ * @brief Sends the changed parts of the framebuffer unless the panel is off.
+ * @note Changes made while off stay dirty and go out on wake.
+ */
+void DisplayPower_Refresh(DISPLAY_POWER *power);
+
+_END_STD_C
+
+#endif // __DISPLAY_POWER_H__
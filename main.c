@@ -1,14 +1,52 @@
 #include "main.h"
+#include "ssd1306_chart.h"
+#include "ssd1306_textfield.h"
+#include "num_format.h"
+#include "sensor_sampler.h"
+#include "app_events.h"
+#include "display_power.h"
+#include "adaptive_sampling.h"
+#include "bin_log.h"
+#include "sample_ring.h"
+#include "sensor_stats.h"
+#include "climate_metrics.h"
+#include "sample_log.h"
+#include "twi_scan.h"
 
 NRF_TWI_MNGR_DEF(twi_mngr_instance, 50, TWI_INSTANCE_ID);
 APP_TIMER_DEF(m_repeated_timer_id);
+APP_TIMER_DEF(m_sample_timer_id);
 RTCDateTime r;
-volatile float temperature;
-volatile uint8_t humidity;
+static SSD1306_CHART temperature_chart;
+static SSD1306_CHART humidity_chart;
+static SSD1306_TEXTFIELD clock_field;
+static SSD1306_TEXTFIELD climate_field;
+static SSD1306_TEXTFIELD range_field;       // Right aligned, up to "-40.0-125.0C"
+static SSD1306_TEXTFIELD dew_point_field;
+static HDC1080_t climate_sensor;
+static HDC1080_t *const climate_sensors[] = {&climate_sensor};
+static SAMPLER_t climate_sampler;
+static SAMPLE_RING climate_samples;
+static STATS_WINDOW temperature_minute;
+static STATS_WINDOW temperature_hour;
+static STATS_WINDOW humidity_minute;
+static STATS_WINDOW humidity_hour;
+static uint32_t uptime;                     // Seconds since start
+static SAMPLE_LOG sample_log;
+extern uint32_t __start_sample_log;         // Flash region reserved by the linker
+extern uint32_t __stop_sample_log;
+static TWI_BUS twi_bus;
+static TWI_SCAN bus_scan;
+static uint8_t clock_fitted;                // DS1307 found by the bus scan
+static uint8_t display_fitted;              // SSD1306 found by the bus scan
+static uint8_t sensor_fitted;               // HDC1080 found by the bus scan
+static DISPLAY_POWER display_power;
+static ADAPTIVE_SAMPLING sampling_policy;
 
 static void in_pin_handler(nrf_drv_gpiote_pin_t pin, nrf_gpiote_polarity_t action)
 {
   nrf_gpio_pin_toggle(LED_1);
+  Events_Post(EVENT_BUTTON);
 }
 
 static void gpiote_init()
@@ -48,28 +86,302 @@ static void lfclk_request(void)
   nrf_drv_clock_lfclk_request(NULL);
 }
 
-/**@brief Timeout handler for the repeated timer.
+/**@brief Sampling cycle done, runs in the TWI interrupt. Queues the
+ *        readings of the sensors that did not fail.
+ */
+static void climate_sampled(SAMPLER_t *sampler)
+{
+  SAMPLE sample;
+  CLIMATE_METRICS metrics;
+  const HDC1080_t *sensor;
+  uint8_t i;
+
+  sample.Time = app_timer_cnt_get();
+  for (i = 0; i < sampler->Count; i++)
+  {
+    if ((sampler->Failed & (1 << i)) == 0)
+    {
+      sensor = sampler->Sensors[i];
+      ClimateMetrics_FromRaw(sensor->Raw[0] << 8 | sensor->Raw[1], sensor->Raw[2] << 8 | sensor->Raw[3], &metrics);
+      sample.CentiDegrees = (int16_t)(sensor->Temperature * 100);
+      sample.Humidity = sensor->Humidity;
+      sample.Sensor = i;
+      sample.DewPoint = metrics.DewPoint;
+      sample.AbsoluteHumidity = metrics.AbsoluteHumidity;
+      SampleRing_Push(&climate_samples, &sample);
+    }
+  }
+  Events_Post(EVENT_CLIMATE);
+}
+
+/**@brief Timeout handler for the repeated timer, runs in the RTC interrupt.
  */
 static void repeated_timer_handler(void *p_context)
 {
+  Events_Post(EVENT_TICK);
+}
+
+/**@brief Timeout handler for the sampling timer, runs in the RTC interrupt.
+ */
+static void sample_timer_handler(void *p_context)
+{
+  Events_Post(EVENT_SAMPLE);
+}
+
+/**@brief Advances the time by one second.
+ * @return 1 at the start of a minute.
+ */
+static uint8_t clock_advance(RTCDateTime *time)
+{
+  if (++time->Second < 60)
+  {
+    return 0;
+  }
+  time->Second = 0;
+  if (++time->Minute == 60)
+  {
+    time->Minute = 0;
+    time->Hour = (time->Hour + 1) % 24;
+  }
+  return 1;
+}
+
+/**@brief Seconds since 2000-01-01 00:00:00 of a date and time. Before the
+ *        clock has been read, or when it holds no valid date, the uptime,
+ *        so the history stays in order.
+ */
+static uint32_t clock_seconds(const RTCDateTime *time)
+{
+  static const uint16_t month_days[12] = {0, 31, 59, 90, 120, 151, 181, 212, 243, 273, 304, 334};
+  uint32_t years;
+  uint32_t days;
+
+  if (time->Year < 2000 || time->Year > 2099 || time->Month < 1 || time->Month > 12 || time->Day < 1 || time->Day > 31)
+  {
+    return uptime;
+  }
+  years = time->Year - 2000;
+  days = years * 365 + (years + 3) / 4 + month_days[time->Month - 1] + time->Day - 1;
+  if (time->Month > 2 && years % 4 == 0)
+  {
+    days++;
+  }
+  return ((days * 24 + time->Hour) * 60 + time->Minute) * 60 + time->Second;
+}
+
+/**@brief Logs the statistics of a window, when it has samples.
+ */
+static void report_window(BINLOG_FORMAT format, STATS_WINDOW *window)
+{
+  STATS_RESULT result;
+
+  if (Stats_Get(window, uptime, &result))
+  {
+    BinLog_Write(format, result.Min, result.Max, result.Mean, result.StdDev);
+  }
+}
+
+/**@brief Logs the health and error counters of a device, once it has had errors.
+ */
+static void report_device(const TWI_DEVICE *device)
+{
+  if (device->Nacks != 0 || device->BusErrors != 0 || device->Failed != 0 || device->Health.State != TWI_HEALTH_OK)
+  {
+    BinLog_Write(BINLOG_TWI, device->Health.State << 8 | device->Address, (int16_t)device->Nacks, (int16_t)device->BusErrors,
+                 (int16_t)device->Failed);
+  }
+}
+
+/**@brief Logs the statistics of the last minute, and of the last hour on
+ *        the hour, with the TWI error counters, and shows the temperature
+ *        range of the last hour.
+ */
+static void report_stats(void)
+{
+  STATS_RESULT result;
+  char range[16];
+  size_t len;
+
+  report_window(BINLOG_TEMPERATURE_MINUTE, &temperature_minute);
+  report_window(BINLOG_HUMIDITY_MINUTE, &humidity_minute);
+  report_device(&DS1307_GetDefault()->Device);
+  report_device(&ssd1306_GetDisplay()->Device);
+  report_device(&climate_sensor.Device);
+  if (r.Minute == 0)
+  {
+    report_window(BINLOG_TEMPERATURE_HOUR, &temperature_hour);
+    report_window(BINLOG_HUMIDITY_HOUR, &humidity_hour);
+    SampleLog_Flush(&sample_log);
+  }
+  // "21.3-23.4C"
+  if (Stats_Get(&temperature_hour, uptime, &result))
+  {
+    len = fmt_Fixed(range, sizeof(range), result.Min / 10, 1, 0);
+    range[len++] = '-';
+    len += fmt_Fixed(&range[len], sizeof(range) - len, result.Max / 10, 1, 0);
+    range[len++] = 'C';
+    range[len] = '\0';
+    ssd1306_TextFieldSet(&range_field, range);
+  }
+}
+
+/**@brief Shows the time, counted locally and read back from the RTC once a minute.
+ */
+static void tick_handler(void)
+{
+  char s3[9];
+
   // DS1307_GetDateTime(&r);
-  nrf_delay_ms(15);
-  HDC1080_Start();
-  nrf_delay_ms(15);
-  HDC1080_ReceiveData();
-  // hdc1080_start_measurement((float *)&temp, (uint8_t *)&humi);
-  NRF_LOG_INFO("Temp " NRF_LOG_FLOAT_MARKER "*C Humidity %d%%\r\n", NRF_LOG_FLOAT(temperature), humidity);
+  uptime++;
+  if (clock_advance(&r))
+  {
+    if (clock_fitted)
+    {
+      DS1307_ScheduleDateAndTime();
+    }
+    report_stats();
+  }
   nrf_gpio_pin_toggle(LED_1);
-  ssd1306_SetCursor(0, 0);
-  char s3[8];
-  // ssd1306_Fill(Black);
-  DS1307_ScheduleDateAndTime();
-  sprintf(s3, "%02d:%02d:%02d%", r.Hour, r.Minute, r.Second);
-  ssd1306_WriteString(s3, Font_6x8, White);
-  NRF_LOG_INFO("%04d-%02d-%02d %02d:%02d:%02d%", r.Year, r.Month, r.Day, r.Hour, r.Minute, r.Second);
-  // NRF_LOG_INFO("%04d-%02d-%02d %02d:%02d:%02d%", year, month, date, hour, minute, second);
-  // NRF_LOG_FLUSH();
-  ssd1306_UpdateScreen();
+  fmt_Time(s3, sizeof(s3), r.Hour, r.Minute, r.Second);
+  ssd1306_TextFieldSet(&clock_field, s3);
+  BinLog_Write(BINLOG_DATETIME, r.Year, r.Month << 8 | r.Day, r.Hour << 8 | r.Minute, r.Second);
+  if (display_fitted)
+  {
+    DisplayPower_Tick(&display_power);
+  }
+  Events_Post(EVENT_DISPLAY_REFRESH);
+}
+
+/**@brief Starts the measurements.
+ */
+static void sample_handler(void)
+{
+  Sampler_Start(&climate_sampler);
+}
+
+/**@brief Sampling policy consumer: sets the period from each sample in turn.
+ */
+static void pace_samples(const SAMPLE *samples, uint32_t count)
+{
+  uint32_t i;
+
+  for (i = 0; i < count; i++)
+  {
+    AdaptiveSampling_Update(&sampling_policy, samples[i].CentiDegrees, samples[i].Humidity);
+  }
+}
+
+/**@brief Storage consumer: keeps the history in flash, stamped with the clock.
+ *        Batches are written when full and on the hour.
+ */
+static void store_samples(const SAMPLE *samples, uint32_t count)
+{
+  SAMPLE sample;
+  uint32_t i;
+
+  for (i = 0; i < count; i++)
+  {
+    sample = samples[i];
+    sample.Time = clock_seconds(&r);
+    SampleLog_Add(&sample_log, &sample);
+  }
+}
+
+/**@brief Logging consumer: one record per sample, with the period it led to.
+ */
+static void log_samples(const SAMPLE *samples, uint32_t count)
+{
+  uint32_t i;
+
+  for (i = 0; i < count; i++)
+  {
+    BinLog_Write(BINLOG_CLIMATE, samples[i].CentiDegrees, samples[i].Humidity, (int16_t)(sampling_policy.Period / 100), samples[i].Sensor);
+    BinLog_Write(BINLOG_MOISTURE, samples[i].DewPoint, (int16_t)samples[i].AbsoluteHumidity, samples[i].Sensor, 0);
+  }
+}
+
+/**@brief Aggregation consumer: adds each sample to the minute and hour windows.
+ */
+static void aggregate_samples(const SAMPLE *samples, uint32_t count)
+{
+  uint32_t i;
+
+  for (i = 0; i < count; i++)
+  {
+    Stats_Add(&temperature_minute, uptime, samples[i].CentiDegrees);
+    Stats_Add(&temperature_hour, uptime, samples[i].CentiDegrees);
+    Stats_Add(&humidity_minute, uptime, samples[i].Humidity);
+    Stats_Add(&humidity_hour, uptime, samples[i].Humidity);
+  }
+}
+
+/**@brief Display consumer: charts every sample and shows the newest one.
+ */
+static void show_samples(const SAMPLE *samples, uint32_t count)
+{
+  char climate[16];
+  size_t len;
+  uint32_t i;
+
+  for (i = 0; i < count; i++)
+  {
+    ssd1306_ChartAddSample(&temperature_chart, samples[i].CentiDegrees / 10);
+    ssd1306_ChartAddSample(&humidity_chart, samples[i].Humidity);
+  }
+  // " 23.45C  45%"
+  len = fmt_Fixed(climate, sizeof(climate), samples[count - 1].CentiDegrees, 2, 6);
+  climate[len++] = 'C';
+  len += fmt_Uint(&climate[len], sizeof(climate) - len, samples[count - 1].Humidity, 4, ' ');
+  climate[len++] = '%';
+  climate[len] = '\0';
+  ssd1306_TextFieldSet(&climate_field, climate);
+  // "Td 12.3C"
+  memcpy(climate, "Td", 2);
+  len = 2 + fmt_Fixed(&climate[2], sizeof(climate) - 2, samples[count - 1].DewPoint / 10, 1, 5);
+  climate[len++] = 'C';
+  climate[len] = '\0';
+  ssd1306_TextFieldSet(&dew_point_field, climate);
+  Events_Post(EVENT_DISPLAY_REFRESH);
+}
+
+/**@brief Hands the queued samples to the consumers in batches and sets the
+ *        time of the next sampling cycle from their rate of change.
+ */
+static void climate_handler(void)
+{
+  const SAMPLE *samples;
+  uint32_t count;
+
+  BinLog_Write(BINLOG_SAMPLER, (int16_t)climate_sampler.CycleTicks, climate_sampler.Failed, (int16_t)climate_samples.Dropped, 0);
+  while ((count = SampleRing_Peek(&climate_samples, &samples)) > 0)
+  {
+    pace_samples(samples, count);
+    log_samples(samples, count);
+    aggregate_samples(samples, count);
+    store_samples(samples, count);
+    show_samples(samples, count);
+    SampleRing_Release(&climate_samples, count);
+  }
+  if (climate_sampler.Failed != 0)
+  {
+    APP_ERROR_CHECK(app_timer_start(m_sample_timer_id, APP_TIMER_TICKS(sampling_policy.MinPeriod), NULL));
+    return;
+  }
+  APP_ERROR_CHECK(app_timer_start(m_sample_timer_id, APP_TIMER_TICKS(sampling_policy.Period), NULL));
+}
+
+/**@brief Sends the changed parts of the frame buffer, once for any number of changes.
+ */
+static void display_refresh_handler(void)
+{
+  DisplayPower_Refresh(&display_power);
+}
+
+/**@brief Wakes the display.
+ */
+static void button_handler(void)
+{
+  DisplayPower_Wake(&display_power);
 }
 
 /**@brief Create timers.
@@ -83,6 +395,10 @@ static void create_timers()
                               APP_TIMER_MODE_REPEATED,
                               repeated_timer_handler);
   APP_ERROR_CHECK(err_code);
+  err_code = app_timer_create(&m_sample_timer_id,
+                              APP_TIMER_MODE_SINGLE_SHOT,
+                              sample_timer_handler);
+  APP_ERROR_CHECK(err_code);
 }
 
 void twi_manager_init()
@@ -93,9 +409,37 @@ void twi_manager_init()
   i2c_config.sda = SDA_PIN_NUMBER;
   i2c_config.frequency = TWIM_FREQUENCY_FREQUENCY_K400;
   i2c_config.interrupt_priority = 6;
+  TwiRecovery_InitBus(&twi_bus, &twi_mngr_instance, SCL_PIN_NUMBER, SDA_PIN_NUMBER);
   APP_ERROR_CHECK(nrf_twi_mngr_init(&twi_mngr_instance, &i2c_config));
 }
 
+/**@brief Finds out which parts are fitted, waiting for the scan in sleep.
+ */
+static void scan_bus(void)
+{
+  uint8_t parts = 0;
+  uint8_t part;
+
+  APP_ERROR_CHECK(TwiScan_Start(&bus_scan, &twi_mngr_instance, NULL));
+  while (bus_scan.Busy)
+  {
+    nrf_pwr_mgmt_run();
+  }
+  for (part = TWI_SCAN_UNKNOWN; part <= TWI_SCAN_HDC1080; part++)
+  {
+    if (TwiScan_Find(&bus_scan, (TWI_SCAN_PART)part) != 0)
+    {
+      parts |= 1 << part;
+    }
+  }
+  clock_fitted = (parts & 1 << TWI_SCAN_DS1307) != 0;
+  display_fitted = (parts & 1 << TWI_SCAN_SSD1306) != 0;
+  sensor_fitted = (parts & 1 << TWI_SCAN_HDC1080) != 0;
+  NRF_LOG_INFO("TWI scan: %d devices in %d us, parts 0x%02x", bus_scan.Found, bus_scan.Duration, parts);
+  BinLog_Write(BINLOG_TWI_SCAN, bus_scan.Found, bus_scan.Duration < INT16_MAX ? (int16_t)bus_scan.Duration : INT16_MAX, parts,
+               TwiScan_Find(&bus_scan, TWI_SCAN_SSD1306));
+}
+
 int main(void)
 {
   ret_code_t err_code;
@@ -108,21 +452,71 @@ int main(void)
   NRF_LOG_DEFAULT_BACKENDS_INIT();
   NRF_LOG_INFO("Log initialized\n");
   NRF_LOG_FLUSH();
+  BinLog_Init();
   err_code = nrf_pwr_mgmt_init();
   APP_ERROR_CHECK(err_code);
   twi_manager_init();
+  lfclk_request();
+  app_timer_init();
 
+  // Let the parts power up, the HDC1080 takes 15 ms, then see which are fitted
+  nrf_delay_ms(50);
+  scan_bus();
   // i2c_manager = &twi_mngr_instance;
-  DS1307_Init(&twi_mngr_instance, &r);
+  if (clock_fitted)
+  {
+    DS1307_Init(&twi_mngr_instance, &r);
+  }
   // set_output(sideA);
   // set_input(DS1307_REG_SECOND);
-  nrf_delay_ms(50);
   gpiote_init();
-  lfclk_request();
-  app_timer_init();
-  ssd1306_TWI_Init(&twi_mngr_instance);
-  hdc1080_init(&twi_mngr_instance, Temperature_Resolution_14_bit, Humidity_Resolution_14_bit, &temperature, &humidity);
+  Events_Init();
+  Events_Subscribe(EVENT_TICK, tick_handler);
+  Events_Subscribe(EVENT_CLIMATE, climate_handler);
+  Events_Subscribe(EVENT_SAMPLE, sample_handler);
+  // Temperature in 0.1 *C, at least 1 *C over the chart height
+  ssd1306_ChartInit(&temperature_chart, 0, 16, SSD1306_WIDTH, 24, 10);
+  ssd1306_ChartInit(&humidity_chart, 0, 40, SSD1306_WIDTH, 24, 5);
+  ssd1306_TextFieldInit(&clock_field, 0, 0, &Font_6x8, White);
+  ssd1306_TextFieldInit(&climate_field, 0, 8, &Font_6x8, White);
+  ssd1306_TextFieldInit(&range_field, SSD1306_WIDTH - 12 * Font_6x8.FontWidth, 0, &Font_6x8, White);
+  ssd1306_TextFieldInit(&dew_point_field, 80, 8, &Font_6x8, White);
+  if (sensor_fitted)
+  {
+    HDC1080_InitDevice(&climate_sensor, &twi_mngr_instance, Temperature_Resolution_14_bit, Humidity_Resolution_14_bit, NULL);
+  }
   create_timers();
+  SampleRing_Init(&climate_samples);
+  // Rolling minute in 1 s buckets and rolling hour in 1 min buckets
+  Stats_Init(&temperature_minute, 60, 1);
+  Stats_Init(&temperature_hour, 60, 60);
+  Stats_Init(&humidity_minute, 60, 1);
+  Stats_Init(&humidity_hour, 60, 60);
+  APP_ERROR_CHECK(SampleLog_Init(&sample_log, (uint32_t)&__start_sample_log,
+                                 (uint32_t)&__stop_sample_log - (uint32_t)&__start_sample_log));
+  if (sensor_fitted)
+  {
+    APP_ERROR_CHECK(Sampler_Init(&climate_sampler, climate_sensors, ARRAY_SIZE(climate_sensors), climate_sampled));
+  }
+  // Last, so the start up above counts towards the time the screen needs to boot
+  if (display_fitted)
+  {
+    ssd1306_InitDisplay(ssd1306_GetDisplay(), &twi_mngr_instance, TwiScan_Find(&bus_scan, TWI_SCAN_SSD1306));
+    // Dim after 30 s and turn off after 2 min without a button press
+    DisplayPower_Init(&display_power, ssd1306_GetDisplay(), 30, 120, 0xFF, 0x10);
+    Events_Subscribe(EVENT_DISPLAY_REFRESH, display_refresh_handler);
+    Events_Subscribe(EVENT_BUTTON, button_handler);
+  }
+  // Sample every 1 s to 60 s, deadbands 0.1 *C and 2 %RH
+  AdaptiveSampling_Init(&sampling_policy, 1000, 60000, 10, 2);
+  if (clock_fitted)
+  {
+    DS1307_ScheduleDateAndTime();
+  }
+  if (sensor_fitted)
+  {
+    Events_Post(EVENT_SAMPLE);
+  }
   err_code = app_timer_start(m_repeated_timer_id, APP_TIMER_TICKS(1000), NULL);
   // APP_ERROR_CHECK(err_code);
   // ssd1306_TWI_Init(&twi_mngr_instance);
@@ -168,6 +562,7 @@ int main(void)
     // ssd1306_WriteString(s3, Font_6x8, White);
     // NRF_LOG_INFO("%04d-%02d-%02d %02d:%02d:%02d%", r.Year, r.Month, r.Day, r.Hour, r.Minute, r.Second);
     // NRF_LOG_INFO("%04d-%02d-%02d %02d:%02d:%02d%", year, month, date, hour, minute, second);
+    Events_Dispatch();
     NRF_LOG_FLUSH();
     // ssd1306_UpdateScreen();
     nrf_pwr_mgmt_run();
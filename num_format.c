@@ -0,0 +1,156 @@
+#include "num_format.h"
+
+// Longest int32 with sign, point and 9 decimals
+#define FMT_MAX_NUMBER 22
+
+static const uint32_t fmt_Pow10[10] = {1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000};
+
+// Write the digits of value backwards from end, at least min_digits of them.
+// Returns the first character written.
+static char *fmt_Reverse(char *end, uint32_t value, uint8_t min_digits)
+{
+    do
+    {
+        *--end = '0' + value % 10;
+        value /= 10;
+        if (min_digits > 0)
+        {
+            min_digits--;
+        }
+    } while (value != 0 || min_digits > 0);
+    return end;
+}
+
+// Copy len characters right aligned in width, padded with pad
+static size_t fmt_Output(char *buf, size_t cap, const char *text, size_t len, uint8_t width, char pad)
+{
+    size_t total = (len < width) ? width : len;
+    size_t i;
+
+    if (cap == 0)
+    {
+        return 0;
+    }
+    if (total + 1 > cap)
+    {
+        buf[0] = '\0';
+        return 0;
+    }
+    for (i = 0; i < total - len; i++)
+    {
+        buf[i] = pad;
+    }
+    for (; i < total; i++)
+    {
+        buf[i] = *text++;
+    }
+    buf[total] = '\0';
+    return total;
+}
+
+// Two digits of a time or date field
+static char *fmt_TwoDigits(char *p, uint8_t value)
+{
+    *p++ = '0' + value / 10 % 10;
+    *p++ = '0' + value % 10;
+    return p;
+}
+
+size_t fmt_Uint(char *buf, size_t cap, uint32_t value, uint8_t width, char pad)
+{
+    char tmp[FMT_MAX_NUMBER];
+    char *end = &tmp[FMT_MAX_NUMBER];
+    char *start = fmt_Reverse(end, value, 1);
+
+    return fmt_Output(buf, cap, start, end - start, width, pad);
+}
+
+size_t fmt_Int(char *buf, size_t cap, int32_t value, uint8_t width, char pad)
+{
+    char tmp[FMT_MAX_NUMBER];
+    char *end = &tmp[FMT_MAX_NUMBER];
+    uint32_t magnitude = (value < 0) ? 0u - (uint32_t)value : (uint32_t)value;
+    char *start = fmt_Reverse(end, magnitude, 1);
+    size_t len;
+
+    // Zeros go between the sign and the digits, padded within cap
+    if (value < 0 && pad == '0' && width > 1)
+    {
+        if (cap < 2)
+        {
+            if (cap != 0)
+            {
+                buf[0] = '\0';
+            }
+            return 0;
+        }
+        len = fmt_Output(&buf[1], cap - 1, start, end - start, width - 1, '0');
+        if (len == 0)
+        {
+            buf[0] = '\0';
+            return 0;
+        }
+        buf[0] = '-';
+        return len + 1;
+    }
+    if (value < 0)
+    {
+        *--start = '-';
+    }
+    return fmt_Output(buf, cap, start, end - start, width, pad);
+}
+
+size_t fmt_Fixed(char *buf, size_t cap, int32_t value, uint8_t decimals, uint8_t width)
+{
+    char tmp[FMT_MAX_NUMBER];
+    char *end = &tmp[FMT_MAX_NUMBER];
+    uint32_t magnitude = (value < 0) ? 0u - (uint32_t)value : (uint32_t)value;
+    char *start;
+
+    if (decimals > 9)
+    {
+        decimals = 9;
+    }
+    if (decimals == 0)
+    {
+        start = fmt_Reverse(end, magnitude, 1);
+    }
+    else
+    {
+        start = fmt_Reverse(end, magnitude % fmt_Pow10[decimals], decimals);
+        *--start = '.';
+        start = fmt_Reverse(start, magnitude / fmt_Pow10[decimals], 1);
+    }
+    if (value < 0)
+    {
+        *--start = '-';
+    }
+    return fmt_Output(buf, cap, start, end - start, width, ' ');
+}
+
+size_t fmt_Time(char *buf, size_t cap, uint8_t hour, uint8_t minute, uint8_t second)
+{
+    char tmp[8];
+    char *p = tmp;
+
+    p = fmt_TwoDigits(p, hour);
+    *p++ = ':';
+    p = fmt_TwoDigits(p, minute);
+    *p++ = ':';
+    p = fmt_TwoDigits(p, second);
+    return fmt_Output(buf, cap, tmp, sizeof(tmp), 0, ' ');
+}
+
+size_t fmt_Date(char *buf, size_t cap, uint16_t year, uint8_t month, uint8_t day)
+{
+    char tmp[10];
+    char *p = tmp;
+
+    fmt_Reverse(&tmp[4], year % 10000, 4);
+    p += 4;
+    *p++ = '-';
+    p = fmt_TwoDigits(p, month);
+    *p++ = '-';
+    p = fmt_TwoDigits(p, day);
+    return fmt_Output(buf, cap, tmp, sizeof(tmp), 0, ' ');
+}
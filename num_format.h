@@ -0,0 +1,42 @@
+#ifndef __NUM_FORMAT_H__
+#define __NUM_FORMAT_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <_ansi.h>
+
+_BEGIN_STD_C
+
+// All formatters write into buf, NUL terminated, and return the number of
+// characters written. When the text and its NUL do not fit in cap bytes,
+// they write an empty string and return 0. They keep no state, so they can
+// be called from interrupt handlers.
+
+/**
+ * @brief Formats an unsigned decimal number.
+ * @param[in] width smallest number of characters, right aligned.
+ * @param[in] pad '0' or ' ' written in front of the digits up to width.
+ */
+size_t fmt_Uint(char *buf, size_t cap, uint32_t value, uint8_t width, char pad);
+/**
+ * @brief Formats a signed decimal number, zero padding goes after the sign.
+ */
+size_t fmt_Int(char *buf, size_t cap, int32_t value, uint8_t width, char pad);
+/**
+ * @brief Formats a fixed-point number, e.g. centi-degrees 2345 with 2 decimals as "23.45".
+ * @param[in] decimals digits after the point, 0 to 9.
+ * @param[in] width smallest number of characters, right aligned with spaces.
+ */
+size_t fmt_Fixed(char *buf, size_t cap, int32_t value, uint8_t decimals, uint8_t width);
+/**
+ * @brief Formats a time as "HH:MM:SS".
+ */
+size_t fmt_Time(char *buf, size_t cap, uint8_t hour, uint8_t minute, uint8_t second);
+/**
+ * @brief Formats a date as "YYYY-MM-DD".
+ */
+size_t fmt_Date(char *buf, size_t cap, uint16_t year, uint8_t month, uint8_t day);
+
+_END_STD_C
+
+#endif // __NUM_FORMAT_H__
@@ -0,0 +1,60 @@
+/*
+ *      pt.h
+ *
+ *	The MIT License.
+ */
+
+#ifndef __PT_H__
+#define __PT_H__
+
+#include <stdint.h>
+
+// Stackless coroutines (protothreads). A thread is a function that returns
+// a PT_STATUS and keeps its resume point in a pt_t. It is written as
+// straight-line code between PT_BEGIN and PT_END; PT_WAIT_UNTIL returns to
+// the caller and the next call continues after it.
+// Limits: locals do not survive a wait, keep state in the thread's struct,
+// and the thread body cannot contain a switch statement of its own.
+
+typedef struct
+{
+  uint16_t lc; // Line to resume at, 0 at the start
+} pt_t;
+
+typedef enum
+{
+  PT_WAITING = 0,
+  PT_ENDED
+} PT_STATUS;
+
+#define PT_INIT(pt) ((pt)->lc = 0)
+
+#define PT_BEGIN(pt)  \
+  switch ((pt)->lc)   \
+  {                   \
+  case 0:
+
+#define PT_END(pt)    \
+  }                   \
+  (pt)->lc = 0;       \
+  return PT_ENDED
+
+#define PT_WAIT_UNTIL(pt, condition) \
+  do                                 \
+  {                                  \
+    (pt)->lc = __LINE__;             \
+  case __LINE__:                     \
+    if (!(condition))                \
+    {                                \
+      return PT_WAITING;             \
+    }                                \
+  } while (0)
+
+#define PT_EXIT(pt)   \
+  do                  \
+  {                   \
+    (pt)->lc = 0;     \
+    return PT_ENDED;  \
+  } while (0)
+
+#endif // __PT_H__
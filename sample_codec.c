@@ -0,0 +1,162 @@
+/*
+ *      sample_codec.c
+ *
+ *	The MIT License.
+ */
+
+#include "sample_codec.h"
+#include <string.h>
+
+// Fields of a sample, in stream order
+enum
+{
+  CODEC_TEMPERATURE,
+  CODEC_TIME,
+  CODEC_HUMIDITY,
+};
+
+// Flags in the low bits of the temperature varint
+#define CODEC_KEYFRAME (1)
+#define CODEC_REPEAT (2)
+
+static uint32_t Codec_ZigZag(int32_t value)
+{
+  return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+}
+
+static int32_t Codec_UnZigZag(uint32_t value)
+{
+  return (int32_t)(value >> 1) ^ -(int32_t)(value & 1);
+}
+
+static uint8_t Codec_PutVarint(uint8_t *out, uint32_t value)
+{
+  uint8_t length = 0;
+
+  while (value >= 0x80)
+  {
+    out[length++] = (uint8_t)value | 0x80;
+    value >>= 7;
+  }
+  out[length++] = (uint8_t)value;
+  return length;
+}
+
+void SampleEncoder_Init(SAMPLE_ENCODER *encoder, uint8_t *buffer, uint16_t size)
+{
+  encoder->Buffer = buffer;
+  encoder->Size = size;
+  encoder->Length = 0;
+  encoder->Since = SAMPLE_CODEC_KEYFRAME_INTERVAL;
+}
+
+uint8_t SampleEncoder_Add(SAMPLE_ENCODER *encoder, const SAMPLE *sample)
+{
+  uint8_t record[SAMPLE_CODEC_MAX_RECORD];
+  uint8_t length;
+  uint8_t keyframe = encoder->Length == 0 || encoder->Since >= SAMPLE_CODEC_KEYFRAME_INTERVAL;
+  uint32_t interval = sample->Time - encoder->Last.Time;
+
+  if (keyframe)
+  {
+    interval = 0;
+    length = Codec_PutVarint(record, Codec_ZigZag(sample->CentiDegrees) << 2 | CODEC_KEYFRAME);
+    length += Codec_PutVarint(&record[length], sample->Time);
+    length += Codec_PutVarint(&record[length], sample->Humidity);
+  }
+  else if (interval == encoder->Interval && sample->Humidity == encoder->Last.Humidity)
+  {
+    length = Codec_PutVarint(record, Codec_ZigZag(sample->CentiDegrees - encoder->Last.CentiDegrees) << 2 | CODEC_REPEAT);
+  }
+  else
+  {
+    length = Codec_PutVarint(record, Codec_ZigZag(sample->CentiDegrees - encoder->Last.CentiDegrees) << 2);
+    length += Codec_PutVarint(&record[length], interval);
+    length += Codec_PutVarint(&record[length], Codec_ZigZag(sample->Humidity - encoder->Last.Humidity));
+  }
+  if (length > encoder->Size - encoder->Length)
+  {
+    return 0;
+  }
+  memcpy(&encoder->Buffer[encoder->Length], record, length);
+  encoder->Length += length;
+  encoder->Since = keyframe ? 1 : encoder->Since + 1;
+  encoder->Interval = interval;
+  encoder->Last = *sample;
+  return 1;
+}
+
+void SampleDecoder_Init(SAMPLE_DECODER *decoder)
+{
+  memset(decoder, 0, sizeof(*decoder));
+}
+
+uint8_t SampleDecoder_Push(SAMPLE_DECODER *decoder, uint8_t byte, SAMPLE *sample)
+{
+  uint32_t value;
+
+  if (decoder->Shift > 28 || (decoder->Shift == 28 && (byte & 0x70) != 0))
+  {
+    // More than 32 bits, drop the sample and resync on a keyframe
+    decoder->Synced = 0;
+    decoder->Value = 0;
+    decoder->Shift = 0;
+    decoder->Field = CODEC_TEMPERATURE;
+    return 0;
+  }
+  decoder->Value |= (uint32_t)(byte & 0x7F) << decoder->Shift;
+  if (byte & 0x80)
+  {
+    decoder->Shift += 7;
+    return 0;
+  }
+  value = decoder->Value;
+  decoder->Value = 0;
+  decoder->Shift = 0;
+
+  switch (decoder->Field)
+  {
+  case CODEC_TEMPERATURE:
+    decoder->Flags = value & (CODEC_KEYFRAME | CODEC_REPEAT);
+    decoder->Next.CentiDegrees = (int16_t)Codec_UnZigZag(value >> 2);
+    if (decoder->Flags & CODEC_REPEAT)
+    {
+      decoder->Next.Time = decoder->Interval;
+      decoder->Next.Humidity = 0;
+      break;
+    }
+    decoder->Field = CODEC_TIME;
+    return 0;
+  case CODEC_TIME:
+    decoder->Next.Time = value;
+    decoder->Field = CODEC_HUMIDITY;
+    return 0;
+  default:
+    decoder->Next.Humidity = (uint8_t)(decoder->Flags & CODEC_KEYFRAME ? value : (uint32_t)Codec_UnZigZag(value));
+    decoder->Field = CODEC_TEMPERATURE;
+    break;
+  }
+
+  if (decoder->Flags & CODEC_KEYFRAME)
+  {
+    decoder->Interval = 0;
+  }
+  else
+  {
+    if (!decoder->Synced)
+    {
+      return 0;
+    }
+    decoder->Interval = decoder->Next.Time;
+    decoder->Next.CentiDegrees += decoder->Last.CentiDegrees;
+    decoder->Next.Time += decoder->Last.Time;
+    decoder->Next.Humidity += decoder->Last.Humidity;
+  }
+  decoder->Synced = 1;
+  decoder->Last = decoder->Next;
+  memset(sample, 0, sizeof(*sample));
+  sample->Time = decoder->Next.Time;
+  sample->CentiDegrees = decoder->Next.CentiDegrees;
+  sample->Humidity = decoder->Next.Humidity;
+  return 1;
+}
@@ -0,0 +1,79 @@
+/*
+ *      sample_codec.h
+ *
+ *	The MIT License.
+ */
+
+#ifndef __SAMPLE_CODEC_H__
+#define __SAMPLE_CODEC_H__
+
+#include <stdint.h>
+
+#include "sample_ring.h"
+
+// Samples between two keyframes, a keyframe also starts every buffer
+#ifndef SAMPLE_CODEC_KEYFRAME_INTERVAL
+#define SAMPLE_CODEC_KEYFRAME_INTERVAL (32)
+#endif
+
+// Longest encoded sample in bytes
+#define SAMPLE_CODEC_MAX_RECORD (10)
+
+// Compact history of Time, CentiDegrees and Humidity. Each sample is one
+// or three varints, 7 bits per byte with the top bit set on all but the
+// last byte:
+//   zigzag(temperature) << 2 | repeat << 1 | keyframe
+//   time          left out with repeat
+//   humidity      left out with repeat
+// A keyframe holds the values themselves. Other samples hold the
+// difference from the previous one, zigzag coded for the temperature and
+// humidity. Repeat stands for the same time interval as the previous
+// sample and the same humidity, so a sample taken at a steady rate with a
+// small temperature change costs one byte. Time differences are taken
+// modulo 2^32; the time should be in seconds or another unit that does
+// not wrap.
+typedef struct
+{
+  uint8_t *Buffer;
+  uint16_t Size;
+  uint16_t Length;      // Bytes used
+  uint8_t Since;        // Samples since the keyframe
+  uint32_t Interval;    // Time from the sample before Last to Last
+  SAMPLE Last;
+} SAMPLE_ENCODER;
+
+// Streaming decoder, fed one byte at a time in stream order
+typedef struct
+{
+  uint32_t Value;       // Varint being read
+  uint8_t Shift;
+  uint8_t Field;        // Varint of the sample being read
+  uint8_t Flags;        // Of the sample being read
+  uint8_t Synced;       // A keyframe was seen, deltas can be applied
+  uint32_t Interval;    // Time from the sample before Last to Last
+  SAMPLE Last;
+  SAMPLE Next;
+} SAMPLE_DECODER;
+
+/**
+ * @brief Starts an empty encoding in buffer, the first sample will be a keyframe.
+ */
+void SampleEncoder_Init(SAMPLE_ENCODER *encoder, uint8_t *buffer, uint16_t size);
+/**
+ * @brief Appends a sample. Only Time, CentiDegrees and Humidity are kept.
+ * @return 0 when the sample does not fit, the buffer is then unchanged.
+ */
+uint8_t SampleEncoder_Add(SAMPLE_ENCODER *encoder, const SAMPLE *sample);
+
+/**
+ * @brief Starts decoding a new stream, skipping anything before its first keyframe.
+ */
+void SampleDecoder_Init(SAMPLE_DECODER *decoder);
+/**
+ * @brief Feeds the next byte of the stream.
+ * @return 1 when the byte completes a sample, copied to sample with the other fields zeroed.
+ * @note A varint longer than 32 bits is corrupt, the decoder then waits for the next keyframe.
+ */
+uint8_t SampleDecoder_Push(SAMPLE_DECODER *decoder, uint8_t byte, SAMPLE *sample);
+
+#endif // __SAMPLE_CODEC_H__
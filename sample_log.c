@@ -0,0 +1,224 @@
+/*
+ *      sample_log.c
+ *
+ *	The MIT License.
+ */
+
+#include "sample_log.h"
+#include "crc16.h"
+#include "nrf_nvmc.h"
+#include <string.h>
+
+#define SAMPLE_LOG_MAGIC (0x474F4C53UL)   // "SLOG"
+#define SAMPLE_LOG_ERASED (0xFFFFFFFFUL)
+#define SAMPLE_LOG_PAGE_HEADER (12)
+#define SAMPLE_LOG_PAGE_WORDS (SAMPLE_LOG_PAGE_SIZE / 4)
+
+static const uint32_t *SampleLog_Page(const SAMPLE_LOG *log, uint16_t page)
+{
+  return (const uint32_t *)(uintptr_t)(log->Start + (uint32_t)page * SAMPLE_LOG_PAGE_SIZE);
+}
+
+// A page is in use when its header is complete. The sequence number is
+// followed by its complement, so a header torn by a reset is not taken for
+// a page with a bogus sequence number.
+static uint8_t SampleLog_PageValid(const uint32_t *page)
+{
+  return page[0] == SAMPLE_LOG_MAGIC && page[2] == ~page[1];
+}
+
+static uint16_t SampleLog_Crc(const uint32_t *record, uint16_t length)
+{
+  uint16_t crc = crc16_compute((const uint8_t *)record, 4 + 2, NULL);
+
+  return crc16_compute((const uint8_t *)&record[SAMPLE_LOG_HEADER_WORDS], length, &crc);
+}
+
+// Size in words of the record at word offset in a page, 0 when there is none:
+// the page is erased from there, or the header is torn
+static uint32_t SampleLog_RecordWords(const uint32_t *page, uint32_t offset)
+{
+  uint32_t words;
+
+  if (page[offset] == SAMPLE_LOG_ERASED && page[offset + 1] == SAMPLE_LOG_ERASED)
+  {
+    return 0;
+  }
+  words = SAMPLE_LOG_HEADER_WORDS + ((page[offset + 1] & 0xFFFF) + 3) / 4;
+  if ((page[offset + 1] & 0xFFFF) == 0 || (page[offset + 1] & 0xFFFF) > SAMPLE_LOG_BATCH ||
+      offset + words > SAMPLE_LOG_PAGE_WORDS)
+  {
+    return 0;
+  }
+  return words;
+}
+
+static void SampleLog_Reset(SAMPLE_LOG *log)
+{
+  SampleEncoder_Init(&log->Encoder, (uint8_t *)&log->Record[SAMPLE_LOG_HEADER_WORDS], SAMPLE_LOG_BATCH);
+}
+
+// Word offset where the next record of a page goes, the end of the page
+// when a torn header hides it. Keeps the sequence number after the last record.
+static uint32_t SampleLog_Scan(const uint32_t *page, uint32_t *sequence)
+{
+  uint32_t offset = SAMPLE_LOG_PAGE_HEADER / 4;
+  uint32_t words;
+
+  while (offset + SAMPLE_LOG_HEADER_WORDS <= SAMPLE_LOG_PAGE_WORDS && (words = SampleLog_RecordWords(page, offset)) != 0)
+  {
+    if (page[offset] + 1 > *sequence)
+    {
+      *sequence = page[offset] + 1;
+    }
+    offset += words;
+  }
+  if (offset + SAMPLE_LOG_HEADER_WORDS <= SAMPLE_LOG_PAGE_WORDS &&
+      (page[offset] != SAMPLE_LOG_ERASED || page[offset + 1] != SAMPLE_LOG_ERASED))
+  {
+    return SAMPLE_LOG_PAGE_WORDS;
+  }
+  return offset;
+}
+
+ret_code_t SampleLog_Init(SAMPLE_LOG *log, uint32_t start, uint32_t size)
+{
+  const uint32_t *page;
+  uint32_t offset = SAMPLE_LOG_PAGE_WORDS;
+  uint16_t i;
+  uint8_t found = 0;
+
+  if (start % SAMPLE_LOG_PAGE_SIZE != 0 || size % SAMPLE_LOG_PAGE_SIZE != 0 || size < 2 * SAMPLE_LOG_PAGE_SIZE)
+  {
+    return NRF_ERROR_INVALID_PARAM;
+  }
+  log->Start = start;
+  log->Pages = size / SAMPLE_LOG_PAGE_SIZE;
+  log->Page = log->Pages - 1;
+  log->PageSequence = 0;
+  log->Sequence = 0;
+  SampleLog_Reset(log);
+
+  // Appending goes on in the page with the highest sequence number, a
+  // blank region starts on page 0
+  for (i = 0; i < log->Pages; i++)
+  {
+    page = SampleLog_Page(log, i);
+    if (SampleLog_PageValid(page))
+    {
+      if (!found || page[1] > log->PageSequence)
+      {
+        log->Page = i;
+        log->PageSequence = page[1];
+        found = 1;
+      }
+    }
+  }
+  for (i = 0; i < log->Pages; i++)
+  {
+    page = SampleLog_Page(log, i);
+    if (SampleLog_PageValid(page))
+    {
+      if (i == log->Page)
+      {
+        offset = SampleLog_Scan(page, &log->Sequence);
+      }
+      else
+      {
+        SampleLog_Scan(page, &log->Sequence);
+      }
+    }
+  }
+  log->Offset = offset * 4;
+  return NRF_SUCCESS;
+}
+
+void SampleLog_Add(SAMPLE_LOG *log, const SAMPLE *sample)
+{
+  if (!SampleEncoder_Add(&log->Encoder, sample))
+  {
+    SampleLog_Flush(log);
+    SampleEncoder_Add(&log->Encoder, sample);
+  }
+}
+
+void SampleLog_Flush(SAMPLE_LOG *log)
+{
+  uint16_t length = log->Encoder.Length;
+  uint32_t words = SAMPLE_LOG_HEADER_WORDS + (length + 3) / 4;
+  uint32_t address;
+  uint32_t header[SAMPLE_LOG_PAGE_HEADER / 4];
+
+  if (length == 0)
+  {
+    return;
+  }
+  if (log->Offset + words * 4 > SAMPLE_LOG_PAGE_SIZE)
+  {
+    // Reuse the oldest page
+    log->Page = (log->Page + 1) % log->Pages;
+    log->PageSequence++;
+    log->Offset = SAMPLE_LOG_PAGE_HEADER;
+    address = log->Start + (uint32_t)log->Page * SAMPLE_LOG_PAGE_SIZE;
+    header[0] = SAMPLE_LOG_MAGIC;
+    header[1] = log->PageSequence;
+    header[2] = ~log->PageSequence;
+    nrf_nvmc_page_erase(address);
+    nrf_nvmc_write_words(address, header, SAMPLE_LOG_PAGE_HEADER / 4);
+  }
+
+  memset((uint8_t *)&log->Record[SAMPLE_LOG_HEADER_WORDS] + length, 0xFF, (words - SAMPLE_LOG_HEADER_WORDS) * 4 - length);
+  log->Record[0] = log->Sequence++;
+  log->Record[1] = length;
+  log->Record[1] |= (uint32_t)SampleLog_Crc(log->Record, length) << 16;
+  nrf_nvmc_write_words(log->Start + (uint32_t)log->Page * SAMPLE_LOG_PAGE_SIZE + log->Offset, log->Record, words);
+  log->Offset += words * 4;
+  SampleLog_Reset(log);
+}
+
+uint32_t SampleLog_ForEach(const SAMPLE_LOG *log, SAMPLE_LOG_handler_t handler, void *context)
+{
+  SAMPLE_DECODER decoder;
+  SAMPLE sample;
+  const uint32_t *page;
+  const uint8_t *payload;
+  uint32_t offset;
+  uint32_t words;
+  uint32_t skipped = 0;
+  uint16_t length;
+  uint16_t i;
+  uint16_t j;
+
+  // Pages are reused in turn, so the oldest follows the newest
+  for (i = 1; i <= log->Pages; i++)
+  {
+    page = SampleLog_Page(log, (log->Page + i) % log->Pages);
+    if (!SampleLog_PageValid(page))
+    {
+      continue;
+    }
+    offset = SAMPLE_LOG_PAGE_HEADER / 4;
+    while (offset + SAMPLE_LOG_HEADER_WORDS <= SAMPLE_LOG_PAGE_WORDS && (words = SampleLog_RecordWords(page, offset)) != 0)
+    {
+      length = page[offset + 1] & 0xFFFF;
+      if (SampleLog_Crc(&page[offset], length) != page[offset + 1] >> 16)
+      {
+        skipped++;
+      }
+      else
+      {
+        payload = (const uint8_t *)&page[offset + SAMPLE_LOG_HEADER_WORDS];
+        SampleDecoder_Init(&decoder);
+        for (j = 0; j < length; j++)
+        {
+          if (SampleDecoder_Push(&decoder, payload[j], &sample))
+          {
+            handler(&sample, context);
+          }
+        }
+      }
+      offset += words;
+    }
+  }
+  return skipped;
+}
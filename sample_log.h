@@ -0,0 +1,79 @@
+/*
+ *      sample_log.h
+ *
+ *	The MIT License.
+ */
+
+#ifndef __SAMPLE_LOG_H__
+#define __SAMPLE_LOG_H__
+
+#include <stdint.h>
+
+#include "sample_codec.h"
+#include "sdk_errors.h"
+
+// Flash page of the nRF52832
+#define SAMPLE_LOG_PAGE_SIZE (4096)
+
+// Encoded samples gathered in RAM before they are written as one record
+#ifndef SAMPLE_LOG_BATCH
+#define SAMPLE_LOG_BATCH (248)
+#endif
+
+#if (SAMPLE_LOG_BATCH % 4) != 0
+#error "SAMPLE_LOG_BATCH must be a whole number of words"
+#endif
+
+// Words of a record header
+#define SAMPLE_LOG_HEADER_WORDS (2)
+
+// Append-only log of samples in a reserved flash region, used as a ring of
+// pages. Each page starts with a magic word, a page sequence number and
+// its complement, then holds records back to back:
+//   word 0  record sequence number
+//   word 1  payload length in bytes | CRC-16 of word 0, length and payload << 16
+//   payload, samples from sample_codec starting with a keyframe, padded
+//   with 0xFF to a whole word
+// Samples are batched in RAM and a record is written in one go, so a page
+// takes about 15 records before the next page is erased. Pages are erased
+// in turn, the oldest one first, which levels the wear over the region.
+// A record torn by a reset fails its CRC and is skipped, and the next
+// record is written after it, or on the next page when its header is torn.
+typedef struct
+{
+  uint32_t Start;             // Address of the first page
+  uint16_t Pages;
+  uint16_t Page;              // Page being appended to
+  uint32_t Offset;            // Append offset in Page
+  uint32_t PageSequence;      // Sequence number of Page
+  uint32_t Sequence;          // Sequence number of the next record
+  SAMPLE_ENCODER Encoder;     // Into Record, after the header
+  uint32_t Record[SAMPLE_LOG_HEADER_WORDS + SAMPLE_LOG_BATCH / 4];
+} SAMPLE_LOG;
+
+typedef void (*SAMPLE_LOG_handler_t)(const SAMPLE *sample, void *context);
+
+/**
+ * @brief Finds where the log in a flash region ends, so appending continues after a reset.
+ * @param[in] start, size page aligned region reserved for the log, at least two pages.
+ * @return NRF_ERROR_INVALID_PARAM for a region that is not made of whole pages.
+ */
+ret_code_t SampleLog_Init(SAMPLE_LOG *log, uint32_t start, uint32_t size);
+/**
+ * @brief Adds a sample to the RAM batch, and writes the batch when it is full.
+ * @note Writing stalls the CPU about 41 us per word, and erasing the next page
+ *       up to 85 ms once per page. Call from the main loop.
+ */
+void SampleLog_Add(SAMPLE_LOG *log, const SAMPLE *sample);
+/**
+ * @brief Writes the samples batched so far as a record.
+ */
+void SampleLog_Flush(SAMPLE_LOG *log);
+/**
+ * @brief Calls handler for each sample in flash, oldest first. Batched samples
+ *        that are not flushed yet are not included.
+ * @return number of records skipped because their CRC did not match.
+ */
+uint32_t SampleLog_ForEach(const SAMPLE_LOG *log, SAMPLE_LOG_handler_t handler, void *context);
+
+#endif // __SAMPLE_LOG_H__
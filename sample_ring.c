@@ -0,0 +1,75 @@
+/*
+ *      sample_ring.c
+ *
+ *	The MIT License.
+ */
+
+#include "sample_ring.h"
+#include "nrf.h"
+
+#define SAMPLE_RING_MASK (SAMPLE_RING_SIZE - 1)
+
+void SampleRing_Init(SAMPLE_RING *ring)
+{
+  ring->Head = 0;
+  ring->Tail = 0;
+  ring->Dropped = 0;
+}
+
+uint8_t SampleRing_Push(SAMPLE_RING *ring, const SAMPLE *sample)
+{
+  uint32_t head = ring->Head;
+
+  if (head - ring->Tail == SAMPLE_RING_SIZE)
+  {
+    ring->Dropped++;
+    return 0;
+  }
+  ring->Samples[head & SAMPLE_RING_MASK] = *sample;
+  // The sample is in place before the consumer can see the new Head
+  __DMB();
+  ring->Head = head + 1;
+  return 1;
+}
+
+uint32_t SampleRing_Peek(SAMPLE_RING *ring, const SAMPLE **samples)
+{
+  uint32_t tail = ring->Tail;
+  uint32_t count = ring->Head - tail;
+  uint32_t contiguous = SAMPLE_RING_SIZE - (tail & SAMPLE_RING_MASK);
+
+  // Samples up to Head are complete before they are read
+  __DMB();
+  *samples = &ring->Samples[tail & SAMPLE_RING_MASK];
+  return count < contiguous ? count : contiguous;
+}
+
+void SampleRing_Release(SAMPLE_RING *ring, uint32_t count)
+{
+  // The samples are read before the producer can overwrite them
+  __DMB();
+  ring->Tail += count;
+}
+
+uint32_t SampleRing_Drain(SAMPLE_RING *ring, SAMPLE *out, uint32_t max)
+{
+  const SAMPLE *samples;
+  uint32_t copied = 0;
+  uint32_t count;
+  uint32_t i;
+
+  while (copied < max && (count = SampleRing_Peek(ring, &samples)) > 0)
+  {
+    if (count > max - copied)
+    {
+      count = max - copied;
+    }
+    for (i = 0; i < count; i++)
+    {
+      out[copied + i] = samples[i];
+    }
+    SampleRing_Release(ring, count);
+    copied += count;
+  }
+  return copied;
+}
@@ -0,0 +1,71 @@
+/*
+ *      sample_ring.h
+ *
+ *	The MIT License.
+ */
+
+#ifndef __SAMPLE_RING_H__
+#define __SAMPLE_RING_H__
+
+#include <stdint.h>
+
+// Samples held between the TWI interrupt and the main loop, a power of two
+#ifndef SAMPLE_RING_SIZE
+#define SAMPLE_RING_SIZE (16)
+#endif
+
+#if (SAMPLE_RING_SIZE & (SAMPLE_RING_SIZE - 1)) != 0
+#error "SAMPLE_RING_SIZE must be a power of two"
+#endif
+
+typedef struct
+{
+  uint32_t Time;              // app_timer ticks when the read completed
+  int16_t CentiDegrees;
+  uint8_t Humidity;           // %RH
+  uint8_t Sensor;             // Index of the sensor in its sampler
+  int16_t DewPoint;           // Centi-degrees
+  uint16_t AbsoluteHumidity;  // Centi-grams per m3
+} SAMPLE;
+
+// Single-producer single-consumer ring of samples. Push runs in the TWI
+// interrupt, Peek and Release in the main loop. Head and Tail count
+// samples since Init and are each written by one side only, so no
+// critical region is needed.
+typedef struct
+{
+  SAMPLE Samples[SAMPLE_RING_SIZE];
+  volatile uint32_t Head;    // Samples pushed, written by the producer
+  volatile uint32_t Tail;    // Samples released, written by the consumer
+  volatile uint32_t Dropped; // Samples lost to a full ring, written by the producer
+} SAMPLE_RING;
+
+/**
+ * @brief Empties the ring. Neither side may be running.
+ */
+void SampleRing_Init(SAMPLE_RING *ring);
+/**
+ * @brief Producer: appends a sample.
+ * @return 0 and counts the sample in Dropped when the ring is full.
+ */
+uint8_t SampleRing_Push(SAMPLE_RING *ring, const SAMPLE *sample);
+/**
+ * @brief Consumer: gives the oldest samples in place, without copying.
+ * @param[out] samples set to the oldest sample.
+ * @return number of consecutive samples at *samples, 0 when empty. The samples
+ *         stay valid until they are released.
+ * @note The run stops at the end of the array, call again after the release
+ *       to get the samples that wrapped around.
+ */
+uint32_t SampleRing_Peek(SAMPLE_RING *ring, const SAMPLE **samples);
+/**
+ * @brief Consumer: frees the oldest count samples given by SampleRing_Peek.
+ */
+void SampleRing_Release(SAMPLE_RING *ring, uint32_t count);
+/**
+ * @brief Consumer: copies and releases up to max of the oldest samples.
+ * @return number of samples copied.
+ */
+uint32_t SampleRing_Drain(SAMPLE_RING *ring, SAMPLE *out, uint32_t max);
+
+#endif // __SAMPLE_RING_H__
@@ -0,0 +1,177 @@
+/*
+ *      sensor_sampler.c
+ *
+ *	The MIT License.
+ */
+
+#include "sensor_sampler.h"
+#include "app_util.h"
+#include "app_util_platform.h"
+#include "nordic_common.h"
+
+static uint8_t Sampler_Index(const SAMPLER_t *sampler, const HDC1080_t *hdc1080)
+{
+  uint8_t i;
+
+  for (i = 0; i < sampler->Count && sampler->Sensors[i] != hdc1080; i++)
+  {
+  }
+  return i;
+}
+
+// The sensor is done with this cycle, finish the cycle with the last one
+static void Sampler_Done(SAMPLER_t *sampler, uint8_t i)
+{
+  uint8_t pending;
+
+  CRITICAL_REGION_ENTER();
+  if (sampler->Sensors[i]->Status != NRF_SUCCESS)
+  {
+    sampler->Failed |= 1 << i;
+  }
+  sampler->Pending &= ~(1 << i);
+  pending = sampler->Pending;
+  CRITICAL_REGION_EXIT();
+
+  if (pending == 0)
+  {
+    sampler->CycleTicks = app_timer_cnt_diff_compute(app_timer_cnt_get(), sampler->CycleStart);
+    if (sampler->OnCycle != NULL)
+    {
+      sampler->OnCycle(sampler);
+    }
+  }
+}
+
+// Ticks until the conversion of a sensor is done, 0 if it is
+static uint32_t Sampler_Remaining(const SAMPLER_t *sampler, uint8_t i, uint32_t now)
+{
+  uint32_t elapsed = app_timer_cnt_diff_compute(now, sampler->Triggered[i]);
+
+  return (elapsed >= sampler->Conversion[i]) ? 0 : sampler->Conversion[i] - elapsed;
+}
+
+// Read the sensors whose conversion is done, earliest first, and set the
+// timer for the next one
+static void Sampler_Service(SAMPLER_t *sampler)
+{
+  uint32_t now = app_timer_cnt_get();
+  uint32_t remaining, next;
+  uint8_t i, first;
+
+  for (;;)
+  {
+    next = UINT32_MAX;
+    first = sampler->Count;
+    CRITICAL_REGION_ENTER();
+    for (i = 0; i < sampler->Count; i++)
+    {
+      if (sampler->Converting & (1 << i))
+      {
+        remaining = Sampler_Remaining(sampler, i, now);
+        if (remaining < next)
+        {
+          next = remaining;
+          first = i;
+        }
+      }
+    }
+    if (next == 0)
+    {
+      sampler->Converting &= ~(1 << first);
+    }
+    CRITICAL_REGION_EXIT();
+
+    if (next != 0)
+    {
+      break;
+    }
+    if (HDC1080_ScheduleRead(sampler->Sensors[first]) != NRF_SUCCESS)
+    {
+      sampler->Sensors[first]->Status = NRF_ERROR_BUSY;
+      Sampler_Done(sampler, first);
+    }
+  }
+
+  if (first < sampler->Count)
+  {
+    APP_ERROR_CHECK(app_timer_stop(sampler->Timer));
+    APP_ERROR_CHECK(app_timer_start(sampler->Timer, MAX(next, APP_TIMER_MIN_TIMEOUT_TICKS), sampler));
+  }
+}
+
+static void Sampler_TimerHandler(void *p_context)
+{
+  Sampler_Service((SAMPLER_t *)p_context);
+}
+
+static void Sampler_Triggered(HDC1080_t *hdc1080)
+{
+  SAMPLER_t *sampler = (SAMPLER_t *)hdc1080->Context;
+  uint8_t i = Sampler_Index(sampler, hdc1080);
+
+  if (hdc1080->Status != NRF_SUCCESS)
+  {
+    Sampler_Done(sampler, i);
+    return;
+  }
+  sampler->Triggered[i] = app_timer_cnt_get();
+  CRITICAL_REGION_ENTER();
+  sampler->Converting |= 1 << i;
+  CRITICAL_REGION_EXIT();
+  Sampler_Service(sampler);
+}
+
+static void Sampler_Read(HDC1080_t *hdc1080)
+{
+  SAMPLER_t *sampler = (SAMPLER_t *)hdc1080->Context;
+
+  Sampler_Done(sampler, Sampler_Index(sampler, hdc1080));
+}
+
+ret_code_t Sampler_Init(SAMPLER_t *sampler, HDC1080_t *const *sensors, uint8_t count, SAMPLER_handler_t on_cycle)
+{
+  uint8_t i;
+
+  if (count > SAMPLER_MAX_SENSORS)
+  {
+    return NRF_ERROR_INVALID_PARAM;
+  }
+  memset(sampler, 0, sizeof(*sampler));
+  sampler->Count = count;
+  sampler->OnCycle = on_cycle;
+  for (i = 0; i < count; i++)
+  {
+    sampler->Sensors[i] = sensors[i];
+    // One extra tick so a read never lands before the conversion is done
+    sampler->Conversion[i] = APP_TIMER_TICKS(CEIL_DIV(sensors[i]->ConversionTime, 1000)) + 1;
+    sensors[i]->OnTrigger = Sampler_Triggered;
+    sensors[i]->OnData = Sampler_Read;
+    sensors[i]->Context = sampler;
+  }
+  sampler->Timer = &sampler->TimerData;
+  return app_timer_create(&sampler->Timer, APP_TIMER_MODE_SINGLE_SHOT, Sampler_TimerHandler);
+}
+
+ret_code_t Sampler_Start(SAMPLER_t *sampler)
+{
+  uint8_t i;
+  uint8_t all = (uint8_t)((1u << sampler->Count) - 1);
+
+  if (sampler->Pending != 0)
+  {
+    return NRF_ERROR_BUSY;
+  }
+  sampler->Failed = 0;
+  sampler->CycleStart = app_timer_cnt_get();
+  sampler->Pending = all;
+  for (i = 0; i < sampler->Count; i++)
+  {
+    if (HDC1080_ScheduleTrigger(sampler->Sensors[i]) != NRF_SUCCESS)
+    {
+      sampler->Sensors[i]->Status = NRF_ERROR_BUSY;
+      Sampler_Done(sampler, i);
+    }
+  }
+  return NRF_SUCCESS;
+}
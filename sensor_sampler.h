@@ -0,0 +1,54 @@
+/*
+ *      sensor_sampler.h
+ *
+ *	The MIT License.
+ */
+
+#ifndef __SENSOR_SAMPLER_H__
+#define __SENSOR_SAMPLER_H__
+
+#include "main.h"
+
+#ifndef SAMPLER_MAX_SENSORS
+#define SAMPLER_MAX_SENSORS (8)
+#endif
+
+typedef struct SAMPLER_s SAMPLER_t;
+
+// Called from interrupt context when every sensor of a cycle is done
+typedef void (*SAMPLER_handler_t)(SAMPLER_t *sampler);
+
+// Pipelined sampling of several HDC1080s. A cycle triggers every sensor
+// back-to-back, then reads each one as soon as its own conversion time has
+// passed, so a cycle takes one conversion time plus the transfers instead
+// of one conversion time per sensor.
+struct SAMPLER_s
+{
+  HDC1080_t *Sensors[SAMPLER_MAX_SENSORS];
+  uint8_t Count;
+  SAMPLER_handler_t OnCycle;                // Optional, may be NULL
+  app_timer_t TimerData;
+  app_timer_id_t Timer;                     // Fires when the next conversion is done
+  uint32_t Triggered[SAMPLER_MAX_SENSORS];  // Tick the trigger of each sensor completed
+  uint32_t Conversion[SAMPLER_MAX_SENSORS]; // Conversion time of each sensor in ticks
+  volatile uint8_t Converting;              // Sensors waiting for their conversion
+  volatile uint8_t Pending;                 // Sensors not done with this cycle
+  volatile uint8_t Failed;                  // Sensors whose trigger or read failed this cycle
+  uint32_t CycleStart;
+  uint32_t CycleTicks;                      // Duration of the last cycle
+};
+
+/**
+ * @brief Sets up a sampler over initialized HDC1080 instances.
+ * @note Takes over the OnTrigger, OnData and Context fields of the sensors.
+ * @return NRF_ERROR_INVALID_PARAM for more than SAMPLER_MAX_SENSORS sensors,
+ *         or the app_timer_create error.
+ */
+ret_code_t Sampler_Init(SAMPLER_t *sampler, HDC1080_t *const *sensors, uint8_t count, SAMPLER_handler_t on_cycle);
+/**
+ * @brief Starts a cycle: schedules the trigger of every sensor.
+ * @return NRF_ERROR_BUSY while the previous cycle is running.
+ */
+ret_code_t Sampler_Start(SAMPLER_t *sampler);
+
+#endif // __SENSOR_SAMPLER_H__
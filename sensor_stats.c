@@ -0,0 +1,155 @@
+/*
+ *      sensor_stats.c
+ *
+ *	The MIT License.
+ */
+
+#include "sensor_stats.h"
+
+static uint8_t Stats_Position(const STATS_WINDOW *window, uint8_t first, uint8_t offset)
+{
+  return (first + offset) % window->Size;
+}
+
+// Drops the buckets that are Size spans older than the bucket of index
+static void Stats_Expire(STATS_WINDOW *window, uint32_t index)
+{
+  STATS_BUCKET *bucket;
+
+  while (window->Used > 0 && index - window->Buckets[window->First].Index >= window->Size)
+  {
+    bucket = &window->Buckets[window->First];
+    window->Count -= bucket->Count;
+    window->Sum -= bucket->Sum;
+    window->SumSquares -= bucket->SumSquares;
+    if (window->MinUsed > 0 && window->MinQueue[window->MinFirst] == window->First)
+    {
+      window->MinFirst = Stats_Position(window, window->MinFirst, 1);
+      window->MinUsed--;
+    }
+    if (window->MaxUsed > 0 && window->MaxQueue[window->MaxFirst] == window->First)
+    {
+      window->MaxFirst = Stats_Position(window, window->MaxFirst, 1);
+      window->MaxUsed--;
+    }
+    window->First = Stats_Position(window, window->First, 1);
+    window->Used--;
+  }
+}
+
+static uint32_t Stats_Sqrt(uint32_t value)
+{
+  uint32_t root = 0;
+  uint32_t bit = 1UL << 30;
+
+  while (bit > value)
+  {
+    bit >>= 2;
+  }
+  while (bit != 0)
+  {
+    if (value >= root + bit)
+    {
+      value -= root + bit;
+      root = (root >> 1) + bit;
+    }
+    else
+    {
+      root >>= 1;
+    }
+    bit >>= 2;
+  }
+  return root;
+}
+
+void Stats_Init(STATS_WINDOW *window, uint8_t size, uint32_t span)
+{
+  window->Span = span;
+  window->Size = size;
+  window->First = 0;
+  window->Used = 0;
+  window->MinFirst = 0;
+  window->MinUsed = 0;
+  window->MaxFirst = 0;
+  window->MaxUsed = 0;
+  window->Count = 0;
+  window->Sum = 0;
+  window->SumSquares = 0;
+}
+
+void Stats_Add(STATS_WINDOW *window, uint32_t time, int16_t value)
+{
+  uint32_t index = time / window->Span;
+  uint8_t last;
+  STATS_BUCKET *bucket;
+
+  Stats_Expire(window, index);
+  last = Stats_Position(window, window->First, window->Used + window->Size - 1);
+  bucket = &window->Buckets[last];
+  if (window->Used == 0 || bucket->Index != index)
+  {
+    last = Stats_Position(window, window->First, window->Used);
+    bucket = &window->Buckets[last];
+    bucket->Index = index;
+    bucket->Count = 0;
+    bucket->Min = INT16_MAX;
+    bucket->Max = INT16_MIN;
+    bucket->Sum = 0;
+    bucket->SumSquares = 0;
+    window->Used++;
+  }
+
+  bucket->Count++;
+  bucket->Sum += value;
+  bucket->SumSquares += (int32_t)value * value;
+  window->Count++;
+  window->Sum += value;
+  window->SumSquares += (int32_t)value * value;
+
+  // The newest bucket goes to the back of a queue, after dropping the
+  // buckets it outlives and beats, itself included when already queued.
+  // The first sample of a bucket always goes in, even at INT16_MAX or INT16_MIN.
+  if (bucket->Count == 1 || value < bucket->Min)
+  {
+    bucket->Min = value;
+    while (window->MinUsed > 0 &&
+           window->Buckets[window->MinQueue[Stats_Position(window, window->MinFirst, window->MinUsed - 1)]].Min >= value)
+    {
+      window->MinUsed--;
+    }
+    window->MinQueue[Stats_Position(window, window->MinFirst, window->MinUsed++)] = last;
+  }
+  if (bucket->Count == 1 || value > bucket->Max)
+  {
+    bucket->Max = value;
+    while (window->MaxUsed > 0 &&
+           window->Buckets[window->MaxQueue[Stats_Position(window, window->MaxFirst, window->MaxUsed - 1)]].Max <= value)
+    {
+      window->MaxUsed--;
+    }
+    window->MaxQueue[Stats_Position(window, window->MaxFirst, window->MaxUsed++)] = last;
+  }
+}
+
+uint8_t Stats_Get(STATS_WINDOW *window, uint32_t time, STATS_RESULT *result)
+{
+  int64_t count;
+  int64_t spread;
+
+  Stats_Expire(window, time / window->Span);
+  if (window->Count == 0)
+  {
+    return 0;
+  }
+  count = window->Count;
+  // n * sum(x^2) - sum(x)^2 is exact: at most 2^16 samples of 2^15
+  spread = count * window->SumSquares - window->Sum * window->Sum;
+
+  result->Count = window->Count;
+  result->Min = window->Buckets[window->MinQueue[window->MinFirst]].Min;
+  result->Max = window->Buckets[window->MaxQueue[window->MaxFirst]].Max;
+  result->Mean = (int16_t)((window->Sum >= 0 ? window->Sum + count / 2 : window->Sum - count / 2) / count);
+  result->Variance = (uint32_t)((spread + count * count / 2) / (count * count));
+  result->StdDev = (uint16_t)Stats_Sqrt((uint32_t)(spread / (count * count)));
+  return 1;
+}
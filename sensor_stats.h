@@ -0,0 +1,78 @@
+/*
+ *      sensor_stats.h
+ *
+ *	The MIT License.
+ */
+
+#ifndef __SENSOR_STATS_H__
+#define __SENSOR_STATS_H__
+
+#include <stdint.h>
+
+// Most buckets of a window
+#ifndef STATS_MAX_BUCKETS
+#define STATS_MAX_BUCKETS (60)
+#endif
+
+// Samples that fell in one span of time
+typedef struct
+{
+  uint32_t Index;      // Time / Span
+  uint16_t Count;
+  int16_t Min;
+  int16_t Max;
+  int32_t Sum;
+  int64_t SumSquares;
+} STATS_BUCKET;
+
+// Rolling window over the last Size spans of time, e.g. 60 buckets of 1 s
+// for a minute or 60 buckets of 60 s for an hour. Samples are summed per
+// bucket, and a whole bucket leaves the window once it is Size spans old.
+// The sums are exact integers, so removing a bucket leaves no rounding
+// behind. Min and Max come from monotonic queues of buckets, so adding a
+// sample costs O(1) amortized whatever the window length.
+typedef struct
+{
+  STATS_BUCKET Buckets[STATS_MAX_BUCKETS]; // Ring, oldest at First
+  uint8_t MinQueue[STATS_MAX_BUCKETS];     // Buckets with increasing Min, oldest first
+  uint8_t MaxQueue[STATS_MAX_BUCKETS];     // Buckets with decreasing Max, oldest first
+  uint32_t Span;                           // Time per bucket
+  uint8_t Size;                            // Buckets per window
+  uint8_t First;
+  uint8_t Used;
+  uint8_t MinFirst;
+  uint8_t MinUsed;
+  uint8_t MaxFirst;
+  uint8_t MaxUsed;
+  uint32_t Count;                          // Totals of the buckets in the window
+  int64_t Sum;
+  int64_t SumSquares;
+} STATS_WINDOW;
+
+typedef struct
+{
+  uint32_t Count;
+  int16_t Min;
+  int16_t Max;
+  int16_t Mean;        // Rounded to the unit of the samples
+  uint32_t Variance;   // Population variance, in units squared
+  uint16_t StdDev;     // Rounded down
+} STATS_RESULT;
+
+/**
+ * @brief Sets up an empty window of size buckets of span time units each.
+ * @param[in] size 1 to STATS_MAX_BUCKETS.
+ * @note A window holds at most 65535 samples.
+ */
+void Stats_Init(STATS_WINDOW *window, uint8_t size, uint32_t span);
+/**
+ * @brief Adds a sample taken at a time, times must not go backwards.
+ */
+void Stats_Add(STATS_WINDOW *window, uint32_t time, int16_t value);
+/**
+ * @brief Gives the statistics of the window ending at a time.
+ * @return 0 when the window has no samples, result is then left untouched.
+ */
+uint8_t Stats_Get(STATS_WINDOW *window, uint32_t time, STATS_RESULT *result);
+
+#endif // __SENSOR_STATS_H__
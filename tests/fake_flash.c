@@ -0,0 +1,110 @@
+/*
+ *      fake_flash.c
+ *
+ *	The MIT License.
+ */
+
+#define _GNU_SOURCE
+
+#include <string.h>
+#include <sys/mman.h>
+
+#include "fake_flash.h"
+#include "crc16.h"
+#include "nrf_nvmc.h"
+
+#define FAKE_FLASH_SIZE (FAKE_FLASH_PAGES * SAMPLE_LOG_PAGE_SIZE)
+
+FAKE_FLASH Fake_Flash;
+
+#ifndef MAP_32BIT
+static uint32_t FakeFlash_Region[FAKE_FLASH_SIZE / 4] __attribute__((aligned(SAMPLE_LOG_PAGE_SIZE)));
+#endif
+
+uint8_t FakeFlash_Init(void)
+{
+  void *region;
+
+  if (Fake_Flash.Words == NULL)
+  {
+#ifdef MAP_32BIT
+    region = mmap(NULL, FAKE_FLASH_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_32BIT, -1, 0);
+    if (region == MAP_FAILED)
+    {
+      return 0;
+    }
+#else
+    region = FakeFlash_Region;
+#endif
+    if ((uintptr_t)region > UINT32_MAX - FAKE_FLASH_SIZE)
+    {
+      return 0;
+    }
+    Fake_Flash.Words = region;
+    Fake_Flash.Start = (uint32_t)(uintptr_t)region;
+  }
+  memset(Fake_Flash.Words, 0xFF, FAKE_FLASH_SIZE);
+  memset(Fake_Flash.Erases, 0, sizeof(Fake_Flash.Erases));
+  Fake_Flash.Budget = -1;
+  return 1;
+}
+
+// Takes one word or erase off the budget, 0 once the power is gone
+static uint8_t FakeFlash_Spend(void)
+{
+  if (Fake_Flash.Budget == 0)
+  {
+    return 0;
+  }
+  if (Fake_Flash.Budget > 0)
+  {
+    Fake_Flash.Budget--;
+  }
+  return 1;
+}
+
+// CRC-16-CCITT as in the SDK
+uint16_t crc16_compute(uint8_t const *p_data, uint32_t size, uint16_t const *p_crc)
+{
+  uint16_t crc = (p_crc == NULL) ? 0xFFFF : *p_crc;
+  uint32_t i;
+
+  for (i = 0; i < size; i++)
+  {
+    crc = (uint8_t)(crc >> 8) | (crc << 8);
+    crc ^= p_data[i];
+    crc ^= (uint8_t)(crc & 0xFF) >> 4;
+    crc ^= (crc << 8) << 4;
+    crc ^= ((crc & 0xFF) << 4) << 1;
+  }
+  return crc;
+}
+
+void nrf_nvmc_page_erase(uint32_t address)
+{
+  uint32_t page = (address - Fake_Flash.Start) / SAMPLE_LOG_PAGE_SIZE;
+
+  if (address % SAMPLE_LOG_PAGE_SIZE != 0 || address < Fake_Flash.Start || page >= FAKE_FLASH_PAGES)
+  {
+    abort();
+  }
+  if (FakeFlash_Spend())
+  {
+    memset(&Fake_Flash.Words[page * SAMPLE_LOG_PAGE_SIZE / 4], 0xFF, SAMPLE_LOG_PAGE_SIZE);
+    Fake_Flash.Erases[page]++;
+  }
+}
+
+void nrf_nvmc_write_words(uint32_t address, const uint32_t *src, uint32_t num_words)
+{
+  uint32_t i;
+
+  if (address % 4 != 0 || address < Fake_Flash.Start || address - Fake_Flash.Start + num_words * 4 > FAKE_FLASH_SIZE)
+  {
+    abort();
+  }
+  for (i = 0; i < num_words && FakeFlash_Spend(); i++)
+  {
+    Fake_Flash.Words[(address - Fake_Flash.Start) / 4 + i] &= src[i];
+  }
+}
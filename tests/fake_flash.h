@@ -0,0 +1,36 @@
+/*
+ *      fake_flash.h
+ *
+ *	The MIT License.
+ */
+
+#ifndef __FAKE_FLASH_H__
+#define __FAKE_FLASH_H__
+
+#include <stdint.h>
+
+#include "sample_log.h"
+
+#define FAKE_FLASH_PAGES (8)
+
+// Model of the nRF52832 NVMC over a region below 4 GB, where flash
+// addresses fit in 32 bits. A write only clears bits, and a page erase
+// sets them all. A power budget stands for a reset: once it is spent,
+// the words and erases that follow are lost.
+typedef struct
+{
+  uint32_t Start;             // Address of the region
+  uint32_t *Words;
+  int32_t Budget;             // Words and erases left before the reset, -1 for no reset
+  uint32_t Erases[FAKE_FLASH_PAGES];
+} FAKE_FLASH;
+
+extern FAKE_FLASH Fake_Flash;
+
+/**
+ * @brief Maps the region if needed and erases it, without a reset pending.
+ * @return 0 when no memory below 4 GB can be had.
+ */
+uint8_t FakeFlash_Init(void);
+
+#endif // __FAKE_FLASH_H__
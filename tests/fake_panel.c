@@ -0,0 +1,168 @@
+/*
+ *      fake_panel.c
+ *
+ *	The MIT License.
+ */
+
+#include "fake_panel.h"
+
+#define FAKE_PANEL_QUEUE (64)
+
+FAKE_PANEL Fake_Panels[2];
+uint8_t Fake_Panel_Hold;
+
+static nrf_twi_mngr_transaction_t *FakePanel_Queue[FAKE_PANEL_QUEUE];
+static uint8_t FakePanel_Queued;
+
+static uint32_t FakePanel_Time;
+
+uint32_t app_timer_cnt_get(void)
+{
+  // Well past the panel boot time
+  return FakePanel_Time += APP_TIMER_TICKS(1000);
+}
+
+static void FakePanel_Command(FAKE_PANEL *panel, const uint8_t *bytes, uint8_t length)
+{
+  uint8_t i;
+
+  for (i = 0; i < length; i++)
+  {
+    if (bytes[i] >= 0xB0 && bytes[i] <= 0xB7)
+    {
+      panel->Page = bytes[i] - 0xB0;
+    }
+    else if (bytes[i] < 0x10)
+    {
+      panel->Column = (panel->Column & 0xF0) | bytes[i];
+    }
+    else if (bytes[i] < 0x20)
+    {
+      panel->Column = (panel->Column & 0x0F) | (bytes[i] & 0x0F) << 4;
+    }
+    else if (bytes[i] >= 0x40 && bytes[i] <= 0x7F)
+    {
+      panel->StartLine = bytes[i] - 0x40;
+    }
+  }
+}
+
+static void FakePanel_Transfer(const nrf_twi_mngr_transfer_t *transfer)
+{
+  FAKE_PANEL *panel = &Fake_Panels[NRF_TWI_MNGR_OP_ADDRESS(transfer->operation) != SSD1306_I2C_ADDR];
+  uint8_t i;
+
+  panel->Bytes += transfer->length + 1;
+  if (transfer->p_data[0] == 0x00)
+  {
+    FakePanel_Command(panel, &transfer->p_data[1], transfer->length - 1);
+    return;
+  }
+  for (i = 1; i < transfer->length && panel->Column < sizeof(panel->Ram[0]); i++)
+  {
+    panel->Ram[panel->Page][panel->Column++] = transfer->p_data[i];
+  }
+}
+
+static void FakePanel_Complete(nrf_twi_mngr_transaction_t *transaction)
+{
+  uint8_t i;
+
+  for (i = 0; i < transaction->number_of_transfers; i++)
+  {
+    FakePanel_Transfer(&transaction->p_transfers[i]);
+  }
+  transaction->callback(NRF_SUCCESS, transaction->p_user_data);
+}
+
+ret_code_t TwiRecovery_InitDevice(TWI_DEVICE *device, const nrf_twi_mngr_t *nrf_twi_mngr_t, uint8_t address)
+{
+  memset(device, 0, sizeof(*device));
+  device->TWI = nrf_twi_mngr_t;
+  device->Address = address;
+  return NRF_SUCCESS;
+}
+
+ret_code_t TwiRecovery_Schedule(TWI_DEVICE *device, TWI_RETRY *retry, nrf_twi_mngr_transaction_t *transaction)
+{
+  if (!Fake_Panel_Hold)
+  {
+    FakePanel_Complete(transaction);
+    return NRF_SUCCESS;
+  }
+  if (FakePanel_Queued == FAKE_PANEL_QUEUE)
+  {
+    return NRF_ERROR_NO_MEM;
+  }
+  FakePanel_Queue[FakePanel_Queued++] = transaction;
+  return NRF_SUCCESS;
+}
+
+uint8_t FakePanel_Run(void)
+{
+  nrf_twi_mngr_transaction_t *transaction = FakePanel_Queue[0];
+
+  if (FakePanel_Queued == 0)
+  {
+    return 0;
+  }
+  memmove(&FakePanel_Queue[0], &FakePanel_Queue[1], --FakePanel_Queued * sizeof(FakePanel_Queue[0]));
+  FakePanel_Complete(transaction);
+  return NRF_TWI_MNGR_OP_ADDRESS(transaction->p_transfers[0].operation);
+}
+
+ret_code_t TwiRecovery_Perform(TWI_DEVICE *device, const nrf_twi_mngr_transfer_t *p_transfers, uint8_t number_of_transfers)
+{
+  uint8_t i;
+
+  for (i = 0; i < number_of_transfers; i++)
+  {
+    FakePanel_Transfer(&p_transfers[i]);
+  }
+  return NRF_SUCCESS;
+}
+
+void FakePanel_Init(SSD1306_t *display)
+{
+  static const nrf_twi_mngr_t twi;
+
+  memset(Fake_Panels, 0, sizeof(Fake_Panels));
+  Fake_Panel_Hold = 0;
+  FakePanel_Queued = 0;
+  ssd1306_InitDisplay(display, &twi, SSD1306_I2C_ADDR);
+  ssd1306_Init();
+}
+
+uint8_t FakePanel_Buffer(const SSD1306_t *display, int16_t x, int16_t y)
+{
+  uint8_t page = ((y / 8) + display->StartPage) & SSD1306_PAGE_MASK;
+
+  return (display->Buffer[page * SSD1306_WIDTH + x] >> (y % 8)) & 1;
+}
+
+uint8_t FakePanel_ShownBy(const FAKE_PANEL *panel, int16_t x, int16_t y)
+{
+  uint8_t row = (y + panel->StartLine) & 0x3F;
+
+  return (panel->Ram[row / 8][x + SSD1306_X_OFFSET] >> (row % 8)) & 1;
+}
+
+uint8_t FakePanel_Shown(int16_t x, int16_t y)
+{
+  return FakePanel_ShownBy(&Fake_Panel, x, y);
+}
+
+uint32_t FakePanel_Count(const SSD1306_t *display)
+{
+  uint32_t count = 0;
+  int16_t x, y;
+
+  for (y = 0; y < SSD1306_HEIGHT; y++)
+  {
+    for (x = 0; x < SSD1306_WIDTH; x++)
+    {
+      count += FakePanel_Buffer(display, x, y);
+    }
+  }
+  return count;
+}
@@ -0,0 +1,57 @@
+/*
+ *      fake_panel.h
+ *
+ *	The MIT License.
+ */
+
+#ifndef __FAKE_PANEL_H__
+#define __FAKE_PANEL_H__
+
+#include "twi_mng_ssd1306.h"
+
+// Model of the SSD1306 display RAM, fed by the command and data streams
+// the driver sends. Transactions complete at once, or wait in a queue
+// while Fake_Panel_Hold is set.
+typedef struct
+{
+  uint8_t Ram[8][132];        // 8 pages of 8 rows, up to 132 columns
+  uint8_t StartLine;
+  uint8_t Page;
+  uint8_t Column;
+  uint32_t Bytes;             // Sent over the bus, addresses included
+} FAKE_PANEL;
+
+// Panels at SSD1306_I2C_ADDR and at the address after it
+extern FAKE_PANEL Fake_Panels[2];
+#define Fake_Panel (Fake_Panels[0])
+
+// Scheduled transactions are queued until FakePanel_Run
+extern uint8_t Fake_Panel_Hold;
+
+/**
+ * @brief Clears the model and sets up display as the selected, initialized panel.
+ */
+void FakePanel_Init(SSD1306_t *display);
+/**
+ * @brief Pixel of the framebuffer at logical x, y, whatever the ring start page.
+ */
+uint8_t FakePanel_Buffer(const SSD1306_t *display, int16_t x, int16_t y);
+/**
+ * @brief Pixel the panel shows at x, y.
+ */
+uint8_t FakePanel_Shown(int16_t x, int16_t y);
+/**
+ * @brief Pixel one of Fake_Panels shows at x, y.
+ */
+uint8_t FakePanel_ShownBy(const FAKE_PANEL *panel, int16_t x, int16_t y);
+/**
+ * @brief Completes the oldest queued transaction.
+ * @return Address it went to, 0 when the queue is empty.
+ */
+uint8_t FakePanel_Run(void);
+/**
+ * @brief Number of lit pixels in the framebuffer.
+ */
+uint32_t FakePanel_Count(const SSD1306_t *display);
+
+#endif // __FAKE_PANEL_H__
@@ -0,0 +1,413 @@
+/*
+ *      fake_twi.c
+ *
+ *	The MIT License.
+ */
+
+#include <stdio.h>
+
+#include "fake_twi.h"
+#include "app_timer.h"
+#include "nrf_drv_twi.h"
+#include "nrf_gpio.h"
+
+typedef struct
+{
+  app_timer_id_t Id;
+  app_timer_timeout_handler_t Handler;
+  app_timer_mode_t Mode;
+  uint8_t Running;
+  uint64_t Due;
+  uint64_t Period;
+  void *Context;
+} FAKE_TWI_TIMER;
+
+FAKE_TWI Fake_Twi;
+
+static const nrf_twi_mngr_transaction_t *FakeTwi_Queue[FAKE_TWI_QUEUE];
+static uint8_t FakeTwi_Head;
+static uint8_t FakeTwi_Count;
+static uint8_t FakeTwi_Running;
+static FAKE_TWI_TIMER FakeTwi_Timers[FAKE_TWI_TIMERS];
+
+void FakeTwi_Init(uint8_t queue_size)
+{
+  memset(&Fake_Twi, 0, sizeof(Fake_Twi));
+  Fake_Twi.QueueSize = MIN(queue_size, FAKE_TWI_QUEUE);
+  FakeTwi_Head = 0;
+  FakeTwi_Count = 0;
+  FakeTwi_Running = 0;
+  memset(FakeTwi_Timers, 0, sizeof(FakeTwi_Timers));
+}
+
+void FakeTwi_Add(FAKE_TWI_DEVICE *device)
+{
+  if (Fake_Twi.DeviceCount < FAKE_TWI_DEVICES)
+  {
+    Fake_Twi.Devices[Fake_Twi.DeviceCount++] = device;
+  }
+}
+
+uint8_t FakeTwi_Queued(void)
+{
+  return FakeTwi_Count;
+}
+
+// 8 bits and the acknowledge at 400 kHz, 22.5 us a byte
+static void FakeTwi_Clock(uint32_t bytes)
+{
+  Fake_Twi.Bytes += bytes;
+  Fake_Twi.Us += (bytes * 45 + 1) / 2;
+}
+
+static ret_code_t FakeTwi_Transfer(const nrf_twi_mngr_transfer_t *transfer)
+{
+  uint8_t address = NRF_TWI_MNGR_OP_ADDRESS(transfer->operation);
+  FAKE_TWI_DEVICE *device = NULL;
+  uint8_t i;
+
+  FakeTwi_Clock(transfer->length + 1);
+  if (Fake_Twi.SdaLow != 0)
+  {
+    return NRF_ERROR_DRV_TWI_ERR_ANACK;
+  }
+  if (Fake_Twi.MuxAddress != 0 && address == Fake_Twi.MuxAddress)
+  {
+    if (NRF_TWI_MNGR_IS_READ_OP(transfer->operation))
+    {
+      memset(transfer->p_data, Fake_Twi.Mux, transfer->length);
+    }
+    else if (transfer->length != 0)
+    {
+      Fake_Twi.Mux = transfer->p_data[transfer->length - 1];
+    }
+    return NRF_SUCCESS;
+  }
+  for (i = 0; i < Fake_Twi.DeviceCount && device == NULL; i++)
+  {
+    if (Fake_Twi.Devices[i]->Address == address &&
+        (Fake_Twi.Devices[i]->Channels == 0 || (Fake_Twi.Devices[i]->Channels & Fake_Twi.Mux) != 0))
+    {
+      device = Fake_Twi.Devices[i];
+    }
+  }
+  if (device == NULL)
+  {
+    return NRF_ERROR_DRV_TWI_ERR_ANACK;
+  }
+  if (device->Fail != 0)
+  {
+    device->Fail--;
+    device->Failures++;
+    Fake_Twi.SdaLow = device->HoldSda;
+    return device->Error != 0 ? device->Error : NRF_ERROR_DRV_TWI_ERR_ANACK;
+  }
+  Fake_Twi.Us += device->StretchUs;
+  device->Transfers++;
+  if (device->Handler != NULL)
+  {
+    return device->Handler(device, transfer);
+  }
+  if (NRF_TWI_MNGR_IS_READ_OP(transfer->operation))
+  {
+    memset(transfer->p_data, 0, transfer->length);
+  }
+  return NRF_SUCCESS;
+}
+
+// Transfers in a row until one fails, as the manager does
+static ret_code_t FakeTwi_Transfers(const nrf_twi_mngr_transfer_t *p_transfers, uint8_t number_of_transfers)
+{
+  ret_code_t result = NRF_SUCCESS;
+  uint8_t i;
+
+  FakeTwi_Running = 1;
+  for (i = 0; i < number_of_transfers && result == NRF_SUCCESS; i++)
+  {
+    result = FakeTwi_Transfer(&p_transfers[i]);
+  }
+  FakeTwi_Running = 0;
+  Fake_Twi.Transactions++;
+  return result;
+}
+
+uint8_t FakeTwi_Run(void)
+{
+  const nrf_twi_mngr_transaction_t *transaction;
+  ret_code_t result;
+
+  if (FakeTwi_Count == 0)
+  {
+    return 0;
+  }
+  transaction = FakeTwi_Queue[FakeTwi_Head];
+  FakeTwi_Head = (FakeTwi_Head + 1) % FAKE_TWI_QUEUE;
+  FakeTwi_Count--;
+
+  result = FakeTwi_Transfers(transaction->p_transfers, transaction->number_of_transfers);
+  if (transaction->callback != NULL)
+  {
+    Fake_Twi.InCallback++;
+    transaction->callback(result, transaction->p_user_data);
+    Fake_Twi.InCallback--;
+  }
+  return 1;
+}
+
+uint32_t FakeTwi_RunAll(void)
+{
+  uint32_t count = 0;
+
+  while (FakeTwi_Run())
+  {
+    count++;
+  }
+  return count;
+}
+
+static uint64_t FakeTwi_TicksToUs(uint32_t ticks)
+{
+  return ((uint64_t)ticks * 1000000 + APP_TIMER_CLOCK_FREQ - 1) / APP_TIMER_CLOCK_FREQ;
+}
+
+static FAKE_TWI_TIMER *FakeTwi_Timer(app_timer_id_t id)
+{
+  uint8_t i;
+
+  for (i = 0; i < FAKE_TWI_TIMERS; i++)
+  {
+    if (FakeTwi_Timers[i].Id == id)
+    {
+      return &FakeTwi_Timers[i];
+    }
+  }
+  return NULL;
+}
+
+// Timer due first, up to the time limit
+static FAKE_TWI_TIMER *FakeTwi_Due(uint64_t limit)
+{
+  FAKE_TWI_TIMER *due = NULL;
+  uint8_t i;
+
+  for (i = 0; i < FAKE_TWI_TIMERS; i++)
+  {
+    if (FakeTwi_Timers[i].Running && FakeTwi_Timers[i].Due <= limit && (due == NULL || FakeTwi_Timers[i].Due < due->Due))
+    {
+      due = &FakeTwi_Timers[i];
+    }
+  }
+  return due;
+}
+
+static void FakeTwi_Fire(FAKE_TWI_TIMER *timer)
+{
+  Fake_Twi.Us = MAX(Fake_Twi.Us, timer->Due);
+  if (timer->Mode == APP_TIMER_MODE_REPEATED)
+  {
+    timer->Due += timer->Period;
+  }
+  else
+  {
+    timer->Running = 0;
+  }
+  timer->Handler(timer->Context);
+}
+
+void FakeTwi_Advance(uint32_t us)
+{
+  uint64_t end = Fake_Twi.Us + us;
+  FAKE_TWI_TIMER *timer;
+
+  while ((timer = FakeTwi_Due(end)) != NULL)
+  {
+    FakeTwi_Fire(timer);
+  }
+  Fake_Twi.Us = MAX(Fake_Twi.Us, end);
+}
+
+void FakeTwi_RunFor(uint32_t us)
+{
+  uint64_t end = Fake_Twi.Us + us;
+  FAKE_TWI_TIMER *timer;
+
+  while (Fake_Twi.Us < end)
+  {
+    if ((timer = FakeTwi_Due(Fake_Twi.Us)) != NULL)
+    {
+      FakeTwi_Fire(timer);
+    }
+    else if (!FakeTwi_Run())
+    {
+      timer = FakeTwi_Due(end);
+      Fake_Twi.Us = (timer != NULL) ? timer->Due : end;
+    }
+  }
+}
+
+uint8_t FakeTwi_NextTimer(void)
+{
+  FAKE_TWI_TIMER *timer = FakeTwi_Due(UINT64_MAX);
+
+  if (timer == NULL)
+  {
+    return 0;
+  }
+  FakeTwi_Fire(timer);
+  return 1;
+}
+
+// Wait for an event: the next TWI interrupt, or else the next timer
+void __WFE(void)
+{
+  if (!FakeTwi_Run() && !FakeTwi_NextTimer())
+  {
+    printf("__WFE: nothing left to wake up\n");
+    abort();
+  }
+}
+
+ret_code_t nrf_twi_mngr_init(nrf_twi_mngr_t const *p_nrf_twi_mngr, nrf_drv_twi_config_t const *p_default_twi_config)
+{
+  return NRF_SUCCESS;
+}
+
+ret_code_t nrf_twi_mngr_schedule(nrf_twi_mngr_t const *p_nrf_twi_mngr, nrf_twi_mngr_transaction_t const *p_transaction)
+{
+  if (FakeTwi_Count >= Fake_Twi.QueueSize)
+  {
+    Fake_Twi.Rejected++;
+    return NRF_ERROR_NO_MEM;
+  }
+  FakeTwi_Queue[(FakeTwi_Head + FakeTwi_Count) % FAKE_TWI_QUEUE] = p_transaction;
+  FakeTwi_Count++;
+  return NRF_SUCCESS;
+}
+
+// Waits behind the transactions queued so far, as the manager does: those
+// scheduled from their callbacks come after it
+ret_code_t nrf_twi_mngr_perform(nrf_twi_mngr_t const *p_nrf_twi_mngr, void const *p_config, nrf_twi_mngr_transfer_t const *p_transfers,
+                                uint8_t number_of_transfers, void (*user_function)(void))
+{
+  uint8_t ahead = FakeTwi_Count;
+
+  if (Fake_Twi.InCallback)
+  {
+    printf("nrf_twi_mngr_perform: called from a transaction callback, it never returns\n");
+    abort();
+  }
+  while (ahead-- != 0)
+  {
+    FakeTwi_Run();
+  }
+  return FakeTwi_Transfers(p_transfers, number_of_transfers);
+}
+
+bool nrf_twi_mngr_is_idle(nrf_twi_mngr_t const *p_nrf_twi_mngr)
+{
+  return FakeTwi_Count == 0 && !FakeTwi_Running;
+}
+
+// A clear in thread mode with a transaction queued cuts into it on the board
+void nrf_drv_twi_disable(nrf_drv_twi_t const *p_instance)
+{
+  Fake_Twi.Clears++;
+  if (FakeTwi_Running || (!Fake_Twi.InCallback && FakeTwi_Count != 0))
+  {
+    Fake_Twi.UnsafeClears++;
+  }
+}
+
+void nrf_drv_twi_enable(nrf_drv_twi_t const *p_instance)
+{
+}
+
+void nrf_gpio_cfg(uint32_t pin_number, int dir, int input, int pull, int drive, int sense)
+{
+}
+
+void nrf_gpio_cfg_output(uint32_t pin_number)
+{
+}
+
+void nrf_gpio_pin_set(uint32_t pin_number)
+{
+}
+
+// Each SCL pulse lets a device stuck in a read shift out one more bit
+void nrf_gpio_pin_clear(uint32_t pin_number)
+{
+  if (pin_number == SCL_PIN_NUMBER && Fake_Twi.SdaLow != 0)
+  {
+    Fake_Twi.SdaLow--;
+  }
+}
+
+void nrf_gpio_pin_toggle(uint32_t pin_number)
+{
+}
+
+uint32_t nrf_gpio_pin_read(uint32_t pin_number)
+{
+  return pin_number != SDA_PIN_NUMBER || Fake_Twi.SdaLow == 0;
+}
+
+ret_code_t app_timer_init(void)
+{
+  return NRF_SUCCESS;
+}
+
+ret_code_t app_timer_create(app_timer_id_t const *p_timer_id, app_timer_mode_t mode, app_timer_timeout_handler_t timeout_handler)
+{
+  FAKE_TWI_TIMER *timer = FakeTwi_Timer(*p_timer_id);
+
+  if (timer == NULL)
+  {
+    timer = FakeTwi_Timer(NULL);
+  }
+  if (timer == NULL)
+  {
+    return NRF_ERROR_NO_MEM;
+  }
+  memset(timer, 0, sizeof(*timer));
+  timer->Id = *p_timer_id;
+  timer->Mode = mode;
+  timer->Handler = timeout_handler;
+  return NRF_SUCCESS;
+}
+
+ret_code_t app_timer_start(app_timer_id_t timer_id, uint32_t timeout_ticks, void *p_context)
+{
+  FAKE_TWI_TIMER *timer = FakeTwi_Timer(timer_id);
+
+  if (timer == NULL || timeout_ticks < APP_TIMER_MIN_TIMEOUT_TICKS)
+  {
+    return NRF_ERROR_INVALID_PARAM;
+  }
+  timer->Period = FakeTwi_TicksToUs(timeout_ticks);
+  timer->Due = Fake_Twi.Us + timer->Period;
+  timer->Context = p_context;
+  timer->Running = 1;
+  return NRF_SUCCESS;
+}
+
+ret_code_t app_timer_stop(app_timer_id_t timer_id)
+{
+  FAKE_TWI_TIMER *timer = FakeTwi_Timer(timer_id);
+
+  if (timer != NULL)
+  {
+    timer->Running = 0;
+  }
+  return NRF_SUCCESS;
+}
+
+uint32_t app_timer_cnt_get(void)
+{
+  return (uint32_t)(Fake_Twi.Us * APP_TIMER_CLOCK_FREQ / 1000000) & 0xFFFFFF;
+}
+
+uint32_t app_timer_cnt_diff_compute(uint32_t ticks_to, uint32_t ticks_from)
+{
+  return (ticks_to - ticks_from) & 0xFFFFFF;
+}
@@ -0,0 +1,100 @@
+/*
+ *      fake_twi.h
+ *
+ *	The MIT License.
+ */
+
+#ifndef __FAKE_TWI_H__
+#define __FAKE_TWI_H__
+
+#include "nrf_twi_mngr.h"
+
+#define FAKE_TWI_QUEUE (32)
+#define FAKE_TWI_DEVICES (16)
+#define FAKE_TWI_TIMERS (16)
+
+typedef struct FAKE_TWI_DEVICE_s FAKE_TWI_DEVICE;
+
+// Answers one transfer to the device: takes the bytes written, or fills in
+// the bytes read. Returns NRF_SUCCESS, or the error the transaction ends with.
+typedef ret_code_t (*FAKE_TWI_handler_t)(FAKE_TWI_DEVICE *device, const nrf_twi_mngr_transfer_t *transfer);
+
+// A device on the bus, or behind the mux channels in Channels
+struct FAKE_TWI_DEVICE_s
+{
+  uint8_t Address;
+  uint8_t Channels;             // Channel mask of the mux in front of it, 0 when on the bus
+  FAKE_TWI_handler_t Handler;   // NULL: writes are acknowledged, reads give 0
+  void *Context;
+  uint8_t Fail;                 // Transfers still to fail with Error
+  ret_code_t Error;             // NRF_ERROR_DRV_TWI_ERR_ANACK when 0
+  uint8_t HoldSda;              // SCL pulses it keeps SDA low after a failure
+  uint32_t StretchUs;           // Clock stretching per transfer
+  uint32_t Transfers;           // Transfers it answered
+  uint32_t Failures;            // Transfers it failed
+};
+
+// Model of one TWI bus behind nrf_twi_mngr. Scheduled transactions wait in
+// the manager queue until FakeTwi_Run, which plays the TWI interrupt: it
+// runs the oldest one on the bus and calls its callback. Bus time moves the
+// app_timer clock, and FakeTwi_Advance fires the timers that are due. An
+// optional TCA9548A at MuxAddress connects the devices behind the channels
+// it has selected.
+typedef struct
+{
+  FAKE_TWI_DEVICE *Devices[FAKE_TWI_DEVICES];
+  uint8_t DeviceCount;
+  uint8_t QueueSize;            // Manager queue length, up to FAKE_TWI_QUEUE
+  uint8_t MuxAddress;           // 0 without a mux
+  uint8_t Mux;                  // Channel mask the mux has selected
+  uint8_t SdaLow;               // SCL pulses until SDA is let go
+  uint8_t InCallback;           // A transaction callback is running
+  uint64_t Us;                  // Time since FakeTwi_Init
+  uint32_t Transactions;        // Transactions run
+  uint32_t Bytes;               // Bytes on the bus, addresses included
+  uint32_t Misrouted;           // Transfers answered by a device behind a channel it was not for
+  uint16_t Clears;              // Bus clears
+  uint16_t UnsafeClears;        // Bus clears while the manager had a transaction to run
+  uint16_t Rejected;            // nrf_twi_mngr_schedule calls refused with a full queue
+} FAKE_TWI;
+
+extern FAKE_TWI Fake_Twi;
+
+/**
+ * @brief Clears the model: no devices, no mux, an empty queue of queue_size, time 0.
+ */
+void FakeTwi_Init(uint8_t queue_size);
+/**
+ * @brief Puts a device on the bus. It must stay valid until the next FakeTwi_Init.
+ */
+void FakeTwi_Add(FAKE_TWI_DEVICE *device);
+/**
+ * @brief Runs the oldest queued transaction and calls its callback.
+ * @return 0 when the queue is empty.
+ */
+uint8_t FakeTwi_Run(void);
+/**
+ * @brief Runs queued transactions until the queue stays empty.
+ * @return Number of transactions run.
+ */
+uint32_t FakeTwi_RunAll(void);
+/**
+ * @brief Moves the clock by us, firing the app_timer timers due on the way.
+ */
+void FakeTwi_Advance(uint32_t us);
+/**
+ * @brief Keeps the bus busy for us: runs the queued transactions back to
+ *        back and fires the timers as they come due.
+ */
+void FakeTwi_RunFor(uint32_t us);
+/**
+ * @brief Moves the clock to the next timer due and fires it.
+ * @return 0 when no timer is running.
+ */
+uint8_t FakeTwi_NextTimer(void);
+/**
+ * @brief Number of transactions waiting in the manager queue.
+ */
+uint8_t FakeTwi_Queued(void);
+
+#endif // __FAKE_TWI_H__
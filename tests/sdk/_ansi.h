@@ -0,0 +1,20 @@
+/*
+ *      _ansi.h
+ *
+ *	The MIT License.
+ */
+
+// newlib header of the target toolchain
+
+#ifndef __HOST_ANSI_H__
+#define __HOST_ANSI_H__
+
+#ifdef __cplusplus
+#define _BEGIN_STD_C extern "C" {
+#define _END_STD_C }
+#else
+#define _BEGIN_STD_C
+#define _END_STD_C
+#endif
+
+#endif // __HOST_ANSI_H__
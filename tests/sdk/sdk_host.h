@@ -0,0 +1,191 @@
+/*
+ *      sdk_host.h
+ *
+ *	The MIT License.
+ */
+
+// Host stand-in for the parts of the nRF5 SDK the firmware modules use.
+// Declarations only, the tests define the functions they call. Every SDK
+// header in this directory includes this one.
+
+#ifndef __SDK_HOST_H__
+#define __SDK_HOST_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+// sdk_errors.h
+typedef uint32_t ret_code_t;
+#define NRF_SUCCESS (0)
+#define NRF_ERROR_INTERNAL (3)
+#define NRF_ERROR_NO_MEM (4)
+#define NRF_ERROR_NOT_FOUND (5)
+#define NRF_ERROR_NOT_SUPPORTED (6)
+#define NRF_ERROR_INVALID_PARAM (7)
+#define NRF_ERROR_INVALID_STATE (8)
+#define NRF_ERROR_INVALID_LENGTH (9)
+#define NRF_ERROR_TIMEOUT (13)
+#define NRF_ERROR_FORBIDDEN (15)
+#define NRF_ERROR_BUSY (17)
+#define NRF_ERROR_DRV_TWI_ERR_OVERRUN (0x8200)
+#define NRF_ERROR_DRV_TWI_ERR_ANACK (0x8201)
+#define NRF_ERROR_DRV_TWI_ERR_DNACK (0x8202)
+
+// app_error.h, nrf_log.h
+#define APP_ERROR_CHECK(err_code) ((void)(err_code))
+#define APP_ERROR_HANDLER(err_code) ((void)(err_code))
+#define NRF_LOG_INFO(...) ((void)0)
+#define NRF_LOG_WARNING(...) ((void)0)
+#define NRF_LOG_ERROR(...) ((void)0)
+#define NRF_LOG_DEBUG(...) ((void)0)
+#define NRF_LOG_FLUSH() ((void)0)
+#define NRF_LOG_INIT(timestamp) (NRF_SUCCESS)
+#define NRF_LOG_DEFAULT_BACKENDS_INIT() ((void)0)
+#define NRF_LOG_FLOAT_MARKER "%s%d.%02d"
+#define NRF_LOG_FLOAT(val) "", (int)(val), 0
+
+// nordic_common.h, app_util.h, app_util_platform.h
+#ifndef MIN
+#define MIN(a, b) ((a) < (b) ? (a) : (b))
+#endif
+#ifndef MAX
+#define MAX(a, b) ((a) < (b) ? (b) : (a))
+#endif
+#define CEIL_DIV(A, B) (((A) + (B)-1) / (B))
+#define ARRAY_SIZE(arr) (sizeof(arr) / sizeof((arr)[0]))
+#define UNUSED_PARAMETER(x) ((void)(x))
+#define UNUSED_VARIABLE(x) ((void)(x))
+#define STATIC_ASSERT(cond) _Static_assert(cond, #cond)
+#define CRITICAL_REGION_ENTER() {
+#define CRITICAL_REGION_EXIT() }
+#define __DMB() __sync_synchronize()
+void __WFE(void);
+#define __CLZ(x) ((uint8_t)__builtin_clz(x))
+
+// nrf_delay.h
+static inline void nrf_delay_ms(uint32_t ms) { (void)ms; }
+static inline void nrf_delay_us(uint32_t us) { (void)us; }
+
+// app_timer.h
+typedef struct
+{
+  int Id;
+} app_timer_t;
+typedef app_timer_t *app_timer_id_t;
+typedef enum
+{
+  APP_TIMER_MODE_SINGLE_SHOT,
+  APP_TIMER_MODE_REPEATED
+} app_timer_mode_t;
+typedef void (*app_timer_timeout_handler_t)(void *p_context);
+#define APP_TIMER_DEF(timer_id)              \
+  static app_timer_t timer_id##_data;        \
+  static const app_timer_id_t timer_id = &timer_id##_data
+#define APP_TIMER_CLOCK_FREQ (32768)
+#define APP_TIMER_MIN_TIMEOUT_TICKS (5)
+#define APP_TIMER_TICKS(MS) ((uint32_t)(((MS) * (uint64_t)APP_TIMER_CLOCK_FREQ) / 1000))
+ret_code_t app_timer_init(void);
+ret_code_t app_timer_create(app_timer_id_t const *p_timer_id, app_timer_mode_t mode, app_timer_timeout_handler_t timeout_handler);
+ret_code_t app_timer_start(app_timer_id_t timer_id, uint32_t timeout_ticks, void *p_context);
+ret_code_t app_timer_stop(app_timer_id_t timer_id);
+uint32_t app_timer_cnt_get(void);
+uint32_t app_timer_cnt_diff_compute(uint32_t ticks_to, uint32_t ticks_from);
+
+// nrf_drv_twi.h, nrf_twi_mngr.h
+#define NRF_TWI_MNGR_NO_STOP (0x01)
+#define NRF_TWI_MNGR_BUFFER_LOC_IND
+#define NRF_TWI_MNGR_WRITE_OP(address) (((address) << 1) & ~0x01)
+#define NRF_TWI_MNGR_READ_OP(address) (((address) << 1) | 0x01)
+#define NRF_TWI_MNGR_IS_READ_OP(operation) ((operation)&0x01)
+#define NRF_TWI_MNGR_OP_ADDRESS(operation) ((operation) >> 1)
+#define NRF_TWI_MNGR_TRANSFER(_operation, _p_data, _length, _flags) \
+  {                                                                 \
+    .p_data = (uint8_t *)(_p_data),                                 \
+    .length = _length,                                              \
+    .operation = _operation,                                        \
+    .flags = _flags                                                 \
+  }
+#define NRF_TWI_MNGR_WRITE(address, p_data, length, flags) NRF_TWI_MNGR_TRANSFER(NRF_TWI_MNGR_WRITE_OP(address), p_data, length, flags)
+#define NRF_TWI_MNGR_READ(address, p_data, length, flags) NRF_TWI_MNGR_TRANSFER(NRF_TWI_MNGR_READ_OP(address), p_data, length, flags)
+#define NRF_TWI_MNGR_DEF(name, queue_size, twi_idx) static nrf_twi_mngr_t name
+#define NRF_DRV_TWI_DEFAULT_CONFIG {0}
+#define TWIM_FREQUENCY_FREQUENCY_K100 (0x01980000)
+#define TWIM_FREQUENCY_FREQUENCY_K400 (0x06400000)
+typedef struct
+{
+  uint8_t *p_data;
+  uint8_t length;
+  uint8_t operation;
+  uint8_t flags;
+} nrf_twi_mngr_transfer_t;
+typedef void (*nrf_twi_mngr_callback_t)(ret_code_t result, void *p_user_data);
+typedef struct
+{
+  nrf_twi_mngr_callback_t callback;
+  void *p_user_data;
+  nrf_twi_mngr_transfer_t const *p_transfers;
+  uint8_t number_of_transfers;
+  void const *p_required_twi_cfg;
+} nrf_twi_mngr_transaction_t;
+typedef struct
+{
+  int Instance;
+} nrf_drv_twi_t;
+typedef struct
+{
+  uint32_t scl;
+  uint32_t sda;
+  uint32_t frequency;
+  uint8_t interrupt_priority;
+  bool clear_bus_init;
+  bool hold_bus_uninit;
+} nrf_drv_twi_config_t;
+typedef struct
+{
+  nrf_drv_twi_t twi;
+} nrf_twi_mngr_t;
+void nrf_drv_twi_enable(nrf_drv_twi_t const *p_instance);
+void nrf_drv_twi_disable(nrf_drv_twi_t const *p_instance);
+ret_code_t nrf_twi_mngr_init(nrf_twi_mngr_t const *p_nrf_twi_mngr, nrf_drv_twi_config_t const *p_default_twi_config);
+ret_code_t nrf_twi_mngr_schedule(nrf_twi_mngr_t const *p_nrf_twi_mngr, nrf_twi_mngr_transaction_t const *p_transaction);
+ret_code_t nrf_twi_mngr_perform(nrf_twi_mngr_t const *p_nrf_twi_mngr, void const *p_config, nrf_twi_mngr_transfer_t const *p_transfers,
+                                uint8_t number_of_transfers, void (*user_function)(void));
+bool nrf_twi_mngr_is_idle(nrf_twi_mngr_t const *p_nrf_twi_mngr);
+
+// nrf_gpio.h, nrf_drv_gpiote.h, boards.h
+#define LED_1 (17)
+#define BUTTON_1 (13)
+#define SCL_PIN_NUMBER (27)
+#define SDA_PIN_NUMBER (26)
+typedef int nrf_gpio_pin_dir_t;
+#define NRF_GPIO_PIN_DIR_INPUT (0)
+#define NRF_GPIO_PIN_DIR_OUTPUT (1)
+#define NRF_GPIO_PIN_INPUT_CONNECT (0)
+#define NRF_GPIO_PIN_INPUT_DISCONNECT (1)
+#define NRF_GPIO_PIN_NOPULL (0)
+#define NRF_GPIO_PIN_PULLUP (3)
+#define NRF_GPIO_PIN_S0D1 (6)
+#define NRF_GPIO_PIN_NOSENSE (0)
+void nrf_gpio_cfg(uint32_t pin_number, int dir, int input, int pull, int drive, int sense);
+void nrf_gpio_cfg_output(uint32_t pin_number);
+void nrf_gpio_pin_set(uint32_t pin_number);
+void nrf_gpio_pin_clear(uint32_t pin_number);
+void nrf_gpio_pin_toggle(uint32_t pin_number);
+uint32_t nrf_gpio_pin_read(uint32_t pin_number);
+typedef uint32_t nrf_drv_gpiote_pin_t;
+typedef int nrf_gpiote_polarity_t;
+
+// crc16.h, nrf_nvmc.h
+uint16_t crc16_compute(uint8_t const *p_data, uint32_t size, uint16_t const *p_crc);
+void nrf_nvmc_page_erase(uint32_t address);
+void nrf_nvmc_write_words(uint32_t address, const uint32_t *src, uint32_t num_words);
+
+// SEGGER_RTT.h
+#define SEGGER_RTT_MODE_NO_BLOCK_SKIP (0)
+int SEGGER_RTT_ConfigUpBuffer(unsigned BufferIndex, const char *sName, void *pBuffer, unsigned BufferSize, unsigned Flags);
+unsigned SEGGER_RTT_Write(unsigned BufferIndex, const void *pBuffer, unsigned NumBytes);
+
+#endif // __SDK_HOST_H__
@@ -0,0 +1,46 @@
+/*
+ *      test.h
+ *
+ *	The MIT License.
+ */
+
+// Checks of the host tests. A failed check is reported and counted, the
+// test goes on, and TEST_EXIT() makes the exit status fail.
+
+#ifndef __TEST_H__
+#define __TEST_H__
+
+#include <stdio.h>
+
+static int Test_Failures;
+
+#define CHECK(cond)                                                      \
+  do                                                                     \
+  {                                                                      \
+    if (!(cond))                                                         \
+    {                                                                    \
+      printf("%s:%d: %s: CHECK(%s) failed\n", __FILE__, __LINE__, __func__, #cond); \
+      Test_Failures++;                                                   \
+    }                                                                    \
+  } while (0)
+
+#define CHECK_EQ(actual, expected)                                       \
+  do                                                                     \
+  {                                                                      \
+    long long test_actual = (long long)(actual);                         \
+    long long test_expected = (long long)(expected);                     \
+    if (test_actual != test_expected)                                    \
+    {                                                                    \
+      printf("%s:%d: %s: %s is %lld, expected %lld\n", __FILE__, __LINE__, __func__, #actual, test_actual, test_expected); \
+      Test_Failures++;                                                   \
+    }                                                                    \
+  } while (0)
+
+#define TEST_EXIT()                                                      \
+  do                                                                     \
+  {                                                                      \
+    printf("%s\n", Test_Failures ? "FAIL" : "PASS");                     \
+    return Test_Failures != 0;                                           \
+  } while (0)
+
+#endif // __TEST_H__
@@ -0,0 +1,185 @@
+/*
+ *      test_adaptive_sampling.c
+ *
+ *	The MIT License.
+ */
+
+#include <stdlib.h>
+
+#include "adaptive_sampling.h"
+#include "test.h"
+
+// The policy as main.c sets it up
+#define MIN_PERIOD (1000)
+#define MAX_PERIOD (60000)
+#define TEMPERATURE_BAND (10)
+#define HUMIDITY_BAND (2)
+
+// Six hours of a room, replayed a second at a time
+#define SECONDS (6 * 3600)
+
+static ADAPTIVE_SAMPLING Policy;
+static int32_t Temperature[SECONDS];
+static int16_t Humidity[SECONDS];
+
+// Noise of the sensor, within a third of the band
+static int32_t Noise(int32_t band)
+{
+  return rand() % (2 * (band / 3) + 1) - band / 3;
+}
+
+// Linear move to the given values from the second start to end
+static void Ramp(uint32_t start, uint32_t end, int32_t *temperature, int32_t *humidity, int32_t temperature_to, int32_t humidity_to)
+{
+  uint32_t t;
+
+  for (t = start; t < end; t++)
+  {
+    Temperature[t] = *temperature + (temperature_to - *temperature) * (int32_t)(t - start) / (int32_t)(end - start);
+    Humidity[t] = *humidity + (humidity_to - *humidity) * (int32_t)(t - start) / (int32_t)(end - start);
+  }
+  *temperature = temperature_to;
+  *humidity = humidity_to;
+}
+
+// An hour at 21 C and 45 %RH, a window opened for 5 minutes, an hour to
+// warm up again, a shower, then a slow drift of the afternoon sun
+static void Record(void)
+{
+  int32_t temperature = 2100;
+  int32_t humidity = 45;
+  uint32_t t;
+
+  Ramp(0, 3600, &temperature, &humidity, 2100, 45);
+  Ramp(3600, 3900, &temperature, &humidity, 1800, 40);
+  Ramp(3900, 7500, &temperature, &humidity, 2100, 45);
+  Ramp(7500, 7620, &temperature, &humidity, 2150, 75);
+  Ramp(7620, 9000, &temperature, &humidity, 2100, 45);
+  Ramp(9000, SECONDS, &temperature, &humidity, 2300, 45);
+  srand(1);
+  for (t = 0; t < SECONDS; t++)
+  {
+    Temperature[t] += Noise(TEMPERATURE_BAND);
+  }
+}
+
+// What the display showed at each second, and the period asked for at
+// each sample, 0 between samples
+static uint32_t Periods[SECONDS];
+static int32_t TemperatureGap[SECONDS];
+static int32_t HumidityGap[SECONDS];
+
+// Samples the recording as the policy asks, and keeps the gap between the
+// last sample and the room at each second
+static void Replay(void)
+{
+  uint32_t next = 0;
+  int32_t shown_temperature = 0;
+  int32_t shown_humidity = 0;
+  uint32_t t;
+
+  AdaptiveSampling_Init(&Policy, MIN_PERIOD, MAX_PERIOD, TEMPERATURE_BAND, HUMIDITY_BAND);
+  for (t = 0; t < SECONDS; t++)
+  {
+    Periods[t] = 0;
+    if (t == next)
+    {
+      Periods[t] = AdaptiveSampling_Update(&Policy, Temperature[t], Humidity[t]);
+      CHECK(Periods[t] >= MIN_PERIOD);
+      CHECK(Periods[t] <= MAX_PERIOD);
+      next = t + Periods[t] / 1000;
+      shown_temperature = Temperature[t];
+      shown_humidity = Humidity[t];
+    }
+    TemperatureGap[t] = abs(Temperature[t] - shown_temperature);
+    HumidityGap[t] = abs(Humidity[t] - shown_humidity);
+  }
+}
+
+typedef struct
+{
+  uint32_t Samples;
+  int32_t TemperatureGap;     // Largest, in centi-degrees
+  int32_t HumidityGap;        // Largest, in %RH
+} SPAN;
+
+static SPAN Span(uint32_t start, uint32_t end)
+{
+  SPAN span = {0};
+  uint32_t t;
+
+  for (t = start; t < end; t++)
+  {
+    span.Samples += Periods[t] != 0;
+    if (TemperatureGap[t] > span.TemperatureGap)
+    {
+      span.TemperatureGap = TemperatureGap[t];
+    }
+    if (HumidityGap[t] > span.HumidityGap)
+    {
+      span.HumidityGap = HumidityGap[t];
+    }
+  }
+  return span;
+}
+
+// First sample that saw a change, the period drops below the longest
+static uint32_t Detected(uint32_t start)
+{
+  uint32_t t = start;
+
+  while (t < SECONDS && (Periods[t] == 0 || Periods[t] == MAX_PERIOD))
+  {
+    t++;
+  }
+  return t;
+}
+
+// Quiet spells are sampled at the longest period. A change is seen within
+// two of them and followed within two bands until it settles.
+static void test_Replay(void)
+{
+  SPAN span;
+  uint32_t detected;
+
+  Record();
+  Replay();
+
+  span = Span(MAX_PERIOD / 1000, 3600);
+  CHECK(span.Samples <= 3600 / (MAX_PERIOD / 1000) + 1);
+  CHECK(span.TemperatureGap < TEMPERATURE_BAND);
+  CHECK_EQ(span.HumidityGap, 0);
+
+  // The window: 3 C in 5 minutes
+  detected = Detected(3600);
+  CHECK(detected <= 3600 + 2 * MAX_PERIOD / 1000);
+  span = Span(detected + 1, 3900);
+  CHECK(span.TemperatureGap <= 2 * TEMPERATURE_BAND);
+  CHECK(span.Samples >= (3900 - detected) / 10);
+
+  // Warming up again at a twelfth of the rate is sampled less often
+  span = Span(3900, 7500);
+  CHECK(span.TemperatureGap <= 2 * TEMPERATURE_BAND);
+  CHECK(span.Samples <= 3600 / 30);
+
+  // The shower: 30 %RH in 2 minutes
+  detected = Detected(7500);
+  CHECK(detected <= 7500 + 2 * MAX_PERIOD / 1000);
+  span = Span(detected + 1, 7620);
+  CHECK(span.HumidityGap <= 2 * HUMIDITY_BAND);
+
+  // A drift of 2 C in 3.5 hours needs no more than the longest period
+  span = Span(9000, SECONDS);
+  CHECK(span.Samples <= (SECONDS - 9000) / (MAX_PERIOD / 1000) + 1);
+  CHECK(span.TemperatureGap < TEMPERATURE_BAND);
+
+  span = Span(0, SECONDS);
+  CHECK(span.Samples * 20 < SECONDS);
+  printf("Samples in %u s: %u\n", (unsigned)SECONDS, (unsigned)span.Samples);
+}
+
+int main(void)
+{
+  test_Replay();
+  TEST_EXIT();
+}
@@ -0,0 +1,137 @@
+/*
+ *      test_bin_log.c
+ *
+ *	The MIT License.
+ */
+
+#include <string.h>
+
+#include "bin_log.h"
+#include "test.h"
+
+static uint8_t Rtt_Stream[64 * BINLOG_RECORD_SIZE];
+static unsigned Rtt_Length;
+static unsigned Rtt_Channel;
+static unsigned Rtt_Size;
+static uint8_t Rtt_Full;
+static uint32_t Ticks;
+
+uint32_t app_timer_cnt_get(void)
+{
+  return Ticks;
+}
+
+int SEGGER_RTT_ConfigUpBuffer(unsigned BufferIndex, const char *sName, void *pBuffer, unsigned BufferSize, unsigned Flags)
+{
+  (void)sName;
+  (void)pBuffer;
+  (void)Flags;
+  Rtt_Channel = BufferIndex;
+  Rtt_Size = BufferSize;
+  return 0;
+}
+
+// Keeps the stream, or drops the record whole as a full RTT buffer does
+unsigned SEGGER_RTT_Write(unsigned BufferIndex, const void *pBuffer, unsigned NumBytes)
+{
+  CHECK_EQ(BufferIndex, BINLOG_RTT_CHANNEL);
+  if (Rtt_Full || Rtt_Length + NumBytes > sizeof(Rtt_Stream))
+  {
+    return 0;
+  }
+  memcpy(&Rtt_Stream[Rtt_Length], pBuffer, NumBytes);
+  Rtt_Length += NumBytes;
+  return NumBytes;
+}
+
+static uint16_t Field(const uint8_t *record, uint8_t i)
+{
+  return record[8 + 2 * i] | record[9 + 2 * i] << 8;
+}
+
+static void test_RecordLayout(void)
+{
+  const uint8_t *record = Rtt_Stream;
+  uint8_t check = 0;
+  uint8_t i;
+
+  Rtt_Length = 0;
+  BinLog_Init();
+  CHECK_EQ(Rtt_Channel, BINLOG_RTT_CHANNEL);
+  CHECK_EQ(Rtt_Size, BINLOG_BUFFER_RECORDS * BINLOG_RECORD_SIZE);
+
+  Ticks = 0x00ABCDEF;
+  BinLog_Write(BINLOG_MOISTURE, -1234, (int16_t)60000, 2, INT16_MIN);
+  CHECK_EQ(Rtt_Length, BINLOG_RECORD_SIZE);
+  CHECK_EQ(record[0], BINLOG_SYNC);
+  CHECK_EQ(record[1], BINLOG_MOISTURE);
+  for (i = 0; i < BINLOG_RECORD_SIZE; i++)
+  {
+    check ^= record[i];
+  }
+  CHECK_EQ(check, 0);
+  CHECK_EQ(record[4] | record[5] << 8 | record[6] << 16 | (uint32_t)record[7] << 24, 0x00ABCDEF);
+  CHECK_EQ((int16_t)Field(record, 0), -1234);
+  CHECK_EQ(Field(record, 1), 60000);
+  CHECK_EQ(Field(record, 2), 2);
+  CHECK_EQ(Field(record, 3), 0x8000);
+}
+
+static void test_SequenceCountsDrops(void)
+{
+  uint8_t first;
+  uint16_t i;
+
+  Rtt_Length = 0;
+  BinLog_Write(BINLOG_SAMPLER, 0, 0, 0, 0);
+  first = Rtt_Stream[2];
+  Rtt_Full = 1;
+  BinLog_Write(BINLOG_SAMPLER, 0, 0, 0, 0);
+  Rtt_Full = 0;
+  for (i = 0; i < 40; i++)
+  {
+    Rtt_Length = BINLOG_RECORD_SIZE;
+    BinLog_Write(BINLOG_SAMPLER, 0, 0, 0, 0);
+  }
+  // The gap shows the record lost to the full buffer
+  CHECK_EQ((uint8_t)(Rtt_Stream[BINLOG_RECORD_SIZE + 2] - first), 41);
+}
+
+// A stream for binlog_decode: records, a drop, garbage and an RTC wrap
+static void WriteStream(const char *path)
+{
+  static const uint8_t garbage[] = {BINLOG_SYNC, 0x00, 0x42};
+  FILE *file;
+
+  Rtt_Length = 0;
+  Ticks = 0x00FF8000;
+  BinLog_Write(BINLOG_CLIMATE, -525, 45, 25, 1);
+  Ticks = (Ticks + 32768) & 0xFFFFFF;
+  BinLog_Write(BINLOG_DATETIME, 2026, 10 << 8 | 19, 12 << 8 | 34, 56);
+  Rtt_Full = 1;
+  BinLog_Write(BINLOG_SAMPLER, 100, 0, 0, 0);
+  Rtt_Full = 0;
+  memcpy(&Rtt_Stream[Rtt_Length], garbage, sizeof(garbage));
+  Rtt_Length += sizeof(garbage);
+  Ticks = (Ticks + 32768) & 0xFFFFFF;
+  BinLog_Write(BINLOG_TWI, 1 << 8 | 0x40, 3, 1, 0);
+
+  file = fopen(path, "wb");
+  CHECK(file != NULL);
+  if (file != NULL)
+  {
+    CHECK_EQ(fwrite(Rtt_Stream, 1, Rtt_Length, file), Rtt_Length);
+    fclose(file);
+  }
+}
+
+int main(int argc, char **argv)
+{
+  test_RecordLayout();
+  test_SequenceCountsDrops();
+  if (argc > 1)
+  {
+    WriteStream(argv[1]);
+  }
+  TEST_EXIT();
+}
@@ -0,0 +1,125 @@
+/*
+ *      test_climate_metrics.c
+ *
+ *	The MIT License.
+ */
+
+#include <math.h>
+#include <stdlib.h>
+
+#include "climate_metrics.h"
+#include "test.h"
+
+// 14-bit codes as the HDC1080 reports them, in the top bits of the register
+#define CODE_STEP (4)
+// Codes skipped between two checks of the sweep
+#define SWEEP_STRIDE (11)
+
+static double Temperature(uint16_t code)
+{
+  return code * 165.0 / 65536 - 40;
+}
+
+// The Magnus formula of climate_metrics.h in double precision, in centi-degrees
+static double ReferenceDewPoint(uint16_t temperature_code, uint16_t humidity_code)
+{
+  double t = Temperature(temperature_code);
+  double gamma = log(humidity_code / 65536.0) + 17.62 * t / (243.12 + t);
+
+  return 100 * 243.12 * gamma / (17.62 - gamma);
+}
+
+// In centi-grams per m3
+static double ReferenceAbsolute(uint16_t temperature_code, uint16_t humidity_code)
+{
+  double t = Temperature(temperature_code);
+
+  return 100 * 6.112 * 216.7 * (humidity_code / 65536.0) * exp(17.62 * t / (243.12 + t)) / (t + 273.15);
+}
+
+static void test_KnownPoints(void)
+{
+  static const struct
+  {
+    double Temperature;
+    double Humidity;
+    int16_t DewPoint;
+  } points[] = {{30, 80, 2617}, {25, 100, 2500}, {20, 50, 926}, {0, 50, -920}, {-20, 30, -3317}};
+  CLIMATE_METRICS metrics;
+  uint16_t temperature_code, humidity_code;
+  uint8_t i;
+
+  for (i = 0; i < sizeof(points) / sizeof(points[0]); i++)
+  {
+    temperature_code = (uint16_t)lround((points[i].Temperature + 40) / 165 * 65536);
+    humidity_code = (uint16_t)fmin(65535, lround(points[i].Humidity / 100 * 65536));
+    ClimateMetrics_FromRaw(temperature_code, humidity_code, &metrics);
+    CHECK(abs(metrics.DewPoint - points[i].DewPoint) <= 2);
+  }
+}
+
+// The bounds documented in climate_metrics.h, over the whole sensor range
+static void test_SweepWithinDocumentedError(void)
+{
+  CLIMATE_METRICS metrics;
+  uint32_t temperature_code, humidity_code;
+  double expected;
+
+  for (temperature_code = 0; temperature_code < 65536; temperature_code += CODE_STEP * SWEEP_STRIDE)
+  {
+    for (humidity_code = CODE_STEP; humidity_code < 65536; humidity_code += CODE_STEP * SWEEP_STRIDE)
+    {
+      ClimateMetrics_FromRaw((uint16_t)temperature_code, (uint16_t)humidity_code, &metrics);
+
+      expected = ReferenceDewPoint((uint16_t)temperature_code, (uint16_t)humidity_code);
+      if (fabs(metrics.DewPoint - expected) > 1)
+      {
+        CHECK_EQ(metrics.DewPoint, lround(expected));
+      }
+
+      expected = ReferenceAbsolute((uint16_t)temperature_code, (uint16_t)humidity_code);
+      // Saturates above 655.35 g/m3
+      expected = fmin(expected, UINT16_MAX);
+      if (fabs(metrics.AbsoluteHumidity - expected) > 0.5 + expected / 10000)
+      {
+        CHECK_EQ(metrics.AbsoluteHumidity, lround(expected));
+      }
+    }
+  }
+}
+
+static void test_ZeroHumidity(void)
+{
+  CLIMATE_METRICS zero, one;
+  uint32_t temperature_code;
+
+  for (temperature_code = 0; temperature_code < 65536; temperature_code += 997)
+  {
+    ClimateMetrics_FromRaw((uint16_t)temperature_code, 0, &zero);
+    ClimateMetrics_FromRaw((uint16_t)temperature_code, 1, &one);
+    CHECK_EQ(zero.DewPoint, one.DewPoint);
+    CHECK_EQ(zero.AbsoluteHumidity, 0);
+  }
+}
+
+static void test_Extremes(void)
+{
+  CLIMATE_METRICS metrics;
+
+  // 125 *C saturated, and -40 *C nearly dry
+  ClimateMetrics_FromRaw(0xFFFC, 0xFFFC, &metrics);
+  CHECK_EQ(metrics.AbsoluteHumidity, UINT16_MAX);
+  CHECK(labs(metrics.DewPoint - lround(ReferenceDewPoint(0xFFFC, 0xFFFC))) <= 1);
+  ClimateMetrics_FromRaw(0, CODE_STEP, &metrics);
+  CHECK(labs(metrics.DewPoint - lround(ReferenceDewPoint(0, CODE_STEP))) <= 1);
+  CHECK_EQ(metrics.AbsoluteHumidity, 0);
+}
+
+int main(void)
+{
+  test_KnownPoints();
+  test_SweepWithinDocumentedError();
+  test_ZeroHumidity();
+  test_Extremes();
+  TEST_EXIT();
+}
@@ -0,0 +1,150 @@
+/*
+ *      test_num_format.c
+ *
+ *	The MIT License.
+ */
+
+#include <string.h>
+
+#include "num_format.h"
+#include "test.h"
+
+// Room for width 255 and its NUL, with guard bytes on both sides
+#define GUARD (16)
+#define ROOM (256)
+
+static char Memory[GUARD + ROOM + GUARD];
+static char *const Buf = &Memory[GUARD];
+
+static void Clear(void)
+{
+  memset(Memory, '#', sizeof(Memory));
+}
+
+// Nothing written outside the cap bytes at Buf
+static void CheckGuards(size_t cap)
+{
+  size_t i;
+
+  for (i = 0; i < GUARD; i++)
+  {
+    CHECK_EQ(Memory[i], '#');
+  }
+  for (i = GUARD + cap; i < sizeof(Memory); i++)
+  {
+    CHECK_EQ(Memory[i], '#');
+  }
+}
+
+static void CheckInt(int32_t value, uint8_t width, char pad, const char *expected)
+{
+  size_t len;
+
+  Clear();
+  len = fmt_Int(Buf, ROOM, value, width, pad);
+  CHECK_EQ(len, strlen(expected));
+  CHECK(strcmp(Buf, expected) == 0);
+  CheckGuards(len + 1);
+}
+
+static void test_Int(void)
+{
+  CheckInt(0, 0, ' ', "0");
+  CheckInt(42, 5, ' ', "   42");
+  CheckInt(-42, 5, ' ', "  -42");
+  CheckInt(42, 5, '0', "00042");
+  CheckInt(-42, 5, '0', "-0042");
+  CheckInt(-42, 1, '0', "-42");
+  CheckInt(-42, 3, '0', "-42");
+  CheckInt(INT32_MAX, 12, '0', "002147483647");
+  CheckInt(INT32_MIN, 0, '0', "-2147483648");
+  CheckInt(INT32_MIN, 12, '0', "-02147483648");
+  CheckInt(INT32_MIN, 13, ' ', "  -2147483648");
+}
+
+// Zero padding wider than any number: it used to be built in the 22-byte
+// buffer of the digits, and ran off its start
+static void test_WideZeroPad(void)
+{
+  size_t len;
+  size_t i;
+
+  Clear();
+  len = fmt_Int(Buf, ROOM, 7, 255, '0');
+  CHECK_EQ(len, 255);
+  for (i = 0; i < 254; i++)
+  {
+    CHECK_EQ(Buf[i], '0');
+  }
+  CHECK_EQ(Buf[254], '7');
+  CHECK_EQ(Buf[255], '\0');
+  CheckGuards(ROOM);
+
+  Clear();
+  len = fmt_Int(Buf, ROOM, INT32_MIN, 255, '0');
+  CHECK_EQ(len, 255);
+  CHECK_EQ(Buf[0], '-');
+  for (i = 1; i < 255 - 10; i++)
+  {
+    CHECK_EQ(Buf[i], '0');
+  }
+  CHECK(strcmp(&Buf[255 - 10], "2147483648") == 0);
+  CheckGuards(ROOM);
+
+  // Too little room: an empty string, whatever the width
+  Clear();
+  CHECK_EQ(fmt_Int(Buf, 40, -7, 255, '0'), 0);
+  CHECK_EQ(Buf[0], '\0');
+  CheckGuards(40);
+  Clear();
+  CHECK_EQ(fmt_Uint(Buf, 40, 7, 255, '0'), 0);
+  CHECK_EQ(Buf[0], '\0');
+  CheckGuards(40);
+}
+
+// Text and NUL take cap exactly, one byte less gives an empty string
+static void test_Cap(void)
+{
+  size_t cap;
+
+  for (cap = 0; cap <= 6; cap++)
+  {
+    Clear();
+    CHECK_EQ(fmt_Int(Buf, cap, -42, 5, '0'), cap == 6 ? 5 : 0);
+    CHECK(cap == 0 || strcmp(Buf, cap == 6 ? "-0042" : "") == 0);
+    CheckGuards(cap);
+
+    Clear();
+    CHECK_EQ(fmt_Int(Buf, cap, -42, 5, ' '), cap == 6 ? 5 : 0);
+    CHECK(cap == 0 || strcmp(Buf, cap == 6 ? "  -42" : "") == 0);
+    CheckGuards(cap);
+  }
+  Clear();
+  CHECK_EQ(fmt_Time(Buf, 9, 12, 34, 56), 8);
+  CHECK(strcmp(Buf, "12:34:56") == 0);
+  CHECK_EQ(fmt_Time(Buf, 8, 12, 34, 56), 0);
+  CheckGuards(9);
+}
+
+static void test_Fixed(void)
+{
+  Clear();
+  CHECK_EQ(fmt_Fixed(Buf, ROOM, 2345, 2, 0), 5);
+  CHECK(strcmp(Buf, "23.45") == 0);
+  CHECK_EQ(fmt_Fixed(Buf, ROOM, -5, 2, 6), 6);
+  CHECK(strcmp(Buf, " -0.05") == 0);
+  CHECK_EQ(fmt_Fixed(Buf, ROOM, INT32_MIN, 9, 0), 12);
+  CHECK(strcmp(Buf, "-2.147483648") == 0);
+  CHECK_EQ(fmt_Date(Buf, ROOM, 2026, 10, 19), 10);
+  CHECK(strcmp(Buf, "2026-10-19") == 0);
+  CheckGuards(ROOM);
+}
+
+int main(void)
+{
+  test_Int();
+  test_WideZeroPad();
+  test_Cap();
+  test_Fixed();
+  TEST_EXIT();
+}
@@ -0,0 +1,234 @@
+/*
+ *      test_sample_codec.c
+ *
+ *	The MIT License.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "sample_codec.h"
+#include "test.h"
+
+#define SAMPLES (2000)
+
+static SAMPLE Samples[SAMPLES];
+static uint16_t Offsets[SAMPLES + 1];   // Of each record in Buffer
+static uint8_t Buffer[SAMPLES * SAMPLE_CODEC_MAX_RECORD];
+
+// Encodes Samples, checking the length of each record
+static uint16_t Encode(uint16_t count)
+{
+  SAMPLE_ENCODER encoder;
+  uint16_t i;
+
+  SampleEncoder_Init(&encoder, Buffer, sizeof(Buffer));
+  for (i = 0; i < count; i++)
+  {
+    Offsets[i] = encoder.Length;
+    CHECK_EQ(SampleEncoder_Add(&encoder, &Samples[i]), 1);
+    CHECK(encoder.Length - Offsets[i] <= SAMPLE_CODEC_MAX_RECORD);
+  }
+  Offsets[count] = encoder.Length;
+  return encoder.Length;
+}
+
+// Decodes Buffer from offset to length and compares with Samples from first
+static void CheckDecode(SAMPLE_DECODER *decoder, uint16_t offset, uint16_t length, uint16_t first, uint16_t count)
+{
+  SAMPLE sample;
+  uint16_t decoded = 0;
+
+  for (; offset < length; offset++)
+  {
+    if (!SampleDecoder_Push(decoder, Buffer[offset], &sample))
+    {
+      continue;
+    }
+    if (decoded < count)
+    {
+      CHECK_EQ(sample.Time, Samples[first + decoded].Time);
+      CHECK_EQ(sample.CentiDegrees, Samples[first + decoded].CentiDegrees);
+      CHECK_EQ(sample.Humidity, Samples[first + decoded].Humidity);
+      CHECK_EQ(sample.Sensor, 0);
+      CHECK_EQ(sample.DewPoint, 0);
+    }
+    decoded++;
+  }
+  CHECK_EQ(decoded, count);
+}
+
+// A sensor read at a steady rate with long stretches of the same humidity,
+// and now and then a gap, a jump or a counter wrap
+static void RandomWalk(uint16_t count)
+{
+  uint32_t time = (uint32_t)rand() * 7919u;
+  uint32_t rate = 1 + rand() % 600;
+  int16_t temperature = (int16_t)(rand() % 4000 - 1000);
+  uint8_t humidity = (uint8_t)(rand() % 101);
+  uint16_t i;
+
+  for (i = 0; i < count; i++)
+  {
+    switch (rand() % 50)
+    {
+    case 0:
+      rate = 1 + rand() % 600;
+      break;
+    case 1:
+      time += (uint32_t)rand() * 65599u;
+      break;
+    case 2:
+      temperature = (int16_t)(rand() % 65536 - 32768);
+      break;
+    case 3:
+      humidity = (uint8_t)rand();
+      break;
+    default:
+      break;
+    }
+    time += rate;
+    temperature = (int16_t)(temperature + rand() % 21 - 10);
+    if (rand() % 8 == 0)
+    {
+      humidity = (uint8_t)(humidity + rand() % 3 - 1);
+    }
+    Samples[i].Time = time;
+    Samples[i].CentiDegrees = temperature;
+    Samples[i].Humidity = humidity;
+    Samples[i].Sensor = (uint8_t)rand();
+    Samples[i].DewPoint = (int16_t)rand();
+  }
+}
+
+static void test_RoundTrip(void)
+{
+  SAMPLE_DECODER decoder;
+  uint16_t length;
+  uint8_t round;
+
+  srand(46);
+  for (round = 0; round < 20; round++)
+  {
+    RandomWalk(SAMPLES);
+    length = Encode(SAMPLES);
+    SampleDecoder_Init(&decoder);
+    CheckDecode(&decoder, 0, length, 0, SAMPLES);
+  }
+}
+
+static void test_SteadyRateCostsOneByte(void)
+{
+  SAMPLE_DECODER decoder;
+  uint16_t i;
+
+  for (i = 0; i < 100; i++)
+  {
+    Samples[i].Time = 1000 + 60 * i;
+    Samples[i].CentiDegrees = (int16_t)(2150 + (i % 7) - 3);
+    Samples[i].Humidity = 45;
+  }
+  Encode(100);
+  // A keyframe has no interval, the sample after it carries one again
+  for (i = 0; i < 100; i++)
+  {
+    if (i % SAMPLE_CODEC_KEYFRAME_INTERVAL > 1)
+    {
+      CHECK_EQ(Offsets[i + 1] - Offsets[i], 1);
+    }
+  }
+  SampleDecoder_Init(&decoder);
+  CheckDecode(&decoder, 0, Offsets[100], 0, 100);
+}
+
+static void test_Extremes(void)
+{
+  SAMPLE_DECODER decoder;
+  uint16_t i;
+
+  for (i = 0; i < 200; i++)
+  {
+    Samples[i].CentiDegrees = (i / 2) % 2 ? INT16_MIN : INT16_MAX;
+    Samples[i].Humidity = i % 3 ? UINT8_MAX : 0;
+    Samples[i].Time = UINT32_MAX - 100 + (i % 5 ? 0 : UINT32_MAX / 3 * (i % 4));
+  }
+  Encode(200);
+  SampleDecoder_Init(&decoder);
+  CheckDecode(&decoder, 0, Offsets[200], 0, 200);
+}
+
+static void test_StartsAtAKeyframe(void)
+{
+  SAMPLE_DECODER decoder;
+  uint16_t start, keyframe;
+
+  srand(4646);
+  RandomWalk(SAMPLES);
+  Encode(SAMPLES);
+  for (start = 0; start < 3 * SAMPLE_CODEC_KEYFRAME_INTERVAL; start++)
+  {
+    keyframe = (uint16_t)((start + SAMPLE_CODEC_KEYFRAME_INTERVAL - 1) / SAMPLE_CODEC_KEYFRAME_INTERVAL * SAMPLE_CODEC_KEYFRAME_INTERVAL);
+    SampleDecoder_Init(&decoder);
+    CheckDecode(&decoder, Offsets[start], Offsets[SAMPLES], keyframe, SAMPLES - keyframe);
+  }
+}
+
+static void test_CorruptVarintResyncs(void)
+{
+  // A 35-bit varint that would end in a keyframe
+  static const uint8_t garbage[] = {0xFF, 0xFF, 0xFF, 0xFF, 0x7F};
+  SAMPLE_DECODER decoder;
+  SAMPLE sample;
+  uint8_t i;
+
+  srand(464);
+  RandomWalk(SAMPLES);
+  Encode(SAMPLES);
+  SampleDecoder_Init(&decoder);
+  CheckDecode(&decoder, 0, Offsets[40], 0, 40);
+  for (i = 0; i < sizeof(garbage); i++)
+  {
+    CHECK_EQ(SampleDecoder_Push(&decoder, garbage[i], &sample), 0);
+  }
+  // The deltas up to the next keyframe are dropped
+  CheckDecode(&decoder, Offsets[41], Offsets[SAMPLES], 2 * SAMPLE_CODEC_KEYFRAME_INTERVAL, SAMPLES - 2 * SAMPLE_CODEC_KEYFRAME_INTERVAL);
+}
+
+static void test_FullBufferIsUnchanged(void)
+{
+  SAMPLE_ENCODER encoder;
+  uint8_t small[64];
+  uint8_t copy[sizeof(small)];
+  SAMPLE_DECODER decoder;
+  uint16_t i, length;
+
+  srand(4);
+  RandomWalk(SAMPLES);
+  memset(small, 0xA5, sizeof(small));
+  SampleEncoder_Init(&encoder, small, sizeof(small));
+  for (i = 0; SampleEncoder_Add(&encoder, &Samples[i]); i++)
+  {
+  }
+  CHECK(i > 0);
+  CHECK(encoder.Length <= sizeof(small));
+  length = encoder.Length;
+  memcpy(copy, small, sizeof(small));
+  CHECK_EQ(SampleEncoder_Add(&encoder, &Samples[i]), 0);
+  CHECK_EQ(encoder.Length, length);
+  CHECK_EQ(memcmp(copy, small, sizeof(small)), 0);
+
+  memcpy(Buffer, small, length);
+  SampleDecoder_Init(&decoder);
+  CheckDecode(&decoder, 0, length, 0, i);
+}
+
+int main(void)
+{
+  test_RoundTrip();
+  test_SteadyRateCostsOneByte();
+  test_Extremes();
+  test_StartsAtAKeyframe();
+  test_CorruptVarintResyncs();
+  test_FullBufferIsUnchanged();
+  TEST_EXIT();
+}
@@ -0,0 +1,221 @@
+/*
+ *      test_sample_log.c
+ *
+ *	The MIT License.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "fake_flash.h"
+#include "sample_log.h"
+#include "test.h"
+
+#define REGION_PAGES (4)
+#define REGION_SIZE (REGION_PAGES * SAMPLE_LOG_PAGE_SIZE)
+
+// Samples expected back from the log, by index
+typedef struct
+{
+  uint32_t First[2];
+  uint32_t Last[2];           // Past the last index of each run
+  uint32_t Seen;
+} EXPECTED;
+
+// Sample number index, taken once a minute
+static void Sample(uint32_t index, SAMPLE *sample)
+{
+  uint32_t hash = index * 2654435761u;
+
+  sample->Time = 60 * index;
+  sample->CentiDegrees = (int16_t)(2000 + (int32_t)(hash >> 24) - 128);
+  sample->Humidity = (uint8_t)(40 + index / 50 % 20);
+  sample->Sensor = 0;
+  sample->DewPoint = 0;
+  sample->AbsoluteHumidity = 0;
+}
+
+static void AddSamples(SAMPLE_LOG *log, uint32_t first, uint32_t last)
+{
+  SAMPLE sample;
+
+  for (; first < last; first++)
+  {
+    Sample(first, &sample);
+    SampleLog_Add(log, &sample);
+  }
+}
+
+static void Expect(const SAMPLE *sample, void *context)
+{
+  EXPECTED *expected = (EXPECTED *)context;
+  uint32_t run = expected->Seen < expected->Last[0] - expected->First[0] ? 0 : 1;
+  uint32_t index = expected->First[run] + expected->Seen - (run ? expected->Last[0] - expected->First[0] : 0);
+  SAMPLE want;
+
+  expected->Seen++;
+  if (index >= expected->Last[run])
+  {
+    return;
+  }
+  Sample(index, &want);
+  CHECK_EQ(sample->Time, want.Time);
+  CHECK_EQ(sample->CentiDegrees, want.CentiDegrees);
+  CHECK_EQ(sample->Humidity, want.Humidity);
+}
+
+// Checks the log holds samples first to last, then first2 to last2
+static void CheckLog(const SAMPLE_LOG *log, uint32_t first, uint32_t last, uint32_t first2, uint32_t last2, uint32_t skipped)
+{
+  EXPECTED expected = {{first, first2}, {last, last2}, 0};
+
+  CHECK_EQ(SampleLog_ForEach(log, Expect, &expected), skipped);
+  CHECK_EQ(expected.Seen, (last - first) + (last2 - first2));
+}
+
+static void test_InvalidRegion(void)
+{
+  SAMPLE_LOG log;
+
+  CHECK_EQ(SampleLog_Init(&log, Fake_Flash.Start + 4, REGION_SIZE), NRF_ERROR_INVALID_PARAM);
+  CHECK_EQ(SampleLog_Init(&log, Fake_Flash.Start, REGION_SIZE - 4), NRF_ERROR_INVALID_PARAM);
+  CHECK_EQ(SampleLog_Init(&log, Fake_Flash.Start, SAMPLE_LOG_PAGE_SIZE), NRF_ERROR_INVALID_PARAM);
+  CHECK_EQ(SampleLog_Init(&log, Fake_Flash.Start, REGION_SIZE), NRF_SUCCESS);
+}
+
+static void test_RoundTrip(void)
+{
+  SAMPLE_LOG log;
+
+  FakeFlash_Init();
+  CHECK_EQ(SampleLog_Init(&log, Fake_Flash.Start, REGION_SIZE), NRF_SUCCESS);
+  CheckLog(&log, 0, 0, 0, 0, 0);
+  // Batched samples are not in flash yet
+  AddSamples(&log, 0, 50);
+  CheckLog(&log, 0, 0, 0, 0, 0);
+  AddSamples(&log, 50, 1000);
+  SampleLog_Flush(&log);
+  CheckLog(&log, 0, 1000, 0, 0, 0);
+  SampleLog_Flush(&log);
+  CheckLog(&log, 0, 1000, 0, 0, 0);
+}
+
+static void test_ForeignRegion(void)
+{
+  SAMPLE_LOG log;
+  uint32_t i;
+
+  FakeFlash_Init();
+  srand(47);
+  for (i = 0; i < REGION_SIZE / 4; i++)
+  {
+    Fake_Flash.Words[i] = (uint32_t)rand() << 16 ^ (uint32_t)rand();
+  }
+  CHECK_EQ(SampleLog_Init(&log, Fake_Flash.Start, REGION_SIZE), NRF_SUCCESS);
+  CheckLog(&log, 0, 0, 0, 0, 0);
+  AddSamples(&log, 0, 300);
+  SampleLog_Flush(&log);
+  CheckLog(&log, 0, 300, 0, 0, 0);
+}
+
+static void Count(const SAMPLE *sample, void *context)
+{
+  (void)sample;
+  (*(uint32_t *)context)++;
+}
+
+// The oldest page goes first, the rest of the log stays in order
+static void test_PageWrapKeepsTheNewest(void)
+{
+  SAMPLE_LOG log;
+  uint32_t last = 60000;
+  uint32_t count = 0;
+  uint32_t i, least = UINT32_MAX, most = 0;
+
+  FakeFlash_Init();
+  CHECK_EQ(SampleLog_Init(&log, Fake_Flash.Start, REGION_SIZE), NRF_SUCCESS);
+  AddSamples(&log, 0, last);
+  SampleLog_Flush(&log);
+
+  // The newest samples, at least the pages not being written to
+  CHECK_EQ(SampleLog_ForEach(&log, Count, &count), 0);
+  CHECK(count > (REGION_PAGES - 1) * (SAMPLE_LOG_PAGE_SIZE / 4));
+  CHECK(count < last);
+  CheckLog(&log, last - count, last, 0, 0, 0);
+
+  for (i = 0; i < REGION_PAGES; i++)
+  {
+    least = Fake_Flash.Erases[i] < least ? Fake_Flash.Erases[i] : least;
+    most = Fake_Flash.Erases[i] > most ? Fake_Flash.Erases[i] : most;
+  }
+  CHECK(least > 2);
+  CHECK(most - least <= 1);
+  CHECK_EQ(Fake_Flash.Erases[REGION_PAGES], 0);
+}
+
+static void test_ResumesAfterReset(void)
+{
+  SAMPLE_LOG log, resumed;
+
+  FakeFlash_Init();
+  CHECK_EQ(SampleLog_Init(&log, Fake_Flash.Start, REGION_SIZE), NRF_SUCCESS);
+  AddSamples(&log, 0, 3000);
+  SampleLog_Flush(&log);
+
+  CHECK_EQ(SampleLog_Init(&resumed, Fake_Flash.Start, REGION_SIZE), NRF_SUCCESS);
+  CHECK_EQ(resumed.Page, log.Page);
+  CHECK_EQ(resumed.Offset, log.Offset);
+  CHECK_EQ(resumed.PageSequence, log.PageSequence);
+  CHECK_EQ(resumed.Sequence, log.Sequence);
+  AddSamples(&resumed, 3000, 4000);
+  SampleLog_Flush(&resumed);
+  CheckLog(&resumed, 0, 4000, 0, 0, 0);
+}
+
+// A reset after each word of a record: the record is lost, and the log
+// goes on after it
+static void test_TornRecordIsSkipped(void)
+{
+  SAMPLE_LOG log;
+  int32_t cut, words;
+
+  for (cut = 0;; cut++)
+  {
+    FakeFlash_Init();
+    CHECK_EQ(SampleLog_Init(&log, Fake_Flash.Start, REGION_SIZE), NRF_SUCCESS);
+    AddSamples(&log, 0, 300);
+    SampleLog_Flush(&log);
+    AddSamples(&log, 300, 400);
+    words = SAMPLE_LOG_HEADER_WORDS + (log.Encoder.Length + 3) / 4;
+    if (cut == words)
+    {
+      break;
+    }
+    Fake_Flash.Budget = cut;
+    SampleLog_Flush(&log);
+    Fake_Flash.Budget = -1;
+
+    CHECK_EQ(SampleLog_Init(&log, Fake_Flash.Start, REGION_SIZE), NRF_SUCCESS);
+    AddSamples(&log, 400, 600);
+    SampleLog_Flush(&log);
+    // A torn header is not a record, a torn payload fails the CRC
+    CheckLog(&log, 0, 300, 400, 600, cut >= SAMPLE_LOG_HEADER_WORDS);
+  }
+  CHECK(cut > SAMPLE_LOG_HEADER_WORDS);
+}
+
+int main(void)
+{
+  if (!FakeFlash_Init())
+  {
+    printf("No memory below 4 GB for the flash\n");
+    return 1;
+  }
+  test_InvalidRegion();
+  test_RoundTrip();
+  test_ForeignRegion();
+  test_PageWrapKeepsTheNewest();
+  test_ResumesAfterReset();
+  test_TornRecordIsSkipped();
+  TEST_EXIT();
+}
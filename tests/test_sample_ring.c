@@ -0,0 +1,165 @@
+/*
+ *      test_sample_ring.c
+ *
+ *	The MIT License.
+ */
+
+#include <pthread.h>
+#include <sched.h>
+
+#include "sample_ring.h"
+#include "test.h"
+
+static SAMPLE_RING Ring;
+
+static SAMPLE Sample(uint32_t n)
+{
+  SAMPLE sample = {0};
+
+  sample.Time = n;
+  sample.CentiDegrees = (int16_t)n;
+  sample.Humidity = (uint8_t)(n * 7);
+  sample.Sensor = (uint8_t)(n >> 16);
+  return sample;
+}
+
+static uint8_t IsSample(const SAMPLE *sample, uint32_t n)
+{
+  return sample->Time == n && sample->CentiDegrees == (int16_t)n && sample->Humidity == (uint8_t)(n * 7) &&
+         sample->Sensor == (uint8_t)(n >> 16);
+}
+
+static void test_FifoAndDrops(void)
+{
+  const SAMPLE *samples;
+  SAMPLE sample;
+  uint32_t i;
+
+  SampleRing_Init(&Ring);
+  CHECK_EQ(SampleRing_Peek(&Ring, &samples), 0);
+  for (i = 0; i < SAMPLE_RING_SIZE; i++)
+  {
+    sample = Sample(i);
+    CHECK_EQ(SampleRing_Push(&Ring, &sample), 1);
+  }
+  sample = Sample(99);
+  CHECK_EQ(SampleRing_Push(&Ring, &sample), 0);
+  CHECK_EQ(Ring.Dropped, 1);
+
+  CHECK_EQ(SampleRing_Peek(&Ring, &samples), SAMPLE_RING_SIZE);
+  for (i = 0; i < SAMPLE_RING_SIZE; i++)
+  {
+    CHECK(IsSample(&samples[i], i));
+  }
+  SampleRing_Release(&Ring, 3);
+  CHECK_EQ(SampleRing_Peek(&Ring, &samples), SAMPLE_RING_SIZE - 3);
+  CHECK(IsSample(&samples[0], 3));
+}
+
+static void test_PeekStopsAtTheEnd(void)
+{
+  const SAMPLE *samples;
+  SAMPLE sample;
+  uint32_t i;
+
+  SampleRing_Init(&Ring);
+  for (i = 0; i < SAMPLE_RING_SIZE - 2; i++)
+  {
+    sample = Sample(i);
+    SampleRing_Push(&Ring, &sample);
+  }
+  SampleRing_Release(&Ring, SAMPLE_RING_SIZE - 2);
+  for (i = 0; i < 5; i++)
+  {
+    sample = Sample(100 + i);
+    SampleRing_Push(&Ring, &sample);
+  }
+  // Two samples before the end of the array, three after wrapping
+  CHECK_EQ(SampleRing_Peek(&Ring, &samples), 2);
+  CHECK(IsSample(&samples[0], 100));
+  SampleRing_Release(&Ring, 2);
+  CHECK_EQ(SampleRing_Peek(&Ring, &samples), 3);
+  CHECK(IsSample(&samples[2], 104));
+}
+
+static void test_DrainAcrossTheEnd(void)
+{
+  SAMPLE out[SAMPLE_RING_SIZE];
+  SAMPLE sample;
+  uint32_t i;
+
+  SampleRing_Init(&Ring);
+  // Counters about to wrap around 2^32
+  Ring.Head = Ring.Tail = UINT32_MAX - 4;
+  for (i = 0; i < SAMPLE_RING_SIZE; i++)
+  {
+    sample = Sample(i);
+    CHECK_EQ(SampleRing_Push(&Ring, &sample), 1);
+  }
+  CHECK_EQ(SampleRing_Push(&Ring, &sample), 0);
+  CHECK_EQ(SampleRing_Drain(&Ring, out, 6), 6);
+  CHECK_EQ(SampleRing_Drain(&Ring, &out[6], SAMPLE_RING_SIZE), SAMPLE_RING_SIZE - 6);
+  for (i = 0; i < SAMPLE_RING_SIZE; i++)
+  {
+    CHECK(IsSample(&out[i], i));
+  }
+  CHECK_EQ(SampleRing_Drain(&Ring, out, SAMPLE_RING_SIZE), 0);
+}
+
+#define STRESS_SAMPLES (200000)
+
+static void *Producer(void *arg)
+{
+  SAMPLE sample;
+  uint32_t i;
+
+  (void)arg;
+  for (i = 0; i < STRESS_SAMPLES; i++)
+  {
+    sample = Sample(i);
+    while (!SampleRing_Push(&Ring, &sample))
+    {
+      sched_yield();
+    }
+  }
+  return NULL;
+}
+
+// The producer thread stands for the TWI interrupt
+static void test_ProducerAndConsumer(void)
+{
+  const SAMPLE *samples;
+  pthread_t producer;
+  uint32_t expected = 0;
+  uint32_t bad = 0;
+  uint32_t count, i;
+
+  SampleRing_Init(&Ring);
+  CHECK_EQ(pthread_create(&producer, NULL, Producer, NULL), 0);
+  while (expected < STRESS_SAMPLES)
+  {
+    count = SampleRing_Peek(&Ring, &samples);
+    if (count == 0)
+    {
+      sched_yield();
+      continue;
+    }
+    for (i = 0; i < count; i++)
+    {
+      bad += !IsSample(&samples[i], expected++);
+    }
+    SampleRing_Release(&Ring, count);
+  }
+  pthread_join(producer, NULL);
+  CHECK_EQ(bad, 0);
+  CHECK_EQ(Ring.Head, STRESS_SAMPLES);
+}
+
+int main(void)
+{
+  test_FifoAndDrops();
+  test_PeekStopsAtTheEnd();
+  test_DrainAcrossTheEnd();
+  test_ProducerAndConsumer();
+  TEST_EXIT();
+}
@@ -0,0 +1,183 @@
+/*
+ *      test_sensor_stats.c
+ *
+ *	The MIT License.
+ */
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sensor_stats.h"
+#include "test.h"
+
+#define HISTORY (20000)
+
+static STATS_WINDOW Window;
+static uint32_t Times[HISTORY];
+static int16_t Values[HISTORY];
+
+// Statistics of the samples still in a window of size buckets, brute force
+static uint8_t Reference(uint32_t count, uint8_t size, uint32_t span, uint32_t time, STATS_RESULT *result)
+{
+  uint32_t index = time / span;
+  int64_t n = 0, sum = 0, squares = 0, spread;
+  uint32_t i;
+
+  result->Min = INT16_MAX;
+  result->Max = INT16_MIN;
+  for (i = 0; i < count; i++)
+  {
+    if (index - Times[i] / span >= size)
+    {
+      continue;
+    }
+    n++;
+    sum += Values[i];
+    squares += (int32_t)Values[i] * Values[i];
+    result->Min = Values[i] < result->Min ? Values[i] : result->Min;
+    result->Max = Values[i] > result->Max ? Values[i] : result->Max;
+  }
+  if (n == 0)
+  {
+    return 0;
+  }
+  spread = n * squares - sum * sum;
+  result->Count = (uint32_t)n;
+  result->Mean = (int16_t)lround((double)sum / n);
+  result->Variance = (uint32_t)llround((double)spread / ((double)n * n));
+  result->StdDev = (uint16_t)floor(sqrt((double)(spread / (n * n))));
+  return 1;
+}
+
+static void test_Empty(void)
+{
+  STATS_RESULT result = {.Count = 12345};
+
+  Stats_Init(&Window, 60, 1);
+  CHECK_EQ(Stats_Get(&Window, 0, &result), 0);
+  CHECK_EQ(result.Count, 12345);
+  Stats_Add(&Window, 10, 5);
+  CHECK_EQ(Stats_Get(&Window, 69, &result), 1);
+  CHECK_EQ(Stats_Get(&Window, 70, &result), 0);
+}
+
+static void test_BucketsExpireWhole(void)
+{
+  STATS_RESULT result;
+
+  // 3 buckets of 10
+  Stats_Init(&Window, 3, 10);
+  Stats_Add(&Window, 0, 100);
+  Stats_Add(&Window, 9, -100);
+  Stats_Add(&Window, 25, 5);
+  CHECK_EQ(Stats_Get(&Window, 29, &result), 1);
+  CHECK_EQ(result.Count, 3);
+  CHECK_EQ(result.Min, -100);
+  CHECK_EQ(result.Max, 100);
+  CHECK_EQ(result.Mean, 2);
+  CHECK_EQ(Stats_Get(&Window, 30, &result), 1);
+  CHECK_EQ(result.Count, 1);
+  CHECK_EQ(result.Min, 5);
+  CHECK_EQ(result.Max, 5);
+  CHECK_EQ(result.Variance, 0);
+}
+
+// A bucket holding only one end of the range is still queued for Min and Max
+static void test_BucketAtTheLimits(void)
+{
+  STATS_RESULT result;
+
+  // Unused queue entries point at the expired bucket 0
+  memset(&Window, 0, sizeof(Window));
+  Stats_Init(&Window, 2, 1);
+  Stats_Add(&Window, 0, 100);
+  Stats_Add(&Window, 1, INT16_MAX);
+  CHECK_EQ(Stats_Get(&Window, 2, &result), 1);
+  CHECK_EQ(result.Count, 1);
+  CHECK_EQ(result.Min, INT16_MAX);
+  CHECK_EQ(result.Max, INT16_MAX);
+
+  memset(&Window, 0, sizeof(Window));
+  Stats_Init(&Window, 2, 1);
+  Stats_Add(&Window, 0, -100);
+  Stats_Add(&Window, 1, INT16_MIN);
+  Stats_Add(&Window, 1, INT16_MIN);
+  CHECK_EQ(Stats_Get(&Window, 2, &result), 1);
+  CHECK_EQ(result.Count, 2);
+  CHECK_EQ(result.Min, INT16_MIN);
+  CHECK_EQ(result.Max, INT16_MIN);
+}
+
+static void test_MatchesBruteForce(void)
+{
+  static const struct
+  {
+    uint8_t Size;
+    uint32_t Span;
+    uint32_t MaxGap;
+  } cases[] = {{60, 1, 3}, {60, 60, 40}, {7, 5, 20}, {1, 10, 12}};
+  STATS_RESULT expected, actual;
+  uint32_t time, i;
+  uint8_t c, has;
+
+  srand(44);
+  for (c = 0; c < sizeof(cases) / sizeof(cases[0]); c++)
+  {
+    Stats_Init(&Window, cases[c].Size, cases[c].Span);
+    time = UINT32_MAX / 2;
+    for (i = 0; i < HISTORY; i++)
+    {
+      // Long pauses now and then empty the window
+      time += (rand() % 500 == 0) ? cases[c].Size * cases[c].Span * 2 : rand() % (cases[c].MaxGap + 1);
+      Times[i] = time;
+      Values[i] = (int16_t)(rand() % 8001 - 4000);
+      Stats_Add(&Window, time, Values[i]);
+      if (i % 97 != 0)
+      {
+        continue;
+      }
+      has = Reference(i + 1, cases[c].Size, cases[c].Span, time, &expected);
+      CHECK_EQ(Stats_Get(&Window, time, &actual), has);
+      if (has)
+      {
+        CHECK_EQ(actual.Count, expected.Count);
+        CHECK_EQ(actual.Min, expected.Min);
+        CHECK_EQ(actual.Max, expected.Max);
+        CHECK_EQ(actual.Mean, expected.Mean);
+        CHECK_EQ(actual.Variance, expected.Variance);
+        CHECK_EQ(actual.StdDev, expected.StdDev);
+      }
+    }
+  }
+}
+
+static void test_ExtremeValues(void)
+{
+  STATS_RESULT result;
+  uint32_t i;
+
+  // The documented limit: 65535 samples at both ends of the int16_t range
+  Stats_Init(&Window, 1, 100000);
+  for (i = 0; i < 65535; i++)
+  {
+    Stats_Add(&Window, i, (i % 2 == 0) ? INT16_MIN : INT16_MAX);
+  }
+  CHECK_EQ(Stats_Get(&Window, 65535, &result), 1);
+  CHECK_EQ(result.Count, 65535);
+  CHECK_EQ(result.Min, INT16_MIN);
+  CHECK_EQ(result.Max, INT16_MAX);
+  CHECK_EQ(result.Mean, -1);
+  CHECK_EQ(result.Variance, 1073709056);
+  CHECK_EQ(result.StdDev, 32767);
+}
+
+int main(void)
+{
+  test_Empty();
+  test_BucketsExpireWhole();
+  test_BucketAtTheLimits();
+  test_MatchesBruteForce();
+  test_ExtremeValues();
+  TEST_EXIT();
+}
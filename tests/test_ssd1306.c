@@ -0,0 +1,515 @@
+/*
+ *      test_ssd1306.c
+ *
+ *	The MIT License.
+ */
+
+#include <math.h>
+#include <stdlib.h>
+
+#include "fake_panel.h"
+#include "test.h"
+
+static SSD1306_t Display;
+
+// Tells whether the lit pixels of every row form one span
+static uint8_t RowsAreSpans(void)
+{
+  int16_t x, y;
+  uint8_t runs;
+
+  for (y = 0; y < SSD1306_HEIGHT; y++)
+  {
+    runs = 0;
+    for (x = 0; x < SSD1306_WIDTH; x++)
+    {
+      if (FakePanel_Buffer(&Display, x, y) && (x == 0 || !FakePanel_Buffer(&Display, x - 1, y)))
+      {
+        runs++;
+      }
+    }
+    if (runs > 1)
+    {
+      return 0;
+    }
+  }
+  return 1;
+}
+
+// Even-odd rule at the pixel center
+static uint8_t InsidePolygon(const SSD1306_VERTEX *vertex, uint16_t count, double x, double y)
+{
+  uint8_t inside = 0;
+  uint16_t i, j;
+
+  for (i = 0, j = count - 1; i < count; j = i++)
+  {
+    if ((vertex[i].y > y) != (vertex[j].y > y) &&
+        x < vertex[j].x + (y - vertex[j].y) * (vertex[i].x - vertex[j].x) / (vertex[i].y - vertex[j].y))
+    {
+      inside = !inside;
+    }
+  }
+  return inside;
+}
+
+// Distance from a point to the outline of a polygon
+static double OutlineDistance(const SSD1306_VERTEX *vertex, uint16_t count, double x, double y)
+{
+  double best = 1e9, dx, dy, t, d;
+  uint16_t i, j;
+
+  for (i = 0, j = count - 1; i < count; j = i++)
+  {
+    dx = vertex[i].x - vertex[j].x;
+    dy = vertex[i].y - vertex[j].y;
+    t = (dx == 0 && dy == 0) ? 0 : ((x - vertex[j].x) * dx + (y - vertex[j].y) * dy) / (dx * dx + dy * dy);
+    t = t < 0 ? 0 : (t > 1 ? 1 : t);
+    d = hypot(x - (vertex[j].x + t * dx), y - (vertex[j].y + t * dy));
+    best = d < best ? d : best;
+  }
+  return best;
+}
+
+// Point of an arc at angle deg, from a double sine truncated like the driver
+static void ReferencePoint(int16_t x, int16_t y, uint8_t radius, uint32_t deg, int16_t *px, int16_t *py)
+{
+  double rad = deg * M_PI / 180.0;
+
+  *px = x + (int16_t)(sin(rad) * radius);
+  *py = y + (int16_t)(cos(rad) * radius);
+}
+
+static void test_ArcStaysOnCircle(void)
+{
+  const int16_t cx = 64, cy = 32;
+  const uint8_t radius = 20;
+  int16_t x, y;
+  double distance;
+
+  ssd1306_Fill(Black);
+  ssd1306_DrawArc(cx, cy, radius, 0, 90, White);
+  for (y = 0; y < SSD1306_HEIGHT; y++)
+  {
+    for (x = 0; x < SSD1306_WIDTH; x++)
+    {
+      if (!FakePanel_Buffer(&Display, x, y))
+      {
+        continue;
+      }
+      // 0 to 90 degrees from the bottom, counterclockwise on the screen
+      distance = hypot(x - cx, y - cy);
+      CHECK(x >= cx && y >= cy);
+      CHECK(distance > radius - 1.5 && distance < radius + 0.5);
+    }
+  }
+  CHECK(FakePanel_Buffer(&Display, cx, cy + radius));
+  CHECK(FakePanel_Buffer(&Display, cx + radius, cy));
+}
+
+static void test_ArcPointsMatchSine(void)
+{
+  const int16_t cx = 64, cy = 32;
+  const uint8_t radii[] = {5, 20, 31};
+  int16_t px, py;
+  uint32_t deg;
+  uint8_t i;
+
+  for (i = 0; i < sizeof(radii); i++)
+  {
+    ssd1306_Fill(Black);
+    // 35 segments of 10 degrees, the full turn would be a midpoint circle
+    ssd1306_DrawArc(cx, cy, radii[i], 0, 350, White);
+    for (deg = 0; deg <= 350; deg += 10)
+    {
+      ReferencePoint(cx, cy, radii[i], deg, &px, &py);
+      CHECK(FakePanel_Buffer(&Display, px, py));
+    }
+  }
+}
+
+static void test_FullTurnIsCircle(void)
+{
+  static uint8_t circle[SSD1306_BUFFER_SIZE];
+
+  ssd1306_Fill(Black);
+  ssd1306_DrawCircle(64, 32, 25, White);
+  memcpy(circle, Display.Buffer, sizeof(circle));
+  ssd1306_Fill(Black);
+  ssd1306_DrawArc(64, 32, 25, 0, 360, White);
+  CHECK(memcmp(circle, Display.Buffer, sizeof(circle)) == 0);
+}
+
+static void test_SweepIsNormalized(void)
+{
+  static uint8_t quarter[SSD1306_BUFFER_SIZE];
+
+  ssd1306_Fill(Black);
+  ssd1306_DrawArc(64, 32, 20, 0, 90, White);
+  memcpy(quarter, Display.Buffer, sizeof(quarter));
+  ssd1306_Fill(Black);
+  ssd1306_DrawArc(64, 32, 20, 0, 450, White);
+  CHECK(memcmp(quarter, Display.Buffer, sizeof(quarter)) == 0);
+}
+
+static void test_ArcWithRadiusLine(void)
+{
+  ssd1306_Fill(Black);
+  ssd1306_DrawArcWithRadiusLine(64, 32, 20, 0, 90, White);
+  CHECK(FakePanel_Buffer(&Display, 64, 32));
+  CHECK(FakePanel_Buffer(&Display, 64, 42));
+  CHECK(FakePanel_Buffer(&Display, 74, 32));
+  CHECK(FakePanel_Buffer(&Display, 64, 52));
+  CHECK(FakePanel_Buffer(&Display, 84, 32));
+}
+
+static void test_FillCircleCoversOutline(void)
+{
+  static uint8_t outline[SSD1306_BUFFER_SIZE];
+  const uint8_t radii[] = {0, 1, 4, 13, 22, 31};
+  int16_t x, y;
+  uint8_t i;
+
+  for (i = 0; i < sizeof(radii); i++)
+  {
+    ssd1306_Fill(Black);
+    ssd1306_DrawCircle(64, 32, radii[i], White);
+    memcpy(outline, Display.Buffer, sizeof(outline));
+    ssd1306_Fill(Black);
+    ssd1306_FillCircle(64, 32, radii[i], White);
+    CHECK(RowsAreSpans());
+    for (y = 0; y < SSD1306_HEIGHT; y++)
+    {
+      for (x = 0; x < SSD1306_WIDTH; x++)
+      {
+        if ((outline[(y / 8) * SSD1306_WIDTH + x] >> (y % 8)) & 1)
+        {
+          CHECK(FakePanel_Buffer(&Display, x, y));
+        }
+        // Symmetric about both axes through the center
+        if (x >= 64 - 31 && x <= 64 + 31 && y >= 1)
+        {
+          CHECK_EQ(FakePanel_Buffer(&Display, x, y), FakePanel_Buffer(&Display, 128 - x, y));
+          CHECK_EQ(FakePanel_Buffer(&Display, x, y), FakePanel_Buffer(&Display, x, 64 - y));
+        }
+      }
+    }
+  }
+  CHECK(FakePanel_Count(&Display) > 0);
+}
+
+static void test_FillCircleAtTheEdges(void)
+{
+  ssd1306_Fill(Black);
+  ssd1306_FillCircle(0, 0, 10, White);
+  CHECK(FakePanel_Buffer(&Display, 0, 0));
+  CHECK(FakePanel_Buffer(&Display, 10, 0));
+  CHECK(FakePanel_Buffer(&Display, 0, 10));
+  CHECK(!FakePanel_Buffer(&Display, 11, 0));
+  ssd1306_Fill(Black);
+  ssd1306_FillCircle(SSD1306_WIDTH - 1, SSD1306_HEIGHT - 1, 40, White);
+  CHECK(FakePanel_Buffer(&Display, SSD1306_WIDTH - 1, SSD1306_HEIGHT - 1));
+  CHECK(RowsAreSpans());
+}
+
+static void test_FillRectangle(void)
+{
+  int16_t x, y;
+
+  ssd1306_Fill(Black);
+  // Corners in any order, across page boundaries
+  ssd1306_FillRectangle(70, 21, 3, 5, White);
+  CHECK_EQ(FakePanel_Count(&Display), 68 * 17);
+  for (y = 0; y < SSD1306_HEIGHT; y++)
+  {
+    for (x = 0; x < SSD1306_WIDTH; x++)
+    {
+      CHECK_EQ(FakePanel_Buffer(&Display, x, y), x >= 3 && x <= 70 && y >= 5 && y <= 21);
+    }
+  }
+  ssd1306_FillRectangle(10, 8, 20, 15, Black);
+  CHECK_EQ(FakePanel_Count(&Display), 68 * 17 - 11 * 8);
+}
+
+static void test_FillRoundRectangle(void)
+{
+  static uint8_t square[SSD1306_BUFFER_SIZE];
+
+  ssd1306_Fill(Black);
+  ssd1306_FillRectangle(10, 5, 90, 50, White);
+  memcpy(square, Display.Buffer, sizeof(square));
+  ssd1306_Fill(Black);
+  ssd1306_FillRoundRectangle(10, 5, 90, 50, 0, White);
+  CHECK(memcmp(square, Display.Buffer, sizeof(square)) == 0);
+
+  ssd1306_Fill(Black);
+  ssd1306_FillRoundRectangle(90, 50, 10, 5, 8, White);
+  CHECK(RowsAreSpans());
+  CHECK(!FakePanel_Buffer(&Display, 10, 5));
+  CHECK(!FakePanel_Buffer(&Display, 90, 50));
+  CHECK(FakePanel_Buffer(&Display, 50, 5));
+  CHECK(FakePanel_Buffer(&Display, 10, 27));
+  CHECK(FakePanel_Buffer(&Display, 90, 27));
+  CHECK(FakePanel_Buffer(&Display, 50, 50));
+  CHECK(FakePanel_Count(&Display) < 81 * 46);
+
+  // A radius larger than the rectangle is cut to half its shorter side
+  ssd1306_Fill(Black);
+  ssd1306_FillRoundRectangle(20, 20, 40, 30, 200, White);
+  CHECK(RowsAreSpans());
+  CHECK(FakePanel_Buffer(&Display, 30, 25));
+  CHECK(!FakePanel_Buffer(&Display, 19, 25));
+  CHECK(!FakePanel_Buffer(&Display, 41, 25));
+}
+
+static void test_FillPolygonMatchesEvenOdd(void)
+{
+  SSD1306_VERTEX vertex[SSD1306_POLYGON_MAX_VERTICES];
+  uint16_t count, i, round;
+  int16_t x, y;
+  uint8_t lit;
+
+  srand(27);
+  for (round = 0; round < 300; round++)
+  {
+    count = 3 + rand() % (SSD1306_POLYGON_MAX_VERTICES - 2);
+    for (i = 0; i < count; i++)
+    {
+      vertex[i].x = rand() % SSD1306_WIDTH;
+      vertex[i].y = rand() % SSD1306_HEIGHT;
+    }
+    ssd1306_Fill(Black);
+    ssd1306_FillPolygon(vertex, count, White);
+    for (y = 0; y < SSD1306_HEIGHT; y++)
+    {
+      for (x = 0; x < SSD1306_WIDTH; x++)
+      {
+        lit = FakePanel_Buffer(&Display, x, y);
+        // Away from the outline the even-odd rule decides alone
+        if (OutlineDistance(vertex, count, x, y) >= 1.0)
+        {
+          CHECK_EQ(lit, InsidePolygon(vertex, count, x, y));
+        }
+      }
+    }
+  }
+}
+
+static void test_FillConcavePolygon(void)
+{
+  // A U: the notch between the arms stays clear
+  const SSD1306_VERTEX u[] = {{10, 5}, {30, 5}, {30, 40}, {80, 40}, {80, 5}, {100, 5}, {100, 60}, {10, 60}};
+
+  ssd1306_Fill(Black);
+  ssd1306_FillPolygon(u, sizeof(u) / sizeof(u[0]), White);
+  CHECK(FakePanel_Buffer(&Display, 20, 20));
+  CHECK(FakePanel_Buffer(&Display, 90, 20));
+  CHECK(FakePanel_Buffer(&Display, 55, 50));
+  CHECK(!FakePanel_Buffer(&Display, 55, 20));
+  CHECK(!FakePanel_Buffer(&Display, 55, 38));
+}
+
+static void test_FillTriangle(void)
+{
+  const SSD1306_VERTEX triangle[] = {{5, 60}, {64, 2}, {120, 60}};
+  static uint8_t polygon[SSD1306_BUFFER_SIZE];
+
+  ssd1306_Fill(Black);
+  ssd1306_FillPolygon(triangle, 3, White);
+  memcpy(polygon, Display.Buffer, sizeof(polygon));
+  ssd1306_Fill(Black);
+  ssd1306_FillTriangle(120, 60, 5, 60, 64, 2, White);
+  CHECK(RowsAreSpans());
+  CHECK(memcmp(polygon, Display.Buffer, sizeof(polygon)) == 0);
+}
+
+// Tells whether the panel shows the framebuffer
+static uint8_t PanelMatches(void)
+{
+  int16_t x, y;
+
+  for (y = 0; y < SSD1306_HEIGHT; y++)
+  {
+    for (x = 0; x < SSD1306_WIDTH; x++)
+    {
+      if (FakePanel_Shown(x, y) != FakePanel_Buffer(&Display, x, y))
+      {
+        return 0;
+      }
+    }
+  }
+  return 1;
+}
+
+// Tells whether every lit pixel is in x1..x2, y1..y2
+static uint8_t LitOnlyIn(int16_t x1, int16_t y1, int16_t x2, int16_t y2)
+{
+  int16_t x, y;
+
+  for (y = 0; y < SSD1306_HEIGHT; y++)
+  {
+    for (x = 0; x < SSD1306_WIDTH; x++)
+    {
+      if (FakePanel_Buffer(&Display, x, y) && (x < x1 || x > x2 || y < y1 || y > y2))
+      {
+        return 0;
+      }
+    }
+  }
+  return 1;
+}
+
+static void test_ClipRectangle(void)
+{
+  ssd1306_Fill(Black);
+  CHECK_EQ(ssd1306_PushClipRect(50, 40, 20, 10), SSD1306_OK);
+  ssd1306_FillRectangle(0, 0, SSD1306_WIDTH - 1, SSD1306_HEIGHT - 1, White);
+  CHECK_EQ(FakePanel_Count(&Display), 31 * 31);
+  CHECK(LitOnlyIn(20, 10, 50, 40));
+
+  // Nested rectangles intersect, popping restores the outer one
+  ssd1306_Fill(Black);
+  CHECK_EQ(ssd1306_PushClipRect(40, 0, 100, 20), SSD1306_OK);
+  ssd1306_FillCircle(45, 15, 30, White);
+  CHECK(LitOnlyIn(40, 10, 50, 20));
+  CHECK_EQ(FakePanel_Count(&Display), 11 * 11);
+  ssd1306_PopClipRect();
+  ssd1306_FillRectangle(0, 0, SSD1306_WIDTH - 1, SSD1306_HEIGHT - 1, White);
+  CHECK_EQ(FakePanel_Count(&Display), 31 * 31);
+  ssd1306_PopClipRect();
+  ssd1306_PopClipRect();
+  ssd1306_FillRectangle(0, 0, SSD1306_WIDTH - 1, SSD1306_HEIGHT - 1, White);
+  CHECK_EQ(FakePanel_Count(&Display), SSD1306_WIDTH * SSD1306_HEIGHT);
+}
+
+static void test_ClipStackDepth(void)
+{
+  uint8_t i;
+
+  for (i = 0; i < SSD1306_CLIP_STACK_DEPTH; i++)
+  {
+    CHECK_EQ(ssd1306_PushClipRect(i, i, SSD1306_WIDTH - 1 - i, SSD1306_HEIGHT - 1 - i), SSD1306_OK);
+  }
+  CHECK_EQ(ssd1306_PushClipRect(0, 0, 1, 1), SSD1306_ERR);
+  ssd1306_Fill(Black);
+  ssd1306_FillRectangle(0, 0, SSD1306_WIDTH - 1, SSD1306_HEIGHT - 1, White);
+  i = SSD1306_CLIP_STACK_DEPTH - 1;
+  CHECK(LitOnlyIn(i, i, SSD1306_WIDTH - 1 - i, SSD1306_HEIGHT - 1 - i));
+  for (i = 0; i < SSD1306_CLIP_STACK_DEPTH; i++)
+  {
+    ssd1306_PopClipRect();
+  }
+  CHECK_EQ(Display.ClipDepth, 0);
+}
+
+static void test_EmptyClipDrawsNothing(void)
+{
+  ssd1306_Fill(Black);
+  CHECK_EQ(ssd1306_PushClipRect(10, 10, 20, 20), SSD1306_OK);
+  CHECK_EQ(ssd1306_PushClipRect(30, 30, 40, 40), SSD1306_OK);
+  ssd1306_FillRectangle(0, 0, SSD1306_WIDTH - 1, SSD1306_HEIGHT - 1, White);
+  ssd1306_Line(0, 0, SSD1306_WIDTH - 1, SSD1306_HEIGHT - 1, White);
+  ssd1306_FillCircle(15, 35, 20, White);
+  ssd1306_DrawPixel(15, 15, White);
+  CHECK_EQ(FakePanel_Count(&Display), 0);
+  ssd1306_PopClipRect();
+  ssd1306_PopClipRect();
+}
+
+static void test_ClippedLineIsTheSameLine(void)
+{
+  static uint8_t whole[SSD1306_BUFFER_SIZE];
+  int16_t x1, y1, x2, y2, x, y;
+  uint16_t round;
+
+  srand(28);
+  for (round = 0; round < 500; round++)
+  {
+    x1 = rand() % 400 - 130;
+    y1 = rand() % 200 - 64;
+    x2 = rand() % 400 - 130;
+    y2 = rand() % 200 - 64;
+    // The screen clips the same line as a clip rectangle inside it
+    ssd1306_Fill(Black);
+    ssd1306_Line(x1, y1, x2, y2, White);
+    memcpy(whole, Display.Buffer, sizeof(whole));
+    ssd1306_Fill(Black);
+    ssd1306_PushClipRect(30, 10, 100, 50);
+    ssd1306_Line(x1, y1, x2, y2, White);
+    ssd1306_PopClipRect();
+    for (y = 0; y < SSD1306_HEIGHT; y++)
+    {
+      for (x = 0; x < SSD1306_WIDTH; x++)
+      {
+        CHECK_EQ(FakePanel_Buffer(&Display, x, y),
+                 x >= 30 && x <= 100 && y >= 10 && y <= 50 && ((whole[(y / 8) * SSD1306_WIDTH + x] >> (y % 8)) & 1));
+      }
+    }
+  }
+}
+
+static void test_FarOffScreen(void)
+{
+  const SSD1306_VERTEX far[] = {{-30000, -30000}, {30000, 10}, {-30000, 30000}};
+  int16_t x;
+
+  ssd1306_Fill(Black);
+  ssd1306_Line(-30000, 10, 30000, 10, White);
+  for (x = 0; x < SSD1306_WIDTH; x++)
+  {
+    CHECK(FakePanel_Buffer(&Display, x, 10));
+  }
+  CHECK_EQ(FakePanel_Count(&Display), SSD1306_WIDTH);
+  ssd1306_Fill(Black);
+  ssd1306_DrawCircle(-5, -5, 20, White);
+  ssd1306_FillCircle(SSD1306_WIDTH + 5, SSD1306_HEIGHT + 5, 20, White);
+  ssd1306_FillRoundRectangle(-100, 30, 10, 300, 5, White);
+  ssd1306_FillPolygon(far, 3, White);
+  ssd1306_DrawRectangle(-1, -1, SSD1306_WIDTH, SSD1306_HEIGHT, White);
+  ssd1306_SetCursor(SSD1306_WIDTH - 3, SSD1306_HEIGHT - 3);
+  ssd1306_WriteString("clip", Font_7x10, White);
+  CHECK(FakePanel_Count(&Display) > 0);
+}
+
+static void test_ClippedTextAndUpdate(void)
+{
+  ssd1306_Fill(Black);
+  ssd1306_UpdateScreen();
+  CHECK(PanelMatches());
+
+  // Only the glyph columns inside the clip go over the bus
+  Fake_Panel.Bytes = 0;
+  ssd1306_PushClipRect(10, 0, 20, 7);
+  ssd1306_SetCursor(4, 2);
+  ssd1306_WriteString("Clip", Font_7x10, White);
+  ssd1306_PopClipRect();
+  CHECK(LitOnlyIn(10, 0, 20, 7));
+  CHECK(FakePanel_Count(&Display) > 0);
+  ssd1306_UpdateScreenPartial();
+  CHECK(PanelMatches());
+  CHECK(Fake_Panel.Bytes <= 2 * (5 + 1 + 12 + 1));
+}
+
+int main(void)
+{
+  FakePanel_Init(&Display);
+  test_ArcStaysOnCircle();
+  test_ArcPointsMatchSine();
+  test_FullTurnIsCircle();
+  test_SweepIsNormalized();
+  test_ArcWithRadiusLine();
+  test_FillCircleCoversOutline();
+  test_FillCircleAtTheEdges();
+  test_FillRectangle();
+  test_FillRoundRectangle();
+  test_FillPolygonMatchesEvenOdd();
+  test_FillConcavePolygon();
+  test_FillTriangle();
+  test_ClipRectangle();
+  test_ClipStackDepth();
+  test_EmptyClipDrawsNothing();
+  test_ClippedLineIsTheSameLine();
+  test_FarOffScreen();
+  test_ClippedTextAndUpdate();
+  TEST_EXIT();
+}
@@ -0,0 +1,161 @@
+/*
+ *      test_ssd1306_panels.c
+ *
+ *	The MIT License.
+ */
+
+#include <string.h>
+
+#include "fake_panel.h"
+#include "test.h"
+
+// Bus time of a byte at 400 kHz: 8 bits and the acknowledge
+#define BYTE_US (9 * 1000000.0 / 400000)
+
+static const nrf_twi_mngr_t Twi;
+static SSD1306_t Left;
+static SSD1306_t Right;
+static SSD1306_t *const Both[] = {&Left, &Right};
+
+static uint32_t Mismatches(const SSD1306_t *display, const FAKE_PANEL *panel)
+{
+  uint32_t count = 0;
+  int16_t x, y;
+
+  for (y = 0; y < SSD1306_HEIGHT; y++)
+  {
+    for (x = 0; x < SSD1306_WIDTH; x++)
+    {
+      count += FakePanel_ShownBy(panel, x, y) != FakePanel_Buffer(display, x, y);
+    }
+  }
+  return count;
+}
+
+static void InitBoth(void)
+{
+  memset(Fake_Panels, 0, sizeof(Fake_Panels));
+  Fake_Panel_Hold = 0;
+  ssd1306_InitDisplay(&Left, &Twi, SSD1306_I2C_ADDR);
+  ssd1306_InitDisplay(&Right, &Twi, SSD1306_I2C_ADDR + 1);
+}
+
+static uint32_t RunAll(void)
+{
+  uint32_t count = 0;
+
+  while (FakePanel_Run() != 0)
+  {
+    count++;
+  }
+  return count;
+}
+
+// An instance on the stack starts from garbage, nothing of it may stick
+static void test_InitResetsTheInstance(void)
+{
+  SSD1306_t display;
+
+  memset(&display, 0xA5, sizeof(display));
+  memset(Fake_Panels, 0, sizeof(Fake_Panels));
+  Fake_Panel_Hold = 0;
+  ssd1306_InitDisplay(&display, &Twi, SSD1306_I2C_ADDR);
+  CHECK_EQ(display.Initialized, 1);
+  CHECK_EQ(display.ClipDepth, 0);
+  ssd1306_FillRectangle(10, 0, 20, SSD1306_HEIGHT - 1, White);
+  ssd1306_UpdateScreenPartial();
+  CHECK_EQ(Mismatches(&display, &Fake_Panel), 0);
+
+  // Initialized again with pages still dirty
+  ssd1306_FillCircle(60, 16, 10, White);
+  ssd1306_InitDisplay(&display, &Twi, SSD1306_I2C_ADDR);
+  CHECK_EQ(FakePanel_Count(&display), 0);
+  CHECK_EQ(Mismatches(&display, &Fake_Panel), 0);
+}
+
+// Each panel gets its own picture, and a shared bus alternates between them
+static void test_FlushesInterleave(void)
+{
+  uint8_t address, previous = 0;
+  uint32_t count = 0;
+
+  InitBoth();
+  ssd1306_SelectDisplay(&Left);
+  ssd1306_FillRectangle(0, 0, SSD1306_WIDTH / 2, SSD1306_HEIGHT - 1, White);
+  ssd1306_SelectDisplay(&Right);
+  ssd1306_FillCircle(SSD1306_WIDTH / 2, SSD1306_HEIGHT / 2, SSD1306_HEIGHT / 2 - 1, White);
+
+  Fake_Panel_Hold = 1;
+  ssd1306_UpdateDisplays(Both, 2);
+  while ((address = FakePanel_Run()) != 0)
+  {
+    CHECK(address != previous);
+    previous = address;
+    count++;
+  }
+  CHECK_EQ(count, 2 * SSD1306_PAGES);
+  CHECK_EQ(Mismatches(&Left, &Fake_Panels[0]), 0);
+  CHECK_EQ(Mismatches(&Right, &Fake_Panels[1]), 0);
+  CHECK(FakePanel_Count(&Left) != FakePanel_Count(&Right));
+}
+
+// A page still on its way is not queued again, its new changes wait
+static void test_BusyPageStaysDirty(void)
+{
+  InitBoth();
+  Fake_Panel_Hold = 1;
+  ssd1306_SelectDisplay(&Left);
+  ssd1306_DrawPixel(3, 3, White);
+  ssd1306_UpdateDisplays(Both, 2);
+  ssd1306_DrawPixel(100, 4, White);
+  ssd1306_UpdateDisplays(Both, 2);
+  CHECK_EQ(RunAll(), 1);
+  CHECK_EQ(FakePanel_ShownBy(&Fake_Panels[0], 100, 4), 0);
+  ssd1306_UpdateDisplays(Both, 2);
+  CHECK_EQ(RunAll(), 1);
+  CHECK_EQ(Mismatches(&Left, &Fake_Panels[0]), 0);
+  CHECK_EQ(Mismatches(&Right, &Fake_Panels[1]), 0);
+}
+
+// Bus bytes of a frame on both panels, reported as frames per second at 400 kHz
+static void test_FrameRate(void)
+{
+  uint32_t bytes;
+  uint8_t frame;
+
+  InitBoth();
+  Fake_Panels[0].Bytes = Fake_Panels[1].Bytes = 0;
+  for (frame = 0; frame < 10; frame++)
+  {
+    ssd1306_SelectDisplay(&Left);
+    ssd1306_UpdateScreen();
+    ssd1306_SelectDisplay(&Right);
+    ssd1306_UpdateScreen();
+  }
+  bytes = (Fake_Panels[0].Bytes + Fake_Panels[1].Bytes) / 10;
+  CHECK_EQ(Fake_Panels[0].Bytes, Fake_Panels[1].Bytes);
+  printf("2 panels, full frames: %u bytes, %.1f frames/s\n", (unsigned)bytes, 1000000 / (bytes * BYTE_US));
+
+  // A 6x8 glyph on each
+  Fake_Panels[0].Bytes = Fake_Panels[1].Bytes = 0;
+  for (frame = 0; frame < 10; frame++)
+  {
+    ssd1306_SelectDisplay(&Left);
+    ssd1306_FillRectangle(60, 8, 65, 15, frame % 2 ? White : Black);
+    ssd1306_SelectDisplay(&Right);
+    ssd1306_FillRectangle(60, 8, 65, 15, frame % 2 ? White : Black);
+    ssd1306_UpdateDisplays(Both, 2);
+  }
+  bytes = (Fake_Panels[0].Bytes + Fake_Panels[1].Bytes) / 10;
+  CHECK(bytes < 50);
+  printf("2 panels, one glyph each: %u bytes, %.1f frames/s\n", (unsigned)bytes, 1000000 / (bytes * BYTE_US));
+}
+
+int main(void)
+{
+  test_InitResetsTheInstance();
+  test_FlushesInterleave();
+  test_BusyPageStaysDirty();
+  test_FrameRate();
+  TEST_EXIT();
+}
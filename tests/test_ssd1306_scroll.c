@@ -0,0 +1,86 @@
+/*
+ *      test_ssd1306_scroll.c
+ *
+ *	The MIT License.
+ */
+
+// Built once per panel height, see CMakeLists.txt
+
+#include <stdlib.h>
+
+#include "fake_panel.h"
+#include "test.h"
+
+static SSD1306_t Display;
+
+static uint32_t Mismatches(void)
+{
+  uint32_t count = 0;
+  int16_t x, y;
+
+  for (y = 0; y < SSD1306_HEIGHT; y++)
+  {
+    for (x = 0; x < SSD1306_WIDTH; x++)
+    {
+      count += FakePanel_Shown(x, y) != FakePanel_Buffer(&Display, x, y);
+    }
+  }
+  return count;
+}
+
+static void test_ScrollKeepsPanelInStep(void)
+{
+  uint8_t round, k;
+
+  srand(29);
+  for (round = 0; round < 40; round++)
+  {
+    ssd1306_ScrollUpPages(1 + round % 3, Black);
+    for (k = 0; k < 30; k++)
+    {
+      ssd1306_DrawPixel(rand() % SSD1306_WIDTH, rand() % SSD1306_HEIGHT, White);
+    }
+    ssd1306_UpdateScreenPartial();
+    CHECK_EQ(Mismatches(), 0);
+  }
+}
+
+static void test_ScrollMovesThePicture(void)
+{
+  ssd1306_Fill(Black);
+  ssd1306_FillRectangle(0, 8, SSD1306_WIDTH - 1, 15, White);
+  ssd1306_UpdateScreen();
+  ssd1306_ScrollUpPages(1, Black);
+  // Page 1 is now at the top, the new bottom page is clear
+  CHECK(FakePanel_Buffer(&Display, 0, 0));
+  CHECK(FakePanel_Buffer(&Display, SSD1306_WIDTH - 1, 7));
+  CHECK(!FakePanel_Buffer(&Display, 0, 8));
+  CHECK_EQ(FakePanel_Count(&Display), SSD1306_WIDTH * 8);
+  ssd1306_UpdateScreenPartial();
+  CHECK_EQ(Mismatches(), 0);
+}
+
+static void test_RingScrollSendsOnlyNewPages(void)
+{
+  ssd1306_Fill(Black);
+  ssd1306_UpdateScreen();
+  Fake_Panel.Bytes = 0;
+  ssd1306_ScrollUpPages(1, White);
+  ssd1306_UpdateScreenPartial();
+  CHECK_EQ(Mismatches(), 0);
+#if SSD1306_RING_SCROLL
+  // Start line command, then one page
+  CHECK(Fake_Panel.Bytes < 2 * (SSD1306_WIDTH + 8));
+#else
+  CHECK(Fake_Panel.Bytes >= SSD1306_PAGES * SSD1306_WIDTH);
+#endif
+}
+
+int main(void)
+{
+  FakePanel_Init(&Display);
+  test_ScrollKeepsPanelInStep();
+  test_ScrollMovesThePicture();
+  test_RingScrollSendsOnlyNewPages();
+  TEST_EXIT();
+}
@@ -0,0 +1,271 @@
+/*
+ *      test_tca9548a.c
+ *
+ *	The MIT License.
+ */
+
+#include "fake_twi.h"
+#include "test.h"
+#include "twi_mng_tca9548a.h"
+
+#define SENSOR_ADD (0x40)
+
+static const nrf_twi_mngr_t Twi;
+static TCA9548A_t Mux;
+static FAKE_TWI_DEVICE Sensors[TCA9548A_CHANNELS];
+
+// A read from a sensor gives the channel it is behind
+static ret_code_t Sensor(FAKE_TWI_DEVICE *device, const nrf_twi_mngr_transfer_t *transfer)
+{
+  memset(transfer->p_data, (int)(device - Sensors), transfer->length);
+  return NRF_SUCCESS;
+}
+
+// A routed read of the sensor behind a channel, and what came back
+typedef struct
+{
+  uint8_t Channel;
+  uint8_t Value;
+  uint8_t Done;
+  ret_code_t Result;
+  nrf_twi_mngr_transfer_t Transfer;
+  nrf_twi_mngr_transaction_t Transaction;
+} READ;
+
+static void ReadDone(ret_code_t result, void *p_user_data)
+{
+  READ *read = (READ *)p_user_data;
+
+  read->Result = result;
+  read->Done++;
+}
+
+static ret_code_t Schedule(READ *read, uint8_t channel)
+{
+  memset(read, 0, sizeof(*read));
+  read->Channel = channel;
+  read->Value = 0xEE;
+  read->Transfer = (nrf_twi_mngr_transfer_t)NRF_TWI_MNGR_READ(SENSOR_ADD, &read->Value, 1, 0);
+  read->Transaction.callback = ReadDone;
+  read->Transaction.p_user_data = read;
+  read->Transaction.p_transfers = &read->Transfer;
+  read->Transaction.number_of_transfers = 1;
+  return TCA9548A_Schedule(&Mux, channel, &read->Transaction);
+}
+
+static uint8_t Perform(uint8_t channel, ret_code_t *result)
+{
+  uint8_t value = 0xEE;
+  nrf_twi_mngr_transfer_t transfer = NRF_TWI_MNGR_READ(SENSOR_ADD, &value, 1, 0);
+
+  *result = TCA9548A_Perform(&Mux, channel, &transfer, 1);
+  return value;
+}
+
+static void CheckRead(const READ *read)
+{
+  CHECK_EQ(read->Done, 1);
+  CHECK_EQ(read->Result, NRF_SUCCESS);
+  CHECK_EQ(read->Value, read->Channel);
+}
+
+// Sensors at the same address behind every channel, the mux deselected
+static void Setup(uint8_t queue_size)
+{
+  uint8_t i;
+
+  FakeTwi_Init(queue_size);
+  Fake_Twi.MuxAddress = TCA9548A_ADD;
+  Fake_Twi.Mux = 0xFF;
+  memset(Sensors, 0, sizeof(Sensors));
+  for (i = 0; i < TCA9548A_CHANNELS; i++)
+  {
+    Sensors[i].Address = SENSOR_ADD;
+    Sensors[i].Channels = 1 << i;
+    Sensors[i].Handler = Sensor;
+    FakeTwi_Add(&Sensors[i]);
+  }
+  TCA9548A_Init(&Mux, &Twi, TCA9548A_ADD);
+}
+
+static void test_InitDeselects(void)
+{
+  Setup(4);
+  CHECK_EQ(Fake_Twi.Mux, 0);
+  CHECK_EQ(Mux.ActiveChannel, TCA9548A_NO_CHANNEL);
+
+  // No mux on the bus
+  Fake_Twi.MuxAddress = 0;
+  CHECK_EQ(TCA9548A_Init(&Mux, &Twi, TCA9548A_ADD), NRF_ERROR_DRV_TWI_ERR_ANACK);
+  CHECK_EQ(Mux.ActiveChannel, TCA9548A_NO_CHANNEL);
+}
+
+// Transactions of one channel share a select, then the next channel gets its turn
+static void test_ScheduleRoutes(void)
+{
+  READ reads[6];
+  static const uint8_t channels[6] = {3, 3, 6, 3, 0, 6};
+  uint8_t i;
+
+  Setup(4);
+  for (i = 0; i < 6; i++)
+  {
+    CHECK_EQ(Schedule(&reads[i], channels[i]), NRF_SUCCESS);
+  }
+  CHECK_EQ(FakeTwi_Queued(), 1);
+  FakeTwi_RunAll();
+  for (i = 0; i < 6; i++)
+  {
+    CheckRead(&reads[i]);
+  }
+  CHECK_EQ(Mux.Transactions, 6);
+  CHECK_EQ(Mux.Switches, 3);
+}
+
+// A routed transaction is dispatched from the callback of the one before
+// it, while a blocking call waits in the manager queue: the blocking call
+// goes through the router, so the dispatch knows which channel is selected
+static void test_PerformBetweenScheduled(void)
+{
+  READ reads[4];
+  ret_code_t result;
+  uint8_t value;
+
+  Setup(4);
+  CHECK_EQ(Schedule(&reads[0], 1), NRF_SUCCESS);
+  CHECK_EQ(Schedule(&reads[1], 1), NRF_SUCCESS);
+  CHECK_EQ(Schedule(&reads[2], 5), NRF_SUCCESS);
+  value = Perform(2, &result);
+  CHECK_EQ(result, NRF_SUCCESS);
+  CHECK_EQ(value, 2);
+  CHECK_EQ(Schedule(&reads[3], 1), NRF_SUCCESS);
+  FakeTwi_RunAll();
+  CheckRead(&reads[0]);
+  CheckRead(&reads[1]);
+  CheckRead(&reads[2]);
+  CheckRead(&reads[3]);
+  CHECK_EQ(Mux.ActiveChannel, 1);
+  CHECK_EQ(Fake_Twi.Mux, 1 << 1);
+}
+
+static void test_PerformAfterPerform(void)
+{
+  ret_code_t result;
+  uint8_t i;
+
+  Setup(4);
+  for (i = 0; i < 2 * TCA9548A_CHANNELS; i++)
+  {
+    CHECK_EQ(Perform(i % 3 * 3, &result), i % 3 * 3);
+    CHECK_EQ(result, NRF_SUCCESS);
+  }
+  CHECK_EQ(FakeTwi_Queued(), 0);
+  CHECK_EQ(Mux.Current, NULL);
+}
+
+// A channel with nothing behind it fails the transaction, and the mux
+// is selected again for the next one
+static void test_PerformFails(void)
+{
+  READ read;
+  ret_code_t result;
+
+  Setup(4);
+  Fake_Twi.DeviceCount = 4;
+  Perform(6, &result);
+  CHECK_EQ(result, NRF_ERROR_DRV_TWI_ERR_ANACK);
+  Sensors[2].Fail = 1;
+  Perform(2, &result);
+  CHECK_EQ(result, NRF_ERROR_DRV_TWI_ERR_ANACK);
+  CHECK_EQ(Mux.ActiveChannel, TCA9548A_NO_CHANNEL);
+  Fake_Twi.Mux = 0;
+  CHECK_EQ(Schedule(&read, 2), NRF_SUCCESS);
+  FakeTwi_RunAll();
+  CheckRead(&read);
+}
+
+static void test_PerformChecksArguments(void)
+{
+  READ reads[TCA9548A_QUEUE_SIZE + 1];
+  nrf_twi_mngr_transfer_t transfers[TCA9548A_MAX_TRANSFERS + 1] = {{0}};
+  ret_code_t result;
+  uint8_t i;
+
+  Setup(4);
+  Perform(TCA9548A_CHANNELS, &result);
+  CHECK_EQ(result, NRF_ERROR_INVALID_PARAM);
+  CHECK_EQ(TCA9548A_Perform(&Mux, 0, transfers, TCA9548A_MAX_TRANSFERS + 1), NRF_ERROR_INVALID_LENGTH);
+
+  // The first one is in the manager, the others fill the channel queue
+  for (i = 0; i <= TCA9548A_QUEUE_SIZE; i++)
+  {
+    CHECK_EQ(Schedule(&reads[i], 4), NRF_SUCCESS);
+  }
+  Perform(4, &result);
+  CHECK_EQ(result, NRF_ERROR_NO_MEM);
+  FakeTwi_RunAll();
+  for (i = 0; i <= TCA9548A_QUEUE_SIZE; i++)
+  {
+    CheckRead(&reads[i]);
+  }
+}
+
+static READ Again;
+
+// Failed read that schedules another one from its callback
+static void ReadAgain(ret_code_t result, void *p_user_data)
+{
+  ReadDone(result, p_user_data);
+  if (result != NRF_SUCCESS)
+  {
+    CHECK_EQ(Schedule(&Again, 6), NRF_SUCCESS);
+  }
+}
+
+// With the manager queue full, the owners get the error back at once and
+// the router is free for the next transaction
+static void test_ManagerQueueFull(void)
+{
+  READ reads[3];
+  uint8_t value;
+  nrf_twi_mngr_transfer_t transfer = NRF_TWI_MNGR_READ(TCA9548A_ADD, &value, 1, 0);
+  nrf_twi_mngr_transaction_t other = {NULL, NULL, &transfer, 1, NULL};
+
+  Setup(1);
+  CHECK_EQ(nrf_twi_mngr_schedule(&Twi, &other), NRF_SUCCESS);
+  CHECK_EQ(Schedule(&reads[0], 3), NRF_SUCCESS);
+  CHECK_EQ(reads[0].Done, 1);
+  CHECK_EQ(reads[0].Result, NRF_ERROR_NO_MEM);
+  CHECK_EQ(Mux.Current, NULL);
+
+  memset(&Again, 0, sizeof(Again));
+  Schedule(&reads[1], 3);
+  CHECK_EQ(reads[1].Done, 1);
+  reads[1].Done = 0;
+  reads[1].Transaction.callback = ReadAgain;
+  CHECK_EQ(TCA9548A_Schedule(&Mux, 3, &reads[1].Transaction), NRF_SUCCESS);
+  CHECK_EQ(reads[1].Done, 1);
+  CHECK_EQ(Again.Done, 1);
+  CHECK_EQ(Again.Result, NRF_ERROR_NO_MEM);
+  CHECK_EQ(Mux.Refused, 4);
+  CHECK_EQ(Mux.Transactions, 0);
+  CHECK_EQ(Mux.ActiveChannel, TCA9548A_NO_CHANNEL);
+
+  FakeTwi_RunAll();
+  CHECK_EQ(Schedule(&reads[2], 3), NRF_SUCCESS);
+  FakeTwi_RunAll();
+  CheckRead(&reads[2]);
+  CHECK_EQ(Mux.Switches, 1);
+}
+
+int main(void)
+{
+  test_InitDeselects();
+  test_ScheduleRoutes();
+  test_PerformBetweenScheduled();
+  test_PerformAfterPerform();
+  test_PerformFails();
+  test_PerformChecksArguments();
+  test_ManagerQueueFull();
+  TEST_EXIT();
+}
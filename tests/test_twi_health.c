@@ -0,0 +1,247 @@
+/*
+ *      test_twi_health.c
+ *
+ *	The MIT License.
+ */
+
+#include "fake_twi.h"
+#include "test.h"
+#include "twi_health.h"
+#include "twi_mng_hdc1080.h"
+#include "twi_mng_ssd1306.h"
+
+// Bus time of an attempt at 400 kHz, in app_timer ticks: 4 bytes, 90 us
+#define TICKS_OK (3)
+#define BYTES (4)
+
+// A full frame is 16 transfers, one command and one data write per page
+#define FRAME_TRANSFERS (2 * SSD1306_PAGES)
+
+static const nrf_twi_mngr_t Twi;
+static TWI_BUS Bus;
+static TWI_HEALTH Health;
+static uint32_t Now;
+
+static void Attempt(uint8_t failed, uint32_t ticks)
+{
+  Now += APP_TIMER_TICKS(100);
+  TwiHealth_Update(&Health, failed, ticks, BYTES, Now);
+}
+
+// One failed attempt in three keeps a device degraded, it does not flap
+// back to healthy between the failures
+static void test_FlappingStaysDegraded(void)
+{
+  TWI_HEALTH_STATE previous = TWI_HEALTH_OK;
+  uint16_t changes = 0;
+  uint16_t i;
+
+  TwiHealth_Init(&Health);
+  Now = 0;
+  for (i = 0; i < 300; i++)
+  {
+    Attempt(i % 3 == 0, TICKS_OK);
+    changes += Health.State != previous;
+    previous = Health.State;
+    CHECK(Health.State != TWI_HEALTH_QUARANTINED);
+  }
+  CHECK_EQ(Health.State, TWI_HEALTH_DEGRADED);
+  CHECK_EQ(changes, 1);
+
+  // Healthy again once the error rate has decayed below 2 %
+  for (i = 0; i < 100 && Health.State != TWI_HEALTH_OK; i++)
+  {
+    Attempt(0, TICKS_OK);
+  }
+  CHECK_EQ(Health.State, TWI_HEALTH_OK);
+  CHECK(i > 30);
+}
+
+// Eight failures in a row quarantine, then one probe every 5 s is let through
+static void test_QuarantineAndProbe(void)
+{
+  uint8_t i;
+
+  TwiHealth_Init(&Health);
+  Now = 0;
+  for (i = 0; i < TWI_HEALTH_QUARANTINE_STREAK; i++)
+  {
+    CHECK_EQ(TwiHealth_Admit(&Health, Now), 1);
+    Attempt(1, TICKS_OK);
+  }
+  CHECK_EQ(Health.State, TWI_HEALTH_QUARANTINED);
+
+  CHECK_EQ(TwiHealth_Admit(&Health, Now + APP_TIMER_TICKS(TWI_HEALTH_PROBE_MS) - 1), 0);
+  CHECK_EQ(Health.Dropped, 1);
+
+  // A failed probe starts the wait again
+  Now += APP_TIMER_TICKS(TWI_HEALTH_PROBE_MS);
+  CHECK_EQ(TwiHealth_Admit(&Health, Now), 1);
+  CHECK_EQ(TwiHealth_Admit(&Health, Now), 0);
+  TwiHealth_Update(&Health, 1, TICKS_OK, BYTES, Now);
+  CHECK_EQ(Health.State, TWI_HEALTH_QUARANTINED);
+  CHECK_EQ(TwiHealth_Admit(&Health, Now + 1), 0);
+
+  // A good probe puts it on probation
+  Now += APP_TIMER_TICKS(TWI_HEALTH_PROBE_MS);
+  CHECK_EQ(TwiHealth_Admit(&Health, Now), 1);
+  TwiHealth_Update(&Health, 0, TICKS_OK, BYTES, Now);
+  CHECK_EQ(Health.State, TWI_HEALTH_DEGRADED);
+  CHECK_EQ(TwiHealth_Admit(&Health, Now), 1);
+}
+
+// A single stall, however long, moves the average by a capped amount
+static void test_StallIsCapped(void)
+{
+  uint8_t i;
+
+  TwiHealth_Init(&Health);
+  Now = 0;
+  for (i = 0; i < 32; i++)
+  {
+    Attempt(0, TICKS_OK);
+  }
+  Attempt(0, APP_TIMER_TICKS(1000));
+  CHECK(Health.State != TWI_HEALTH_QUARANTINED);
+  for (i = 0; i < 32; i++)
+  {
+    Attempt(0, TICKS_OK);
+  }
+  CHECK_EQ(Health.State, TWI_HEALTH_OK);
+
+  // A device that keeps stalling is quarantined all the same
+  for (i = 0; i < 32 && Health.State != TWI_HEALTH_QUARANTINED; i++)
+  {
+    Attempt(0, APP_TIMER_TICKS(1000));
+  }
+  CHECK_EQ(Health.State, TWI_HEALTH_QUARANTINED);
+  CHECK(i >= 8);
+}
+
+static FAKE_TWI_DEVICE Panel;
+static FAKE_TWI_DEVICE Sensor;
+static SSD1306_t Display;
+static HDC1080_t Hdc;
+static uint32_t Readings;
+static uint8_t Limit;
+
+// An HDC1080 that flaps: 3 s fine, then 3 s holding SCL 25 ms per
+// transfer and not acknowledging
+static ret_code_t Flapping(FAKE_TWI_DEVICE *device, const nrf_twi_mngr_transfer_t *transfer)
+{
+  if (Fake_Twi.Us / 3000000 % 2 == 1)
+  {
+    Fake_Twi.Us += 25000;
+    return NRF_ERROR_DRV_TWI_ERR_ANACK;
+  }
+  if (NRF_TWI_MNGR_IS_READ_OP(transfer->operation))
+  {
+    memset(transfer->p_data, 0x66, transfer->length);
+  }
+  return NRF_SUCCESS;
+}
+
+static void OnData(HDC1080_t *hdc1080)
+{
+  Readings += hdc1080->Status == NRF_SUCCESS;
+}
+
+// Without health tracking: every device healthy, whatever it does
+static void Unlimited(void)
+{
+  TwiHealth_Init(&Hdc.Device.Health);
+  TwiHealth_Init(&Display.Device.Health);
+}
+
+// A frame every 50 ms and a measurement every 100 ms for 12 s, with the
+// fewest frames shown in a second and the worst state of the sensor
+static uint32_t Run(TWI_HEALTH_STATE *worst)
+{
+  uint32_t fewest = UINT32_MAX;
+  uint32_t last = 0;
+  uint32_t ms;
+  uint64_t start;
+
+  FakeTwi_Init(FAKE_TWI_QUEUE);
+  memset(&Panel, 0, sizeof(Panel));
+  memset(&Sensor, 0, sizeof(Sensor));
+  Panel.Address = SSD1306_I2C_ADDR;
+  Sensor.Address = HDC_1080_ADD;
+  Sensor.Handler = Flapping;
+  FakeTwi_Add(&Panel);
+  FakeTwi_Add(&Sensor);
+
+  // As main.c sets them up
+  TwiRecovery_InitBus(&Bus, &Twi, SCL_PIN_NUMBER, SDA_PIN_NUMBER);
+  ssd1306_InitDisplay(&Display, &Twi, SSD1306_I2C_ADDR);
+  Fake_Twi.Us = 1000 * SSD1306_BOOT_MS;
+  ssd1306_Init();
+  HDC1080_InitDevice(&Hdc, &Twi, Temperature_Resolution_14_bit, Humidity_Resolution_14_bit, OnData);
+  Readings = 0;
+  *worst = TWI_HEALTH_OK;
+  start = Fake_Twi.Us;
+
+  for (ms = 0; ms < 12000; ms += 10)
+  {
+    if (!Limit)
+    {
+      Unlimited();
+    }
+    if (ms % 50 == 0)
+    {
+      ssd1306_Fill((ms / 50) % 2 ? White : Black);
+      ssd1306_UpdateScreen();
+    }
+    if (ms % 100 == 0)
+    {
+      HDC1080_ScheduleTrigger(&Hdc);
+    }
+    if (ms % 100 == 20)
+    {
+      HDC1080_ScheduleRead(&Hdc);
+    }
+    if (Fake_Twi.Us < start + 1000 * (ms + 10))
+    {
+      FakeTwi_RunFor(start + 1000 * (ms + 10) - Fake_Twi.Us);
+    }
+    *worst = MAX(*worst, Hdc.Device.Health.State);
+    if (ms % 1000 == 990)
+    {
+      fewest = MIN(fewest, (Panel.Transfers - last) / FRAME_TRANSFERS);
+      last = Panel.Transfers;
+    }
+  }
+  return fewest;
+}
+
+// The flapping sensor is taken off the bus while it misbehaves, and the
+// display keeps its frame rate
+static void test_DisplayKeepsFrameRate(void)
+{
+  TWI_HEALTH_STATE worst;
+  uint32_t fewest;
+  uint32_t unlimited;
+
+  Limit = 0;
+  unlimited = Run(&worst);
+  CHECK_EQ(worst, TWI_HEALTH_OK);
+
+  Limit = 1;
+  fewest = Run(&worst);
+  CHECK_EQ(worst, TWI_HEALTH_QUARANTINED);
+  CHECK(Hdc.Device.Health.Dropped > 0);
+  CHECK_EQ(Display.Device.Failed, 0);
+  CHECK(Readings > 30);
+  CHECK(fewest >= 18);
+  CHECK(fewest >= unlimited + 4);
+  printf("Frames per second, fewest: %u, %u without health tracking\n", (unsigned)fewest, (unsigned)unlimited);
+}
+
+int main(void)
+{
+  test_FlappingStaysDegraded();
+  test_QuarantineAndProbe();
+  test_StallIsCapped();
+  test_DisplayKeepsFrameRate();
+  TEST_EXIT();
+}
@@ -0,0 +1,305 @@
+/*
+ *      test_twi_recovery.c
+ *
+ *	The MIT License.
+ */
+
+#include "fake_twi.h"
+#include "test.h"
+#include "twi_mng_tca9548a.h"
+#include "twi_recovery.h"
+
+#define SENSOR_ADD (0x40)
+#define OTHER_ADD (0x68)
+
+static const nrf_twi_mngr_t Twi;
+static TWI_BUS Bus;
+static TCA9548A_t Mux;
+static TWI_DEVICE Device;
+static TWI_DEVICE Other;
+static FAKE_TWI_DEVICE Sensor;
+static FAKE_TWI_DEVICE OtherSensor;
+
+// A read through TwiRecovery_Schedule and the result its owner got
+typedef struct
+{
+  uint8_t Value[2];
+  uint8_t Done;
+  ret_code_t Result;
+  uint64_t Us;                // Time of the result
+  nrf_twi_mngr_transfer_t Transfer;
+  nrf_twi_mngr_transaction_t Transaction;
+  TWI_RETRY Retry;
+} READ;
+
+static void ReadDone(ret_code_t result, void *p_user_data)
+{
+  READ *read = (READ *)p_user_data;
+
+  read->Result = result;
+  read->Us = Fake_Twi.Us;
+  read->Done++;
+}
+
+static ret_code_t Schedule(TWI_DEVICE *device, READ *read)
+{
+  memset(read, 0, sizeof(*read));
+  read->Transfer = (nrf_twi_mngr_transfer_t)NRF_TWI_MNGR_READ(device->Address, read->Value, sizeof(read->Value), 0);
+  read->Transaction.callback = ReadDone;
+  read->Transaction.p_user_data = read;
+  read->Transaction.p_transfers = &read->Transfer;
+  read->Transaction.number_of_transfers = 1;
+  return TwiRecovery_Schedule(device, &read->Retry, &read->Transaction);
+}
+
+static ret_code_t Perform(TWI_DEVICE *device)
+{
+  uint8_t value[2];
+  nrf_twi_mngr_transfer_t transfer = NRF_TWI_MNGR_READ(device->Address, value, sizeof(value), 0);
+
+  return TwiRecovery_Perform(device, &transfer, 1);
+}
+
+// Interrupts and timers until nothing is left to do
+static void Drain(void)
+{
+  uint16_t i;
+
+  for (i = 0; i < 1000 && (FakeTwi_Run() || FakeTwi_NextTimer()); i++)
+  {
+  }
+  CHECK(i < 1000);
+}
+
+static void Setup(uint8_t queue_size)
+{
+  FakeTwi_Init(queue_size);
+  memset(&Sensor, 0, sizeof(Sensor));
+  memset(&OtherSensor, 0, sizeof(OtherSensor));
+  Sensor.Address = SENSOR_ADD;
+  OtherSensor.Address = OTHER_ADD;
+  FakeTwi_Add(&Sensor);
+  FakeTwi_Add(&OtherSensor);
+  TwiRecovery_InitBus(&Bus, &Twi, SCL_PIN_NUMBER, SDA_PIN_NUMBER);
+  CHECK_EQ(TwiRecovery_InitDevice(&Device, &Twi, SENSOR_ADD), NRF_SUCCESS);
+  CHECK_EQ(TwiRecovery_InitDevice(&Other, &Twi, OTHER_ADD), NRF_SUCCESS);
+  CHECK(Device.Bus == &Bus);
+}
+
+static void test_Classify(void)
+{
+  CHECK_EQ(TwiRecovery_Classify(NRF_SUCCESS), TWI_ERROR_NONE);
+  CHECK_EQ(TwiRecovery_Classify(NRF_ERROR_DRV_TWI_ERR_ANACK), TWI_ERROR_NACK);
+  CHECK_EQ(TwiRecovery_Classify(NRF_ERROR_DRV_TWI_ERR_DNACK), TWI_ERROR_NACK);
+  CHECK_EQ(TwiRecovery_Classify(NRF_ERROR_BUSY), TWI_ERROR_NACK);
+  CHECK_EQ(TwiRecovery_Classify(NRF_ERROR_NO_MEM), TWI_ERROR_NACK);
+  CHECK_EQ(TwiRecovery_Classify(NRF_ERROR_DRV_TWI_ERR_OVERRUN), TWI_ERROR_BUS);
+  CHECK_EQ(TwiRecovery_Classify(NRF_ERROR_INTERNAL), TWI_ERROR_BUS);
+  CHECK_EQ(TwiRecovery_Classify(NRF_ERROR_TIMEOUT), TWI_ERROR_BUS);
+  CHECK_EQ(TwiRecovery_Classify(NRF_ERROR_INVALID_PARAM), TWI_ERROR_FATAL);
+}
+
+// Two NACKs, then the third attempt goes through after 2 and 4 ms
+static void test_RetriedWithBackoff(void)
+{
+  READ read;
+
+  Setup(4);
+  Sensor.Fail = 2;
+  CHECK_EQ(Schedule(&Device, &read), NRF_SUCCESS);
+  Drain();
+  CHECK_EQ(read.Done, 1);
+  CHECK_EQ(read.Result, NRF_SUCCESS);
+  CHECK(read.Us >= 6000);
+  CHECK(read.Us < 8000);
+  CHECK_EQ(Sensor.Transfers, 1);
+  CHECK_EQ(Device.Nacks, 2);
+  CHECK_EQ(Device.Retries, 2);
+  CHECK_EQ(Device.Recovered, 1);
+  CHECK_EQ(Device.Failed, 0);
+  CHECK_EQ(Device.BusErrors, 0);
+  CHECK_EQ(Fake_Twi.Clears, 0);
+}
+
+// The owner sees the last error once, after TWI_RECOVERY_RETRIES retries
+static void test_GivesUp(void)
+{
+  READ read;
+
+  Setup(4);
+  Sensor.Fail = 0xFF;
+  CHECK_EQ(Schedule(&Device, &read), NRF_SUCCESS);
+  Drain();
+  CHECK_EQ(read.Done, 1);
+  CHECK_EQ(read.Result, NRF_ERROR_DRV_TWI_ERR_ANACK);
+  CHECK_EQ(Sensor.Failures, 1 + TWI_RECOVERY_RETRIES);
+  CHECK_EQ(Device.Retries, TWI_RECOVERY_RETRIES);
+  CHECK_EQ(Device.Failed, 1);
+  CHECK_EQ(Device.Recovered, 0);
+}
+
+static void test_FatalNotRetried(void)
+{
+  READ read;
+
+  Setup(4);
+  Sensor.Fail = 1;
+  Sensor.Error = NRF_ERROR_INVALID_PARAM;
+  CHECK_EQ(Schedule(&Device, &read), NRF_SUCCESS);
+  Drain();
+  CHECK_EQ(read.Result, NRF_ERROR_INVALID_PARAM);
+  CHECK_EQ(Device.Retries, 0);
+  CHECK_EQ(Device.Failed, 1);
+  CHECK_EQ(Device.Nacks + Device.BusErrors, 0);
+}
+
+static void test_DegradedNotRetried(void)
+{
+  READ read;
+
+  Setup(4);
+  Device.Health.State = TWI_HEALTH_DEGRADED;
+  Sensor.Fail = 1;
+  CHECK_EQ(Schedule(&Device, &read), NRF_SUCCESS);
+  Drain();
+  CHECK_EQ(read.Result, NRF_ERROR_DRV_TWI_ERR_ANACK);
+  CHECK_EQ(Device.Retries, 0);
+  CHECK_EQ(Device.Failed, 1);
+}
+
+// A fault leaves the sensor holding SDA: the callback clears the bus before
+// the next transaction, and the retry goes through
+static void test_BusClearedFromCallback(void)
+{
+  READ read, other;
+
+  Setup(4);
+  Sensor.Fail = 1;
+  Sensor.Error = NRF_ERROR_DRV_TWI_ERR_OVERRUN;
+  Sensor.HoldSda = 5;
+  CHECK_EQ(Schedule(&Device, &read), NRF_SUCCESS);
+  CHECK_EQ(Schedule(&Other, &other), NRF_SUCCESS);
+  Drain();
+  CHECK_EQ(read.Result, NRF_SUCCESS);
+  CHECK_EQ(other.Result, NRF_SUCCESS);
+  CHECK_EQ(Fake_Twi.SdaLow, 0);
+  CHECK_EQ(Fake_Twi.Clears, 1);
+  CHECK_EQ(Fake_Twi.UnsafeClears, 0);
+  CHECK_EQ(Bus.Clears, 1);
+  CHECK_EQ(Device.BusErrors, 1);
+  CHECK_EQ(Device.Recovered, 1);
+  CHECK_EQ(Other.Failed, 0);
+}
+
+// A NACK with SDA still low is a stuck bus too
+static void test_StuckAfterNack(void)
+{
+  Setup(4);
+  Sensor.Fail = 1;
+  Sensor.HoldSda = 9;
+  CHECK_EQ(Perform(&Device), NRF_SUCCESS);
+  CHECK_EQ(Fake_Twi.Clears, 1);
+  CHECK_EQ(Device.BusErrors, 1);
+  CHECK_EQ(Device.Nacks, 0);
+  CHECK_EQ(Device.Recovered, 1);
+}
+
+static READ Queued;
+
+// Schedules a read of the other device behind the transaction it ends
+static void ScheduleOther(ret_code_t result, void *p_user_data)
+{
+  CHECK_EQ(Schedule(&Other, &Queued), NRF_SUCCESS);
+}
+
+// The blocking call fails with SDA held while the manager still has a
+// transaction queued: the bus is cleared from that transaction callback,
+// not from thread mode in the middle of it
+static void test_PerformDefersClear(void)
+{
+  uint8_t value;
+  nrf_twi_mngr_transfer_t transfer = NRF_TWI_MNGR_READ(OTHER_ADD, &value, 1, 0);
+  nrf_twi_mngr_transaction_t first = {ScheduleOther, NULL, &transfer, 1, NULL};
+
+  Setup(4);
+  Sensor.Fail = 1;
+  Sensor.HoldSda = 3;
+  CHECK_EQ(nrf_twi_mngr_schedule(&Twi, &first), NRF_SUCCESS);
+  CHECK_EQ(Perform(&Device), NRF_SUCCESS);
+  CHECK_EQ(Fake_Twi.Clears, 1);
+  CHECK_EQ(Fake_Twi.UnsafeClears, 0);
+  CHECK_EQ(Bus.Deferred, TWI_ERROR_NONE);
+  CHECK_EQ(Device.Recovered, 1);
+  Drain();
+  CHECK_EQ(Queued.Done, 1);
+  CHECK_EQ(Queued.Result, NRF_SUCCESS);
+}
+
+// A retry that finds the manager queue full ends the transaction
+static void test_RetryRefused(void)
+{
+  READ read;
+  uint8_t value;
+  nrf_twi_mngr_transfer_t transfer = NRF_TWI_MNGR_READ(OTHER_ADD, &value, 1, 0);
+  nrf_twi_mngr_transaction_t other = {NULL, NULL, &transfer, 1, NULL};
+
+  Setup(1);
+  Sensor.Fail = 1;
+  CHECK_EQ(Schedule(&Device, &read), NRF_SUCCESS);
+  CHECK(FakeTwi_Run());
+  CHECK_EQ(nrf_twi_mngr_schedule(&Twi, &other), NRF_SUCCESS);
+  CHECK(FakeTwi_NextTimer());
+  CHECK_EQ(read.Done, 1);
+  CHECK_EQ(read.Result, NRF_ERROR_NO_MEM);
+  CHECK_EQ(Device.Failed, 1);
+  CHECK_EQ(Device.Health.Probing, 0);
+}
+
+// Retries of the transactions of a device behind a mux go through its router
+static void test_BehindMux(void)
+{
+  READ reads[2];
+
+  Setup(4);
+  Fake_Twi.MuxAddress = TCA9548A_ADD;
+  Sensor.Channels = 1 << 2;
+  OtherSensor.Channels = 1 << 5;
+  CHECK_EQ(TCA9548A_Init(&Mux, &Twi, TCA9548A_ADD), NRF_SUCCESS);
+  CHECK_EQ(TwiRecovery_InitMuxDevice(&Device, &Mux, 2, SENSOR_ADD), NRF_SUCCESS);
+  CHECK_EQ(TwiRecovery_InitMuxDevice(&Other, &Mux, 5, OTHER_ADD), NRF_SUCCESS);
+  CHECK(Device.Bus == &Bus);
+
+  CHECK_EQ(Perform(&Device), NRF_SUCCESS);
+  Sensor.Fail = 1;
+  CHECK_EQ(Schedule(&Device, &reads[0]), NRF_SUCCESS);
+  CHECK_EQ(Schedule(&Other, &reads[1]), NRF_SUCCESS);
+  Drain();
+  CHECK_EQ(reads[0].Result, NRF_SUCCESS);
+  CHECK_EQ(reads[1].Result, NRF_SUCCESS);
+  CHECK_EQ(Device.Retries, 1);
+  CHECK_EQ(Device.Recovered, 1);
+  CHECK_EQ(Sensor.Transfers, 2);
+  CHECK_EQ(OtherSensor.Transfers, 1);
+  CHECK_EQ(Mux.Transactions, 4);
+
+  Sensor.Fail = 1;
+  CHECK_EQ(Perform(&Device), NRF_SUCCESS);
+  CHECK_EQ(Device.Retries, 2);
+  CHECK_EQ(Sensor.Transfers, 3);
+  CHECK_EQ(Mux.Current, NULL);
+}
+
+int main(void)
+{
+  test_Classify();
+  test_RetriedWithBackoff();
+  test_GivesUp();
+  test_FatalNotRetried();
+  test_DegradedNotRetried();
+  test_BusClearedFromCallback();
+  test_StuckAfterNack();
+  test_PerformDefersClear();
+  test_RetryRefused();
+  test_BehindMux();
+  TEST_EXIT();
+}
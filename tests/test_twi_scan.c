@@ -0,0 +1,272 @@
+/*
+ *      test_twi_scan.c
+ *
+ *	The MIT License.
+ */
+
+#include "fake_twi.h"
+#include "test.h"
+#include "twi_mng_ds1307.h"
+#include "twi_mng_hdc1080.h"
+#include "twi_scan.h"
+
+#define PROBES (TWI_SCAN_LAST - TWI_SCAN_FIRST + 1)
+
+static const nrf_twi_mngr_t Twi;
+static TWI_SCAN Scan;
+static uint8_t Done;
+
+// A device with 256 registers of Width bytes, most significant first,
+// behind a register pointer
+typedef struct
+{
+  FAKE_TWI_DEVICE Device;
+  uint16_t Registers[256];
+  uint8_t Width;
+  uint8_t Pointer;
+} REGISTERS;
+
+static ret_code_t Registers(FAKE_TWI_DEVICE *device, const nrf_twi_mngr_transfer_t *transfer)
+{
+  REGISTERS *registers = (REGISTERS *)device;
+  uint8_t i;
+
+  for (i = 0; i < transfer->length; i++)
+  {
+    if (NRF_TWI_MNGR_IS_READ_OP(transfer->operation))
+    {
+      transfer->p_data[i] = registers->Registers[registers->Pointer] >> (8 * (registers->Width - 1 - i % registers->Width));
+      registers->Pointer += (i % registers->Width) == registers->Width - 1;
+    }
+    else if (i == 0)
+    {
+      registers->Pointer = transfer->p_data[0];
+    }
+    else
+    {
+      registers->Registers[registers->Pointer++] = transfer->p_data[i];
+    }
+  }
+  return NRF_SUCCESS;
+}
+
+static REGISTERS Hdc;
+static REGISTERS Rtc;
+static FAKE_TWI_DEVICE Panels[2];
+static FAKE_TWI_DEVICE Eeprom;
+static FAKE_TWI_DEVICE Last;
+
+static void Add(REGISTERS *registers, uint8_t address, uint8_t width)
+{
+  memset(registers, 0, sizeof(*registers));
+  registers->Device.Address = address;
+  registers->Device.Handler = Registers;
+  registers->Width = width;
+  FakeTwi_Add(&registers->Device);
+}
+
+// IDs in the 16-bit registers 0xFE and 0xFF
+static void AddHdc1080(uint16_t manufacturer, uint16_t device)
+{
+  Add(&Hdc, HDC_1080_ADD, 2);
+  Hdc.Registers[0xFE] = manufacturer;
+  Hdc.Registers[0xFF] = device;
+}
+
+static void AddDs1307(uint8_t control)
+{
+  Add(&Rtc, DS1307_I2C_ADDR, 1);
+  Rtc.Registers[0x07] = control;
+}
+
+static void AddDevice(FAKE_TWI_DEVICE *device, uint8_t address)
+{
+  memset(device, 0, sizeof(*device));
+  device->Address = address;
+  FakeTwi_Add(device);
+}
+
+static void OnDone(TWI_SCAN *scan)
+{
+  CHECK(scan == &Scan);
+  CHECK_EQ(scan->Busy, 0);
+  Done++;
+}
+
+static void Setup(uint8_t queue_size)
+{
+  FakeTwi_Init(queue_size);
+  memset(&Scan, 0, sizeof(Scan));
+  Done = 0;
+}
+
+static ret_code_t Start(void)
+{
+  ret_code_t err_code = TwiScan_Start(&Scan, &Twi, OnDone);
+
+  FakeTwi_RunAll();
+  return err_code;
+}
+
+static uint8_t Count(TWI_SCAN_PART part)
+{
+  uint8_t count = 0;
+  uint8_t address;
+
+  for (address = 0; address <= TWI_SCAN_LAST; address++)
+  {
+    count += Scan.Parts[address] == part;
+  }
+  return count;
+}
+
+static void test_EmptyBus(void)
+{
+  Setup(TWI_SCAN_BATCH);
+  CHECK_EQ(Start(), NRF_SUCCESS);
+  CHECK_EQ(Done, 1);
+  CHECK_EQ(Scan.Busy, 0);
+  CHECK_EQ(Scan.Found, 0);
+  CHECK_EQ(Scan.Next, TWI_SCAN_LAST + 1);
+  CHECK_EQ(Fake_Twi.Transactions, PROBES);
+  CHECK_EQ(Count(TWI_SCAN_NONE), TWI_SCAN_LAST + 1);
+  CHECK_EQ(TwiScan_Find(&Scan, TWI_SCAN_HDC1080), 0);
+  CHECK_EQ(TwiScan_Find(&Scan, TWI_SCAN_SSD1306), 0);
+}
+
+// The parts of the board, both panel addresses, and two unknown devices
+// at the ends of the range
+static void test_BoardParts(void)
+{
+  uint64_t start;
+
+  Setup(TWI_SCAN_BATCH);
+  AddHdc1080(0x5449, 0x1050);
+  AddDs1307(0x13);
+  AddDevice(&Panels[0], 0x3C);
+  AddDevice(&Panels[1], 0x3D);
+  AddDevice(&Eeprom, TWI_SCAN_FIRST);
+  AddDevice(&Last, TWI_SCAN_LAST);
+  start = Fake_Twi.Us;
+  CHECK_EQ(Start(), NRF_SUCCESS);
+  CHECK_EQ(Done, 1);
+  CHECK_EQ(Scan.Found, 6);
+  CHECK_EQ(Scan.Parts[HDC_1080_ADD], TWI_SCAN_HDC1080);
+  CHECK_EQ(Scan.Parts[DS1307_I2C_ADDR], TWI_SCAN_DS1307);
+  CHECK_EQ(Scan.Parts[0x3C], TWI_SCAN_SSD1306);
+  CHECK_EQ(Scan.Parts[0x3D], TWI_SCAN_SSD1306);
+  CHECK_EQ(Scan.Parts[TWI_SCAN_FIRST], TWI_SCAN_UNKNOWN);
+  CHECK_EQ(Scan.Parts[TWI_SCAN_LAST], TWI_SCAN_UNKNOWN);
+  CHECK_EQ(Count(TWI_SCAN_NONE), TWI_SCAN_LAST + 1 - 6);
+  CHECK_EQ(TwiScan_Find(&Scan, TWI_SCAN_SSD1306), 0x3C);
+  CHECK_EQ(TwiScan_Find(&Scan, TWI_SCAN_HDC1080), HDC_1080_ADD);
+  CHECK_EQ(TwiScan_Find(&Scan, TWI_SCAN_DS1307), DS1307_I2C_ADDR);
+
+  // Reads and writes reach only the ID and control registers
+  CHECK_EQ(Hdc.Device.Transfers, 4);
+  CHECK_EQ(Rtc.Device.Transfers, 2);
+  CHECK_EQ(Rtc.Registers[0x07], 0x13);
+
+  // Duration is the bus time, to an app_timer tick
+  CHECK(Scan.Duration + 31 >= Fake_Twi.Us - start);
+  CHECK(Scan.Duration <= Fake_Twi.Us - start + 31);
+}
+
+// Other parts at the same addresses are not taken for ours
+static void test_WrongIds(void)
+{
+  Setup(TWI_SCAN_BATCH);
+  AddHdc1080(0x5449, 0x1000);
+  AddDs1307(0xFF);
+  CHECK_EQ(Start(), NRF_SUCCESS);
+  CHECK_EQ(Scan.Found, 2);
+  CHECK_EQ(Scan.Parts[HDC_1080_ADD], TWI_SCAN_UNKNOWN);
+  CHECK_EQ(Scan.Parts[DS1307_I2C_ADDR], TWI_SCAN_UNKNOWN);
+  CHECK_EQ(TwiScan_Find(&Scan, TWI_SCAN_HDC1080), 0);
+  CHECK_EQ(TwiScan_Find(&Scan, TWI_SCAN_DS1307), 0);
+  CHECK_EQ(TwiScan_Find(&Scan, TWI_SCAN_UNKNOWN), HDC_1080_ADD);
+
+  Setup(TWI_SCAN_BATCH);
+  AddHdc1080(0x0000, 0x1050);
+  CHECK_EQ(Start(), NRF_SUCCESS);
+  CHECK_EQ(Scan.Parts[HDC_1080_ADD], TWI_SCAN_UNKNOWN);
+}
+
+// A second scan waits for the first, then starts from a clean result
+static void test_Busy(void)
+{
+  Setup(TWI_SCAN_BATCH);
+  AddDs1307(0x00);
+  CHECK_EQ(TwiScan_Start(&Scan, &Twi, OnDone), NRF_SUCCESS);
+  CHECK_EQ(FakeTwi_Queued(), TWI_SCAN_BATCH);
+  CHECK(FakeTwi_Run());
+  CHECK_EQ(TwiScan_Start(&Scan, &Twi, OnDone), NRF_ERROR_BUSY);
+  FakeTwi_RunAll();
+  CHECK_EQ(Done, 1);
+  CHECK_EQ(Scan.Parts[DS1307_I2C_ADDR], TWI_SCAN_DS1307);
+
+  Fake_Twi.DeviceCount = 0;
+  CHECK_EQ(Start(), NRF_SUCCESS);
+  CHECK_EQ(Done, 2);
+  CHECK_EQ(Scan.Found, 0);
+  CHECK_EQ(Scan.Parts[DS1307_I2C_ADDR], TWI_SCAN_NONE);
+}
+
+// With room for fewer probes than the batch, the probes that made it into
+// the queue carry the scan to the end
+static void test_ShortQueue(void)
+{
+  Setup(2);
+  AddDevice(&Last, TWI_SCAN_LAST);
+  CHECK_EQ(TwiScan_Start(&Scan, &Twi, OnDone), NRF_SUCCESS);
+  CHECK_EQ(Scan.Pending, 2);
+  FakeTwi_RunAll();
+  CHECK_EQ(Done, 1);
+  CHECK_EQ(Scan.Next, TWI_SCAN_LAST + 1);
+  CHECK_EQ(Fake_Twi.Transactions, PROBES);
+  CHECK_EQ(Scan.Parts[TWI_SCAN_LAST], TWI_SCAN_UNKNOWN);
+
+  // Other transactions take the room while the scan runs
+  Setup(TWI_SCAN_BATCH);
+  AddDevice(&Last, TWI_SCAN_LAST);
+  CHECK_EQ(TwiScan_Start(&Scan, &Twi, OnDone), NRF_SUCCESS);
+  Fake_Twi.QueueSize = 3;
+  FakeTwi_RunAll();
+  CHECK_EQ(Done, 1);
+  CHECK_EQ(Scan.Next, TWI_SCAN_LAST + 1);
+  CHECK_EQ(Fake_Twi.Transactions, PROBES);
+  CHECK_EQ(Scan.Parts[TWI_SCAN_LAST], TWI_SCAN_UNKNOWN);
+}
+
+// No room at all: the scan ends, and Next tells where it stopped
+static void test_QueueFull(void)
+{
+  Setup(0);
+  CHECK_EQ(Start(), NRF_SUCCESS);
+  CHECK_EQ(Done, 1);
+  CHECK_EQ(Scan.Busy, 0);
+  CHECK_EQ(Scan.Next, TWI_SCAN_FIRST);
+  CHECK_EQ(Fake_Twi.Transactions, 0);
+
+  Setup(TWI_SCAN_BATCH);
+  AddDevice(&Last, TWI_SCAN_LAST);
+  CHECK_EQ(TwiScan_Start(&Scan, &Twi, OnDone), NRF_SUCCESS);
+  CHECK(FakeTwi_Run());
+  Fake_Twi.QueueSize = 0;
+  FakeTwi_RunAll();
+  CHECK_EQ(Done, 1);
+  CHECK_EQ(Scan.Busy, 0);
+  CHECK_EQ(Scan.Next, TWI_SCAN_FIRST + TWI_SCAN_BATCH + 1);
+  CHECK_EQ(Scan.Parts[TWI_SCAN_LAST], TWI_SCAN_NONE);
+}
+
+int main(void)
+{
+  test_EmptyBus();
+  test_BoardParts();
+  test_WrongIds();
+  test_Busy();
+  test_ShortQueue();
+  test_QueueFull();
+  TEST_EXIT();
+}
@@ -0,0 +1,325 @@
+/*
+ *      test_twi_task.c
+ *
+ *	The MIT License.
+ */
+
+#include "fake_twi.h"
+#include "test.h"
+#include "twi_mng_ds1307.h"
+#include "twi_mng_hdc1080.h"
+#include "twi_task.h"
+
+#define WORKERS (3)
+#define STEPS (3)
+
+static const nrf_twi_mngr_t Twi;
+
+// Runs the bus and the timers until nothing is left to do, a task that
+// keeps waking itself up fails the check instead of hanging the test
+static void RunAll(void)
+{
+  uint32_t events = 0;
+
+  while (events < 10000 && (FakeTwi_Run() || FakeTwi_NextTimer()))
+  {
+    events++;
+  }
+  CHECK(events < 10000);
+}
+
+// A device whose reads count up, and the order the bus reached the devices in
+static FAKE_TWI_DEVICE Counters[WORKERS];
+static uint8_t Order[WORKERS * STEPS];
+static uint8_t OrderCount;
+
+static ret_code_t Counter(FAKE_TWI_DEVICE *device, const nrf_twi_mngr_transfer_t *transfer)
+{
+  memset(transfer->p_data, (int)device->Transfers, transfer->length);
+  if (OrderCount < sizeof(Order))
+  {
+    Order[OrderCount++] = device->Address;
+  }
+  return NRF_SUCCESS;
+}
+
+// A sequence that reads its device and sleeps, STEPS times
+typedef struct
+{
+  TWI_TASK_t Task;
+  uint8_t Address;
+  uint32_t Ticks;
+  uint8_t Step;
+  uint8_t Values[STEPS];
+  uint8_t Refused;
+  uint8_t Done;
+  uint64_t DoneUs;
+} WORKER;
+
+static WORKER Workers[WORKERS];
+static uint8_t DoneCount;
+
+static PT_STATUS Work(TWI_TASK_t *task)
+{
+  WORKER *worker = (WORKER *)task->Context;
+
+  TWI_TASK_BEGIN(task);
+  for (worker->Step = 0; worker->Step < STEPS; worker->Step++)
+  {
+    while (worker->Refused < WORKERS * STEPS)
+    {
+      TWI_TASK_AWAIT(task, NRF_TWI_MNGR_READ(worker->Address, &worker->Values[worker->Step], 1, 0));
+      if (task->Result != NRF_ERROR_NO_MEM)
+      {
+        break;
+      }
+      worker->Refused++;
+      TWI_TASK_SLEEP(task, APP_TIMER_MIN_TIMEOUT_TICKS);
+    }
+    TWI_TASK_SLEEP(task, worker->Ticks);
+  }
+  TWI_TASK_END(task);
+}
+
+static void WorkDone(TWI_TASK_t *task)
+{
+  WORKER *worker = (WORKER *)task->Context;
+
+  CHECK_EQ(task->Active, 0);
+  worker->Done++;
+  worker->DoneUs = Fake_Twi.Us;
+  DoneCount++;
+}
+
+static void Setup(uint8_t queue_size)
+{
+  uint8_t i;
+
+  FakeTwi_Init(queue_size);
+  memset(Counters, 0, sizeof(Counters));
+  memset(Workers, 0, sizeof(Workers));
+  OrderCount = 0;
+  DoneCount = 0;
+  for (i = 0; i < WORKERS; i++)
+  {
+    Counters[i].Address = 0x50 + i;
+    Counters[i].Handler = Counter;
+    FakeTwi_Add(&Counters[i]);
+    CHECK_EQ(TwiTask_Init(&Workers[i].Task, &Twi), NRF_SUCCESS);
+    Workers[i].Address = Counters[i].Address;
+    Workers[i].Ticks = APP_TIMER_TICKS(10 * (WORKERS - i));
+  }
+}
+
+static void CheckWorker(const WORKER *worker)
+{
+  uint8_t step;
+
+  CHECK_EQ(worker->Done, 1);
+  CHECK_EQ(worker->Task.Active, 0);
+  CHECK_EQ(worker->Task.Result, NRF_SUCCESS);
+  for (step = 0; step < STEPS; step++)
+  {
+    CHECK_EQ(worker->Values[step], step + 1);
+  }
+}
+
+// The sequences share the bus: each one waits only for its own
+// transactions and timer, and ends in the order of its sleeps
+static void test_Interleaved(void)
+{
+  uint8_t i;
+
+  Setup(FAKE_TWI_QUEUE);
+  for (i = 0; i < WORKERS; i++)
+  {
+    CHECK_EQ(TwiTask_Start(&Workers[i].Task, Work, &Workers[i], WorkDone), NRF_SUCCESS);
+    CHECK_EQ(Workers[i].Task.Waiting, 1);
+  }
+  CHECK_EQ(FakeTwi_Queued(), WORKERS);
+  RunAll();
+  CHECK_EQ(DoneCount, WORKERS);
+  for (i = 0; i < WORKERS; i++)
+  {
+    CheckWorker(&Workers[i]);
+  }
+
+  // One read of each in turn, the shortest sleeper reads again first
+  CHECK_EQ(OrderCount, WORKERS * STEPS);
+  for (i = 0; i < WORKERS; i++)
+  {
+    CHECK_EQ(Order[i], 0x50 + i);
+  }
+  CHECK_EQ(Order[WORKERS], 0x50 + WORKERS - 1);
+  CHECK(Workers[2].DoneUs < Workers[1].DoneUs);
+  CHECK(Workers[1].DoneUs < Workers[0].DoneUs);
+
+  // Three sleeps of 30 ms, not the sum of all sleeps
+  CHECK(Workers[0].DoneUs >= 3 * 30000);
+  CHECK(Workers[0].DoneUs < 3 * 30000 + 2000);
+}
+
+// A full manager queue fails the await at once, the body sees the error
+// and tries again later
+static void test_QueueFull(void)
+{
+  uint8_t i;
+  uint8_t refused = 0;
+
+  Setup(1);
+  for (i = 0; i < WORKERS; i++)
+  {
+    CHECK_EQ(TwiTask_Start(&Workers[i].Task, Work, &Workers[i], WorkDone), NRF_SUCCESS);
+  }
+  CHECK_EQ(Workers[0].Refused, 0);
+  CHECK_EQ(Workers[1].Refused, 1);
+  CHECK_EQ(Workers[2].Refused, 1);
+  RunAll();
+  CHECK_EQ(DoneCount, WORKERS);
+  for (i = 0; i < WORKERS; i++)
+  {
+    CheckWorker(&Workers[i]);
+    refused += Workers[i].Refused;
+  }
+  CHECK_EQ(refused, Fake_Twi.Rejected);
+}
+
+// A task runs one body at a time, and can start the next one from the
+// handler of the last
+static uint8_t Restarts;
+
+static void StartAgain(TWI_TASK_t *task)
+{
+  WorkDone(task);
+  if (Restarts > 0)
+  {
+    Restarts--;
+    CHECK_EQ(TwiTask_Start(task, Work, task->Context, StartAgain), NRF_SUCCESS);
+  }
+}
+
+static void test_Restart(void)
+{
+  Setup(FAKE_TWI_QUEUE);
+  Restarts = 2;
+  CHECK_EQ(TwiTask_Start(&Workers[0].Task, Work, &Workers[0], StartAgain), NRF_SUCCESS);
+  CHECK_EQ(TwiTask_Start(&Workers[0].Task, Work, &Workers[0], StartAgain), NRF_ERROR_BUSY);
+  RunAll();
+  CHECK_EQ(Workers[0].Done, 3);
+  CHECK_EQ(Counters[0].Transfers, 3 * STEPS);
+  CHECK_EQ(Workers[0].Values[STEPS - 1], 3 * STEPS);
+  CHECK_EQ(Workers[0].Task.Active, 0);
+}
+
+// More transfers than a task holds fail the await, nothing is scheduled
+static PT_STATUS TooMany(TWI_TASK_t *task)
+{
+  static uint8_t value;
+
+  TWI_TASK_BEGIN(task);
+  TWI_TASK_AWAIT(task,
+                 NRF_TWI_MNGR_READ(0x50, &value, 1, 0),
+                 NRF_TWI_MNGR_READ(0x50, &value, 1, 0),
+                 NRF_TWI_MNGR_READ(0x50, &value, 1, 0),
+                 NRF_TWI_MNGR_READ(0x50, &value, 1, 0));
+  TWI_TASK_END(task);
+}
+
+static void test_TooManyTransfers(void)
+{
+  Setup(FAKE_TWI_QUEUE);
+  CHECK_EQ(TwiTask_Start(&Workers[0].Task, TooMany, &Workers[0], WorkDone), NRF_SUCCESS);
+  CHECK_EQ(Workers[0].Done, 1);
+  CHECK_EQ(Workers[0].Task.Result, NRF_ERROR_INVALID_LENGTH);
+  CHECK_EQ(FakeTwi_Queued(), 0);
+}
+
+// An HDC1080 measurement and a DS1307 control update at the same time
+static FAKE_TWI_DEVICE Sensor;
+static FAKE_TWI_DEVICE Rtc;
+static uint64_t TriggerUs;
+static uint64_t ReadUs;
+static uint8_t RtcPointer;
+static uint8_t RtcControl;
+static HDC1080_t Hdc;
+static DS1307_t Ds1307;
+static TWI_TASK_t HdcTask;
+static TWI_TASK_t RtcTask;
+
+static ret_code_t HdcSensor(FAKE_TWI_DEVICE *device, const nrf_twi_mngr_transfer_t *transfer)
+{
+  static const uint8_t raw[4] = {0x66, 0x66, 0x80, 0x00};
+
+  if (!NRF_TWI_MNGR_IS_READ_OP(transfer->operation))
+  {
+    TriggerUs = Fake_Twi.Us;
+  }
+  else
+  {
+    ReadUs = Fake_Twi.Us;
+    memcpy(transfer->p_data, raw, MIN(transfer->length, sizeof(raw)));
+  }
+  return NRF_SUCCESS;
+}
+
+static ret_code_t RtcRegisters(FAKE_TWI_DEVICE *device, const nrf_twi_mngr_transfer_t *transfer)
+{
+  if (NRF_TWI_MNGR_IS_READ_OP(transfer->operation))
+  {
+    transfer->p_data[0] = (RtcPointer == DS1307_REG_CONTROL) ? RtcControl : 0;
+    return NRF_SUCCESS;
+  }
+  RtcPointer = transfer->p_data[0];
+  if (transfer->length > 1 && RtcPointer == DS1307_REG_CONTROL)
+  {
+    RtcControl = transfer->p_data[1];
+  }
+  return NRF_SUCCESS;
+}
+
+static void test_DriversShareTheBus(void)
+{
+  FakeTwi_Init(FAKE_TWI_QUEUE);
+  memset(&Sensor, 0, sizeof(Sensor));
+  memset(&Rtc, 0, sizeof(Rtc));
+  Sensor.Address = HDC_1080_ADD;
+  Sensor.Handler = HdcSensor;
+  Rtc.Address = DS1307_I2C_ADDR;
+  Rtc.Handler = RtcRegisters;
+  FakeTwi_Add(&Sensor);
+  FakeTwi_Add(&Rtc);
+  RtcControl = 0x93;
+  HDC1080_InitDevice(&Hdc, &Twi, Temperature_Resolution_14_bit, Humidity_Resolution_14_bit, NULL);
+  DS1307_InitDevice(&Ds1307, &Twi, NULL);
+  CHECK_EQ(TwiTask_Init(&HdcTask, &Twi), NRF_SUCCESS);
+  CHECK_EQ(TwiTask_Init(&RtcTask, &Twi), NRF_SUCCESS);
+
+  CHECK_EQ(HDC1080_StartMeasureTask(&Hdc, &HdcTask, NULL), NRF_SUCCESS);
+  CHECK_EQ(DS1307_StartControlUpdate(&Ds1307, &RtcTask, 0x13, 0x10, NULL), NRF_SUCCESS);
+  CHECK_EQ(DS1307_StartControlUpdate(&Ds1307, &RtcTask, 0x13, 0x10, NULL), NRF_ERROR_BUSY);
+  CHECK_EQ(FakeTwi_Queued(), 2);
+
+  // The control update is done while the sensor converts
+  FakeTwi_RunFor(1000);
+  CHECK_EQ(RtcTask.Active, 0);
+  CHECK_EQ(RtcControl, 0x90);
+  CHECK_EQ(HdcTask.Active, 1);
+
+  RunAll();
+  CHECK_EQ(HdcTask.Active, 0);
+  CHECK_EQ(Hdc.Status, NRF_SUCCESS);
+  CHECK_EQ(Hdc.Humidity, 50);
+  CHECK(ReadUs - TriggerUs >= Hdc.ConversionTime);
+  CHECK_EQ(Sensor.Transfers, 1 + 2);
+  CHECK_EQ(Rtc.Transfers, 3);
+}
+
+int main(void)
+{
+  test_Interleaved();
+  test_QueueFull();
+  test_Restart();
+  test_TooManyTransfers();
+  test_DriversShareTheBus();
+  TEST_EXIT();
+}
@@ -0,0 +1,194 @@
+// Decoder of the binary log records written by bin_log.c.
+//
+// Built and checked against bin_log.c with the host tests, target
+// binlog_decode of tests/CMakeLists.txt, or by hand:
+//   c++ -std=c++11 -O2 -I.. binlog_decode.cpp -o binlog_decode
+// Capture RTT channel 1 to a file, e.g. JLinkRTTLogger -RTTChannel 1 log.bin, then:
+//   ./binlog_decode log.bin      (or read from stdin)
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "bin_log_formats.h"
+
+namespace
+{
+
+enum Format
+{
+#define BINLOG_ENUM(name, id, text) name = id,
+    BINLOG_FORMATS(BINLOG_ENUM)
+#undef BINLOG_ENUM
+};
+
+struct Record
+{
+    uint8_t format;
+    uint8_t sequence;
+    uint32_t time;
+    int16_t field[BINLOG_FIELDS];
+};
+
+const char *formatName(uint8_t format)
+{
+    switch (format)
+    {
+#define BINLOG_NAME(name, id, text) \
+    case id:                        \
+        return text;
+        BINLOG_FORMATS(BINLOG_NAME)
+#undef BINLOG_NAME
+    default:
+        return nullptr;
+    }
+}
+
+// A record starts at p when the sync byte, checksum and format id all match
+bool parse(const uint8_t *p, Record &record)
+{
+    uint8_t check = 0;
+
+    if (p[0] != BINLOG_SYNC)
+    {
+        return false;
+    }
+    for (int i = 0; i < BINLOG_RECORD_SIZE; i++)
+    {
+        check ^= p[i];
+    }
+    if (check != 0 || formatName(p[1]) == nullptr)
+    {
+        return false;
+    }
+    record.format = p[1];
+    record.sequence = p[2];
+    record.time = p[4] | (p[5] << 8) | (p[6] << 16) | (uint32_t(p[7]) << 24);
+    for (int i = 0; i < BINLOG_FIELDS; i++)
+    {
+        record.field[i] = int16_t(p[8 + 2 * i] | (p[9 + 2 * i] << 8));
+    }
+    return true;
+}
+
+void print(const Record &r, double seconds)
+{
+    const int16_t *f = r.field;
+
+    std::printf("%10.3f %-8s ", seconds, formatName(r.format));
+    switch (r.format)
+    {
+    case BINLOG_CLIMATE:
+        std::printf("sensor %d %s%d.%02d *C %d %%RH, next in %d.%d s\n", f[3], f[0] < 0 ? "-" : "", std::abs(f[0]) / 100,
+                    std::abs(f[0]) % 100, f[1], f[2] / 10, f[2] % 10);
+        break;
+    case BINLOG_DATETIME:
+        std::printf("%04d-%02d-%02d %02d:%02d:%02d\n", f[0], (f[1] >> 8) & 0xFF, f[1] & 0xFF, (f[2] >> 8) & 0xFF, f[2] & 0xFF, f[3]);
+        break;
+    case BINLOG_SAMPLER:
+        std::printf("cycle %.2f ms, failed mask 0x%02X, %u samples dropped\n", uint16_t(f[0]) * 1000.0 / 32768, f[1] & 0xFF,
+                    unsigned(uint16_t(f[2])));
+        break;
+    case BINLOG_TEMPERATURE_MINUTE:
+    case BINLOG_TEMPERATURE_HOUR:
+        std::printf("min %.2f max %.2f mean %.2f sd %.2f *C\n", f[0] / 100.0, f[1] / 100.0, f[2] / 100.0, f[3] / 100.0);
+        break;
+    case BINLOG_HUMIDITY_MINUTE:
+    case BINLOG_HUMIDITY_HOUR:
+        std::printf("min %d max %d mean %d sd %d %%RH\n", f[0], f[1], f[2], f[3]);
+        break;
+    case BINLOG_MOISTURE:
+        std::printf("sensor %d dew point %.2f *C, %.2f g/m3\n", f[2], f[0] / 100.0, uint16_t(f[1]) / 100.0);
+        break;
+    case BINLOG_TWI:
+    {
+        static const char *const health[] = {"ok", "degraded", "quarantined"};
+        unsigned state = (f[0] >> 8) & 0xFF;
+        std::printf("device 0x%02X %s: %u NACKs, %u bus errors, %u failed\n", f[0] & 0xFF, state < 3 ? health[state] : "?",
+                    unsigned(uint16_t(f[1])), unsigned(uint16_t(f[2])), unsigned(uint16_t(f[3])));
+    }
+        break;
+    case BINLOG_TWI_SCAN:
+    {
+        // Bit per TWI_SCAN_PART of twi_scan.h
+        static const char *const parts[] = {"none", "unknown", "DS1307", "SSD1306", "HDC1080"};
+        std::printf("%d devices in %u us:", f[0], unsigned(uint16_t(f[1])));
+        for (unsigned part = 1; part < sizeof(parts) / sizeof(parts[0]); part++)
+        {
+            if (f[2] & (1 << part))
+            {
+                std::printf(" %s", parts[part]);
+            }
+        }
+        if (f[3] != 0)
+        {
+            std::printf(", display at 0x%02X", f[3]);
+        }
+        std::printf("\n");
+    }
+        break;
+    default:
+        std::printf("%d %d %d %d\n", f[0], f[1], f[2], f[3]);
+        break;
+    }
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    std::vector<uint8_t> data;
+    if (argc > 1)
+    {
+        std::ifstream file(argv[1], std::ios::binary);
+        if (!file)
+        {
+            std::fprintf(stderr, "cannot open %s\n", argv[1]);
+            return 1;
+        }
+        data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    }
+    else
+    {
+        std::cin >> std::noskipws;
+        data.assign(std::istreambuf_iterator<char>(std::cin), std::istreambuf_iterator<char>());
+    }
+
+    unsigned long records = 0, lost = 0, skipped = 0;
+    uint32_t last_ticks = 0;
+    uint64_t ticks = 0;
+    int last_sequence = -1;
+    Record record;
+    size_t i = 0;
+
+    while (i + BINLOG_RECORD_SIZE <= data.size())
+    {
+        if (!parse(&data[i], record))
+        {
+            // Resynchronise byte by byte after garbage or a torn record
+            i++;
+            skipped++;
+            continue;
+        }
+        if (last_sequence >= 0)
+        {
+            lost += uint8_t(record.sequence - last_sequence - 1);
+        }
+        // The RTC counter is 24 bits, unwrap it into a running time
+        ticks += (record.time - last_ticks) & 0xFFFFFF;
+        last_ticks = record.time;
+        last_sequence = record.sequence;
+        print(record, ticks / 32768.0);
+        records++;
+        i += BINLOG_RECORD_SIZE;
+    }
+    // The summary follows the records when both go to one pipe
+    std::fflush(stdout);
+    std::fprintf(stderr, "%lu records, %lu lost, %lu bytes skipped\n", records, lost, skipped);
+    return 0;
+}
@@ -0,0 +1,108 @@
+/*
+ *      twi_health.c
+ *
+ *	The MIT License.
+ */
+
+#include <string.h>
+
+#include "twi_health.h"
+#include "app_timer.h"
+#include "app_util_platform.h"
+
+#define TWI_HEALTH_RATE(percent) ((int32_t)(percent) * 65536 / 100)
+#define TWI_HEALTH_SLOW ((int32_t)((uint64_t)TWI_HEALTH_SLOW_US_PER_BYTE * APP_TIMER_CLOCK_FREQ * 256 / 1000000))
+// Cap of one attempt, a stall of any length moves the average by SLOW / 2
+// at most, and about 11 slow attempts in a row are needed to quarantine
+#define TWI_HEALTH_SLOW_CAP (8 * TWI_HEALTH_SLOW)
+
+// Moving average over about 16 values
+static uint16_t TwiHealth_Average(uint16_t average, int32_t value)
+{
+  return (uint16_t)(average + (value - average) / 16);
+}
+
+static void TwiHealth_Quarantine(TWI_HEALTH *health, uint32_t now)
+{
+  health->State = TWI_HEALTH_QUARANTINED;
+  health->ProbeTime = now;
+  health->Probing = 0;
+}
+
+void TwiHealth_Init(TWI_HEALTH *health)
+{
+  memset(health, 0, sizeof(*health));
+  health->State = TWI_HEALTH_OK;
+}
+
+uint8_t TwiHealth_Admit(TWI_HEALTH *health, uint32_t now)
+{
+  uint8_t admit = 0;
+
+  if (health->State != TWI_HEALTH_QUARANTINED)
+  {
+    return 1;
+  }
+  CRITICAL_REGION_ENTER();
+  if (!health->Probing && app_timer_cnt_diff_compute(now, health->ProbeTime) >= APP_TIMER_TICKS(TWI_HEALTH_PROBE_MS))
+  {
+    health->Probing = 1;
+    health->ProbeTime = now;
+    admit = 1;
+  }
+  else
+  {
+    health->Dropped++;
+  }
+  CRITICAL_REGION_EXIT();
+  return admit;
+}
+
+void TwiHealth_Update(TWI_HEALTH *health, uint8_t failed, uint32_t ticks, uint16_t bytes, uint32_t now)
+{
+  uint64_t scaled = ((uint64_t)ticks << 8) / (bytes != 0 ? bytes : 1);
+  int32_t per_byte = scaled > TWI_HEALTH_SLOW_CAP ? TWI_HEALTH_SLOW_CAP : (int32_t)scaled;
+
+  health->ErrorRate = TwiHealth_Average(health->ErrorRate, failed ? 65535 : 0);
+  health->TicksPerByte = TwiHealth_Average(health->TicksPerByte, per_byte);
+  health->Streak = failed ? (health->Streak < 0xFF ? health->Streak + 1 : 0xFF) : 0;
+
+  switch (health->State)
+  {
+  case TWI_HEALTH_OK:
+  case TWI_HEALTH_DEGRADED:
+    if (health->ErrorRate > TWI_HEALTH_RATE(TWI_HEALTH_QUARANTINE_PERCENT) || health->Streak >= TWI_HEALTH_QUARANTINE_STREAK ||
+        health->TicksPerByte > 4 * TWI_HEALTH_SLOW)
+    {
+      TwiHealth_Quarantine(health, now);
+    }
+    else if (health->ErrorRate > TWI_HEALTH_RATE(TWI_HEALTH_DEGRADED_PERCENT) || health->TicksPerByte > TWI_HEALTH_SLOW)
+    {
+      health->State = TWI_HEALTH_DEGRADED;
+    }
+    else if (health->ErrorRate < TWI_HEALTH_RATE(TWI_HEALTH_OK_PERCENT) && health->TicksPerByte < TWI_HEALTH_SLOW / 2)
+    {
+      health->State = TWI_HEALTH_OK;
+    }
+    break;
+  case TWI_HEALTH_QUARANTINED:
+    // Transactions queued before the quarantine only feed the averages
+    if (!health->Probing)
+    {
+      break;
+    }
+    health->Probing = 0;
+    if (failed)
+    {
+      health->ProbeTime = now;
+    }
+    else
+    {
+      // Back on probation: the error rate has to decay before it is healthy
+      health->State = TWI_HEALTH_DEGRADED;
+      health->ErrorRate = TWI_HEALTH_RATE(TWI_HEALTH_DEGRADED_PERCENT);
+      health->TicksPerByte = per_byte;
+    }
+    break;
+  }
+}
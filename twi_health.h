@@ -0,0 +1,84 @@
+/*
+ *      twi_health.h
+ *
+ *	The MIT License.
+ */
+
+#ifndef __TWI_HEALTH_H__
+#define __TWI_HEALTH_H__
+
+#include <stdint.h>
+
+// Failed attempts, in percent, above which a device is degraded
+#ifndef TWI_HEALTH_DEGRADED_PERCENT
+#define TWI_HEALTH_DEGRADED_PERCENT (10)
+#endif
+
+// and below which it is healthy again
+#ifndef TWI_HEALTH_OK_PERCENT
+#define TWI_HEALTH_OK_PERCENT (2)
+#endif
+
+// Failed attempts, in percent, above which a device is quarantined
+#ifndef TWI_HEALTH_QUARANTINE_PERCENT
+#define TWI_HEALTH_QUARANTINE_PERCENT (50)
+#endif
+
+// Failed attempts in a row that quarantine a device
+#ifndef TWI_HEALTH_QUARANTINE_STREAK
+#define TWI_HEALTH_QUARANTINE_STREAK (8)
+#endif
+
+// Bus time per byte in us above which a device is degraded, about four
+// times a byte at 400 kHz: the device stretches the clock. Four times
+// this quarantines it. An attempt counts as eight times this at most, so
+// a single stall, e.g. an erase holding the CPU, cannot quarantine.
+#ifndef TWI_HEALTH_SLOW_US_PER_BYTE
+#define TWI_HEALTH_SLOW_US_PER_BYTE (100)
+#endif
+
+// Time between probes of a quarantined device in ms
+#ifndef TWI_HEALTH_PROBE_MS
+#define TWI_HEALTH_PROBE_MS (5000)
+#endif
+
+typedef enum
+{
+  TWI_HEALTH_OK,
+  TWI_HEALTH_DEGRADED,        // Not retried, so it takes less of the bus
+  TWI_HEALTH_QUARANTINED      // Dropped, except one probe every TWI_HEALTH_PROBE_MS
+} TWI_HEALTH_STATE;
+
+// Health of one device from the outcome and bus time of each attempt.
+// Error rate and time per byte are moving averages over about 16
+// attempts, and a state is left only when its cause is well gone, so a
+// device that flaps does not flap the state with it.
+typedef struct
+{
+  volatile TWI_HEALTH_STATE State;
+  uint16_t ErrorRate;         // Failed attempts, 65536 is 100 %
+  uint16_t TicksPerByte;      // Bus time per byte in 1/256 app_timer ticks
+  uint8_t Streak;             // Failed attempts in a row
+  volatile uint8_t Probing;   // The probe of a quarantined device is on the bus
+  uint32_t ProbeTime;         // app_timer tick of the last probe or quarantine
+  uint16_t Dropped;           // Transactions not sent while quarantined
+} TWI_HEALTH;
+
+/**
+ * @brief Starts healthy.
+ */
+void TwiHealth_Init(TWI_HEALTH *health);
+/**
+ * @brief Tells whether a transaction may go on the bus. In quarantine one
+ *        is let through as a probe every TWI_HEALTH_PROBE_MS.
+ * @param now app_timer_cnt_get()
+ * @return 0 when the transaction is to be dropped.
+ */
+uint8_t TwiHealth_Admit(TWI_HEALTH *health, uint32_t now);
+/**
+ * @brief Takes the outcome of one attempt into account.
+ * @param ticks time the attempt had the bus, bytes its length with addresses.
+ */
+void TwiHealth_Update(TWI_HEALTH *health, uint8_t failed, uint32_t ticks, uint16_t bytes, uint32_t now);
+
+#endif // __TWI_HEALTH_H__
@@ -13,9 +13,9 @@
 #include "main.h"
 #include "twi_mng_ds1307.h"
 
+// Instance behind DS1307_Init and the blocking register functions
+static DS1307_t DS1307_Default;
 static const nrf_twi_mngr_t *TWI_manager = NULL;
-RTCDateTime *DateTime;
-uint8_t DS1307Buffer[7];
 
 /**
  * @brief Initializes the DS1307 module, sets TWI_manager. Sets clock halt bit to 0 to start timing.
@@ -25,10 +25,42 @@ uint8_t DS1307Buffer[7];
 void DS1307_Init(nrf_twi_mngr_t *nrf_twi_mngr_t, RTCDateTime *datetime)
 {
 	TWI_manager = nrf_twi_mngr_t;
-	DateTime = datetime;
+	DS1307_InitDevice(&DS1307_Default, nrf_twi_mngr_t, datetime);
 	DS1307_SetClockHalt(0);
 }
 
+DS1307_t *DS1307_GetDefault(void)
+{
+	return &DS1307_Default;
+}
+
+void DS1307_InitDevice(DS1307_t *ds1307, const nrf_twi_mngr_t *nrf_twi_mngr_t, RTCDateTime *datetime)
+{
+	ds1307->TWI = nrf_twi_mngr_t;
+	ds1307->Address = DS1307_I2C_ADDR;
+	ds1307->Register = DS1307_REG_SECOND;
+	ds1307->DateTime = datetime;
+	ds1307->Busy = 0;
+	APP_ERROR_CHECK(TwiRecovery_InitDevice(&ds1307->Device, nrf_twi_mngr_t, DS1307_I2C_ADDR));
+}
+
+// Blocking read of one register of the default instance
+static ret_code_t DS1307_ReadRegByte(uint8_t regAddr, uint8_t *val)
+{
+	nrf_twi_mngr_transfer_t const read_transfer[] =
+		{
+			NRF_TWI_MNGR_WRITE(DS1307_I2C_ADDR, &regAddr, 1, NRF_TWI_MNGR_NO_STOP),
+			NRF_TWI_MNGR_READ(DS1307_I2C_ADDR, val, 1, 0),
+		};
+	ret_code_t error_code = TwiRecovery_Perform(&DS1307_Default.Device, read_transfer, 2);
+
+	if (error_code != NRF_SUCCESS)
+	{
+		NRF_LOG_WARNING("DS1307_ReadRegByte - 0x%02x error: %d", regAddr, (int)error_code);
+	}
+	return error_code;
+}
+
 /**
  * @brief Sets clock halt bit.
  * @param halt Clock halt bit to set, 0 or 1. 0 to start timing, 0 to stop.
@@ -36,7 +68,13 @@ void DS1307_Init(nrf_twi_mngr_t *nrf_twi_mngr_t, RTCDateTime *datetime)
 void DS1307_SetClockHalt(uint8_t halt)
 {
 	uint8_t ch = (halt ? 1 << 7 : 0);
-	DS1307_SetRegByteTWIManager(DS1307_REG_SECOND, ch | (DS1307_GetRegByteTWIManager(DS1307_REG_SECOND) & 0x7f));
+	uint8_t second;
+
+	// Not written back from a failed read, which would clear the seconds
+	if (DS1307_ReadRegByte(DS1307_REG_SECOND, &second) == NRF_SUCCESS)
+	{
+		DS1307_SetRegByteTWIManager(DS1307_REG_SECOND, ch | (second & 0x7f));
+	}
 }
 
 /**
@@ -52,8 +90,9 @@ uint8_t DS1307_GetClockHalt(void)
  * @brief Sets the byte in the designated DS1307 register to value by TWI Manager
  * @param regAddr Register address to write.
  * @param val Value to set, 0 to 255.
+ * @return NRF_ERROR_FORBIDDEN while the RTC is quarantined, or the TWI error.
  */
-void DS1307_SetRegByteTWIManager(uint8_t regAddr, uint8_t val)
+ret_code_t DS1307_SetRegByteTWIManager(uint8_t regAddr, uint8_t val)
 {
 	uint8_t bytes[2] = {regAddr, val};
 
@@ -61,25 +100,28 @@ void DS1307_SetRegByteTWIManager(uint8_t regAddr, uint8_t val)
 		{
 			NRF_TWI_MNGR_WRITE(DS1307_I2C_ADDR, bytes, 2, 0),
 		};
-	ret_code_t error_code = nrf_twi_mngr_perform(TWI_manager, NULL, write_transfer, 1, NULL);
-	APP_ERROR_CHECK(error_code);
+	ret_code_t error_code = TwiRecovery_Perform(&DS1307_Default.Device, write_transfer, 1);
+
+	if (error_code != NRF_SUCCESS)
+	{
+		NRF_LOG_WARNING("DS1307_SetRegByteTWIManager - 0x%02x error: %d", regAddr, (int)error_code);
+	}
+	return error_code;
 }
 
 /**
  * @brief Gets the byte in the designated DS1307 register.
  * @param regAddr Register address to read.
- * @return Value stored in the register, 0 to 255.
+ * @return Value stored in the register, 0 to 255, 0 when the read failed.
  */
 uint8_t DS1307_GetRegByteTWIManager(uint8_t regAddr)
 {
-	uint8_t val;
-	nrf_twi_mngr_transfer_t const read_transfer[] =
-		{
-			NRF_TWI_MNGR_WRITE(DS1307_I2C_ADDR, &regAddr, 1, NRF_TWI_MNGR_NO_STOP),
-			NRF_TWI_MNGR_READ(DS1307_I2C_ADDR, &val, 1, 0),
-		};
-	ret_code_t error_code = nrf_twi_mngr_perform(TWI_manager, NULL, read_transfer, 2, NULL);
-	APP_ERROR_CHECK(error_code);
+	uint8_t val = 0;
+
+	if (DS1307_ReadRegByte(regAddr, &val) != NRF_SUCCESS)
+	{
+		val = 0;
+	}
 	return val;
 }
 
@@ -89,9 +131,12 @@ uint8_t DS1307_GetRegByteTWIManager(uint8_t regAddr)
  */
 void DS1307_SetEnableSquareWave(DS1307_SquareWaveEnable mode)
 {
-	uint8_t controlReg = DS1307_GetRegByteTWIManager(DS1307_REG_CONTROL);
-	uint8_t newControlReg = (controlReg & ~(1 << 4)) | ((mode & 1) << 4);
-	DS1307_SetRegByteTWIManager(DS1307_REG_CONTROL, newControlReg);
+	uint8_t controlReg;
+
+	if (DS1307_ReadRegByte(DS1307_REG_CONTROL, &controlReg) == NRF_SUCCESS)
+	{
+		DS1307_SetRegByteTWIManager(DS1307_REG_CONTROL, (controlReg & ~(1 << 4)) | ((mode & 1) << 4));
+	}
 }
 
 /**
@@ -100,9 +145,12 @@ void DS1307_SetEnableSquareWave(DS1307_SquareWaveEnable mode)
  */
 void DS1307_SetInterruptRate(DS1307_Rate rate)
 {
-	uint8_t controlReg = DS1307_GetRegByteTWIManager(DS1307_REG_CONTROL);
-	uint8_t newControlReg = (controlReg & ~0x03) | rate;
-	DS1307_SetRegByteTWIManager(DS1307_REG_CONTROL, newControlReg);
+	uint8_t controlReg;
+
+	if (DS1307_ReadRegByte(DS1307_REG_CONTROL, &controlReg) == NRF_SUCCESS)
+	{
+		DS1307_SetRegByteTWIManager(DS1307_REG_CONTROL, (controlReg & ~0x03) | rate);
+	}
 }
 
 /**
@@ -115,11 +163,14 @@ uint8_t DS1307_GetDayOfWeek(void)
 }
 
 /**
- * @brief Calculate Date and Time from DS1307_GetDateTime
- * @param DateTime RTCDateTime pointer
+ * @brief Calculate Date and Time from the raw registers of an instance
+ * @param ds1307 instance holding the registers and the RTCDateTime to fill
  */
-void DS1307_CalculateDateTime()
+static void DS1307_CalculateDateTime(DS1307_t *ds1307)
 {
+	RTCDateTime *DateTime = ds1307->DateTime;
+	const uint8_t *DS1307Buffer = ds1307->Buffer;
+
 	DateTime->Second = DS1307_DecodeBCD(DS1307Buffer[0]);
 	DateTime->Minute = DS1307_DecodeBCD(DS1307Buffer[1]);
 	DateTime->Hour = DS1307_DecodeBCD(DS1307Buffer[2] & 0x3F);
@@ -130,47 +181,91 @@ void DS1307_CalculateDateTime()
 }
 
 /**
- * @brief Callback from DS1307_GetDateTimeSchedule.
- * @note call DS1307_CalculateDateTime to convert array
+ * @brief Schedules a read of the default instance set up by DS1307_Init.
+ * @note The result is decoded into the RTCDateTime given to DS1307_Init.
  */
 void DS1307_ScheduleDateAndTime()
 {
-	DS1307_GetDateTimeSchedule();
+	DS1307_ScheduleRead(&DS1307_Default);
 }
 
 /**
- * @brief Callback from DS1307_GetDateTimeSchedule.
+ * @brief Callback from DS1307_ScheduleRead.
+ * @param p_user_data the DS1307_t instance that was read.
  * @note call DS1307_CalculateDateTime to convert array.
- * @note
  */
 void DS1307_ReadDateTimeRegisters(ret_code_t result, void *p_user_data)
 {
+	DS1307_t *ds1307 = (DS1307_t *)p_user_data;
+
 	if (result != NRF_SUCCESS)
 	{
 		NRF_LOG_WARNING("DS1307_ReadDateTimeRegisters - error: %d", (int)result);
-		return;
 	}
-	DS1307_CalculateDateTime();
+	else
+	{
+		DS1307_CalculateDateTime(ds1307);
+	}
+	// The buffer may be reused once decoded
+	ds1307->Busy = 0;
 }
 
-/**
- * @brief Gets the current time and date
- * @note call DS1307_CalculateDateTime to convert array
- */
-static void DS1307_GetDateTimeSchedule()
+ret_code_t DS1307_ScheduleRead(DS1307_t *ds1307)
 {
-	static nrf_twi_mngr_transfer_t const transfers[] =
-		{
-			NRF_TWI_MNGR_WRITE(DS1307_I2C_ADDR, DS1307_REG_SECOND, 1, NRF_TWI_MNGR_NO_STOP),
-			NRF_TWI_MNGR_READ(DS1307_I2C_ADDR, &DS1307Buffer, 7, 0),
-		};
-	static nrf_twi_mngr_transaction_t NRF_TWI_MNGR_BUFFER_LOC_IND transaction =
-		{
-			.callback = DS1307_ReadDateTimeRegisters,
-			.p_user_data = NULL,
-			.p_transfers = transfers,
-			.number_of_transfers = sizeof(transfers) / sizeof(transfers[0])};
-	APP_ERROR_CHECK(nrf_twi_mngr_schedule(TWI_manager, &transaction));
+	ret_code_t err_code;
+
+	if (ds1307->Busy)
+	{
+		return NRF_ERROR_BUSY;
+	}
+
+	ds1307->Transfers[0] = (nrf_twi_mngr_transfer_t)NRF_TWI_MNGR_WRITE(ds1307->Address, &ds1307->Register, 1, NRF_TWI_MNGR_NO_STOP);
+	ds1307->Transfers[1] = (nrf_twi_mngr_transfer_t)NRF_TWI_MNGR_READ(ds1307->Address, ds1307->Buffer, sizeof(ds1307->Buffer), 0);
+	ds1307->Transaction.callback = DS1307_ReadDateTimeRegisters;
+	ds1307->Transaction.p_user_data = ds1307;
+	ds1307->Transaction.p_transfers = ds1307->Transfers;
+	ds1307->Transaction.number_of_transfers = 2;
+	ds1307->Busy = 1;
+
+	err_code = TwiRecovery_Schedule(&ds1307->Device, &ds1307->Retry, &ds1307->Transaction);
+	if (err_code != NRF_SUCCESS)
+	{
+		ds1307->Busy = 0;
+	}
+	return err_code;
+}
+
+// Read the control register, replace the masked bits and write it back
+static PT_STATUS DS1307_ControlTask(TWI_TASK_t *task)
+{
+	DS1307_t *ds1307 = (DS1307_t *)task->Context;
+
+	TWI_TASK_BEGIN(task);
+	ds1307->Control[0] = DS1307_REG_CONTROL;
+	TWI_TASK_AWAIT(task,
+				   NRF_TWI_MNGR_WRITE(ds1307->Address, &ds1307->Control[0], 1, NRF_TWI_MNGR_NO_STOP),
+				   NRF_TWI_MNGR_READ(ds1307->Address, &ds1307->Control[1], 1, 0));
+	if (task->Result == NRF_SUCCESS)
+	{
+		ds1307->Control[1] = (ds1307->Control[1] & ~ds1307->ControlMask) | (ds1307->ControlBits & ds1307->ControlMask);
+		TWI_TASK_AWAIT(task, NRF_TWI_MNGR_WRITE(ds1307->Address, ds1307->Control, 2, 0));
+	}
+	if (task->Result != NRF_SUCCESS)
+	{
+		NRF_LOG_WARNING("DS1307_ControlTask - error: %d", (int)task->Result);
+	}
+	TWI_TASK_END(task);
+}
+
+ret_code_t DS1307_StartControlUpdate(DS1307_t *ds1307, TWI_TASK_t *task, uint8_t mask, uint8_t bits, TWI_TASK_handler_t on_done)
+{
+	if (task->Active)
+	{
+		return NRF_ERROR_BUSY;
+	}
+	ds1307->ControlMask = mask;
+	ds1307->ControlBits = bits;
+	return TwiTask_Start(task, DS1307_ControlTask, ds1307, on_done);
 }
 
 /**
@@ -179,7 +274,7 @@ static void DS1307_GetDateTimeSchedule()
  * @param bufp - pointer on buffer to read
  * @param len - length of buffer
  */
-void DS1307_WriteMem(uint8_t reg, uint8_t *bufp, uint16_t len)
+ret_code_t DS1307_WriteMem(uint8_t reg, uint8_t *bufp, uint16_t len)
 {
 	uint8_t buffer[1 + len];
 	memcpy(buffer, &reg, 1);
@@ -188,24 +283,40 @@ void DS1307_WriteMem(uint8_t reg, uint8_t *bufp, uint16_t len)
 		{
 			NRF_TWI_MNGR_WRITE(DS1307_I2C_ADDR, &buffer, len + 1, NRF_TWI_MNGR_NO_STOP),
 		};
-	ret_code_t error_code = nrf_twi_mngr_perform(TWI_manager, NULL, read_transfer, 2, NULL);
-	APP_ERROR_CHECK(error_code);
+	ret_code_t error_code = TwiRecovery_Perform(&DS1307_Default.Device, read_transfer, 1);
+
+	if (error_code != NRF_SUCCESS)
+	{
+		NRF_LOG_WARNING("DS1307_WriteMem - error: %d", (int)error_code);
+	}
+	return error_code;
 }
 
 /**
  * @brief Gets the current time and date
  * @note call DS1307_CalculateDateTime to convert array
+ * @return the TWI error, DateTime is then left as it was.
  */
-void DS1307_GetDateTime(RTCDateTime *DateTime)
+ret_code_t DS1307_GetDateTime(RTCDateTime *DateTime)
 {
+	DS1307_t ds1307;
+
+	ds1307.Register = DS1307_REG_SECOND;
+	ds1307.DateTime = DateTime;
 	nrf_twi_mngr_transfer_t const read_transfer[] =
 		{
-			NRF_TWI_MNGR_WRITE(DS1307_I2C_ADDR, DS1307_REG_SECOND, 1, NRF_TWI_MNGR_NO_STOP),
-			NRF_TWI_MNGR_READ(DS1307_I2C_ADDR, &DS1307Buffer, 7, 0),
+			NRF_TWI_MNGR_WRITE(DS1307_I2C_ADDR, &ds1307.Register, 1, NRF_TWI_MNGR_NO_STOP),
+			NRF_TWI_MNGR_READ(DS1307_I2C_ADDR, ds1307.Buffer, 7, 0),
 		};
-	ret_code_t error_code = nrf_twi_mngr_perform(TWI_manager, NULL, read_transfer, 2, NULL);
-	APP_ERROR_CHECK(error_code);
-	DS1307_CalculateDateTime(DateTime);
+	ret_code_t error_code = TwiRecovery_Perform(&DS1307_Default.Device, read_transfer, 2);
+
+	if (error_code != NRF_SUCCESS)
+	{
+		NRF_LOG_WARNING("DS1307_GetDateTime - error: %d", (int)error_code);
+		return error_code;
+	}
+	DS1307_CalculateDateTime(&ds1307);
+	return NRF_SUCCESS;
 }
 
 /**
@@ -294,7 +405,7 @@ int dayofweek(int Day, int Month, int Year)
 	return (7 + N) % 7;
 }
 
-void DS1307_SetDateTime(RTCDateTime *DateTime)
+ret_code_t DS1307_SetDateTime(RTCDateTime *DateTime)
 {
 	uint8_t tmp[8];
 
@@ -323,8 +434,13 @@ void DS1307_SetDateTime(RTCDateTime *DateTime)
 		{
 			NRF_TWI_MNGR_WRITE(DS1307_I2C_ADDR, tmp, sizeof(tmp), NRF_TWI_MNGR_NO_STOP),
 		};
-	ret_code_t error_code = nrf_twi_mngr_perform(TWI_manager, NULL, write_transfer, 1, NULL);
-	APP_ERROR_CHECK(error_code);
+	ret_code_t error_code = TwiRecovery_Perform(&DS1307_Default.Device, write_transfer, 1);
+
+	if (error_code != NRF_SUCCESS)
+	{
+		NRF_LOG_WARNING("DS1307_SetDateTime - error: %d", (int)error_code);
+	}
+	return error_code;
 }
 
 /**
@@ -41,6 +41,8 @@
 #define TWI_MNG_DS1307_H__
 
 // #include "nrf_twi_mngr.h"
+#include "twi_task.h"
+#include "twi_recovery.h"
 
 #ifdef __cplusplus
 extern "C"
@@ -92,19 +94,58 @@ extern "C"
 		uint8_t DayOfWeek;
 	} RTCDateTime;
 
+	// One DS1307. The caller owns the instance; scheduled reads use its
+	// buffers and decode into its DateTime, so instances never share state.
+	typedef struct
+	{
+		const nrf_twi_mngr_t *TWI;             // Bus the RTC is on
+		uint8_t Address;                       // 7-bit TWI address
+		uint8_t Register;                      // Register pointer sent before a read
+		uint8_t Buffer[7];                     // Raw time and date registers
+		RTCDateTime *DateTime;                 // Decoded by the read callback
+		nrf_twi_mngr_transfer_t Transfers[2];
+		nrf_twi_mngr_transaction_t Transaction;
+		volatile uint8_t Busy;                 // Read queued or in progress
+		uint8_t Control[2];                    // Control register address and value
+		uint8_t ControlMask;                   // Bits replaced by DS1307_StartControlUpdate
+		uint8_t ControlBits;
+		TWI_RETRY Retry;                       // Of the scheduled read
+		TWI_DEVICE Device;                     // Retries and error counters
+	} DS1307_t;
+
 	void DS1307_Init(nrf_twi_mngr_t *nrf_twi_mngr_t, RTCDateTime *datetime);
+	/**
+	 * @brief Instance set up by DS1307_Init.
+	 */
+	DS1307_t *DS1307_GetDefault(void);
+	/**
+	 * @brief Sets up a DS1307 instance, nothing is sent.
+	 * @param datetime where scheduled reads are decoded to.
+	 */
+	void DS1307_InitDevice(DS1307_t *ds1307, const nrf_twi_mngr_t *nrf_twi_mngr_t, RTCDateTime *datetime);
+	/**
+	 * @brief Schedules a read of the time and date into the instance.
+	 * @return NRF_ERROR_BUSY if the previous read of this instance has not finished.
+	 */
+	ret_code_t DS1307_ScheduleRead(DS1307_t *ds1307);
+
+	/**
+	 * @brief Read-modify-write of the control register as a TWI task.
+	 * @param mask bits to replace, bits their new value.
+	 * @return NRF_ERROR_BUSY if the task is still running.
+	 */
+	ret_code_t DS1307_StartControlUpdate(DS1307_t *ds1307, TWI_TASK_t *task, uint8_t mask, uint8_t bits, TWI_TASK_handler_t on_done);
 
 	void DS1307_SetClockHalt(uint8_t halt);
 	uint8_t DS1307_GetClockHalt(void);
 
-	void DS1307_SetRegByteTWIManager(uint8_t regAddr, uint8_t val);
+	ret_code_t DS1307_SetRegByteTWIManager(uint8_t regAddr, uint8_t val);
 	uint8_t DS1307_GetRegByteTWIManager(uint8_t regAddr);
 
 	void DS1307_SetEnableSquareWave(DS1307_SquareWaveEnable mode);
 	void DS1307_SetInterruptRate(DS1307_Rate rate);
 
-        static void DS1307_GetDateTimeSchedule();
-        void DS1307_ScheduleDateAndTime();
+	void DS1307_ScheduleDateAndTime();
 
 	uint8_t DS1307_GetDayOfWeek(void);
 	uint8_t DS1307_GetDate(void);
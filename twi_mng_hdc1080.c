@@ -12,34 +12,29 @@
 
 #include "twi_mng_hdc1080.h"
 #include "main.h"
+#include "twi_mng_tca9548a.h"
 
 static const nrf_twi_mngr_t *TWI_manager = NULL;
-uint8_t receive_data[4];
+// Instance behind hdc1080_init, HDC1080_Start and HDC1080_ReceiveData
+static HDC1080_t HDC1080_Default;
 volatile float *temp;
 volatile uint8_t *humi;
 
-/**
- * @brief Initializes the HDC1080. Sets clock halt bit to 0 to start timing.
- * @param m_twi User TWI handle pointer.
- * @param Temp_Reso Temperature_Resolution in bits
- * @param Humi_Reso Humidity_Resolution in bits
- * @param temperature Pointer to the temperature
- * @param humidity Pointer to the humidity
- */
-void hdc1080_init(nrf_twi_mngr_t *nrf_twi_mngr_t, Temp_Reso Temperature_Resolution_x_bit, Humi_Reso Humidity_Resolution_x_bit, volatile float *temperature, volatile uint8_t *humidity)
+static void HDC1080_CopyToUser(HDC1080_t *hdc1080)
 {
-  /* Temperature and Humidity are acquired in sequence, Temperature first
-   * Default:   Temperature resolution = 14 bit,
-   *            Humidity resolution = 14 bit
-   */
-  /* Set the acquisition mode to measure both temperature and humidity by setting Bit[12] to 1 */
-  TWI_manager = nrf_twi_mngr_t;
+  if (hdc1080->Status != NRF_SUCCESS)
+  {
+    return;
+  }
+  *temp = hdc1080->Temperature;
+  *humi = hdc1080->Humidity;
+}
 
-  temp = temperature;
-  humi = humidity;
-  ret_code_t err_code;
+// Configuration register value for the requested resolutions
+static uint16_t HDC1080_ConfigValue(Temp_Reso Temperature_Resolution_x_bit, Humi_Reso Humidity_Resolution_x_bit)
+{
+  /* Set the acquisition mode to measure both temperature and humidity by setting Bit[12] to 1 */
   uint16_t config_reg_value = 0x1000;
-  uint8_t data_send[2];
 
   if (Temperature_Resolution_x_bit == Temperature_Resolution_11_bit)
   {
@@ -54,19 +49,102 @@ void hdc1080_init(nrf_twi_mngr_t *nrf_twi_mngr_t, Temp_Reso Temperature_Resoluti
   case Humidity_Resolution_8_bit:
     config_reg_value |= (1 << 9);
     break;
+  default:
+    break;
+  }
+  return config_reg_value;
+}
+
+// Conversion time in us for the requested resolutions, datasheet maximums
+static uint16_t HDC1080_ConversionTime(Temp_Reso Temperature_Resolution_x_bit, Humi_Reso Humidity_Resolution_x_bit)
+{
+  uint16_t conversion_time = (Temperature_Resolution_x_bit == Temperature_Resolution_11_bit) ? 3650 : 6350;
+
+  switch (Humidity_Resolution_x_bit)
+  {
+  case Humidity_Resolution_11_bit:
+    conversion_time += 3850;
+    break;
+  case Humidity_Resolution_8_bit:
+    conversion_time += 2500;
+    break;
+  default:
+    conversion_time += 6500;
+    break;
+  }
+  return conversion_time;
+}
+
+// Set up the instance fields and write the configuration register
+static void HDC1080_Setup(HDC1080_t *hdc1080, Temp_Reso Temperature_Resolution_x_bit, Humi_Reso Humidity_Resolution_x_bit, HDC1080_data_handler_t on_data)
+{
+  uint16_t config_reg_value = HDC1080_ConfigValue(Temperature_Resolution_x_bit, Humidity_Resolution_x_bit);
+  uint8_t buffer[3] = {Configuration_register_add, config_reg_value >> 8, config_reg_value & 0x00ff};
+
+  hdc1080->Address = HDC_1080_ADD;
+  hdc1080->Register = Temperature_register_add;
+  hdc1080->ConversionTime = HDC1080_ConversionTime(Temperature_Resolution_x_bit, Humidity_Resolution_x_bit);
+  hdc1080->Status = NRF_SUCCESS;
+  hdc1080->OnData = on_data;
+  hdc1080->OnTrigger = NULL;
+  hdc1080->Context = NULL;
+  hdc1080->Trigger.Busy = 0;
+  hdc1080->Read.Busy = 0;
+  if (hdc1080->Mux != NULL)
+  {
+    APP_ERROR_CHECK(TwiRecovery_InitMuxDevice(&hdc1080->Device, hdc1080->Mux, hdc1080->Channel, hdc1080->Address));
+  }
+  else
+  {
+    APP_ERROR_CHECK(TwiRecovery_InitDevice(&hdc1080->Device, hdc1080->TWI, hdc1080->Address));
   }
 
-  data_send[0] = (config_reg_value >> 8);
-  data_send[1] = (config_reg_value & 0x00ff);
-  uint8_t buffer[1 + 2];
-  memset(buffer, Configuration_register_add, 1);
-  memcpy(buffer + 1, data_send, 2);
   nrf_twi_mngr_transfer_t const write_transfer[] =
       {
-          NRF_TWI_MNGR_WRITE(HDC_1080_ADD, buffer, sizeof(buffer), NRF_TWI_MNGR_NO_STOP),
+          NRF_TWI_MNGR_WRITE(hdc1080->Address, buffer, sizeof(buffer), 0),
       };
-  ret_code_t error_code = nrf_twi_mngr_perform(TWI_manager, NULL, write_transfer, 1, NULL);
-  APP_ERROR_CHECK(error_code);
+  hdc1080->Status = TwiRecovery_Perform(&hdc1080->Device, write_transfer, 1);
+  if (hdc1080->Status != NRF_SUCCESS)
+  {
+    NRF_LOG_WARNING("HDC1080_Setup - error: %d", (int)hdc1080->Status);
+  }
+}
+
+void HDC1080_InitDevice(HDC1080_t *hdc1080, const nrf_twi_mngr_t *nrf_twi_mngr_t, Temp_Reso Temperature_Resolution_x_bit, Humi_Reso Humidity_Resolution_x_bit, HDC1080_data_handler_t on_data)
+{
+  hdc1080->TWI = nrf_twi_mngr_t;
+  hdc1080->Mux = NULL;
+  hdc1080->Channel = 0;
+  HDC1080_Setup(hdc1080, Temperature_Resolution_x_bit, Humidity_Resolution_x_bit, on_data);
+}
+
+void HDC1080_InitDeviceOnMux(HDC1080_t *hdc1080, struct TCA9548A_s *tca9548a, uint8_t channel, Temp_Reso Temperature_Resolution_x_bit, Humi_Reso Humidity_Resolution_x_bit, HDC1080_data_handler_t on_data)
+{
+  hdc1080->TWI = tca9548a->TWI;
+  hdc1080->Mux = tca9548a;
+  hdc1080->Channel = channel;
+  HDC1080_Setup(hdc1080, Temperature_Resolution_x_bit, Humidity_Resolution_x_bit, on_data);
+}
+
+/**
+ * @brief Initializes the HDC1080. Sets clock halt bit to 0 to start timing.
+ * @param m_twi User TWI handle pointer.
+ * @param Temp_Reso Temperature_Resolution in bits
+ * @param Humi_Reso Humidity_Resolution in bits
+ * @param temperature Pointer to the temperature
+ * @param humidity Pointer to the humidity
+ */
+void hdc1080_init(nrf_twi_mngr_t *nrf_twi_mngr_t, Temp_Reso Temperature_Resolution_x_bit, Humi_Reso Humidity_Resolution_x_bit, volatile float *temperature, volatile uint8_t *humidity)
+{
+  /* Temperature and Humidity are acquired in sequence, Temperature first
+   * Default:   Temperature resolution = 14 bit,
+   *            Humidity resolution = 14 bit
+   */
+  TWI_manager = nrf_twi_mngr_t;
+
+  temp = temperature;
+  humi = humidity;
+  HDC1080_InitDevice(&HDC1080_Default, nrf_twi_mngr_t, Temperature_Resolution_x_bit, Humidity_Resolution_x_bit, HDC1080_CopyToUser);
   NRF_LOG_FLUSH();
 }
 
@@ -80,98 +158,169 @@ void hdc1080_start_measurement(float *temperature, uint8_t *humidity)
   uint8_t receive_data[4];
   uint16_t temp_x, humi_x;
   uint8_t send_data = Temperature_register_add;
-  ret_code_t err_code;
 
   nrf_twi_mngr_transfer_t const write_transfer[] =
       {
-          NRF_TWI_MNGR_WRITE(HDC_1080_ADD, send_data, sizeof(send_data), NRF_TWI_MNGR_NO_STOP),
+          NRF_TWI_MNGR_WRITE(HDC_1080_ADD, &send_data, sizeof(send_data), NRF_TWI_MNGR_NO_STOP),
       };
-  ret_code_t error_code = nrf_twi_mngr_perform(TWI_manager, NULL, write_transfer, 1, NULL);
-  APP_ERROR_CHECK(error_code);
+  ret_code_t error_code = TwiRecovery_Perform(&HDC1080_Default.Device, write_transfer, 1);
+  if (error_code != NRF_SUCCESS)
+  {
+    NRF_LOG_WARNING("hdc1080_start_measurement - error: %d", (int)error_code);
+    return;
+  }
   nrf_delay_ms(15);
   nrf_twi_mngr_transfer_t const read_transfer[] =
       {
           NRF_TWI_MNGR_READ(HDC_1080_ADD, &receive_data, sizeof(receive_data), NRF_TWI_MNGR_NO_STOP),
       };
-  error_code = nrf_twi_mngr_perform(TWI_manager, NULL, read_transfer, 1, NULL);
-  APP_ERROR_CHECK(error_code);
+  error_code = TwiRecovery_Perform(&HDC1080_Default.Device, read_transfer, 1);
+  if (error_code != NRF_SUCCESS)
+  {
+    NRF_LOG_WARNING("hdc1080_start_measurement - error: %d", (int)error_code);
+    return;
+  }
   temp_x = ((receive_data[0] << 8) | receive_data[1]);
   humi_x = ((receive_data[2] << 8) | receive_data[3]);
   *temperature = ((temp_x / 65536.0) * 165.0) - 40.0;
   *humidity = (uint8_t)((humi_x / 65536.0) * 100.0);
 }
 
-/**
- * @brief Measure temperature and humudity. 15ms delay in function
- * @param float Temperature
- * @param uint8_t Humidity
- * @return 0
- */
-static void HDC1080_CommandStartMeasuring()
+// Transaction callback of the trigger
+static void HDC1080_TriggerDone(ret_code_t result, void *p_user_data)
 {
-  ret_code_t err_code;
+  HDC1080_t *hdc1080 = (HDC1080_t *)p_user_data;
 
-  static nrf_twi_mngr_transfer_t const transfers[] =
-      {
-          NRF_TWI_MNGR_WRITE(HDC_1080_ADD, Temperature_register_add, 1, NRF_TWI_MNGR_NO_STOP),
-      };
-  static nrf_twi_mngr_transaction_t NRF_TWI_MNGR_BUFFER_LOC_IND transaction =
-      {
-          .callback = NULL,
-          .p_user_data = NULL,
-          .p_transfers = transfers,
-          .number_of_transfers = sizeof(transfers) / sizeof(transfers[0])};
-  APP_ERROR_CHECK(nrf_twi_mngr_schedule(TWI_manager, &transaction));
+  if (result != NRF_SUCCESS)
+  {
+    NRF_LOG_WARNING("HDC1080_TriggerDone - error: %d", (int)result);
+  }
+  hdc1080->Status = result;
+  hdc1080->Trigger.Busy = 0;
+  if (hdc1080->OnTrigger != NULL)
+  {
+    hdc1080->OnTrigger(hdc1080);
+  }
 }
 
-void HDC1080_Convert()
+static void HDC1080_Convert(HDC1080_t *hdc1080)
 {
   uint16_t temp_x, humi_x;
-  temp_x = ((receive_data[0] << 8) | receive_data[1]);
-  humi_x = ((receive_data[2] << 8) | receive_data[3]);
+  temp_x = ((hdc1080->Raw[0] << 8) | hdc1080->Raw[1]);
+  humi_x = ((hdc1080->Raw[2] << 8) | hdc1080->Raw[3]);
 
-  *temp = ((temp_x / 65536.0) * 165.0) - 40.0;
-  *humi = (uint8_t)((humi_x / 65536.0) * 100.0);
+  hdc1080->Temperature = ((temp_x / 65536.0) * 165.0) - 40.0;
+  hdc1080->Humidity = (uint8_t)((humi_x / 65536.0) * 100.0);
 }
 
 /**
- * @brief Callback from HDC1080_ReceiveData.
- * @note call
- * @note
+ * @brief Callback from HDC1080_ScheduleRead.
+ * @param p_user_data the HDC1080_t instance that was read.
+ * @note converts the raw registers and calls the instance handler.
  */
 void HDC1080_ReadRegisters(ret_code_t result, void *p_user_data)
 {
+  HDC1080_t *hdc1080 = (HDC1080_t *)p_user_data;
+
   if (result != NRF_SUCCESS)
   {
-    NRF_LOG_WARNING("DS1307_ReadDateTimeRegisters - error: %d", (int)result);
-    return;
+    NRF_LOG_WARNING("HDC1080_ReadRegisters - error: %d", (int)result);
+  }
+  else
+  {
+    HDC1080_Convert(hdc1080);
+  }
+  hdc1080->Status = result;
+  hdc1080->Read.Busy = 0;
+  if (hdc1080->OnData != NULL)
+  {
+    hdc1080->OnData(hdc1080);
   }
-  HDC1080_Convert();
 }
 
-static void HDC1080_CommandReceiveData()
+// Schedule one transfer of an instance with the instance as user data.
+// The transfer is copied in only once tx is known to be free, a queued
+// one belongs to the TWI manager until its callback.
+static ret_code_t HDC1080_Schedule(HDC1080_t *hdc1080, HDC1080_TX *tx, nrf_twi_mngr_transfer_t transfer, nrf_twi_mngr_callback_t callback)
 {
-  uint8_t send_data = Temperature_register_add;
+  ret_code_t err_code;
 
-  static nrf_twi_mngr_transfer_t const transfers[] =
-      {
-          NRF_TWI_MNGR_READ(HDC_1080_ADD, &receive_data, sizeof(receive_data), 0),
-      };
-  static nrf_twi_mngr_transaction_t NRF_TWI_MNGR_BUFFER_LOC_IND transaction =
-      {
-          .callback = HDC1080_ReadRegisters,
-          .p_user_data = NULL,
-          .p_transfers = transfers,
-          .number_of_transfers = sizeof(transfers) / sizeof(transfers[0])};
-  APP_ERROR_CHECK(nrf_twi_mngr_schedule(TWI_manager, &transaction));
+  if (tx->Busy)
+  {
+    return NRF_ERROR_BUSY;
+  }
+  tx->Transfer = transfer;
+  tx->Transaction.callback = callback;
+  tx->Transaction.p_user_data = hdc1080;
+  tx->Transaction.p_transfers = &tx->Transfer;
+  tx->Transaction.number_of_transfers = 1;
+  tx->Busy = 1;
+
+  err_code = TwiRecovery_Schedule(&hdc1080->Device, &tx->Retry, &tx->Transaction);
+  if (err_code != NRF_SUCCESS)
+  {
+    tx->Busy = 0;
+  }
+  return err_code;
+}
+
+ret_code_t HDC1080_ScheduleTrigger(HDC1080_t *hdc1080)
+{
+  return HDC1080_Schedule(hdc1080, &hdc1080->Trigger,
+                          (nrf_twi_mngr_transfer_t)NRF_TWI_MNGR_WRITE(hdc1080->Address, &hdc1080->Register, 1, 0),
+                          HDC1080_TriggerDone);
+}
+
+ret_code_t HDC1080_ScheduleRead(HDC1080_t *hdc1080)
+{
+  return HDC1080_Schedule(hdc1080, &hdc1080->Read,
+                          (nrf_twi_mngr_transfer_t)NRF_TWI_MNGR_READ(hdc1080->Address, hdc1080->Raw, sizeof(hdc1080->Raw), 0),
+                          HDC1080_ReadRegisters);
+}
+
+// Trigger, conversion and read of one measurement
+static PT_STATUS HDC1080_MeasureTask(TWI_TASK_t *task)
+{
+  HDC1080_t *hdc1080 = (HDC1080_t *)task->Context;
+
+  TWI_TASK_BEGIN(task);
+  TWI_TASK_AWAIT(task, NRF_TWI_MNGR_WRITE(hdc1080->Address, &hdc1080->Register, 1, 0));
+  if (task->Result == NRF_SUCCESS)
+  {
+    TWI_TASK_SLEEP(task, APP_TIMER_TICKS(CEIL_DIV(hdc1080->ConversionTime, 1000)) + 1);
+    TWI_TASK_AWAIT(task, NRF_TWI_MNGR_READ(hdc1080->Address, hdc1080->Raw, sizeof(hdc1080->Raw), 0));
+  }
+  if (task->Result == NRF_SUCCESS)
+  {
+    HDC1080_Convert(hdc1080);
+  }
+  else
+  {
+    NRF_LOG_WARNING("HDC1080_MeasureTask - error: %d", (int)task->Result);
+  }
+  hdc1080->Status = task->Result;
+  if (hdc1080->OnData != NULL)
+  {
+    hdc1080->OnData(hdc1080);
+  }
+  TWI_TASK_END(task);
+}
+
+ret_code_t HDC1080_StartMeasureTask(HDC1080_t *hdc1080, TWI_TASK_t *task, TWI_TASK_handler_t on_done)
+{
+  if (hdc1080->Mux != NULL)
+  {
+    return NRF_ERROR_NOT_SUPPORTED;
+  }
+  return TwiTask_Start(task, HDC1080_MeasureTask, hdc1080, on_done);
 }
 
 void HDC1080_Start()
 {
-  HDC1080_CommandStartMeasuring();
+  HDC1080_ScheduleTrigger(&HDC1080_Default);
 }
 
 void HDC1080_ReceiveData()
 {
-  HDC1080_CommandReceiveData();
-}
\ No newline at end of file
+  HDC1080_ScheduleRead(&HDC1080_Default);
+}
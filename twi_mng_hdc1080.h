@@ -2,6 +2,8 @@
 #define __HDC1080_H__
 
 #include "main.h"
+#include "twi_task.h"
+#include "twi_recovery.h"
 
 #define         HDC_1080_ADD                            (0x40)
 #define         Configuration_register_add              (0x02)
@@ -21,10 +23,75 @@ typedef enum
   Humidity_Resolution_8_bit =2
 }Humi_Reso;
 
-static void HDC1080_CommandStartMeasuring();
-static void HDC1080_CommandReceiveData();
+// One queued HDC1080 transfer with its own busy flag
+typedef struct
+{
+  nrf_twi_mngr_transfer_t Transfer;
+  nrf_twi_mngr_transaction_t Transaction;
+  TWI_RETRY Retry;
+  volatile uint8_t Busy;
+} HDC1080_TX;
+
+typedef struct HDC1080_s HDC1080_t;
+struct TCA9548A_s;
+
+// Called from the TWI callback when a transfer of the instance is done,
+// Status holds its result
+typedef void (*HDC1080_data_handler_t)(HDC1080_t *hdc1080);
+
+// One HDC1080. The caller owns the instance: the trigger and the read use
+// its own buffers and the results are stored in it.
+struct HDC1080_s
+{
+  const nrf_twi_mngr_t *TWI;      // Bus the sensor is on
+  uint8_t Address;                // 7-bit TWI address
+  uint8_t Register;               // Register pointer written to trigger a measurement
+  uint8_t Raw[4];                 // Temperature and humidity registers
+  volatile float Temperature;     // Last result in *C
+  volatile uint8_t Humidity;      // Last result in %RH
+  uint16_t ConversionTime;        // Time in us from trigger to result
+  volatile ret_code_t Status;     // Result of the last configuration, trigger or read
+  HDC1080_data_handler_t OnData;  // After each read, optional
+  HDC1080_data_handler_t OnTrigger; // After each trigger, optional
+  void *Context;                  // For the handlers
+  struct TCA9548A_s *Mux;         // Mux the sensor is behind, NULL if none
+  uint8_t Channel;                // Mux channel
+  HDC1080_TX Trigger;
+  HDC1080_TX Read;
+  TWI_DEVICE Device;              // Retries and error counters, routed through Mux if set
+};
+
 void HDC1080_Start();
 void HDC1080_ReceiveData();
+/**
+ * @brief Sets up an HDC1080 instance and writes its configuration register.
+ * @param on_data called after each read, may be NULL. Temperature and Humidity
+ *        keep the previous result when Status is not NRF_SUCCESS.
+ * @note Status holds the result of the configuration write.
+ */
+void HDC1080_InitDevice(HDC1080_t *hdc1080, const nrf_twi_mngr_t *nrf_twi_mngr_t, Temp_Reso Temperature_Resolution_x_bit, Humi_Reso Humidity_Resolution_x_bit, HDC1080_data_handler_t on_data);
+/**
+ * @brief Same as HDC1080_InitDevice for a sensor behind a TCA9548A channel.
+ * @note All transfers of the instance are then routed through the mux.
+ */
+void HDC1080_InitDeviceOnMux(HDC1080_t *hdc1080, struct TCA9548A_s *tca9548a, uint8_t channel, Temp_Reso Temperature_Resolution_x_bit, Humi_Reso Humidity_Resolution_x_bit, HDC1080_data_handler_t on_data);
+/**
+ * @brief Schedules the register pointer write that starts a measurement.
+ * @note The result is ready for HDC1080_ScheduleRead after ConversionTime.
+ * @return NRF_ERROR_BUSY if the previous trigger of this instance is still queued.
+ */
+ret_code_t HDC1080_ScheduleTrigger(HDC1080_t *hdc1080);
+/**
+ * @brief Schedules the read of temperature and humidity into the instance.
+ * @return NRF_ERROR_BUSY if the previous read of this instance is still queued.
+ */
+ret_code_t HDC1080_ScheduleRead(HDC1080_t *hdc1080);
+/**
+ * @brief Measures once as a TWI task: trigger, wait the conversion time, read.
+ * @note For sensors not behind a mux. Status and OnData as for HDC1080_ScheduleRead.
+ * @return NRF_ERROR_BUSY if the task is still running.
+ */
+ret_code_t HDC1080_StartMeasureTask(HDC1080_t *hdc1080, TWI_TASK_t *task, TWI_TASK_handler_t on_done);
 void hdc1080_init(nrf_twi_mngr_t *nrf_twi_mngr_t, Temp_Reso Temperature_Resolution_x_bit, Humi_Reso Humidity_Resolution_x_bit, volatile float *temperature, volatile uint8_t *humidity);
 void hdc1080_start_measurement(float* temperature, uint8_t* humidity);
 
@@ -1,7 +1,15 @@
 #include "main.h"
 #include "twi_mng_ssd1306.h"
+#include "nordic_common.h"
 
-static const nrf_twi_mngr_t *TWI_manager = NULL;
+// Display used when the application does not create its own
+static SSD1306_t SSD1306_Default =
+    {
+        .Address = SSD1306_I2C_ADDR,
+        .Clip = {0, 0, SSD1306_WIDTH - 1, SSD1306_HEIGHT - 1}};
+
+// Display all drawing goes to
+static SSD1306_t *SSD1306 = &SSD1306_Default;
 
 /**
  * @brief Initializes the SSD1306 module.
@@ -9,105 +17,128 @@ static const nrf_twi_mngr_t *TWI_manager = NULL;
  */
 void ssd1306_TWI_Init(nrf_twi_mngr_t *nrf_twi_mngr_t)
 {
-    TWI_manager = nrf_twi_mngr_t;
+    ssd1306_InitDisplay(&SSD1306_Default, nrf_twi_mngr_t, SSD1306_I2C_ADDR);
+}
+
+void ssd1306_InitDisplay(SSD1306_t *display, const nrf_twi_mngr_t *nrf_twi_mngr_t, uint8_t address)
+{
+    uint8_t page;
+
+    // The instance may be on the stack or initialized before: no page left
+    // Busy or dirty, the framebuffer is cleared by ssd1306_Init
+    memset(display, 0, sizeof(*display));
+    for (page = 0; page < SSD1306_PAGES; page++)
+    {
+        display->DirtyX1[page] = SSD1306_WIDTH;
+    }
+    display->Clip.x2 = SSD1306_WIDTH - 1;
+    display->Clip.y2 = SSD1306_HEIGHT - 1;
+    display->TWI = nrf_twi_mngr_t;
+    display->Address = address;
+    APP_ERROR_CHECK(TwiRecovery_InitDevice(&display->Device, nrf_twi_mngr_t, address));
+    SSD1306 = display;
     ssd1306_Init();
 }
 
+SSD1306_t *ssd1306_SelectDisplay(SSD1306_t *display)
+{
+    SSD1306_t *previous = SSD1306;
+
+    SSD1306 = display;
+    return previous;
+}
+
+SSD1306_t *ssd1306_GetDisplay(void)
+{
+    return SSD1306;
+}
+
 /**
- * @brief Initializes the SSD1306 module.
+ * @brief Sends one command byte.
  * @param uint8_t write Byte
  */
-void ssd1306_WriteCommand(uint8_t byte)
+ret_code_t ssd1306_WriteCommand(uint8_t byte)
 {
-    ret_code_t err_code;
     uint8_t buffer[2];
     buffer[0] = 0x00;
     buffer[1] = byte;
 
     nrf_twi_mngr_transfer_t const write_transfer[] =
         {
-            NRF_TWI_MNGR_WRITE(SSD1306_I2C_ADDR, buffer, sizeof(buffer), 0),
+            NRF_TWI_MNGR_WRITE(SSD1306->Address, buffer, sizeof(buffer), 0),
         };
-    ret_code_t error_code = nrf_twi_mngr_perform(TWI_manager, NULL, write_transfer, 1, NULL);
-    APP_ERROR_CHECK(error_code);
-}
+    ret_code_t error_code = TwiRecovery_Perform(&SSD1306->Device, write_transfer, 1);
 
-/**
- * @brief
- * @note
- */
-static void ssd1306_WriteCommandSchedule(uint8_t byte)
-{
-    ret_code_t err_code;
-    static uint8_t buffer[2];
-    buffer[0] = 0x00;
-    // buffer[1] = 0x00;
-    buffer[1] = byte;
-    static nrf_twi_mngr_transfer_t const transfers[] =
-        {
-            NRF_TWI_MNGR_WRITE(SSD1306_I2C_ADDR, buffer, 2, NRF_TWI_MNGR_NO_STOP),
-        };
-    static nrf_twi_mngr_transaction_t NRF_TWI_MNGR_BUFFER_LOC_IND transaction =
-        {
-            .p_user_data = NULL,
-            .p_transfers = transfers,
-            .number_of_transfers = sizeof(transfers) / sizeof(transfers[0])};
-    APP_ERROR_CHECK(nrf_twi_mngr_schedule(TWI_manager, &transaction));
+    if (error_code != NRF_SUCCESS)
+    {
+        NRF_LOG_WARNING("ssd1306_WriteCommand - 0x%02x error: %d", byte, (int)error_code);
+    }
+    return error_code;
 }
 
-void ssd1306_WriteData(uint8_t *bufp, size_t buff_size)
+ret_code_t ssd1306_WriteData(uint8_t *bufp, size_t buff_size)
 {
-    ret_code_t err_code;
     uint8_t buffer[1 + buff_size];
     memset(buffer, 0x40, 1);
     memcpy(buffer + 1, bufp, buff_size);
 
     nrf_twi_mngr_transfer_t const write_transfer[] =
         {
-            NRF_TWI_MNGR_WRITE(SSD1306_I2C_ADDR, buffer, buff_size, 0),
+            NRF_TWI_MNGR_WRITE(SSD1306->Address, buffer, buff_size, 0),
         };
-    ret_code_t error_code = nrf_twi_mngr_perform(TWI_manager, NULL, write_transfer, 1, NULL);
-    APP_ERROR_CHECK(error_code);
+    ret_code_t error_code = TwiRecovery_Perform(&SSD1306->Device, write_transfer, 1);
 
+    if (error_code != NRF_SUCCESS)
+    {
+        NRF_LOG_WARNING("ssd1306_WriteData - error: %d", (int)error_code);
+        return error_code;
+    }
     // if (NRF_SUCCESS == err_code)
     //{
     //     err_code = nrf_drv_twi_tx(_ssd1306_m_twi, SSD1306_I2C_ADDR, buffer, buff_size, true);
     // }
     nrf_delay_ms(1);
+    return NRF_SUCCESS;
 }
 
-/**
- * @brief
- * @note
- */
-static void ssd1306_WriteDataSchedule(uint8_t *bufp, size_t buff_size)
+// Init sequence for the configured geometry as one command stream,
+// kept in RAM for EasyDMA
+static uint8_t NRF_TWI_MNGR_BUFFER_LOC_IND SSD1306_InitCommands[] = {0x00, SSD1306_INIT_COMMANDS};
+
+// Mark the columns x1..x2 of the logical rows y1..y2 (clipped, ordered)
+// for the next partial update. Dirty ranges are kept per RAM page.
+static void ssd1306_MarkDirty(int32_t x1, int32_t y1, int32_t x2, int32_t y2)
 {
-    ret_code_t err_code;
-    static uint8_t buffer[1 + SSD1306_WIDTH];
-    memset(buffer, 0x40, 1);
-    memcpy(buffer + 1, bufp, SSD1306_WIDTH);
+    uint8_t page, ram_page;
 
-    static nrf_twi_mngr_transfer_t const transfers[] =
+    for (page = y1 / 8; page <= y2 / 8; page++)
+    {
+        ram_page = (page + SSD1306->StartPage) & SSD1306_PAGE_MASK;
+        if (x1 < SSD1306->DirtyX1[ram_page])
         {
-            NRF_TWI_MNGR_WRITE(SSD1306_I2C_ADDR, buffer, SSD1306_WIDTH + 1, NRF_TWI_MNGR_NO_STOP),
-        };
-    static nrf_twi_mngr_transaction_t NRF_TWI_MNGR_BUFFER_LOC_IND transaction =
+            SSD1306->DirtyX1[ram_page] = x1;
+        }
+        if (x2 > SSD1306->DirtyX2[ram_page])
         {
-            .p_user_data = NULL,
-            .p_transfers = transfers,
-            .number_of_transfers = sizeof(transfers) / sizeof(transfers[0])};
-    APP_ERROR_CHECK(nrf_twi_mngr_schedule(TWI_manager, &transaction));
+            SSD1306->DirtyX2[ram_page] = x2;
+        }
+    }
 }
 
-static uint8_t SSD1306_Buffer[SSD1306_BUFFER_SIZE];
-static SSD1306_t SSD1306;
+// Framebuffer row of a logical page, the display start line selects
+// the RAM page shown at the top
+static inline uint8_t *ssd1306_PageRow(uint8_t page)
+{
+    return &SSD1306->Buffer[((page + SSD1306->StartPage) & SSD1306_PAGE_MASK) * SSD1306_WIDTH];
+}
 
 SSD1306_Error_t ssd1306_FillBuffer(uint8_t *buf, uint32_t len)
 {
     SSD1306_Error_t ret = SSD1306_ERR;
     if (len <= SSD1306_BUFFER_SIZE)
     {
-        memcpy(SSD1306_Buffer, buf, len);
+        memcpy(SSD1306->Buffer, buf, len);
+        ssd1306_MarkDirty(0, 0, SSD1306_WIDTH - 1, SSD1306_HEIGHT - 1);
         ret = SSD1306_OK;
     }
     return ret;
@@ -115,92 +146,35 @@ SSD1306_Error_t ssd1306_FillBuffer(uint8_t *buf, uint32_t len)
 
 void ssd1306_Init(void)
 {
+    ret_code_t err_code;
+    uint32_t uptime_ms = (uint32_t)((uint64_t)app_timer_cnt_get() * 1000 / APP_TIMER_CLOCK_FREQ);
+
     // Reset OLED
     // ssd1306_Reset();
 
-    // Wait for the screen to boot
-    nrf_delay_ms(100);
-
-    // Init OLED
-    ssd1306_SetDisplayOn(0); // display off
-
-    ssd1306_WriteCommand(0x20); // Set Memory Addressing Mode
-    ssd1306_WriteCommand(0x00); // 00b,Horizontal Addressing Mode; 01b,Vertical Addressing Mode;
-                                // 10b,Page Addressing Mode (RESET); 11b,Invalid
-
-    ssd1306_WriteCommand(0xB0); // Set Page Start Address for Page Addressing Mode,0-7
-
-#ifdef SSD1306_MIRROR_VERT
-    ssd1306_WriteCommand(0xC0); // Mirror vertically
-#else
-    ssd1306_WriteCommand(0xC8); // Set COM Output Scan Direction
-#endif
-
-    ssd1306_WriteCommand(0x00); //---set low column address
-    ssd1306_WriteCommand(0x10); //---set high column address
-
-    ssd1306_WriteCommand(0x40); //--set start line address - CHECK
-
-    ssd1306_SetContrast(0xFF);
-
-#ifdef SSD1306_MIRROR_HORIZ
-    ssd1306_WriteCommand(0xA0); // Mirror horizontally
-#else
-    ssd1306_WriteCommand(0xA1); //--set segment re-map 0 to 127 - CHECK
-#endif
-
-#ifdef SSD1306_INVERSE_COLOR
-    ssd1306_WriteCommand(0xA7); //--set inverse color
-#else
-    ssd1306_WriteCommand(0xA6); //--set normal color
-#endif
-
-// Set multiplex ratio.
-#if (SSD1306_HEIGHT == 128)
-    // Found in the Luma Python lib for SH1106.
-    ssd1306_WriteCommand(0xFF);
-#else
-    ssd1306_WriteCommand(0xA8); //--set multiplex ratio(1 to 64) - CHECK
-#endif
-
-#if (SSD1306_HEIGHT == 32)
-    ssd1306_WriteCommand(0x1F); //
-#elif (SSD1306_HEIGHT == 64)
-    ssd1306_WriteCommand(0x3F); //
-#elif (SSD1306_HEIGHT == 128)
-    ssd1306_WriteCommand(0x3F); // Seems to work for 128px high displays too.
-#else
-#error "Only 32, 64, or 128 lines of height are supported!"
-#endif
-
-    ssd1306_WriteCommand(0xA4); // 0xa4,Output follows RAM content;0xa5,Output ignores RAM content
-
-    ssd1306_WriteCommand(0xD3); //-set display offset - CHECK
-    ssd1306_WriteCommand(0x00); //-not offset
-
-    ssd1306_WriteCommand(0xD5); //--set display clock divide ratio/oscillator frequency
-    ssd1306_WriteCommand(0xF0); //--set divide ratio
-
-    ssd1306_WriteCommand(0xD9); //--set pre-charge period
-    ssd1306_WriteCommand(0x22); //
-
-    ssd1306_WriteCommand(0xDA); //--set com pins hardware configuration - CHECK
-#if (SSD1306_HEIGHT == 32)
-    ssd1306_WriteCommand(0x02);
-#elif (SSD1306_HEIGHT == 64)
-    ssd1306_WriteCommand(0x12);
-#elif (SSD1306_HEIGHT == 128)
-    ssd1306_WriteCommand(0x12);
-#else
-#error "Only 32, 64, or 128 lines of height are supported!"
-#endif
+    // Wait for the screen to boot, what is left of it after the rest of the start up
+    if (uptime_ms < SSD1306_BOOT_MS)
+    {
+        nrf_delay_ms(SSD1306_BOOT_MS - uptime_ms);
+    }
 
-    ssd1306_WriteCommand(0xDB); //--set vcomh
-    ssd1306_WriteCommand(0x20); // 0x20,0.77xVcc
+    // Logical page 0 starts at RAM page 0
+    SSD1306->StartPage = 0;
+    SSD1306->StartLinePending = 0;
 
-    ssd1306_WriteCommand(0x8D); //--set DC-DC enable
-    ssd1306_WriteCommand(0x14); //
-    ssd1306_SetDisplayOn(1);    //--turn on SSD1306 panel
+    // Init OLED, display on at the end
+    nrf_twi_mngr_transfer_t const init_transfer[] =
+        {
+            NRF_TWI_MNGR_WRITE(SSD1306->Address, SSD1306_InitCommands, sizeof(SSD1306_InitCommands), 0),
+        };
+    err_code = TwiRecovery_Perform(&SSD1306->Device, init_transfer, 1);
+    if (err_code != NRF_SUCCESS)
+    {
+        // Left uninitialized, the panel stays dark
+        NRF_LOG_WARNING("ssd1306_Init - 0x%02x error: %d", SSD1306->Address, (int)err_code);
+        return;
+    }
+    SSD1306->DisplayOn = 1;
 
     // Clear screen
     ssd1306_Fill(Black);
@@ -209,21 +183,134 @@ void ssd1306_Init(void)
     ssd1306_UpdateScreen();
 
     // Set default values for screen object
-    SSD1306.CurrentX = 0;
-    SSD1306.CurrentY = 0;
-
-    SSD1306.Initialized = 1;
+    SSD1306->CurrentX = 0;
+    SSD1306->CurrentY = 0;
+    SSD1306->ClipDepth = 0;
+    SSD1306->Clip.x1 = 0;
+    SSD1306->Clip.y1 = 0;
+    SSD1306->Clip.x2 = SSD1306_WIDTH - 1;
+    SSD1306->Clip.y2 = SSD1306_HEIGHT - 1;
+
+    SSD1306->Initialized = 1;
 }
 
 void ssd1306_Fill(SSD1306_COLOR color)
 {
     /* Set memory */
-    uint32_t i;
+    memset(SSD1306->Buffer, (color == Black) ? 0x00 : 0xFF, sizeof(SSD1306->Buffer));
+    ssd1306_MarkDirty(0, 0, SSD1306_WIDTH - 1, SSD1306_HEIGHT - 1);
+}
+
+// Transaction callback, the page or command buffer may be reused
+static void ssd1306_TransactionDone(ret_code_t result, void *p_user_data)
+{
+    if (result != NRF_SUCCESS)
+    {
+        NRF_LOG_WARNING("ssd1306_TransactionDone - error: %d", (int)result);
+    }
+    *(volatile uint8_t *)p_user_data = 0;
+}
+
+// Schedule columns x1..x2 of one RAM page. The data is copied, drawing
+// may continue while the transaction is queued. A page that cannot be
+// queued, on a full queue or a quarantined panel, is free again.
+static ret_code_t ssd1306_SchedulePage(SSD1306_t *display, uint8_t page, uint8_t x1, uint8_t x2)
+{
+    SSD1306_PAGE_TX *tx = &display->PageTx[page];
+    uint8_t column = x1 + SSD1306_X_OFFSET;
+    uint8_t length = x2 - x1 + 1;
+    ret_code_t err_code;
+
+    tx->Command[0] = 0x00;                           // Command stream
+    tx->Command[1] = 0xB0 + page;                    // Set the current RAM page address.
+    tx->Command[2] = 0x00 + (column & 0x0F);         // Lower column start address
+    tx->Command[3] = 0x10 + ((column >> 4) & 0x0F); // Higher column start address
+    tx->Data[0] = 0x40;                              // Data stream
+    memcpy(&tx->Data[1], &display->Buffer[SSD1306_WIDTH * page + x1], length);
+
+    tx->Transfers[0] = (nrf_twi_mngr_transfer_t)NRF_TWI_MNGR_WRITE(display->Address, tx->Command, sizeof(tx->Command), 0);
+    tx->Transfers[1] = (nrf_twi_mngr_transfer_t)NRF_TWI_MNGR_WRITE(display->Address, tx->Data, length + 1, 0);
+    tx->Transaction.callback = ssd1306_TransactionDone;
+    tx->Transaction.p_user_data = (void *)&tx->Busy;
+    tx->Transaction.p_transfers = tx->Transfers;
+    tx->Transaction.number_of_transfers = 2;
+    tx->Busy = 1;
+    err_code = TwiRecovery_Schedule(&display->Device, &tx->Retry, &tx->Transaction);
+    if (err_code != NRF_SUCCESS)
+    {
+        tx->Busy = 0;
+    }
+    return err_code;
+}
+
+// Schedule the display start line command after a ring scroll
+static ret_code_t ssd1306_ScheduleStartLine(SSD1306_t *display)
+{
+    SSD1306_CMD_TX *tx = &display->StartLineTx;
+    ret_code_t err_code;
 
-    for (i = 0; i < sizeof(SSD1306_Buffer); i++)
+    tx->Command[0] = 0x00;
+    tx->Command[1] = 0x40 | ((display->StartPage * 8) & 0x3F); // Set display start line
+    tx->Transfers[0] = (nrf_twi_mngr_transfer_t)NRF_TWI_MNGR_WRITE(display->Address, tx->Command, sizeof(tx->Command), 0);
+    tx->Transaction.callback = ssd1306_TransactionDone;
+    tx->Transaction.p_user_data = (void *)&tx->Busy;
+    tx->Transaction.p_transfers = tx->Transfers;
+    tx->Transaction.number_of_transfers = 1;
+    tx->Busy = 1;
+    err_code = TwiRecovery_Schedule(&display->Device, &tx->Retry, &tx->Transaction);
+    if (err_code != NRF_SUCCESS)
     {
-        SSD1306_Buffer[i] = (color == Black) ? 0x00 : 0xFF;
+        tx->Busy = 0;
     }
+    return err_code;
+}
+
+// Schedule the dirty columns of one RAM page, unless the page is still
+// on its way or cannot be queued: then it stays dirty until the next update
+static void ssd1306_FlushPage(SSD1306_t *display, uint8_t page)
+{
+    if (display->DirtyX1[page] > display->DirtyX2[page] || display->PageTx[page].Busy)
+    {
+        return;
+    }
+    if (ssd1306_SchedulePage(display, page, display->DirtyX1[page], display->DirtyX2[page]) != NRF_SUCCESS)
+    {
+        return;
+    }
+    display->DirtyX1[page] = SSD1306_WIDTH;
+    display->DirtyX2[page] = 0;
+}
+
+void ssd1306_UpdateDisplays(SSD1306_t *const *displays, uint8_t count)
+{
+    uint8_t i, page;
+
+    for (i = 0; i < count; i++)
+    {
+        if (displays[i]->DisplayOn && displays[i]->StartLinePending && !displays[i]->StartLineTx.Busy)
+        {
+            displays[i]->StartLinePending = (ssd1306_ScheduleStartLine(displays[i]) != NRF_SUCCESS);
+        }
+    }
+
+    // Round robin over the displays page by page, so panels sharing a bus
+    // all make progress instead of queueing behind each other
+    for (page = 0; page < SSD1306_PAGES; page++)
+    {
+        for (i = 0; i < count; i++)
+        {
+            // A panel that is off keeps its changes dirty until it is on again
+            if (displays[i]->DisplayOn)
+            {
+                ssd1306_FlushPage(displays[i], page);
+            }
+        }
+    }
+}
+
+void ssd1306_UpdateScreenPartial(void)
+{
+    ssd1306_UpdateDisplays(&SSD1306, 1);
 }
 
 void ssd1306_UpdateScreen(void)
@@ -234,77 +321,260 @@ void ssd1306_UpdateScreen(void)
     //  * 32px   ==  4 pages
     //  * 64px   ==  8 pages
     //  * 128px  ==  16 pages
-    for (uint8_t i = 0; i < SSD1306_HEIGHT / 8; i++)
+    ssd1306_MarkDirty(0, 0, SSD1306_WIDTH - 1, SSD1306_HEIGHT - 1);
+    ssd1306_UpdateScreenPartial();
+}
+
+// Draw one pixel without any bounds check.
+// Callers clip against SSD1306->Clip and mark the touched area dirty,
+// so y is not negative and the page and bit are plain shifts.
+static inline void ssd1306_PutPixel(int32_t x, int32_t y, SSD1306_COLOR color)
+{
+    uint32_t row = (uint32_t)y;
+
+    if (color == White)
+    {
+        ssd1306_PageRow(row / 8)[x] |= 1 << (row % 8);
+    }
+    else
     {
-        ssd1306_WriteCommand(0xB0 + i); // Set the current RAM page address.
-        ssd1306_WriteCommandSchedule(0x00 + SSD1306_X_OFFSET_LOWER);
-        ssd1306_WriteCommandSchedule(0x10 + SSD1306_X_OFFSET_UPPER);
-        ssd1306_WriteDataSchedule(&SSD1306_Buffer[SSD1306_WIDTH * i], SSD1306_WIDTH);
+        ssd1306_PageRow(row / 8)[x] &= ~(1 << (row % 8));
     }
 }
 
+// Check a point against the current clip rectangle
+static inline uint8_t ssd1306_IsClipped(int32_t x, int32_t y)
+{
+    return (x < SSD1306->Clip.x1 || x > SSD1306->Clip.x2 || y < SSD1306->Clip.y1 || y > SSD1306->Clip.y2);
+}
+
 //    Draw one pixel in the screenbuffer
 //    X => X Coordinate
 //    Y => Y Coordinate
 //    color => Pixel color
-void ssd1306_DrawPixel(uint8_t x, uint8_t y, SSD1306_COLOR color)
+void ssd1306_DrawPixel(int16_t x, int16_t y, SSD1306_COLOR color)
 {
-    if (x >= SSD1306_WIDTH || y >= SSD1306_HEIGHT)
+    if (ssd1306_IsClipped(x, y))
     {
-        // Don't write outside the buffer
+        // Don't write outside the clip rectangle
         return;
     }
 
-    // Draw in the right color
+    ssd1306_PutPixel(x, y, color);
+    ssd1306_MarkDirty(x, y, x, y);
+}
+
+/**
+ * @brief Restricts drawing to a rectangle inside the current clip rectangle.
+ * @param x1, y1, x2, y2 Corners of the rectangle, inclusive, in any order.
+ * @return SSD1306_ERR if SSD1306_CLIP_STACK_DEPTH rectangles are already pushed.
+ */
+SSD1306_Error_t ssd1306_PushClipRect(int16_t x1, int16_t y1, int16_t x2, int16_t y2)
+{
+    SSD1306_RECT *clip = &SSD1306->Clip;
+
+    if (SSD1306->ClipDepth >= SSD1306_CLIP_STACK_DEPTH)
+    {
+        return SSD1306_ERR;
+    }
+    SSD1306->ClipStack[SSD1306->ClipDepth++] = *clip;
+
+    // Intersect with the current clip, an empty result rejects everything
+    clip->x1 = MAX(clip->x1, MIN(x1, x2));
+    clip->y1 = MAX(clip->y1, MIN(y1, y2));
+    clip->x2 = MIN(clip->x2, MAX(x1, x2));
+    clip->y2 = MIN(clip->y2, MAX(y1, y2));
+    return SSD1306_OK;
+}
+
+/**
+ * @brief Restores the clip rectangle that was active before the last ssd1306_PushClipRect.
+ */
+void ssd1306_PopClipRect(void)
+{
+    if (SSD1306->ClipDepth > 0)
+    {
+        SSD1306->Clip = SSD1306->ClipStack[--SSD1306->ClipDepth];
+    }
+}
+
+// Fill columns x1..x2 (inclusive) of one logical page with a row mask.
+// This is the byte-wise kernel behind all filled shapes: one byte per column.
+static void ssd1306_FillPageSpan(int32_t x1, int32_t x2, uint8_t page, uint8_t mask, SSD1306_COLOR color)
+{
+    uint8_t *p = &ssd1306_PageRow(page)[x1];
+    uint8_t *end = p + (x2 - x1) + 1;
+
+    ssd1306_MarkDirty(x1, page * 8, x2, page * 8);
+
     if (color == White)
     {
-        SSD1306_Buffer[x + (y / 8) * SSD1306_WIDTH] |= 1 << (y % 8);
+        while (p < end)
+        {
+            *p++ |= mask;
+        }
     }
     else
     {
-        SSD1306_Buffer[x + (y / 8) * SSD1306_WIDTH] &= ~(1 << (y % 8));
+        mask = ~mask;
+        while (p < end)
+        {
+            *p++ &= mask;
+        }
     }
 }
 
+// Fill a horizontal span x1..x2 (inclusive) of row y, clipped once
+static void ssd1306_FillSpan(int32_t x1, int32_t x2, int32_t y, SSD1306_COLOR color)
+{
+    if (y < SSD1306->Clip.y1 || y > SSD1306->Clip.y2)
+    {
+        return;
+    }
+    if (x1 < SSD1306->Clip.x1)
+    {
+        x1 = SSD1306->Clip.x1;
+    }
+    if (x2 > SSD1306->Clip.x2)
+    {
+        x2 = SSD1306->Clip.x2;
+    }
+    if (x1 > x2)
+    {
+        return;
+    }
+    ssd1306_FillPageSpan(x1, x2, y / 8, 1 << (y % 8), color);
+}
+
+// Fill the block x1..x2, y1..y2 (inclusive, ordered), clipped once.
+// Rows sharing a page are filled with one mask per column.
+static void ssd1306_FillBlock(int32_t x1, int32_t y1, int32_t x2, int32_t y2, SSD1306_COLOR color)
+{
+    uint8_t page;
+    uint8_t mask;
+
+    x1 = MAX(x1, SSD1306->Clip.x1);
+    y1 = MAX(y1, SSD1306->Clip.y1);
+    x2 = MIN(x2, SSD1306->Clip.x2);
+    y2 = MIN(y2, SSD1306->Clip.y2);
+    if (x1 > x2 || y1 > y2)
+    {
+        return;
+    }
+
+    for (page = y1 / 8; page <= y2 / 8; page++)
+    {
+        mask = 0xFF;
+        if (page == y1 / 8)
+        {
+            mask &= 0xFF << (y1 % 8);
+        }
+        if (page == y2 / 8)
+        {
+            mask &= 0xFF >> (7 - y2 % 8);
+        }
+        ssd1306_FillPageSpan(x1, x2, page, mask, color);
+    }
+}
+
+// Fill a circle stretched to a rounded box: the quarter circles of radius par_r
+// are centred on (left, top), (right, top), (left, bottom) and (right, bottom).
+// Half-widths per row come from the same Bresenham walk as ssd1306_DrawCircle.
+static void ssd1306_FillRoundedSpans(int32_t left, int32_t top, int32_t right, int32_t bottom, uint8_t par_r, SSD1306_COLOR color)
+{
+    int32_t x = -par_r;
+    int32_t y = 0;
+    int32_t err = 2 - 2 * par_r;
+    int32_t e2;
+    int32_t last_y = -1;
+
+    do
+    {
+        // The first step on a row has the widest extent of that row
+        if (y != last_y)
+        {
+            if (y == 0)
+            {
+                ssd1306_FillBlock(left + x, top, right - x, bottom, color);
+            }
+            else
+            {
+                ssd1306_FillSpan(left + x, right - x, top - y, color);
+                ssd1306_FillSpan(left + x, right - x, bottom + y, color);
+            }
+            last_y = y;
+        }
+
+        e2 = err;
+        if (e2 <= y)
+        {
+            y++;
+            err = err + (y * 2 + 1);
+            if (-x == y && e2 <= x)
+            {
+                e2 = 0;
+            }
+        }
+        if (e2 > x)
+        {
+            x++;
+            err = err + (x * 2 + 1);
+        }
+    } while (x <= 0);
+}
+
 // Draw 1 char to the screen buffer
 // ch       => char om weg te schrijven
 // Font     => Font waarmee we gaan schrijven
 // color    => Black or White
 char ssd1306_WriteChar(char ch, FontDef Font, SSD1306_COLOR color)
 {
-    uint32_t i, b, j;
+    int32_t i, j;
+    int32_t i_start, i_end, j_start, j_end;
+    uint32_t b;
 
     // Check if character is valid
     if (ch < 32 || ch > 126)
         return 0;
 
     // Check remaining space on current line
-    if (SSD1306_WIDTH < (SSD1306.CurrentX + Font.FontWidth) ||
-        SSD1306_HEIGHT < (SSD1306.CurrentY + Font.FontHeight))
+    if (SSD1306_WIDTH < (SSD1306->CurrentX + Font.FontWidth) ||
+        SSD1306_HEIGHT < (SSD1306->CurrentY + Font.FontHeight))
     {
         // Not enough space on current line
         return 0;
     }
 
+    // Clip the glyph cell once, then draw its visible part unchecked
+    i_start = MAX(0, SSD1306->Clip.y1 - SSD1306->CurrentY);
+    i_end = MIN(Font.FontHeight, SSD1306->Clip.y2 - SSD1306->CurrentY + 1);
+    j_start = MAX(0, SSD1306->Clip.x1 - SSD1306->CurrentX);
+    j_end = MIN(Font.FontWidth, SSD1306->Clip.x2 - SSD1306->CurrentX + 1);
+
     // Use the font to write
-    for (i = 0; i < Font.FontHeight; i++)
+    for (i = i_start; i < i_end; i++)
     {
         b = Font.data[(ch - 32) * Font.FontHeight + i];
-        for (j = 0; j < Font.FontWidth; j++)
+        for (j = j_start; j < j_end; j++)
         {
             if ((b << j) & 0x8000)
             {
-                ssd1306_DrawPixel(SSD1306.CurrentX + j, (SSD1306.CurrentY + i), (SSD1306_COLOR)color);
+                ssd1306_PutPixel(SSD1306->CurrentX + j, (SSD1306->CurrentY + i), (SSD1306_COLOR)color);
             }
             else
             {
-                ssd1306_DrawPixel(SSD1306.CurrentX + j, (SSD1306.CurrentY + i), (SSD1306_COLOR)!color);
+                ssd1306_PutPixel(SSD1306->CurrentX + j, (SSD1306->CurrentY + i), (SSD1306_COLOR)!color);
             }
         }
     }
+    if (i_start < i_end && j_start < j_end)
+    {
+        ssd1306_MarkDirty(SSD1306->CurrentX + j_start, SSD1306->CurrentY + i_start,
+                          SSD1306->CurrentX + j_end - 1, SSD1306->CurrentY + i_end - 1);
+    }
 
     // The current space is now taken
-    SSD1306.CurrentX += Font.FontWidth;
+    SSD1306->CurrentX += Font.FontWidth;
 
     // Return written char for validation
     return ch;
@@ -331,31 +601,150 @@ char ssd1306_WriteString(char *str, FontDef Font, SSD1306_COLOR color)
 }
 
 // Position the cursor
-void ssd1306_SetCursor(uint8_t x, uint8_t y)
+void ssd1306_SetCursor(int16_t x, int16_t y)
 {
-    SSD1306.CurrentX = x;
-    SSD1306.CurrentY = y;
+    SSD1306->CurrentX = x;
+    SSD1306->CurrentY = y;
 }
 
-// Draw line by Bresenhem's algorithm
-void ssd1306_Line(uint8_t x1, uint8_t y1, uint8_t x2, uint8_t y2, SSD1306_COLOR color)
+// Cohen-Sutherland outcodes against the clip rectangle
+#define SSD1306_OUT_LEFT 0x01
+#define SSD1306_OUT_RIGHT 0x02
+#define SSD1306_OUT_TOP 0x04
+#define SSD1306_OUT_BOTTOM 0x08
+
+static uint8_t ssd1306_OutCode(int32_t x, int32_t y)
+{
+    uint8_t code = 0;
+
+    if (x < SSD1306->Clip.x1)
+    {
+        code |= SSD1306_OUT_LEFT;
+    }
+    else if (x > SSD1306->Clip.x2)
+    {
+        code |= SSD1306_OUT_RIGHT;
+    }
+    if (y < SSD1306->Clip.y1)
+    {
+        code |= SSD1306_OUT_TOP;
+    }
+    else if (y > SSD1306->Clip.y2)
+    {
+        code |= SSD1306_OUT_BOTTOM;
+    }
+    return code;
+}
+
+// Number of minor axis steps the Bresenham walk below has taken after
+// par_k major axis steps, for a line of par_n major and par_m minor steps
+static int32_t ssd1306_MinorSteps(int32_t par_k, int32_t par_n, int32_t par_m)
+{
+    return (int32_t)((2 * (int64_t)par_m * par_k + par_n - 1) / (2 * (int64_t)par_n));
+}
+
+// Range of major axis steps [*par_first, *par_last] whose pixels lie inside
+// the clip rectangle. Returns 0 if there are none.
+static uint8_t ssd1306_ClipSteps(int32_t x1, int32_t y1, int32_t deltaX, int32_t deltaY, int32_t signX, int32_t signY,
+                                 int32_t *par_first, int32_t *par_last)
+{
+    const uint8_t x_major = (deltaX >= deltaY);
+    int32_t n = x_major ? deltaX : deltaY;
+    int32_t m = x_major ? deltaY : deltaX;
+    int32_t major = x_major ? x1 : y1;
+    int32_t minor = x_major ? y1 : x1;
+    int32_t major_sign = x_major ? signX : signY;
+    int32_t minor_sign = x_major ? signY : signX;
+    int32_t major_lo = x_major ? SSD1306->Clip.x1 : SSD1306->Clip.y1;
+    int32_t major_hi = x_major ? SSD1306->Clip.x2 : SSD1306->Clip.y2;
+    int32_t minor_lo = x_major ? SSD1306->Clip.y1 : SSD1306->Clip.x1;
+    int32_t minor_hi = x_major ? SSD1306->Clip.y2 : SSD1306->Clip.x2;
+    int32_t first, last, j_first, j_last;
+
+    // Steps whose major coordinate is inside
+    first = (major_sign > 0) ? major_lo - major : major - major_hi;
+    last = (major_sign > 0) ? major_hi - major : major - major_lo;
+
+    // Steps whose minor coordinate is inside, the minor walk is monotonic
+    j_first = (minor_sign > 0) ? minor_lo - minor : minor - minor_hi;
+    j_last = (minor_sign > 0) ? minor_hi - minor : minor - minor_lo;
+    if (j_last < 0 || j_first > m)
+    {
+        return 0;
+    }
+    if (m != 0)
+    {
+        if (j_first > 0)
+        {
+            first = MAX(first, (int32_t)((2 * (int64_t)n * j_first - n + 2 * m) / (2 * (int64_t)m)));
+        }
+        last = MIN(last, (int32_t)((2 * (int64_t)n * j_last + n) / (2 * (int64_t)m)));
+    }
+
+    *par_first = MAX(first, 0);
+    *par_last = MIN(last, n);
+    return (*par_first <= *par_last);
+}
+
+// Draw line by Bresenhem's algorithm.
+// Lines on one side of the clip rectangle are rejected by their Cohen-Sutherland
+// outcodes, lines fully inside are drawn unchecked. Other lines are clipped
+// once in Bresenham step space, so the visible pixels are exactly those of the
+// unclipped line.
+void ssd1306_Line(int16_t x1, int16_t y1, int16_t x2, int16_t y2, SSD1306_COLOR color)
 {
     int32_t deltaX = abs(x2 - x1);
     int32_t deltaY = abs(y2 - y1);
     int32_t signX = ((x1 < x2) ? 1 : -1);
     int32_t signY = ((y1 < y2) ? 1 : -1);
-    int32_t error = deltaX - deltaY;
+    int32_t error;
     int32_t error2;
+    int32_t first = 0;
+    int32_t last = MAX(deltaX, deltaY);
+    int32_t steps_x, steps_y;
+    int32_t x, y;
+    int32_t x_first, y_first;
+    uint8_t code1 = ssd1306_OutCode(x1, y1);
+    uint8_t code2 = ssd1306_OutCode(x2, y2);
+
+    if (code1 & code2)
+    {
+        return;
+    }
+    if ((code1 | code2) && !ssd1306_ClipSteps(x1, y1, deltaX, deltaY, signX, signY, &first, &last))
+    {
+        return;
+    }
+
+    // Walk state after the invisible leading steps
+    if (deltaX >= deltaY)
+    {
+        steps_x = first;
+        steps_y = (deltaX != 0) ? ssd1306_MinorSteps(first, deltaX, deltaY) : 0;
+    }
+    else
+    {
+        steps_y = first;
+        steps_x = ssd1306_MinorSteps(first, deltaY, deltaX);
+    }
+    x = x1 + signX * steps_x;
+    y = y1 + signY * steps_y;
+    error = deltaX * (1 + steps_y) - deltaY * (1 + steps_x);
+    x_first = x;
+    y_first = y;
 
-    ssd1306_DrawPixel(x2, y2, color);
-    while ((x1 != x2) || (y1 != y2))
+    while (1)
     {
-        ssd1306_DrawPixel(x1, y1, color);
+        ssd1306_PutPixel(x, y, color);
+        if (first++ == last)
+        {
+            break;
+        }
         error2 = error * 2;
         if (error2 > -deltaY)
         {
             error -= deltaY;
-            x1 += signX;
+            x += signX;
         }
         else
         {
@@ -365,13 +754,14 @@ void ssd1306_Line(uint8_t x1, uint8_t y1, uint8_t x2, uint8_t y2, SSD1306_COLOR
         if (error2 < deltaX)
         {
             error += deltaX;
-            y1 += signY;
+            y += signY;
         }
         else
         {
             /*nothing to do*/
         }
     }
+    ssd1306_MarkDirty(MIN(x_first, x), MIN(y_first, y), MAX(x_first, x), MAX(y_first, y));
     return;
 }
 // Draw polyline
@@ -391,11 +781,153 @@ void ssd1306_Polyline(const SSD1306_VERTEX *par_vertex, uint16_t par_size, SSD13
     }
     return;
 }
-/*Convert Degrees to Radians*/
-static float ssd1306_DegToRad(float par_deg)
+// Draw filled polygon. Rows are scanned with the even-odd rule, each pair of
+// edge crossings is filled as one span, then the outline is drawn so that the
+// result covers the same pixels as ssd1306_Polyline of the closed polygon
+void ssd1306_FillPolygon(const SSD1306_VERTEX *par_vertex, uint16_t par_size, SSD1306_COLOR color)
 {
-    return par_deg * 3.14 / 180.0;
+    int32_t crossing[SSD1306_POLYGON_MAX_VERTICES];
+    int32_t y_min, y_max;
+    int32_t x0, y0, x1, y1;
+    int32_t y, t;
+    int64_t n;
+    uint16_t i, j, count;
+
+    if (par_vertex == 0 || par_size < 3 || par_size > SSD1306_POLYGON_MAX_VERTICES)
+    {
+        return;
+    }
+
+    y_min = y_max = par_vertex[0].y;
+    for (i = 1; i < par_size; i++)
+    {
+        if (par_vertex[i].y < y_min)
+        {
+            y_min = par_vertex[i].y;
+        }
+        if (par_vertex[i].y > y_max)
+        {
+            y_max = par_vertex[i].y;
+        }
+    }
+    y_min = MAX(y_min, SSD1306->Clip.y1);
+    y_max = MIN(y_max, SSD1306->Clip.y2);
+
+    for (y = y_min; y <= y_max; y++)
+    {
+        // Collect crossings of the row with every non-horizontal edge,
+        // half-open in y so shared vertices are counted once
+        count = 0;
+        for (i = 0; i < par_size; i++)
+        {
+            j = (i + 1 < par_size) ? i + 1 : 0;
+            if (par_vertex[i].y < par_vertex[j].y)
+            {
+                x0 = par_vertex[i].x;
+                y0 = par_vertex[i].y;
+                x1 = par_vertex[j].x;
+                y1 = par_vertex[j].y;
+            }
+            else
+            {
+                x0 = par_vertex[j].x;
+                y0 = par_vertex[j].y;
+                x1 = par_vertex[i].x;
+                y1 = par_vertex[i].y;
+            }
+            if (y0 <= y && y < y1)
+            {
+                // x0 + (y - y0) * dx / dy rounded to nearest, dy > 0.
+                // 64 bits: dy and dx span up to 65535 between int16_t vertices
+                n = 2 * (int64_t)(y - y0) * (x1 - x0) + (y1 - y0);
+                n = (n >= 0) ? n / (2 * (y1 - y0)) : -((2 * (y1 - y0) - 1 - n) / (2 * (y1 - y0)));
+                crossing[count++] = x0 + (int32_t)n;
+            }
+        }
+
+        // Insertion sort, count is bounded by the vertex count
+        for (i = 1; i < count; i++)
+        {
+            t = crossing[i];
+            for (j = i; j > 0 && crossing[j - 1] > t; j--)
+            {
+                crossing[j] = crossing[j - 1];
+            }
+            crossing[j] = t;
+        }
+
+        for (i = 0; i + 1 < count; i += 2)
+        {
+            ssd1306_FillSpan(crossing[i], crossing[i + 1], y, color);
+        }
+    }
+
+    ssd1306_Polyline(par_vertex, par_size, color);
+    ssd1306_Line(par_vertex[par_size - 1].x, par_vertex[par_size - 1].y, par_vertex[0].x, par_vertex[0].y, color);
+    return;
+}
+
+// Draw filled triangle
+void ssd1306_FillTriangle(int16_t x1, int16_t y1, int16_t x2, int16_t y2, int16_t x3, int16_t y3, SSD1306_COLOR color)
+{
+    const SSD1306_VERTEX loc_vertex[] =
+        {
+            {x1, y1},
+            {x2, y2},
+            {x3, y3}};
+
+    ssd1306_FillPolygon(loc_vertex, sizeof(loc_vertex) / sizeof(loc_vertex[0]), color);
+    return;
 }
+
+/*Quarter-wave sine table: sin(0..90 degree) in Q15, 32768 == 1.0*/
+#define SSD1306_SIN_ONE 32768
+static const uint16_t ssd1306_SinTable[91] =
+    {
+        0, 572, 1144, 1715, 2286, 2856, 3425, 3993, 4560, 5126,
+        5690, 6252, 6813, 7371, 7927, 8481, 9032, 9580, 10126, 10668,
+        11207, 11743, 12275, 12803, 13328, 13848, 14365, 14876, 15384, 15886,
+        16384, 16877, 17364, 17847, 18324, 18795, 19261, 19720, 20174, 20622,
+        21063, 21498, 21926, 22348, 22763, 23170, 23571, 23965, 24351, 24730,
+        25102, 25466, 25822, 26170, 26510, 26842, 27166, 27482, 27789, 28088,
+        28378, 28660, 28932, 29197, 29452, 29698, 29935, 30163, 30382, 30592,
+        30792, 30983, 31164, 31336, 31499, 31651, 31795, 31928, 32052, 32166,
+        32270, 32365, 32449, 32524, 32588, 32643, 32688, 32723, 32748, 32763,
+        32768};
+
+/*Sine of an integer angle in degree, Q15*/
+static int32_t ssd1306_Sin(uint32_t par_deg)
+{
+    par_deg %= 360;
+    if (par_deg <= 90)
+    {
+        return ssd1306_SinTable[par_deg];
+    }
+    else if (par_deg <= 180)
+    {
+        return ssd1306_SinTable[180 - par_deg];
+    }
+    else if (par_deg <= 270)
+    {
+        return -(int32_t)ssd1306_SinTable[par_deg - 180];
+    }
+    return -(int32_t)ssd1306_SinTable[360 - par_deg];
+}
+
+/*Cosine of an integer angle in degree, Q15*/
+static int32_t ssd1306_Cos(uint32_t par_deg)
+{
+    return ssd1306_Sin(par_deg + 90);
+}
+
+/*Point on the circle (x, y, radius) at angle par_deg, counted like in ssd1306_DrawArc*/
+static void ssd1306_ArcPoint(int16_t x, int16_t y, uint8_t radius, uint32_t par_deg, int16_t *par_px, int16_t *par_py)
+{
+    // Division truncates toward zero, like the former (int8_t) cast of the float product
+    *par_px = x + (ssd1306_Sin(par_deg) * radius) / SSD1306_SIN_ONE;
+    *par_py = y + (ssd1306_Cos(par_deg) * radius) / SSD1306_SIN_ONE;
+}
+
 /*Normalize degree to [0;360]*/
 static uint16_t ssd1306_NormalizeTo0_360(uint16_t par_deg)
 {
@@ -407,46 +939,39 @@ static uint16_t ssd1306_NormalizeTo0_360(uint16_t par_deg)
     else
     {
         loc_angle = par_deg % 360;
-        loc_angle = ((par_deg != 0) ? par_deg : 360);
+        loc_angle = ((loc_angle != 0) ? loc_angle : 360);
     }
     return loc_angle;
 }
 /*DrawArc. Draw angle is beginning from 4 quart of trigonometric circle (3pi/2)
  * start_angle in degree
  * sweep in degree
+ * A full turn starting at 0 is drawn with the midpoint circle, without trigonometry.
  */
-void ssd1306_DrawArc(uint8_t x, uint8_t y, uint8_t radius, uint16_t start_angle, uint16_t sweep, SSD1306_COLOR color)
+void ssd1306_DrawArc(int16_t x, int16_t y, uint8_t radius, uint16_t start_angle, uint16_t sweep, SSD1306_COLOR color)
 {
     static const uint8_t CIRCLE_APPROXIMATION_SEGMENTS = 36;
-    float approx_degree;
     uint32_t approx_segments;
-    uint8_t xp1, xp2;
-    uint8_t yp1, yp2;
+    int16_t xp1, xp2;
+    int16_t yp1, yp2;
     uint32_t count = 0;
     uint32_t loc_sweep = 0;
-    float rad;
 
     loc_sweep = ssd1306_NormalizeTo0_360(sweep);
 
     count = (ssd1306_NormalizeTo0_360(start_angle) * CIRCLE_APPROXIMATION_SEGMENTS) / 360;
     approx_segments = (loc_sweep * CIRCLE_APPROXIMATION_SEGMENTS) / 360;
-    approx_degree = loc_sweep / (float)approx_segments;
+    if (count == 0 && loc_sweep == 360)
+    {
+        ssd1306_DrawCircle(x, y, radius, color);
+        return;
+    }
+
     while (count < approx_segments)
     {
-        rad = ssd1306_DegToRad(count * approx_degree);
-        xp1 = x + (int8_t)(sin(rad) * radius);
-        yp1 = y + (int8_t)(cos(rad) * radius);
+        ssd1306_ArcPoint(x, y, radius, (count * loc_sweep) / approx_segments, &xp1, &yp1);
         count++;
-        if (count != approx_segments)
-        {
-            rad = ssd1306_DegToRad(count * approx_degree);
-        }
-        else
-        {
-            rad = ssd1306_DegToRad(loc_sweep);
-        }
-        xp2 = x + (int8_t)(sin(rad) * radius);
-        yp2 = y + (int8_t)(cos(rad) * radius);
+        ssd1306_ArcPoint(x, y, radius, (count * loc_sweep) / approx_segments, &xp2, &yp2);
         ssd1306_Line(xp1, yp1, xp2, yp2, color);
     }
 
@@ -459,44 +984,34 @@ void ssd1306_DrawArc(uint8_t x, uint8_t y, uint8_t radius, uint16_t start_angle,
  * start_angle: start angle in degree
  * sweep: finish angle in degree
  */
-void ssd1306_DrawArcWithRadiusLine(uint8_t x, uint8_t y, uint8_t radius, uint16_t start_angle, uint16_t sweep, SSD1306_COLOR color)
+void ssd1306_DrawArcWithRadiusLine(int16_t x, int16_t y, uint8_t radius, uint16_t start_angle, uint16_t sweep, SSD1306_COLOR color)
 {
     static const uint8_t CIRCLE_APPROXIMATION_SEGMENTS = 36;
-    float approx_degree;
     uint32_t approx_segments;
-    uint8_t xp1 = 0;
-    uint8_t xp2 = 0;
-    uint8_t yp1 = 0;
-    uint8_t yp2 = 0;
+    int16_t xp1 = 0;
+    int16_t xp2 = 0;
+    int16_t yp1 = 0;
+    int16_t yp2 = 0;
     uint32_t count = 0;
     uint32_t loc_sweep = 0;
-    float rad;
+    int16_t first_point_x;
+    int16_t first_point_y;
 
     loc_sweep = ssd1306_NormalizeTo0_360(sweep);
 
     count = (ssd1306_NormalizeTo0_360(start_angle) * CIRCLE_APPROXIMATION_SEGMENTS) / 360;
     approx_segments = (loc_sweep * CIRCLE_APPROXIMATION_SEGMENTS) / 360;
-    approx_degree = loc_sweep / (float)approx_segments;
+    if (approx_segments == 0)
+    {
+        return;
+    }
 
-    rad = ssd1306_DegToRad(count * approx_degree);
-    uint8_t first_point_x = x + (int8_t)(sin(rad) * radius);
-    uint8_t first_point_y = y + (int8_t)(cos(rad) * radius);
+    ssd1306_ArcPoint(x, y, radius, (count * loc_sweep) / approx_segments, &first_point_x, &first_point_y);
     while (count < approx_segments)
     {
-        rad = ssd1306_DegToRad(count * approx_degree);
-        xp1 = x + (int8_t)(sin(rad) * radius);
-        yp1 = y + (int8_t)(cos(rad) * radius);
+        ssd1306_ArcPoint(x, y, radius, (count * loc_sweep) / approx_segments, &xp1, &yp1);
         count++;
-        if (count != approx_segments)
-        {
-            rad = ssd1306_DegToRad(count * approx_degree);
-        }
-        else
-        {
-            rad = ssd1306_DegToRad(loc_sweep);
-        }
-        xp2 = x + (int8_t)(sin(rad) * radius);
-        yp2 = y + (int8_t)(cos(rad) * radius);
+        ssd1306_ArcPoint(x, y, radius, (count * loc_sweep) / approx_segments, &xp2, &yp2);
         ssd1306_Line(xp1, yp1, xp2, yp2, color);
     }
 
@@ -506,25 +1021,45 @@ void ssd1306_DrawArcWithRadiusLine(uint8_t x, uint8_t y, uint8_t radius, uint16_
     return;
 }
 
-// Draw circle by Bresenhem's algorithm
-void ssd1306_DrawCircle(uint8_t par_x, uint8_t par_y, uint8_t par_r, SSD1306_COLOR par_color)
+// Draw circle by Bresenhem's algorithm.
+// The bounding box is clipped once: circles fully inside the clip rectangle
+// are drawn unchecked, circles fully outside are skipped.
+void ssd1306_DrawCircle(int16_t par_x, int16_t par_y, uint8_t par_r, SSD1306_COLOR par_color)
 {
     int32_t x = -par_r;
     int32_t y = 0;
     int32_t err = 2 - 2 * par_r;
     int32_t e2;
+    uint8_t inside;
 
-    if (par_x >= SSD1306_WIDTH || par_y >= SSD1306_HEIGHT)
+    if (par_x + par_r < SSD1306->Clip.x1 || par_x - par_r > SSD1306->Clip.x2 ||
+        par_y + par_r < SSD1306->Clip.y1 || par_y - par_r > SSD1306->Clip.y2)
     {
         return;
     }
+    inside = (par_x - par_r >= SSD1306->Clip.x1 && par_x + par_r <= SSD1306->Clip.x2 &&
+              par_y - par_r >= SSD1306->Clip.y1 && par_y + par_r <= SSD1306->Clip.y2);
+    if (inside)
+    {
+        ssd1306_MarkDirty(par_x - par_r, par_y - par_r, par_x + par_r, par_y + par_r);
+    }
 
     do
     {
-        ssd1306_DrawPixel(par_x - x, par_y + y, par_color);
-        ssd1306_DrawPixel(par_x + x, par_y + y, par_color);
-        ssd1306_DrawPixel(par_x + x, par_y - y, par_color);
-        ssd1306_DrawPixel(par_x - x, par_y - y, par_color);
+        if (inside)
+        {
+            ssd1306_PutPixel(par_x - x, par_y + y, par_color);
+            ssd1306_PutPixel(par_x + x, par_y + y, par_color);
+            ssd1306_PutPixel(par_x + x, par_y - y, par_color);
+            ssd1306_PutPixel(par_x - x, par_y - y, par_color);
+        }
+        else
+        {
+            ssd1306_DrawPixel(par_x - x, par_y + y, par_color);
+            ssd1306_DrawPixel(par_x + x, par_y + y, par_color);
+            ssd1306_DrawPixel(par_x + x, par_y - y, par_color);
+            ssd1306_DrawPixel(par_x - x, par_y - y, par_color);
+        }
         e2 = err;
         if (e2 <= y)
         {
@@ -557,64 +1092,22 @@ void ssd1306_DrawCircle(uint8_t par_x, uint8_t par_y, uint8_t par_r, SSD1306_COL
     return;
 }
 
-// Draw filled circle. Pixel positions calculated using Bresenham's algorithm
-void ssd1306_FillCircle(uint8_t par_x, uint8_t par_y, uint8_t par_r, SSD1306_COLOR par_color)
+// Draw filled circle. Row extents calculated using Bresenham's algorithm,
+// each row is filled as one span
+void ssd1306_FillCircle(int16_t par_x, int16_t par_y, uint8_t par_r, SSD1306_COLOR par_color)
 {
-    int32_t x = -par_r;
-    int32_t y = 0;
-    int32_t err = 2 - 2 * par_r;
-    int32_t e2;
-
-    if (par_x >= SSD1306_WIDTH || par_y >= SSD1306_HEIGHT)
+    if (par_x + par_r < SSD1306->Clip.x1 || par_x - par_r > SSD1306->Clip.x2 ||
+        par_y + par_r < SSD1306->Clip.y1 || par_y - par_r > SSD1306->Clip.y2)
     {
         return;
     }
 
-    do
-    {
-        for (uint8_t _y = (par_y + y); _y >= (par_y - y); _y--)
-        {
-            for (uint8_t _x = (par_x - x); _x >= (par_x + x); _x--)
-            {
-                ssd1306_DrawPixel(_x, _y, par_color);
-            }
-        }
-
-        e2 = err;
-        if (e2 <= y)
-        {
-            y++;
-            err = err + (y * 2 + 1);
-            if (-x == y && e2 <= x)
-            {
-                e2 = 0;
-            }
-            else
-            {
-                /*nothing to do*/
-            }
-        }
-        else
-        {
-            /*nothing to do*/
-        }
-
-        if (e2 > x)
-        {
-            x++;
-            err = err + (x * 2 + 1);
-        }
-        else
-        {
-            /*nothing to do*/
-        }
-    } while (x <= 0);
-
+    ssd1306_FillRoundedSpans(par_x, par_y, par_x, par_y, par_r, par_color);
     return;
 }
 
 // Draw rectangle
-void ssd1306_DrawRectangle(uint8_t x1, uint8_t y1, uint8_t x2, uint8_t y2, SSD1306_COLOR color)
+void ssd1306_DrawRectangle(int16_t x1, int16_t y1, int16_t x2, int16_t y2, SSD1306_COLOR color)
 {
     ssd1306_Line(x1, y1, x2, y1, color);
     ssd1306_Line(x2, y1, x2, y2, color);
@@ -625,69 +1118,189 @@ void ssd1306_DrawRectangle(uint8_t x1, uint8_t y1, uint8_t x2, uint8_t y2, SSD13
 }
 
 // Draw filled rectangle
-void ssd1306_FillRectangle(uint8_t x1, uint8_t y1, uint8_t x2, uint8_t y2, SSD1306_COLOR color)
+void ssd1306_FillRectangle(int16_t x1, int16_t y1, int16_t x2, int16_t y2, SSD1306_COLOR color)
 {
-    for (uint8_t y = y2; y >= y1; y--)
+    ssd1306_FillBlock((x1 < x2) ? x1 : x2, (y1 < y2) ? y1 : y2,
+                      (x1 < x2) ? x2 : x1, (y1 < y2) ? y2 : y1, color);
+    return;
+}
+
+// Draw filled rectangle with rounded corners of radius par_r
+void ssd1306_FillRoundRectangle(int16_t x1, int16_t y1, int16_t x2, int16_t y2, uint8_t par_r, SSD1306_COLOR color)
+{
+    int32_t left = (x1 < x2) ? x1 : x2;
+    int32_t right = (x1 < x2) ? x2 : x1;
+    int32_t top = (y1 < y2) ? y1 : y2;
+    int32_t bottom = (y1 < y2) ? y2 : y1;
+
+    // The corners can not be larger than half of the shorter side
+    if (2 * par_r > right - left)
     {
-        for (uint8_t x = x2; x >= x1; x--)
+        par_r = (right - left) / 2;
+    }
+    if (2 * par_r > bottom - top)
+    {
+        par_r = (bottom - top) / 2;
+    }
+
+    ssd1306_FillRoundedSpans(left + par_r, top + par_r, right - par_r, bottom - par_r, par_r, color);
+    return;
+}
+
+// Draw bitmap - ported from the ADAFruit GFX library.
+// Only the rows and columns inside the clip rectangle are visited.
+void ssd1306_DrawBitmap(int16_t x, int16_t y, const unsigned char *bitmap, uint8_t w, uint8_t h, SSD1306_COLOR color)
+{
+    int16_t byteWidth = (w + 7) / 8; // Bitmap scanline pad = whole byte
+    int32_t i_start = MAX(0, SSD1306->Clip.x1 - x);
+    int32_t i_end = MIN(w, SSD1306->Clip.x2 - x + 1);
+    int32_t j_start = MAX(0, SSD1306->Clip.y1 - y);
+    int32_t j_end = MIN(h, SSD1306->Clip.y2 - y + 1);
+    const unsigned char *row;
+
+    for (int32_t j = j_start; j < j_end; j++)
+    {
+        row = &bitmap[j * byteWidth];
+        for (int32_t i = i_start; i < i_end; i++)
         {
-            ssd1306_DrawPixel(x, y, color);
+            if (row[i / 8] & (0x80 >> (i & 7)))
+                ssd1306_PutPixel(x + i, y + j, color);
         }
     }
+    if (i_start < i_end && j_start < j_end)
+    {
+        ssd1306_MarkDirty(x + i_start, y + j_start, x + i_end - 1, y + j_end - 1);
+    }
     return;
 }
 
-// Draw bitmap - ported from the ADAFruit GFX library
-
-void ssd1306_DrawBitmap(uint8_t x, uint8_t y, const unsigned char *bitmap, uint8_t w, uint8_t h, SSD1306_COLOR color)
+/**
+ * @brief Scrolls the picture up by par_pages pages of 8 rows using the display
+ *        start line. The framebuffer is a ring: no pixel is moved, the pages
+ *        leaving at the top are filled with color and become the bottom pages.
+ * @note Sent by the next ssd1306_UpdateScreenPartial as one start line command
+ *       plus the new pages, instead of the whole framebuffer. Only on 64-row
+ *       panels, see SSD1306_RING_SCROLL.
+ */
+void ssd1306_ScrollUpPages(uint8_t par_pages, SSD1306_COLOR color)
 {
-    int16_t byteWidth = (w + 7) / 8; // Bitmap scanline pad = whole byte
-    uint8_t byte = 0;
+    uint8_t page;
 
-    if (x >= SSD1306_WIDTH || y >= SSD1306_HEIGHT)
+    par_pages %= SSD1306_PAGES;
+    if (par_pages == 0)
     {
         return;
     }
 
-    for (uint8_t j = 0; j < h; j++, y++)
+#if SSD1306_RING_SCROLL
+    SSD1306->StartPage = (SSD1306->StartPage + par_pages) % SSD1306_PAGES;
+    SSD1306->StartLinePending = 1;
+#else
+    // The panel would show RAM pages outside the ring: the picture is
+    // moved instead and sent again whole
+    memmove(SSD1306->Buffer, &SSD1306->Buffer[par_pages * SSD1306_WIDTH], (SSD1306_PAGES - par_pages) * SSD1306_WIDTH);
+    ssd1306_MarkDirty(0, 0, SSD1306_WIDTH - 1, SSD1306_HEIGHT - 1);
+#endif
+
+    // The pages that wrapped around are now the bottom of the picture,
+    // cleared regardless of the clip rectangle
+    for (page = SSD1306_PAGES - par_pages; page < SSD1306_PAGES; page++)
     {
-        for (uint8_t i = 0; i < w; i++)
-        {
-            if (i & 7)
-                byte <<= 1;
-            else
-                byte = (*(const unsigned char *)(&bitmap[j * byteWidth + i / 8]));
-            if (byte & 0x80)
-                ssd1306_DrawPixel(x + i, y, color);
-        }
+        ssd1306_FillPageSpan(0, SSD1306_WIDTH - 1, page, 0xFF, color);
     }
-    return;
 }
 
-void ssd1306_SetContrast(const uint8_t value)
+// Sends a command sequence, up to the first byte that fails
+static ret_code_t ssd1306_WriteCommands(const uint8_t *bytes, size_t count)
 {
-    const uint8_t kSetContrastControlRegister = 0x81;
-    ssd1306_WriteCommand(kSetContrastControlRegister);
-    ssd1306_WriteCommand(value);
+    ret_code_t err_code = NRF_SUCCESS;
+    size_t i;
+
+    for (i = 0; i < count && err_code == NRF_SUCCESS; i++)
+    {
+        err_code = ssd1306_WriteCommand(bytes[i]);
+    }
+    return err_code;
 }
 
-void ssd1306_SetDisplayOn(const uint8_t on)
+// Hardware continuous scroll set up, the panel shifts its RAM content itself
+static ret_code_t ssd1306_ScrollSetup(uint8_t command, uint8_t start_page, uint8_t end_page, SSD1306_SCROLL_INTERVAL interval)
 {
-    uint8_t value;
-    if (on)
+    const uint8_t commands[] = {
+        0x2E, // Scroll parameters may only change while deactivated
+        command,
+        0x00, // Dummy byte
+        start_page & 0x07,
+        interval,
+        end_page & 0x07};
+
+    return ssd1306_WriteCommands(commands, sizeof(commands));
+}
+
+ret_code_t ssd1306_ScrollHorizontal(SSD1306_SCROLL_DIR dir, uint8_t start_page, uint8_t end_page, SSD1306_SCROLL_INTERVAL interval)
+{
+    const uint8_t dummy[] = {0x00, 0xFF};
+    ret_code_t err_code = ssd1306_ScrollSetup((dir == SSD1306_SCROLL_RIGHT) ? 0x26 : 0x27, start_page, end_page, interval);
+
+    if (err_code != NRF_SUCCESS)
     {
-        value = 0xAF; // Display on
-        SSD1306.DisplayOn = 1;
+        return err_code;
     }
-    else
+    return ssd1306_WriteCommands(dummy, sizeof(dummy));
+}
+
+ret_code_t ssd1306_ScrollDiagonal(SSD1306_SCROLL_DIR dir, uint8_t start_page, uint8_t end_page, SSD1306_SCROLL_INTERVAL interval,
+                                  uint8_t fixed_rows, uint8_t scroll_rows, uint8_t vertical_offset)
+{
+    const uint8_t area[] = {
+        0x2E,
+        0xA3, // Set vertical scroll area
+        fixed_rows & 0x3F,
+        scroll_rows & 0x7F};
+    ret_code_t err_code = ssd1306_WriteCommands(area, sizeof(area));
+
+    if (err_code == NRF_SUCCESS)
+    {
+        err_code = ssd1306_ScrollSetup((dir == SSD1306_SCROLL_RIGHT) ? 0x29 : 0x2A, start_page, end_page, interval);
+    }
+    if (err_code != NRF_SUCCESS)
+    {
+        return err_code;
+    }
+    return ssd1306_WriteCommand(vertical_offset & 0x3F);
+}
+
+ret_code_t ssd1306_ScrollStart(void)
+{
+    return ssd1306_WriteCommand(0x2F); // Activate scroll
+}
+
+ret_code_t ssd1306_ScrollStop(void)
+{
+    return ssd1306_WriteCommand(0x2E); // Deactivate scroll
+}
+
+ret_code_t ssd1306_SetContrast(const uint8_t value)
+{
+    const uint8_t kSetContrastControlRegister = 0x81;
+    const uint8_t commands[] = {kSetContrastControlRegister, value};
+
+    return ssd1306_WriteCommands(commands, sizeof(commands));
+}
+
+ret_code_t ssd1306_SetDisplayOn(const uint8_t on)
+{
+    // Display on or off
+    ret_code_t err_code = ssd1306_WriteCommand(on ? 0xAF : 0xAE);
+
+    if (err_code == NRF_SUCCESS)
     {
-        value = 0xAE; // Display off
-        SSD1306.DisplayOn = 0;
+        SSD1306->DisplayOn = on ? 1 : 0;
     }
-    ssd1306_WriteCommand(value);
+    return err_code;
 }
 
 uint8_t ssd1306_GetDisplayOn()
 {
-    return SSD1306.DisplayOn;
+    return SSD1306->DisplayOn;
 }
\ No newline at end of file
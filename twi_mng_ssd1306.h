@@ -9,33 +9,28 @@
 _BEGIN_STD_C
 
 #include "ssd1306_conf.h"
-
-#ifdef SSD1306_X_OFFSET
-#define SSD1306_X_OFFSET_LOWER (SSD1306_X_OFFSET & 0x0F)
-#define SSD1306_X_OFFSET_UPPER ((SSD1306_X_OFFSET >> 4) & 0x07)
-#else
-#define SSD1306_X_OFFSET_LOWER 0
-#define SSD1306_X_OFFSET_UPPER 0
-#endif
+#include "ssd1306_geometry.h"
 
 #include "ssd1306_fonts.h"
+#include "twi_recovery.h"
 
 #ifndef SSD1306_I2C_ADDR
 #define SSD1306_I2C_ADDR (0x3C)
 #endif
 
-// SSD1306 OLED height in pixels
-#ifndef SSD1306_HEIGHT
-#define SSD1306_HEIGHT 64
+// Time the screen needs after power-up in ms, counted from app_timer_init
+#ifndef SSD1306_BOOT_MS
+#define SSD1306_BOOT_MS 100
 #endif
 
-// SSD1306 width in pixels
-#ifndef SSD1306_WIDTH
-#define SSD1306_WIDTH 128
+// Number of nested ssd1306_PushClipRect calls
+#ifndef SSD1306_CLIP_STACK_DEPTH
+#define SSD1306_CLIP_STACK_DEPTH 4
 #endif
 
-#ifndef SSD1306_BUFFER_SIZE
-#define SSD1306_BUFFER_SIZE SSD1306_WIDTH *SSD1306_HEIGHT / 8
+// Largest polygon accepted by ssd1306_FillPolygon
+#ifndef SSD1306_POLYGON_MAX_VERTICES
+#define SSD1306_POLYGON_MAX_VERTICES 16
 #endif
 
 // Enumeration for screen colors
@@ -45,58 +40,191 @@ typedef enum
     White = 0x01  // Pixel is set. Color depends on OLED
 } SSD1306_COLOR;
 
+// Direction of the hardware continuous scroll
+typedef enum
+{
+    SSD1306_SCROLL_RIGHT = 0x00,
+    SSD1306_SCROLL_LEFT = 0x01
+} SSD1306_SCROLL_DIR;
+
+// Time between hardware scroll steps, in frames
+typedef enum
+{
+    SSD1306_SCROLL_FRAMES_2 = 0x07,
+    SSD1306_SCROLL_FRAMES_3 = 0x04,
+    SSD1306_SCROLL_FRAMES_4 = 0x05,
+    SSD1306_SCROLL_FRAMES_5 = 0x00,
+    SSD1306_SCROLL_FRAMES_25 = 0x06,
+    SSD1306_SCROLL_FRAMES_64 = 0x01,
+    SSD1306_SCROLL_FRAMES_128 = 0x02,
+    SSD1306_SCROLL_FRAMES_256 = 0x03
+} SSD1306_SCROLL_INTERVAL;
+
 typedef enum
 {
     SSD1306_OK = 0x00,
     SSD1306_ERR = 0x01 // Generic error.
 } SSD1306_Error_t;
 
-// Struct to store transformations
+// Rectangle with inclusive corners, used for clipping
 typedef struct
 {
-    uint16_t CurrentX;
-    uint16_t CurrentY;
+    int16_t x1;
+    int16_t y1;
+    int16_t x2;
+    int16_t y2;
+} SSD1306_RECT;
+
+// One RAM page on its way to the panel: page and column address commands
+// followed by the page data, sent as one transaction
+typedef struct
+{
+    uint8_t Command[4];
+    uint8_t Data[1 + SSD1306_WIDTH];
+    nrf_twi_mngr_transfer_t Transfers[2];
+    nrf_twi_mngr_transaction_t Transaction;
+    TWI_RETRY Retry;
+    volatile uint8_t Busy;
+} SSD1306_PAGE_TX;
+
+// Display start line command, sent ahead of the pages after a ring scroll
+typedef struct
+{
+    uint8_t Command[2];
+    nrf_twi_mngr_transfer_t Transfers[1];
+    nrf_twi_mngr_transaction_t Transaction;
+    TWI_RETRY Retry;
+    volatile uint8_t Busy;
+} SSD1306_CMD_TX;
+
+// One panel: bus, framebuffer, transformations and transfers in flight.
+// Instances are written by EasyDMA and must be in RAM.
+typedef struct
+{
+    const nrf_twi_mngr_t *TWI;             // Bus the panel is on
+    uint8_t Address;                       // 7-bit TWI address
+    TWI_DEVICE Device;                     // Retries and error counters
+    uint8_t Buffer[SSD1306_BUFFER_SIZE];   // Framebuffer, a ring of RAM pages
+    SSD1306_PAGE_TX PageTx[SSD1306_PAGES]; // Transfer of each RAM page
+    SSD1306_CMD_TX StartLineTx;
+    int16_t CurrentX;
+    int16_t CurrentY;
     uint8_t Initialized;
     uint8_t DisplayOn;
+    SSD1306_RECT Clip;
+    SSD1306_RECT ClipStack[SSD1306_CLIP_STACK_DEPTH];
+    uint8_t ClipDepth;
+    uint8_t StartPage;              // RAM page shown at the top
+    uint8_t StartLinePending;       // Start line command not sent yet
+    uint8_t DirtyX1[SSD1306_PAGES]; // Changed columns per RAM page,
+    uint8_t DirtyX2[SSD1306_PAGES]; // clean when DirtyX1 > DirtyX2
 } SSD1306_t;
 
 typedef struct
 {
-    uint8_t x;
-    uint8_t y;
+    int16_t x;
+    int16_t y;
 } SSD1306_VERTEX;
 
 // Procedure definitions
 void ssd1306_TWI_Init(nrf_twi_mngr_t *nrf_twi_mngr_t);
+/**
+ * @brief Initializes a display and selects it for drawing.
+ * @details All of the instance is reset, the display needs no prior setup.
+ * @note The display must have no transfer in flight, e.g. from before a re-init.
+ * @note ssd1306_TWI_Init does the same for the default display at SSD1306_I2C_ADDR.
+ */
+void ssd1306_InitDisplay(SSD1306_t *display, const nrf_twi_mngr_t *nrf_twi_mngr_t, uint8_t address);
+/**
+ * @brief Selects the display all drawing functions work on.
+ * @return display selected before.
+ */
+SSD1306_t *ssd1306_SelectDisplay(SSD1306_t *display);
+/**
+ * @brief Returns the display selected for drawing.
+ */
+SSD1306_t *ssd1306_GetDisplay(void);
+/**
+ * @brief Sends the changed columns of several displays, interleaved page by page.
+ * @note Fair on a shared bus: no panel waits for a whole frame of another one.
+ * @note Panels turned off with ssd1306_SetDisplayOn are skipped.
+ */
+void ssd1306_UpdateDisplays(SSD1306_t *const *displays, uint8_t count);
 void ssd1306_Init(void);
 void ssd1306_twi_Init(nrf_drv_twi_t *m_twi);
 void ssd1306_Fill(SSD1306_COLOR color);
 void ssd1306_UpdateScreen(void);
-void ssd1306_DrawPixel(uint8_t x, uint8_t y, SSD1306_COLOR color);
+/**
+ * @brief Sends only the columns changed since the last update, per page.
+ * @note Pages still being sent by a previous update stay dirty for the next one.
+ */
+void ssd1306_UpdateScreenPartial(void);
+void ssd1306_DrawPixel(int16_t x, int16_t y, SSD1306_COLOR color);
 char ssd1306_WriteChar(char ch, FontDef Font, SSD1306_COLOR color);
 char ssd1306_WriteString(char *str, FontDef Font, SSD1306_COLOR color);
-void ssd1306_SetCursor(uint8_t x, uint8_t y);
-void ssd1306_Line(uint8_t x1, uint8_t y1, uint8_t x2, uint8_t y2, SSD1306_COLOR color);
-void ssd1306_DrawArc(uint8_t x, uint8_t y, uint8_t radius, uint16_t start_angle, uint16_t sweep, SSD1306_COLOR color);
-void ssd1306_DrawArcWithRadiusLine(uint8_t x, uint8_t y, uint8_t radius, uint16_t start_angle, uint16_t sweep, SSD1306_COLOR color);
-void ssd1306_DrawCircle(uint8_t par_x, uint8_t par_y, uint8_t par_r, SSD1306_COLOR color);
-void ssd1306_FillCircle(uint8_t par_x, uint8_t par_y, uint8_t par_r, SSD1306_COLOR par_color);
+void ssd1306_SetCursor(int16_t x, int16_t y);
+void ssd1306_Line(int16_t x1, int16_t y1, int16_t x2, int16_t y2, SSD1306_COLOR color);
+void ssd1306_DrawArc(int16_t x, int16_t y, uint8_t radius, uint16_t start_angle, uint16_t sweep, SSD1306_COLOR color);
+void ssd1306_DrawArcWithRadiusLine(int16_t x, int16_t y, uint8_t radius, uint16_t start_angle, uint16_t sweep, SSD1306_COLOR color);
+void ssd1306_DrawCircle(int16_t par_x, int16_t par_y, uint8_t par_r, SSD1306_COLOR color);
+void ssd1306_FillCircle(int16_t par_x, int16_t par_y, uint8_t par_r, SSD1306_COLOR par_color);
 void ssd1306_Polyline(const SSD1306_VERTEX *par_vertex, uint16_t par_size, SSD1306_COLOR color);
-void ssd1306_DrawRectangle(uint8_t x1, uint8_t y1, uint8_t x2, uint8_t y2, SSD1306_COLOR color);
-void ssd1306_FillRectangle(uint8_t x1, uint8_t y1, uint8_t x2, uint8_t y2, SSD1306_COLOR color);
-void ssd1306_DrawBitmap(uint8_t x, uint8_t y, const unsigned char *bitmap, uint8_t w, uint8_t h, SSD1306_COLOR color);
+void ssd1306_FillPolygon(const SSD1306_VERTEX *par_vertex, uint16_t par_size, SSD1306_COLOR color);
+void ssd1306_FillTriangle(int16_t x1, int16_t y1, int16_t x2, int16_t y2, int16_t x3, int16_t y3, SSD1306_COLOR color);
+void ssd1306_DrawRectangle(int16_t x1, int16_t y1, int16_t x2, int16_t y2, SSD1306_COLOR color);
+void ssd1306_FillRectangle(int16_t x1, int16_t y1, int16_t x2, int16_t y2, SSD1306_COLOR color);
+void ssd1306_FillRoundRectangle(int16_t x1, int16_t y1, int16_t x2, int16_t y2, uint8_t par_r, SSD1306_COLOR color);
+void ssd1306_DrawBitmap(int16_t x, int16_t y, const unsigned char *bitmap, uint8_t w, uint8_t h, SSD1306_COLOR color);
+/**
+ * @brief Restricts all drawing to the intersection of the current clip
+ *        rectangle and x1..x2, y1..y2 (inclusive, any order).
+ * @note Shapes are clipped once per call, not per pixel.
+ * @return SSD1306_ERR if SSD1306_CLIP_STACK_DEPTH rectangles are already pushed.
+ */
+SSD1306_Error_t ssd1306_PushClipRect(int16_t x1, int16_t y1, int16_t x2, int16_t y2);
+/**
+ * @brief Restores the clip rectangle active before the last ssd1306_PushClipRect.
+ */
+void ssd1306_PopClipRect(void);
+/**
+ * @brief Scrolls the picture up by whole pages (8 rows) through the display start line.
+ * @param[in] par_pages pages to scroll.
+ * @param[in] color color of the pages that appear at the bottom.
+ * @note Drawing coordinates stay relative to the top of the visible picture.
+ * @note Panels of other than 64 rows move the framebuffer and send it whole.
+ */
+void ssd1306_ScrollUpPages(uint8_t par_pages, SSD1306_COLOR color);
+/**
+ * @brief Sets up hardware continuous horizontal scroll of pages start_page..end_page.
+ * @note SSD1306 only, takes effect after ssd1306_ScrollStart.
+ * @note Stop the scroll before writing to the framebuffer area being scrolled.
+ */
+ret_code_t ssd1306_ScrollHorizontal(SSD1306_SCROLL_DIR dir, uint8_t start_page, uint8_t end_page, SSD1306_SCROLL_INTERVAL interval);
+/**
+ * @brief Sets up hardware continuous vertical and horizontal scroll.
+ * @param[in] fixed_rows rows on top that do not scroll.
+ * @param[in] scroll_rows rows in the vertical scroll area.
+ * @param[in] vertical_offset rows per scroll step.
+ * @note SSD1306 only, takes effect after ssd1306_ScrollStart.
+ */
+ret_code_t ssd1306_ScrollDiagonal(SSD1306_SCROLL_DIR dir, uint8_t start_page, uint8_t end_page, SSD1306_SCROLL_INTERVAL interval,
+                                  uint8_t fixed_rows, uint8_t scroll_rows, uint8_t vertical_offset);
+ret_code_t ssd1306_ScrollStart(void);
+ret_code_t ssd1306_ScrollStop(void);
 /**
  * @brief Sets the contrast of the display.
  * @param[in] value contrast to set.
  * @note Contrast increases as the value increases.
  * @note RESET = 7Fh.
+ * @return NRF_ERROR_FORBIDDEN while the panel is quarantined, or the TWI error.
  */
-void ssd1306_SetContrast(const uint8_t value);
+ret_code_t ssd1306_SetContrast(const uint8_t value);
 /**
  * @brief Set Display ON/OFF.
  * @param[in] on 0 for OFF, any for ON.
+ * @return as ssd1306_SetContrast, DisplayOn is kept on failure.
  */
-void ssd1306_SetDisplayOn(const uint8_t on);
+ret_code_t ssd1306_SetDisplayOn(const uint8_t on);
 /**
  * @brief Reads DisplayOn state.
  * @return  0: OFF.
@@ -106,8 +234,9 @@ uint8_t ssd1306_GetDisplayOn();
 
 // Low-level procedures
 void ssd1306_Reset(void);
-void ssd1306_WriteCommand(uint8_t byte);
-void ssd1306_WriteData(uint8_t *buffer, size_t buff_size);
+// Blocking, return NRF_ERROR_FORBIDDEN while the panel is quarantined
+ret_code_t ssd1306_WriteCommand(uint8_t byte);
+ret_code_t ssd1306_WriteData(uint8_t *buffer, size_t buff_size);
 SSD1306_Error_t ssd1306_FillBuffer(uint8_t *buf, uint32_t len);
 
 _END_STD_C
@@ -0,0 +1,246 @@
+/*
+ *      twi_mng_tca9548a.c
+ *
+ *	The MIT License.
+ */
+
+#include "twi_mng_tca9548a.h"
+#include "app_util_platform.h"
+
+static void TCA9548A_Dispatch(TCA9548A_t *tca9548a);
+
+ret_code_t TCA9548A_Init(TCA9548A_t *tca9548a, const nrf_twi_mngr_t *nrf_twi_mngr_t, uint8_t address)
+{
+  uint8_t none = 0x00;
+  ret_code_t err_code;
+
+  memset(tca9548a, 0, sizeof(*tca9548a));
+  tca9548a->TWI = nrf_twi_mngr_t;
+  tca9548a->Address = address;
+  tca9548a->ActiveChannel = TCA9548A_NO_CHANNEL;
+
+  nrf_twi_mngr_transfer_t const write_transfer[] =
+      {
+          NRF_TWI_MNGR_WRITE(address, &none, 1, 0),
+      };
+  err_code = nrf_twi_mngr_perform(tca9548a->TWI, NULL, write_transfer, 1, NULL);
+  if (err_code != NRF_SUCCESS)
+  {
+    NRF_LOG_WARNING("TCA9548A_Init - 0x%02x error: %d", address, (int)err_code);
+  }
+  return err_code;
+}
+
+// Forwarded transaction done: hand the result to its owner, then send the next one
+static void TCA9548A_ForwardDone(ret_code_t result, void *p_user_data)
+{
+  TCA9548A_t *tca9548a = (TCA9548A_t *)p_user_data;
+  const nrf_twi_mngr_transaction_t *p_transaction = tca9548a->Current;
+
+  if (result != NRF_SUCCESS)
+  {
+    // The select write may not have reached the mux
+    tca9548a->ActiveChannel = TCA9548A_NO_CHANNEL;
+  }
+  CRITICAL_REGION_ENTER();
+  tca9548a->Current = NULL;
+  CRITICAL_REGION_EXIT();
+
+  if (p_transaction->callback != NULL)
+  {
+    p_transaction->callback(result, p_transaction->p_user_data);
+  }
+  TCA9548A_Dispatch(tca9548a);
+}
+
+// Channel to serve next: the selected one while its batch lasts,
+// otherwise the next channel with work after it
+static uint8_t TCA9548A_NextChannel(const TCA9548A_t *tca9548a)
+{
+  uint8_t i, channel;
+  uint8_t start = (tca9548a->ActiveChannel == TCA9548A_NO_CHANNEL) ? 0 : tca9548a->ActiveChannel;
+
+  if (start == tca9548a->ActiveChannel && tca9548a->Queue[start].Count != 0 && tca9548a->Batch < TCA9548A_MAX_BATCH)
+  {
+    return start;
+  }
+  for (i = 1; i <= TCA9548A_CHANNELS; i++)
+  {
+    channel = (start + i) % TCA9548A_CHANNELS;
+    if (tca9548a->Queue[channel].Count != 0)
+    {
+      return channel;
+    }
+  }
+  return TCA9548A_NO_CHANNEL;
+}
+
+// Put the next queued transaction into the manager, unless one is already
+// there. A transaction the manager refuses goes back to its owner with the
+// error, and the next one is tried. Only one call at a time runs the loop:
+// a call from a callback or an interrupt meanwhile leaves its work to it.
+static void TCA9548A_Dispatch(TCA9548A_t *tca9548a)
+{
+  const nrf_twi_mngr_transaction_t *p_transaction;
+  TCA9548A_QUEUE *queue;
+  uint8_t channel;
+  uint8_t dispatching;
+  uint8_t select;
+  uint8_t n;
+  uint8_t i;
+  ret_code_t err_code;
+
+  CRITICAL_REGION_ENTER();
+  dispatching = tca9548a->Dispatching;
+  tca9548a->Dispatching = 1;
+  CRITICAL_REGION_EXIT();
+  if (dispatching)
+  {
+    return;
+  }
+
+  for (;;)
+  {
+    p_transaction = NULL;
+    channel = TCA9548A_NO_CHANNEL;
+    CRITICAL_REGION_ENTER();
+    if (tca9548a->Current == NULL)
+    {
+      channel = TCA9548A_NextChannel(tca9548a);
+      if (channel != TCA9548A_NO_CHANNEL)
+      {
+        queue = &tca9548a->Queue[channel];
+        p_transaction = queue->Items[queue->Head];
+        queue->Head = (queue->Head + 1) % TCA9548A_QUEUE_SIZE;
+        queue->Count--;
+        tca9548a->Current = p_transaction;
+      }
+    }
+    if (p_transaction == NULL)
+    {
+      tca9548a->Dispatching = 0;
+    }
+    CRITICAL_REGION_EXIT();
+
+    if (p_transaction == NULL)
+    {
+      return;
+    }
+
+    n = 0;
+    select = (channel != tca9548a->ActiveChannel);
+    if (select)
+    {
+      tca9548a->SelectMask = 1 << channel;
+      tca9548a->Transfers[n++] = (nrf_twi_mngr_transfer_t)NRF_TWI_MNGR_WRITE(tca9548a->Address, &tca9548a->SelectMask, 1, 0);
+      tca9548a->ActiveChannel = channel;
+      tca9548a->Batch = 0;
+    }
+    for (i = 0; i < p_transaction->number_of_transfers; i++)
+    {
+      tca9548a->Transfers[n++] = p_transaction->p_transfers[i];
+    }
+    tca9548a->Batch++;
+
+    tca9548a->Forward.callback = TCA9548A_ForwardDone;
+    tca9548a->Forward.p_user_data = tca9548a;
+    tca9548a->Forward.p_transfers = tca9548a->Transfers;
+    tca9548a->Forward.number_of_transfers = n;
+    tca9548a->Forward.p_required_twi_cfg = p_transaction->p_required_twi_cfg;
+    err_code = nrf_twi_mngr_schedule(tca9548a->TWI, &tca9548a->Forward);
+    if (err_code == NRF_SUCCESS)
+    {
+      tca9548a->Switches += select;
+      tca9548a->Transactions++;
+      continue;
+    }
+
+    // Nothing of it reached the bus
+    NRF_LOG_WARNING("TCA9548A_Dispatch - channel %d error: %d", channel, (int)err_code);
+    tca9548a->ActiveChannel = TCA9548A_NO_CHANNEL;
+    tca9548a->Refused++;
+    CRITICAL_REGION_ENTER();
+    tca9548a->Current = NULL;
+    CRITICAL_REGION_EXIT();
+    if (p_transaction->callback != NULL)
+    {
+      p_transaction->callback(err_code, p_transaction->p_user_data);
+    }
+  }
+}
+
+ret_code_t TCA9548A_Schedule(TCA9548A_t *tca9548a, uint8_t channel, const nrf_twi_mngr_transaction_t *p_transaction)
+{
+  TCA9548A_QUEUE *queue;
+  ret_code_t err_code = NRF_SUCCESS;
+
+  if (channel >= TCA9548A_CHANNELS)
+  {
+    return NRF_ERROR_INVALID_PARAM;
+  }
+  if (p_transaction->number_of_transfers > TCA9548A_MAX_TRANSFERS)
+  {
+    return NRF_ERROR_INVALID_LENGTH;
+  }
+  queue = &tca9548a->Queue[channel];
+
+  CRITICAL_REGION_ENTER();
+  if (queue->Count == TCA9548A_QUEUE_SIZE)
+  {
+    err_code = NRF_ERROR_NO_MEM;
+  }
+  else
+  {
+    queue->Items[(queue->Head + queue->Count) % TCA9548A_QUEUE_SIZE] = p_transaction;
+    queue->Count++;
+  }
+  CRITICAL_REGION_EXIT();
+
+  if (err_code == NRF_SUCCESS)
+  {
+    TCA9548A_Dispatch(tca9548a);
+  }
+  return err_code;
+}
+
+// Blocking transaction waiting in a channel queue, done in the TWI interrupt
+typedef struct
+{
+  volatile uint8_t Done;
+  volatile ret_code_t Result;
+} TCA9548A_WAIT;
+
+static void TCA9548A_PerformDone(ret_code_t result, void *p_user_data)
+{
+  TCA9548A_WAIT *wait = (TCA9548A_WAIT *)p_user_data;
+
+  wait->Result = result;
+  wait->Done = 1;
+}
+
+ret_code_t TCA9548A_Perform(TCA9548A_t *tca9548a, uint8_t channel, const nrf_twi_mngr_transfer_t *p_transfers, uint8_t number_of_transfers)
+{
+  TCA9548A_WAIT wait = {0, NRF_SUCCESS};
+  nrf_twi_mngr_transaction_t const transaction =
+      {
+          .callback = TCA9548A_PerformDone,
+          .p_user_data = &wait,
+          .p_transfers = p_transfers,
+          .number_of_transfers = number_of_transfers,
+          .p_required_twi_cfg = NULL,
+      };
+  ret_code_t err_code;
+
+  // Routed like the scheduled transactions, so only the router selects
+  // channels and ActiveChannel stays right
+  err_code = TCA9548A_Schedule(tca9548a, channel, &transaction);
+  if (err_code != NRF_SUCCESS)
+  {
+    return err_code;
+  }
+  while (!wait.Done)
+  {
+    __WFE();
+  }
+  return wait.Result;
+}
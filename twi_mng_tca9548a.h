@@ -0,0 +1,85 @@
+/*
+ *      twi_mng_tca9548a.h
+ *
+ *	The MIT License.
+ */
+
+#ifndef __TCA9548A_H__
+#define __TCA9548A_H__
+
+#include "main.h"
+
+#define TCA9548A_ADD (0x70)     // A2..A0 low, up to 0x77
+#define TCA9548A_CHANNELS (8)
+
+// Transactions waiting per channel
+#ifndef TCA9548A_QUEUE_SIZE
+#define TCA9548A_QUEUE_SIZE (4)
+#endif
+
+// Longest transaction routed through the mux, in transfers
+#ifndef TCA9548A_MAX_TRANSFERS
+#define TCA9548A_MAX_TRANSFERS (3)
+#endif
+
+// Transactions sent on one channel before other channels get a turn
+#ifndef TCA9548A_MAX_BATCH
+#define TCA9548A_MAX_BATCH (8)
+#endif
+
+// No channel known to be selected
+#define TCA9548A_NO_CHANNEL (0xFF)
+
+typedef struct
+{
+  const nrf_twi_mngr_transaction_t *Items[TCA9548A_QUEUE_SIZE];
+  uint8_t Head;
+  uint8_t Count;
+} TCA9548A_QUEUE;
+
+// One TCA9548A and the transactions routed through it. The router keeps one
+// transaction at a time in the TWI manager queue, so it always knows which
+// channel the mux has selected. The channel select write is prepended to a
+// transaction only when the channel changes, and queued transactions of the
+// selected channel go first, up to TCA9548A_MAX_BATCH in a row.
+typedef struct TCA9548A_s
+{
+  const nrf_twi_mngr_t *TWI;              // Bus the mux is on
+  uint8_t Address;                        // 7-bit TWI address
+  uint8_t ActiveChannel;                  // Channel selected in the mux
+  uint8_t SelectMask;                     // Channel select byte being sent
+  uint8_t Batch;                          // Transactions sent since the last switch
+  TCA9548A_QUEUE Queue[TCA9548A_CHANNELS];
+  const nrf_twi_mngr_transaction_t *Current; // Transaction in the manager, NULL when idle
+  nrf_twi_mngr_transfer_t Transfers[1 + TCA9548A_MAX_TRANSFERS];
+  nrf_twi_mngr_transaction_t Forward;
+  volatile uint8_t Dispatching;           // A call is moving transactions to the manager
+  uint32_t Transactions;                  // Routed transactions
+  uint32_t Switches;                      // Channel select writes
+  uint32_t Refused;                       // Transactions the manager queue had no room for
+} TCA9548A_t;
+
+/**
+ * @brief Sets up a mux and deselects all channels.
+ * @return Result of the deselect write, the mux is usable either way.
+ */
+ret_code_t TCA9548A_Init(TCA9548A_t *tca9548a, const nrf_twi_mngr_t *nrf_twi_mngr_t, uint8_t address);
+/**
+ * @brief Queues a transaction for a device behind a mux channel.
+ * @note The transaction must stay valid until its callback runs, as with nrf_twi_mngr_schedule.
+ *       When the TWI manager queue has no room for it, the callback gets
+ *       NRF_ERROR_NO_MEM.
+ * @return NRF_ERROR_NO_MEM if the channel queue is full,
+ *         NRF_ERROR_INVALID_LENGTH if it has more than TCA9548A_MAX_TRANSFERS transfers.
+ */
+ret_code_t TCA9548A_Schedule(TCA9548A_t *tca9548a, uint8_t channel, const nrf_twi_mngr_transaction_t *p_transaction);
+/**
+ * @brief Blocking transfers to a device behind a mux channel, queued behind
+ *        the transactions already scheduled on that channel.
+ * @note Sleeps until the TWI interrupt is done with them: only from thread
+ *       mode or interrupts below the TWI priority.
+ * @return NRF_ERROR_NO_MEM if the channel queue is full.
+ */
+ret_code_t TCA9548A_Perform(TCA9548A_t *tca9548a, uint8_t channel, const nrf_twi_mngr_transfer_t *p_transfers, uint8_t number_of_transfers);
+
+#endif // __TCA9548A_H__
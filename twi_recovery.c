@@ -0,0 +1,444 @@
+/*
+ *      twi_recovery.c
+ *
+ *	The MIT License.
+ */
+
+#include <string.h>
+
+#include "twi_recovery.h"
+#include "twi_mng_tca9548a.h"
+#include "app_util_platform.h"
+#include "nordic_common.h"
+#include "nrf_delay.h"
+#include "nrf_drv_twi.h"
+#include "nrf_gpio.h"
+#include "nrf_log.h"
+
+// Half of an SCL period at 100 kHz
+#define TWI_RECOVERY_HALF_PERIOD_US (5)
+
+static TWI_BUS *TwiRecovery_Buses[TWI_RECOVERY_MAX_BUSES];
+
+// Configuration the TWI driver gives its pins: open drain, pulled up
+static void TwiRecovery_PinConfig(uint32_t pin, nrf_gpio_pin_dir_t dir)
+{
+  nrf_gpio_cfg(pin, dir, NRF_GPIO_PIN_INPUT_CONNECT, NRF_GPIO_PIN_PULLUP, NRF_GPIO_PIN_S0D1, NRF_GPIO_PIN_NOSENSE);
+}
+
+// Bit-banged bus clear on released pins
+static uint8_t TwiRecovery_ClearLines(uint32_t scl, uint32_t sda)
+{
+  uint8_t i;
+
+  nrf_gpio_pin_set(scl);
+  nrf_gpio_pin_set(sda);
+  TwiRecovery_PinConfig(scl, NRF_GPIO_PIN_DIR_OUTPUT);
+  TwiRecovery_PinConfig(sda, NRF_GPIO_PIN_DIR_OUTPUT);
+  nrf_delay_us(TWI_RECOVERY_HALF_PERIOD_US);
+
+  // A device in the middle of a read lets SDA go at the end of its byte
+  for (i = 0; i < 9 && nrf_gpio_pin_read(sda) == 0; i++)
+  {
+    nrf_gpio_pin_clear(scl);
+    nrf_delay_us(TWI_RECOVERY_HALF_PERIOD_US);
+    nrf_gpio_pin_set(scl);
+    nrf_delay_us(TWI_RECOVERY_HALF_PERIOD_US);
+  }
+
+  // Stop condition: SDA rises while SCL is high
+  nrf_gpio_pin_clear(scl);
+  nrf_gpio_pin_clear(sda);
+  nrf_delay_us(TWI_RECOVERY_HALF_PERIOD_US);
+  nrf_gpio_pin_set(scl);
+  nrf_delay_us(TWI_RECOVERY_HALF_PERIOD_US);
+  nrf_gpio_pin_set(sda);
+  nrf_delay_us(TWI_RECOVERY_HALF_PERIOD_US);
+
+  TwiRecovery_PinConfig(scl, NRF_GPIO_PIN_DIR_INPUT);
+  TwiRecovery_PinConfig(sda, NRF_GPIO_PIN_DIR_INPUT);
+  return nrf_gpio_pin_read(sda) != 0;
+}
+
+void TwiRecovery_InitBus(TWI_BUS *bus, const nrf_twi_mngr_t *nrf_twi_mngr_t, uint32_t scl, uint32_t sda)
+{
+  uint8_t i;
+
+  bus->TWI = nrf_twi_mngr_t;
+  bus->SCL = scl;
+  bus->SDA = sda;
+  bus->Clears = 0;
+  bus->Deferred = TWI_ERROR_NONE;
+  for (i = 0; i < TWI_RECOVERY_MAX_BUSES; i++)
+  {
+    if (TwiRecovery_Buses[i] == NULL || TwiRecovery_Buses[i]->TWI == nrf_twi_mngr_t)
+    {
+      TwiRecovery_Buses[i] = bus;
+      break;
+    }
+  }
+  // A reset in the middle of a read leaves the device driving SDA
+  TwiRecovery_ClearLines(scl, sda);
+}
+
+static void TwiRecovery_TimerHandler(void *p_context);
+
+ret_code_t TwiRecovery_InitDevice(TWI_DEVICE *device, const nrf_twi_mngr_t *nrf_twi_mngr_t, uint8_t address)
+{
+  uint8_t i;
+
+  memset(device, 0, sizeof(*device));
+  device->TWI = nrf_twi_mngr_t;
+  device->Address = address;
+  for (i = 0; i < TWI_RECOVERY_MAX_BUSES; i++)
+  {
+    if (TwiRecovery_Buses[i] != NULL && TwiRecovery_Buses[i]->TWI == nrf_twi_mngr_t)
+    {
+      device->Bus = TwiRecovery_Buses[i];
+    }
+  }
+  TwiHealth_Init(&device->Health);
+  device->Timer = &device->TimerData;
+  return app_timer_create(&device->Timer, APP_TIMER_MODE_SINGLE_SHOT, TwiRecovery_TimerHandler);
+}
+
+ret_code_t TwiRecovery_InitMuxDevice(TWI_DEVICE *device, struct TCA9548A_s *tca9548a, uint8_t channel, uint8_t address)
+{
+  ret_code_t err_code = TwiRecovery_InitDevice(device, tca9548a->TWI, address);
+
+  device->Mux = tca9548a;
+  device->Channel = channel;
+  return err_code;
+}
+
+TWI_ERROR_CLASS TwiRecovery_Classify(ret_code_t result)
+{
+  switch (result)
+  {
+  case NRF_SUCCESS:
+    return TWI_ERROR_NONE;
+  case NRF_ERROR_DRV_TWI_ERR_ANACK:
+  case NRF_ERROR_DRV_TWI_ERR_DNACK:
+  case NRF_ERROR_BUSY:
+  case NRF_ERROR_NO_MEM:
+    return TWI_ERROR_NACK;
+  case NRF_ERROR_DRV_TWI_ERR_OVERRUN:
+  case NRF_ERROR_INTERNAL:
+  case NRF_ERROR_TIMEOUT:
+    return TWI_ERROR_BUS;
+  default:
+    return TWI_ERROR_FATAL;
+  }
+}
+
+uint8_t TwiRecovery_ClearBus(TWI_BUS *bus)
+{
+  uint8_t released;
+
+  nrf_drv_twi_disable(&bus->TWI->twi);
+  released = TwiRecovery_ClearLines(bus->SCL, bus->SDA);
+  nrf_drv_twi_enable(&bus->TWI->twi);
+  bus->Clears++;
+  return released;
+}
+
+// Clears the bus after a fault, or after a NACK with SDA still low: a
+// device stuck in a read. Only while nothing is on the bus.
+// @return 1 when the bus was cleared
+static uint8_t TwiRecovery_Check(TWI_BUS *bus, TWI_ERROR_CLASS error)
+{
+  if (error == TWI_ERROR_BUS || nrf_gpio_pin_read(bus->SDA) == 0)
+  {
+    TwiRecovery_ClearBus(bus);
+    return 1;
+  }
+  return 0;
+}
+
+// Checks the bus for a failure seen while it was busy, from a transaction
+// callback, before the manager starts the next transaction
+static void TwiRecovery_CheckDeferred(TWI_BUS *bus)
+{
+  TWI_ERROR_CLASS error;
+
+  CRITICAL_REGION_ENTER();
+  error = (TWI_ERROR_CLASS)bus->Deferred;
+  bus->Deferred = TWI_ERROR_NONE;
+  CRITICAL_REGION_EXIT();
+  if (error != TWI_ERROR_NONE)
+  {
+    TwiRecovery_Check(bus, error);
+  }
+}
+
+// Checks the bus in thread mode, unless the manager has a transaction on
+// it: then the next transaction callback does
+// @return 1 when the bus was cleared
+static uint8_t TwiRecovery_CheckIdle(TWI_BUS *bus, TWI_ERROR_CLASS error)
+{
+  uint8_t cleared = 0;
+
+  CRITICAL_REGION_ENTER();
+  if (error == TWI_ERROR_NONE)
+  {
+    error = (TWI_ERROR_CLASS)bus->Deferred;
+  }
+  else if (bus->Deferred != TWI_ERROR_BUS)
+  {
+    bus->Deferred = error;
+  }
+  if (error != TWI_ERROR_NONE && nrf_twi_mngr_is_idle(bus->TWI))
+  {
+    bus->Deferred = TWI_ERROR_NONE;
+    cleared = TwiRecovery_Check(bus, error);
+  }
+  CRITICAL_REGION_EXIT();
+  return cleared;
+}
+
+// Counts a failure and clears the bus when it is stuck.
+// @param callback 1 from a transaction callback, 0 in thread mode
+// @return 1 when the transaction is worth another attempt.
+static uint8_t TwiRecovery_Failed(TWI_DEVICE *device, ret_code_t result, uint8_t callback)
+{
+  TWI_ERROR_CLASS error = TwiRecovery_Classify(result);
+  uint8_t cleared = 0;
+
+  if (error == TWI_ERROR_FATAL)
+  {
+    return 0;
+  }
+  if (device->Bus != NULL)
+  {
+    cleared = callback ? TwiRecovery_Check(device->Bus, error) : TwiRecovery_CheckIdle(device->Bus, error);
+  }
+  if (cleared || error == TWI_ERROR_BUS)
+  {
+    device->BusErrors++;
+  }
+  else
+  {
+    device->Nacks++;
+  }
+  return 1;
+}
+
+// Bus time of an attempt: since it was scheduled, or since the transaction
+// before it ended when it had to wait for the bus
+static void TwiRecovery_Measure(TWI_DEVICE *device, uint32_t start, const nrf_twi_mngr_transfer_t *p_transfers,
+                                uint8_t number_of_transfers, ret_code_t result)
+{
+  uint32_t now = app_timer_cnt_get();
+  uint32_t ticks = app_timer_cnt_diff_compute(now, start);
+  uint16_t bytes = 0;
+  uint8_t i;
+
+  if (device->Bus != NULL)
+  {
+    ticks = MIN(ticks, app_timer_cnt_diff_compute(now, device->Bus->LastDone));
+    device->Bus->LastDone = now;
+  }
+  for (i = 0; i < number_of_transfers; i++)
+  {
+    bytes += p_transfers[i].length + 1;
+  }
+  TwiHealth_Update(&device->Health, result != NRF_SUCCESS, ticks, bytes, now);
+}
+
+// Retries a transaction gets, from the device state when it is first sent
+static uint8_t TwiRecovery_Retries(const TWI_DEVICE *device)
+{
+  return device->Health.State == TWI_HEALTH_OK ? TWI_RECOVERY_RETRIES : 0;
+}
+
+static void TwiRecovery_Finish(TWI_RETRY *retry, ret_code_t result)
+{
+  if (result != NRF_SUCCESS)
+  {
+    retry->Device->Failed++;
+  }
+  if (retry->Callback != NULL)
+  {
+    retry->Callback(result, retry->Context);
+  }
+}
+
+// Queues a retry behind those already waiting, and starts the backoff
+// unless it is running
+static void TwiRecovery_Backoff(TWI_DEVICE *device, TWI_RETRY *retry)
+{
+  TWI_RETRY **link;
+  uint8_t start;
+  ret_code_t err_code;
+
+  retry->Next = NULL;
+  CRITICAL_REGION_ENTER();
+  link = (TWI_RETRY **)&device->Pending;
+  while (*link != NULL)
+  {
+    link = &(*link)->Next;
+  }
+  *link = retry;
+  start = !device->TimerRunning;
+  device->TimerRunning = 1;
+  CRITICAL_REGION_EXIT();
+
+  if (start)
+  {
+    err_code = app_timer_start(device->Timer, MAX(APP_TIMER_TICKS(TWI_RECOVERY_BACKOFF_MS << (retry->Attempt - 1)), APP_TIMER_MIN_TIMEOUT_TICKS), device);
+    if (err_code != NRF_SUCCESS)
+    {
+      TwiRecovery_TimerHandler(device);
+    }
+  }
+}
+
+static void TwiRecovery_Done(ret_code_t result, void *p_user_data)
+{
+  TWI_RETRY *retry = (TWI_RETRY *)p_user_data;
+
+  if (retry->Device->Bus != NULL)
+  {
+    TwiRecovery_CheckDeferred(retry->Device->Bus);
+  }
+  TwiRecovery_Measure(retry->Device, retry->Start, retry->Transaction->p_transfers, retry->Transaction->number_of_transfers, result);
+  if (result == NRF_SUCCESS)
+  {
+    if (retry->Attempt != 0)
+    {
+      retry->Device->Recovered++;
+    }
+    if (retry->Callback != NULL)
+    {
+      retry->Callback(result, retry->Context);
+    }
+    return;
+  }
+  if (TwiRecovery_Failed(retry->Device, result, 1) && retry->Attempt < retry->Retries)
+  {
+    retry->Attempt++;
+    retry->Device->Retries++;
+    TwiRecovery_Backoff(retry->Device, retry);
+    return;
+  }
+  NRF_LOG_WARNING("TwiRecovery_Done - 0x%02x error: %d", retry->Device->Address, (int)result);
+  TwiRecovery_Finish(retry, result);
+}
+
+// Schedules an admitted transaction. A probe that does not make it to
+// the bus lets the next transaction probe.
+static ret_code_t TwiRecovery_Send(TWI_DEVICE *device, nrf_twi_mngr_transaction_t *transaction)
+{
+  ret_code_t err_code;
+
+  if (device->Mux != NULL)
+  {
+    err_code = TCA9548A_Schedule(device->Mux, device->Channel, transaction);
+  }
+  else
+  {
+    err_code = nrf_twi_mngr_schedule(device->TWI, transaction);
+  }
+
+  if (err_code != NRF_SUCCESS)
+  {
+    device->Health.Probing = 0;
+  }
+  return err_code;
+}
+
+// Backoff over: schedules the waiting retries again
+static void TwiRecovery_TimerHandler(void *p_context)
+{
+  TWI_DEVICE *device = (TWI_DEVICE *)p_context;
+  TWI_RETRY *retry;
+  TWI_RETRY *next;
+  ret_code_t err_code;
+
+  CRITICAL_REGION_ENTER();
+  retry = device->Pending;
+  device->Pending = NULL;
+  device->TimerRunning = 0;
+  CRITICAL_REGION_EXIT();
+
+  while (retry != NULL)
+  {
+    next = retry->Next;
+    retry->Start = app_timer_cnt_get();
+    err_code = NRF_ERROR_FORBIDDEN;
+    if (TwiHealth_Admit(&device->Health, retry->Start))
+    {
+      err_code = TwiRecovery_Send(device, retry->Transaction);
+    }
+    if (err_code != NRF_SUCCESS)
+    {
+      TwiRecovery_Finish(retry, err_code);
+    }
+    retry = next;
+  }
+}
+
+ret_code_t TwiRecovery_Schedule(TWI_DEVICE *device, TWI_RETRY *retry, nrf_twi_mngr_transaction_t *transaction)
+{
+  uint32_t now = app_timer_cnt_get();
+
+  if (!TwiHealth_Admit(&device->Health, now))
+  {
+    return NRF_ERROR_FORBIDDEN;
+  }
+  retry->Start = now;
+  retry->Transaction = transaction;
+  retry->Callback = transaction->callback;
+  retry->Context = transaction->p_user_data;
+  retry->Device = device;
+  retry->Attempt = 0;
+  retry->Retries = TwiRecovery_Retries(device);
+  transaction->callback = TwiRecovery_Done;
+  transaction->p_user_data = retry;
+  return TwiRecovery_Send(device, transaction);
+}
+
+ret_code_t TwiRecovery_Perform(TWI_DEVICE *device, const nrf_twi_mngr_transfer_t *p_transfers, uint8_t number_of_transfers)
+{
+  uint8_t retries = TwiRecovery_Retries(device);
+  ret_code_t err_code;
+  uint32_t start;
+  uint8_t attempt;
+
+  for (attempt = 0;; attempt++)
+  {
+    start = app_timer_cnt_get();
+    if (!TwiHealth_Admit(&device->Health, start))
+    {
+      return NRF_ERROR_FORBIDDEN;
+    }
+    if (device->Bus != NULL && device->Bus->Deferred != TWI_ERROR_NONE)
+    {
+      TwiRecovery_CheckIdle(device->Bus, TWI_ERROR_NONE);
+    }
+    if (device->Mux != NULL)
+    {
+      err_code = TCA9548A_Perform(device->Mux, device->Channel, p_transfers, number_of_transfers);
+    }
+    else
+    {
+      err_code = nrf_twi_mngr_perform(device->TWI, NULL, p_transfers, number_of_transfers, NULL);
+    }
+    TwiRecovery_Measure(device, start, p_transfers, number_of_transfers, err_code);
+    if (err_code == NRF_SUCCESS)
+    {
+      if (attempt != 0)
+      {
+        device->Recovered++;
+      }
+      return NRF_SUCCESS;
+    }
+    if (!TwiRecovery_Failed(device, err_code, 0) || attempt >= retries)
+    {
+      device->Failed++;
+      return err_code;
+    }
+    device->Retries++;
+    nrf_delay_ms(TWI_RECOVERY_BACKOFF_MS << attempt);
+  }
+}
@@ -0,0 +1,133 @@
+/*
+ *      twi_recovery.h
+ *
+ *	The MIT License.
+ */
+
+#ifndef __TWI_RECOVERY_H__
+#define __TWI_RECOVERY_H__
+
+#include "app_timer.h"
+#include "nrf_twi_mngr.h"
+#include "twi_health.h"
+
+// Attempts after the first one, for a transaction that failed
+#ifndef TWI_RECOVERY_RETRIES
+#define TWI_RECOVERY_RETRIES (3)
+#endif
+
+// Wait before the first retry in ms, doubled for each further retry
+#ifndef TWI_RECOVERY_BACKOFF_MS
+#define TWI_RECOVERY_BACKOFF_MS (2)
+#endif
+
+// Buses whose lines can be cleared
+#ifndef TWI_RECOVERY_MAX_BUSES
+#define TWI_RECOVERY_MAX_BUSES (2)
+#endif
+
+typedef enum
+{
+  TWI_ERROR_NONE,
+  TWI_ERROR_NACK,             // Device absent, busy or mid-conversion, or queue full
+  TWI_ERROR_BUS,              // Bus fault or SDA held low, the bus is cleared
+  TWI_ERROR_FATAL             // Bad parameters, not retried
+} TWI_ERROR_CLASS;
+
+// Pins of a bus, to clock out a device that holds SDA low
+typedef struct
+{
+  const nrf_twi_mngr_t *TWI;
+  uint32_t SCL;
+  uint32_t SDA;
+  uint16_t Clears;            // Bus clears done
+  volatile uint32_t LastDone; // app_timer tick the last transaction ended
+  volatile uint8_t Deferred;  // TWI_ERROR_CLASS of a failure seen while the bus was busy
+} TWI_BUS;
+
+typedef struct TWI_DEVICE_s TWI_DEVICE;
+typedef struct TWI_RETRY_s TWI_RETRY;
+struct TCA9548A_s;
+
+// Retry state of one transaction, kept next to it by its owner
+struct TWI_RETRY_s
+{
+  nrf_twi_mngr_transaction_t *Transaction;
+  nrf_twi_mngr_callback_t Callback;          // Owner callback and user data,
+  void *Context;                             // called with the final result
+  TWI_DEVICE *Device;
+  TWI_RETRY *Next;                           // Waiting in the backoff of Device
+  uint32_t Start;                            // app_timer tick of the attempt
+  uint8_t Attempt;
+  uint8_t Retries;                           // Attempts after the first it gets
+};
+
+// One device on a bus, its error counters and its health. A failed
+// transaction of a healthy device is retried after 2, 4 and 8 ms, and its
+// owner only sees the result of the last attempt. The failed attempts
+// may degrade the device meanwhile, the transaction keeps its retries.
+// The transactions of a degraded device are not retried, and those of a
+// quarantined one are refused with NRF_ERROR_FORBIDDEN, so the other
+// devices keep their share of the bus.
+// The transactions of a device behind a TCA9548A go through its router.
+struct TWI_DEVICE_s
+{
+  const nrf_twi_mngr_t *TWI;
+  TWI_BUS *Bus;                              // NULL when the bus has no pins set
+  uint8_t Address;                           // 7-bit TWI address
+  struct TCA9548A_s *Mux;                    // Mux the device is behind, NULL if none
+  uint8_t Channel;                           // Mux channel
+  TWI_RETRY *volatile Pending;               // Retries waiting for the timer
+  volatile uint8_t TimerRunning;
+  app_timer_t TimerData;
+  app_timer_id_t Timer;
+  volatile uint16_t Nacks;
+  volatile uint16_t BusErrors;
+  volatile uint16_t Retries;
+  volatile uint16_t Recovered;               // Succeeded after a retry
+  volatile uint16_t Failed;                  // Failed after all retries
+  TWI_HEALTH Health;
+};
+
+/**
+ * @brief Records the pins of a bus and clears it, before nrf_twi_mngr_init.
+ */
+void TwiRecovery_InitBus(TWI_BUS *bus, const nrf_twi_mngr_t *nrf_twi_mngr_t, uint32_t scl, uint32_t sda);
+/**
+ * @brief Sets up a device and creates its backoff timer.
+ */
+ret_code_t TwiRecovery_InitDevice(TWI_DEVICE *device, const nrf_twi_mngr_t *nrf_twi_mngr_t, uint8_t address);
+/**
+ * @brief Same as TwiRecovery_InitDevice for a device behind a TCA9548A channel.
+ */
+ret_code_t TwiRecovery_InitMuxDevice(TWI_DEVICE *device, struct TCA9548A_s *tca9548a, uint8_t channel, uint8_t address);
+/**
+ * @brief Sorts a TWI manager result by what can be done about it.
+ */
+TWI_ERROR_CLASS TwiRecovery_Classify(ret_code_t result);
+/**
+ * @brief Clocks SCL until SDA is released, up to 9 times, then sends a stop.
+ * @note Only while no transfer is in progress: from a transaction callback,
+ *       before nrf_twi_mngr_init, or in thread mode inside a critical region
+ *       where nrf_twi_mngr_is_idle. Once nrf_twi_mngr_perform returns, the
+ *       manager may already be clocking the next queued transaction.
+ * @return 1 when SDA is high at the end.
+ */
+uint8_t TwiRecovery_ClearBus(TWI_BUS *bus);
+/**
+ * @brief Schedules a transaction that is retried on failure. Its callback and
+ *        user data are kept in retry and called once, with the final result.
+ * @note Only for idempotent transactions: register reads, measurement
+ *       triggers, writes that set the whole state they touch.
+ * @return NRF_ERROR_FORBIDDEN when the device is quarantined.
+ */
+ret_code_t TwiRecovery_Schedule(TWI_DEVICE *device, TWI_RETRY *retry, nrf_twi_mngr_transaction_t *transaction);
+/**
+ * @brief nrf_twi_mngr_perform, or TCA9548A_Perform behind a mux, with the
+ *        same retries, waiting in nrf_delay_ms.
+ * @note A bus to clear while other transactions are queued is left to the
+ *       next transaction callback, or to the next call that finds it idle.
+ */
+ret_code_t TwiRecovery_Perform(TWI_DEVICE *device, const nrf_twi_mngr_transfer_t *p_transfers, uint8_t number_of_transfers);
+
+#endif // __TWI_RECOVERY_H__
@@ -0,0 +1,201 @@
+/*
+ *      twi_scan.c
+ *
+ *	The MIT License.
+ */
+
+#include <string.h>
+
+#include "twi_scan.h"
+#include "app_util_platform.h"
+#include "nrf_log.h"
+#include "twi_mng_ds1307.h"
+#include "twi_mng_hdc1080.h"
+
+#define TWI_SCAN_HDC1080_MANUFACTURER_ID (0x5449) // "TI"
+#define TWI_SCAN_HDC1080_DEVICE_ID (0x1050)
+#define TWI_SCAN_DS1307_CONTROL (0x07)
+#define TWI_SCAN_DS1307_CONTROL_ZERO (0x6C)       // Bits that always read 0
+#define TWI_SCAN_SSD1306_SA0_LOW (0x3C)
+#define TWI_SCAN_SSD1306_SA0_HIGH (0x3D)
+
+// Register pointers of the HDC1080 manufacturer and device IDs
+static const uint8_t TwiScan_HDC1080_Ids[] = {0xFE, 0xFF};
+static const uint8_t TwiScan_DS1307_Control = TWI_SCAN_DS1307_CONTROL;
+// Command stream with a NOP, the SSD1306 cannot be read over TWI
+static const uint8_t TwiScan_SSD1306_Nop[] = {0x00, 0xE3};
+
+static void TwiScan_Done(ret_code_t result, void *p_user_data);
+
+// Sets up the transaction of a probe: an ID read for a known part,
+// otherwise one byte read, which no device acts on
+static void TwiScan_Prepare(TWI_SCAN_PROBE *probe, uint8_t address)
+{
+  nrf_twi_mngr_transfer_t *transfers = probe->Transfers;
+  uint8_t count;
+
+  probe->Address = address;
+  switch (address)
+  {
+  case HDC_1080_ADD:
+    transfers[0] = (nrf_twi_mngr_transfer_t)NRF_TWI_MNGR_WRITE(address, &TwiScan_HDC1080_Ids[0], 1, NRF_TWI_MNGR_NO_STOP);
+    transfers[1] = (nrf_twi_mngr_transfer_t)NRF_TWI_MNGR_READ(address, &probe->Data[0], 2, 0);
+    transfers[2] = (nrf_twi_mngr_transfer_t)NRF_TWI_MNGR_WRITE(address, &TwiScan_HDC1080_Ids[1], 1, NRF_TWI_MNGR_NO_STOP);
+    transfers[3] = (nrf_twi_mngr_transfer_t)NRF_TWI_MNGR_READ(address, &probe->Data[2], 2, 0);
+    count = 4;
+    break;
+  case DS1307_I2C_ADDR:
+    transfers[0] = (nrf_twi_mngr_transfer_t)NRF_TWI_MNGR_WRITE(address, &TwiScan_DS1307_Control, 1, NRF_TWI_MNGR_NO_STOP);
+    transfers[1] = (nrf_twi_mngr_transfer_t)NRF_TWI_MNGR_READ(address, &probe->Data[0], 1, 0);
+    count = 2;
+    break;
+  case TWI_SCAN_SSD1306_SA0_LOW:
+  case TWI_SCAN_SSD1306_SA0_HIGH:
+    transfers[0] = (nrf_twi_mngr_transfer_t)NRF_TWI_MNGR_WRITE(address, TwiScan_SSD1306_Nop, sizeof(TwiScan_SSD1306_Nop), 0);
+    count = 1;
+    break;
+  default:
+    transfers[0] = (nrf_twi_mngr_transfer_t)NRF_TWI_MNGR_READ(address, &probe->Data[0], 1, 0);
+    count = 1;
+    break;
+  }
+  probe->Transaction.callback = TwiScan_Done;
+  probe->Transaction.p_user_data = probe;
+  probe->Transaction.p_transfers = transfers;
+  probe->Transaction.number_of_transfers = count;
+  probe->Transaction.p_required_twi_cfg = NULL;
+}
+
+// Part that answered a probe
+static TWI_SCAN_PART TwiScan_Identify(const TWI_SCAN_PROBE *probe)
+{
+  switch (probe->Address)
+  {
+  case HDC_1080_ADD:
+    if ((probe->Data[0] << 8 | probe->Data[1]) == TWI_SCAN_HDC1080_MANUFACTURER_ID &&
+        (probe->Data[2] << 8 | probe->Data[3]) == TWI_SCAN_HDC1080_DEVICE_ID)
+    {
+      return TWI_SCAN_HDC1080;
+    }
+    break;
+  case DS1307_I2C_ADDR:
+    if ((probe->Data[0] & TWI_SCAN_DS1307_CONTROL_ZERO) == 0)
+    {
+      return TWI_SCAN_DS1307;
+    }
+    break;
+  case TWI_SCAN_SSD1306_SA0_LOW:
+  case TWI_SCAN_SSD1306_SA0_HIGH:
+    return TWI_SCAN_SSD1306;
+  default:
+    break;
+  }
+  return TWI_SCAN_UNKNOWN;
+}
+
+// Queues the next address on a free probe. When the manager queue is
+// full the address is left to the probes still queued.
+// @return 0 when the probe stays free
+static uint8_t TwiScan_Next(TWI_SCAN_PROBE *probe)
+{
+  TWI_SCAN *scan = probe->Scan;
+  ret_code_t err_code;
+
+  if (scan->Next > TWI_SCAN_LAST)
+  {
+    return 0;
+  }
+  TwiScan_Prepare(probe, scan->Next);
+  err_code = nrf_twi_mngr_schedule(scan->TWI, &probe->Transaction);
+  if (err_code != NRF_SUCCESS)
+  {
+    NRF_LOG_WARNING("TwiScan_Next - 0x%02x error: %d", probe->Address, (int)err_code);
+    return 0;
+  }
+  scan->Next++;
+  return 1;
+}
+
+static void TwiScan_Finish(TWI_SCAN *scan)
+{
+  if (scan->Next <= TWI_SCAN_LAST)
+  {
+    NRF_LOG_WARNING("TwiScan_Finish - not probed from 0x%02x", scan->Next);
+  }
+  scan->Duration = (uint32_t)((uint64_t)app_timer_cnt_diff_compute(app_timer_cnt_get(), scan->Start) * 1000000 / APP_TIMER_CLOCK_FREQ);
+  scan->Busy = 0;
+  if (scan->OnDone != NULL)
+  {
+    scan->OnDone(scan);
+  }
+}
+
+static void TwiScan_Done(ret_code_t result, void *p_user_data)
+{
+  TWI_SCAN_PROBE *probe = (TWI_SCAN_PROBE *)p_user_data;
+  TWI_SCAN *scan = probe->Scan;
+
+  if (result == NRF_SUCCESS)
+  {
+    scan->Parts[probe->Address] = TwiScan_Identify(probe);
+    scan->Found++;
+  }
+  if (TwiScan_Next(probe))
+  {
+    return;
+  }
+  if (--scan->Pending == 0)
+  {
+    TwiScan_Finish(scan);
+  }
+}
+
+ret_code_t TwiScan_Start(TWI_SCAN *scan, const nrf_twi_mngr_t *nrf_twi_mngr_t, TWI_SCAN_handler_t on_done)
+{
+  uint8_t i;
+
+  if (scan->Busy)
+  {
+    return NRF_ERROR_BUSY;
+  }
+  scan->TWI = nrf_twi_mngr_t;
+  scan->OnDone = on_done;
+  memset(scan->Parts, TWI_SCAN_NONE, sizeof(scan->Parts));
+  scan->Next = TWI_SCAN_FIRST;
+  scan->Found = 0;
+  scan->Pending = 0;
+  scan->Busy = 1;
+  scan->Start = app_timer_cnt_get();
+
+  // The first callbacks wait until the batch is queued
+  CRITICAL_REGION_ENTER();
+  for (i = 0; i < TWI_SCAN_BATCH; i++)
+  {
+    scan->Probes[i].Scan = scan;
+    if (TwiScan_Next(&scan->Probes[i]))
+    {
+      scan->Pending++;
+    }
+  }
+  CRITICAL_REGION_EXIT();
+
+  if (scan->Pending == 0)
+  {
+    TwiScan_Finish(scan);
+  }
+  return NRF_SUCCESS;
+}
+
+uint8_t TwiScan_Find(const TWI_SCAN *scan, TWI_SCAN_PART part)
+{
+  uint8_t address;
+
+  for (address = TWI_SCAN_FIRST; address <= TWI_SCAN_LAST; address++)
+  {
+    if (scan->Parts[address] == part)
+    {
+      return address;
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,78 @@
+/*
+ *      twi_scan.h
+ *
+ *	The MIT License.
+ */
+
+#ifndef __TWI_SCAN_H__
+#define __TWI_SCAN_H__
+
+#include "app_timer.h"
+#include "nrf_twi_mngr.h"
+
+// Addresses probed, 0x00-0x07 and 0x78-0x7F are reserved
+#define TWI_SCAN_FIRST (0x08)
+#define TWI_SCAN_LAST (0x77)
+
+// Probes in the TWI manager queue at a time
+#ifndef TWI_SCAN_BATCH
+#define TWI_SCAN_BATCH (8)
+#endif
+
+typedef enum
+{
+  TWI_SCAN_NONE,              // Nothing answers at the address
+  TWI_SCAN_UNKNOWN,           // Answers, and is none of the parts below
+  TWI_SCAN_DS1307,
+  TWI_SCAN_SSD1306,           // By its address, it has no ID to read
+  TWI_SCAN_HDC1080
+} TWI_SCAN_PART;
+
+typedef struct TWI_SCAN_s TWI_SCAN;
+
+// Called from the TWI callback of the last probe
+typedef void (*TWI_SCAN_handler_t)(TWI_SCAN *scan);
+
+// One address being probed. The known parts are asked for their ID in the
+// same transaction.
+typedef struct
+{
+  TWI_SCAN *Scan;
+  uint8_t Address;
+  uint8_t Data[4];
+  nrf_twi_mngr_transfer_t Transfers[4];
+  nrf_twi_mngr_transaction_t Transaction;
+} TWI_SCAN_PROBE;
+
+// Enumeration of the devices on a bus. nrf_twi_mngr ends a transaction at
+// its first NACK, so each address gets a transaction of its own, and
+// TWI_SCAN_BATCH of them are kept queued: the callback of a probe queues
+// the next address, and the bus goes from one to the next without
+// waiting for the CPU.
+struct TWI_SCAN_s
+{
+  const nrf_twi_mngr_t *TWI;
+  TWI_SCAN_handler_t OnDone;                 // Optional, may be NULL
+  uint8_t Parts[TWI_SCAN_LAST + 1];          // TWI_SCAN_PART by address
+  uint8_t Next;                              // Past TWI_SCAN_LAST when all were probed
+  uint8_t Found;                             // Addresses that answered
+  volatile uint8_t Pending;                  // Probes queued
+  volatile uint8_t Busy;
+  uint32_t Start;                            // app_timer tick the scan started
+  uint32_t Duration;                         // Of the last scan in us
+  TWI_SCAN_PROBE Probes[TWI_SCAN_BATCH];
+};
+
+/**
+ * @brief Probes every address of a bus and identifies the known parts.
+ * @note Busy is cleared when the scan is over, then OnDone is called.
+ * @return NRF_ERROR_BUSY if a scan of the instance is running.
+ */
+ret_code_t TwiScan_Start(TWI_SCAN *scan, const nrf_twi_mngr_t *nrf_twi_mngr_t, TWI_SCAN_handler_t on_done);
+/**
+ * @brief Looks a part up in the result of the last scan.
+ * @return Lowest address the part answered at, 0 if it was not found.
+ */
+uint8_t TwiScan_Find(const TWI_SCAN *scan, TWI_SCAN_PART part);
+
+#endif // __TWI_SCAN_H__
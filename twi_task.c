@@ -0,0 +1,144 @@
+/*
+ *      twi_task.c
+ *
+ *	The MIT License.
+ */
+
+#include <string.h>
+
+#include "twi_task.h"
+#include "app_util_platform.h"
+#include "nordic_common.h"
+
+// Run the body until it waits or ends. A wake-up that comes while the body
+// runs (a callback called from within the schedule) makes it run again
+// instead of nesting.
+static void TwiTask_Resume(TWI_TASK_t *task)
+{
+  PT_STATUS status;
+  uint8_t run = 0;
+
+  CRITICAL_REGION_ENTER();
+  if (task->Running)
+  {
+    task->Again = 1;
+  }
+  else
+  {
+    task->Running = 1;
+    run = 1;
+  }
+  CRITICAL_REGION_EXIT();
+
+  if (!run)
+  {
+    return;
+  }
+  while (run)
+  {
+    task->Again = 0;
+    status = task->Run(task);
+
+    CRITICAL_REGION_ENTER();
+    run = (status == PT_WAITING) && task->Again;
+    if (!run)
+    {
+      task->Running = 0;
+    }
+    CRITICAL_REGION_EXIT();
+  }
+
+  if (status == PT_ENDED)
+  {
+    task->Active = 0;
+    if (task->OnDone != NULL)
+    {
+      task->OnDone(task);
+    }
+  }
+}
+
+static void TwiTask_TransactionDone(ret_code_t result, void *p_user_data)
+{
+  TWI_TASK_t *task = (TWI_TASK_t *)p_user_data;
+
+  task->Result = result;
+  task->Waiting = 0;
+  TwiTask_Resume(task);
+}
+
+static void TwiTask_TimerHandler(void *p_context)
+{
+  TWI_TASK_t *task = (TWI_TASK_t *)p_context;
+
+  task->Result = NRF_SUCCESS;
+  task->Waiting = 0;
+  TwiTask_Resume(task);
+}
+
+ret_code_t TwiTask_Init(TWI_TASK_t *task, const nrf_twi_mngr_t *nrf_twi_mngr_t)
+{
+  memset(task, 0, sizeof(*task));
+  task->TWI = nrf_twi_mngr_t;
+  task->Timer = &task->TimerData;
+  return app_timer_create(&task->Timer, APP_TIMER_MODE_SINGLE_SHOT, TwiTask_TimerHandler);
+}
+
+ret_code_t TwiTask_Start(TWI_TASK_t *task, TWI_TASK_fn run, void *context, TWI_TASK_handler_t on_done)
+{
+  if (task->Active)
+  {
+    return NRF_ERROR_BUSY;
+  }
+  PT_INIT(&task->PT);
+  task->Run = run;
+  task->Context = context;
+  task->OnDone = on_done;
+  task->Result = NRF_SUCCESS;
+  task->Waiting = 0;
+  task->Active = 1;
+  TwiTask_Resume(task);
+  return NRF_SUCCESS;
+}
+
+void TwiTask_Schedule(TWI_TASK_t *task, const nrf_twi_mngr_transfer_t *p_transfers, uint8_t number_of_transfers)
+{
+  ret_code_t err_code;
+  uint8_t i;
+
+  if (number_of_transfers > TWI_TASK_MAX_TRANSFERS)
+  {
+    task->Result = NRF_ERROR_INVALID_LENGTH;
+    return;
+  }
+  for (i = 0; i < number_of_transfers; i++)
+  {
+    task->Transfers[i] = p_transfers[i];
+  }
+  task->Transaction.callback = TwiTask_TransactionDone;
+  task->Transaction.p_user_data = task;
+  task->Transaction.p_transfers = task->Transfers;
+  task->Transaction.number_of_transfers = number_of_transfers;
+  task->Transaction.p_required_twi_cfg = NULL;
+  task->Waiting = 1;
+
+  err_code = nrf_twi_mngr_schedule(task->TWI, &task->Transaction);
+  if (err_code != NRF_SUCCESS)
+  {
+    task->Result = err_code;
+    task->Waiting = 0;
+  }
+}
+
+void TwiTask_Sleep(TWI_TASK_t *task, uint32_t ticks)
+{
+  ret_code_t err_code;
+
+  task->Waiting = 1;
+  err_code = app_timer_start(task->Timer, MAX(ticks, APP_TIMER_MIN_TIMEOUT_TICKS), task);
+  if (err_code != NRF_SUCCESS)
+  {
+    task->Result = err_code;
+    task->Waiting = 0;
+  }
+}
@@ -0,0 +1,86 @@
+/*
+ *      twi_task.h
+ *
+ *	The MIT License.
+ */
+
+#ifndef __TWI_TASK_H__
+#define __TWI_TASK_H__
+
+#include "app_timer.h"
+#include "app_util.h"
+#include "nrf_twi_mngr.h"
+#include "pt.h"
+
+// Most transfers in one awaited transaction
+#ifndef TWI_TASK_MAX_TRANSFERS
+#define TWI_TASK_MAX_TRANSFERS (3)
+#endif
+
+typedef struct TWI_TASK_s TWI_TASK_t;
+
+// Task body, a protothread between TWI_TASK_BEGIN and TWI_TASK_END
+typedef PT_STATUS (*TWI_TASK_fn)(TWI_TASK_t *task);
+// Called when the body has ended
+typedef void (*TWI_TASK_handler_t)(TWI_TASK_t *task);
+
+// A multi-step TWI sequence written as straight-line code. The body suspends
+// on TWI_TASK_AWAIT until its transaction is done and on TWI_TASK_SLEEP
+// until its timer expires, and is resumed from the TWI manager callback or
+// the app_timer handler. The CPU is never blocked.
+struct TWI_TASK_s
+{
+  pt_t PT;
+  TWI_TASK_fn Run;
+  TWI_TASK_handler_t OnDone;                 // Optional, may be NULL
+  void *Context;                             // Device the body works on
+  const nrf_twi_mngr_t *TWI;
+  nrf_twi_mngr_transfer_t Transfers[TWI_TASK_MAX_TRANSFERS];
+  nrf_twi_mngr_transaction_t Transaction;
+  app_timer_t TimerData;
+  app_timer_id_t Timer;
+  volatile ret_code_t Result;                // Result of the last await
+  volatile uint8_t Waiting;                  // Suspended on a transaction or the timer
+  volatile uint8_t Active;                   // Started and not ended
+  volatile uint8_t Running;                  // Body is executing
+  volatile uint8_t Again;                    // Woken while executing, run again
+};
+
+#define TWI_TASK_BEGIN(task) PT_BEGIN(&(task)->PT)
+#define TWI_TASK_END(task) PT_END(&(task)->PT)
+
+// Schedule the listed transfers as one transaction and wait for it,
+// the result is then in task->Result. Buffers must outlive the wait.
+#define TWI_TASK_AWAIT(task, ...)                                     \
+  do                                                                  \
+  {                                                                   \
+    {                                                                 \
+      nrf_twi_mngr_transfer_t const _transfers[] = {__VA_ARGS__};     \
+      TwiTask_Schedule((task), _transfers, ARRAY_SIZE(_transfers));   \
+    }                                                                 \
+    PT_WAIT_UNTIL(&(task)->PT, !(task)->Waiting);                     \
+  } while (0)
+
+// Wait the given number of app_timer ticks
+#define TWI_TASK_SLEEP(task, ticks)                                   \
+  do                                                                  \
+  {                                                                   \
+    TwiTask_Sleep((task), (ticks));                                   \
+    PT_WAIT_UNTIL(&(task)->PT, !(task)->Waiting);                     \
+  } while (0)
+
+/**
+ * @brief Sets up a task and creates its timer.
+ */
+ret_code_t TwiTask_Init(TWI_TASK_t *task, const nrf_twi_mngr_t *nrf_twi_mngr_t);
+/**
+ * @brief Runs a body on the task until its first wait.
+ * @return NRF_ERROR_BUSY if the task is still running a body.
+ */
+ret_code_t TwiTask_Start(TWI_TASK_t *task, TWI_TASK_fn run, void *context, TWI_TASK_handler_t on_done);
+
+// Used by the macros above
+void TwiTask_Schedule(TWI_TASK_t *task, const nrf_twi_mngr_transfer_t *p_transfers, uint8_t number_of_transfers);
+void TwiTask_Sleep(TWI_TASK_t *task, uint32_t ticks);
+
+#endif // __TWI_TASK_H__